@@ -127,6 +127,10 @@ void SerializerJson::visit(SqlitePointRecord &pr) {
   this->visit((DbPointRecord&)pr);
   _v[_c] = JSV("sqlite");
 }
+void SerializerJson::visit(ColumnarPointRecord &pr) {
+  this->visit((DbPointRecord&)pr);
+  _v[_c] = JSV("columnar");
+}
 void SerializerJson::visit(InfluxDbPointRecord &pr) {
   this->visit((DbPointRecord&)pr);
   _v[_c] = JSV("influx");
@@ -141,6 +145,8 @@ void SerializerJson::visit(OdbcPointRecord &pr) {
   _v["driver"] = JSV(pr.driver());
   _v["meta"] = JSV(pr.metaQuery());
   _v["range"] = JSV(pr.rangeQuery());
+  _v["wideRangeQuery"] = JSV(pr.wideRangeQuery());
+  _v["maxConnections"] = JSV(pr.maxConnections());
   
   for (auto z : _odbc_zone_strings()) {
     if (z.second == pr.timeFormat()) {
@@ -153,6 +159,7 @@ void SerializerJson::visit(PiPointRecord &pr) {
   _v[_c] = JSV("pi");
   _v["tagSearchPath"] = JSV(pr.tagSearchPath());
   _v["conversions"] = JSV(pr.conversions());
+  _v["webIdCachePath"] = JSV(pr.webIdCachePath());
 }
 
 
@@ -178,6 +185,7 @@ RTX_object::_sp DeserializerJson::from_json(JSV json) {
   if (json.is_object()) {
     map< string, std::function<RTX_object::_sp()> > c = { // c is for "CREATOR"
       { "sqlite",     &_newRtxObj<SqlitePointRecord>},
+      { "columnar",   &_newRtxObj<ColumnarPointRecord>},
       { "influx",     &_newRtxObj<InfluxDbPointRecord>},
       { "influx_udp", &_newRtxObj<InfluxUdpPointRecord>},
       { "odbc",       &_newRtxObj<OdbcPointRecord>},
@@ -267,6 +275,9 @@ void DeserializerJson::visit(DbPointRecord &pr) {
 void DeserializerJson::visit(SqlitePointRecord &pr) {
   this->visit((DbPointRecord&)pr);
 };
+void DeserializerJson::visit(ColumnarPointRecord &pr) {
+  this->visit((DbPointRecord&)pr);
+};
 void DeserializerJson::visit(InfluxDbPointRecord &pr) {
   this->visit((DbPointRecord&)pr);
 };
@@ -280,6 +291,13 @@ void DeserializerJson::visit(OdbcPointRecord &pr) {
   pr.setDriver(o.at("driver").as_string());
   pr.setMetaQuery(o.at("meta").as_string());
   pr.setRangeQuery(o.at("range").as_string());
+  // optional, for configurations saved before these were added
+  if (_v.has_field("wideRangeQuery")) {
+    pr.setWideRangeQuery(_v["wideRangeQuery"].as_string());
+  }
+  if (_v.has_field("maxConnections")) {
+    pr.setMaxConnections(_v["maxConnections"].as_integer());
+  }
   
   string thisTF = o.at("zone").as_string();
   map<string, PointRecordTime::time_format_t> tf = _odbc_zone_strings();
@@ -295,6 +313,9 @@ void DeserializerJson::visit(PiPointRecord &pr) {
   if (_v.has_field("conversions")) {
     pr.setConversions(_v["conversions"].as_string());
   }
+  if (_v.has_field("webIdCachePath")) {
+    pr.setWebIdCachePath(_v["webIdCachePath"].as_string());
+  }
 }
 
 
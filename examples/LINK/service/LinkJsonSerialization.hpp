@@ -20,6 +20,7 @@ namespace RTX {
   public Visitor<PointRecord>,
   public Visitor<DbPointRecord>,
   public Visitor<SqlitePointRecord>,
+  public Visitor<ColumnarPointRecord>,
   public Visitor<InfluxDbPointRecord>,
   public Visitor<InfluxUdpPointRecord>,
   public Visitor<OdbcPointRecord>,
@@ -38,6 +39,7 @@ namespace RTX {
     void visit(PointRecord &pr);
     void visit(DbPointRecord &pr);
     void visit(SqlitePointRecord &pr);
+    void visit(ColumnarPointRecord &pr);
     void visit(InfluxDbPointRecord &pr);
     void visit(InfluxUdpPointRecord &pr);
     void visit(OdbcPointRecord &pr);
@@ -57,6 +59,7 @@ namespace RTX {
   public Visitor<PointRecord>,
   public Visitor<DbPointRecord>,
   public Visitor<SqlitePointRecord>,
+  public Visitor<ColumnarPointRecord>,
   public Visitor<InfluxDbPointRecord>,
   public Visitor<InfluxUdpPointRecord>,
   public Visitor<OdbcPointRecord>,
@@ -77,6 +80,7 @@ namespace RTX {
     void visit(PointRecord &pr);
     void visit(DbPointRecord &pr);
     void visit(SqlitePointRecord &pr);
+    void visit(ColumnarPointRecord &pr);
     void visit(InfluxDbPointRecord &pr);
     void visit(InfluxUdpPointRecord &pr);
     void visit(OdbcPointRecord &pr);
@@ -0,0 +1,76 @@
+#include "BoundaryTable.h"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <set>
+
+#include "DbPointRecord.h"
+
+using namespace std;
+using namespace RTX;
+
+#define RTX_BOUNDARY_LOOKBACK (12*60*60) // raw history fetched ahead of the window, for filters that look back
+
+BoundaryTable::BoundaryTable(const vector<TimeSeries::_sp>& series, TimeRange window) : _window(window) {
+
+  // one batched query per database record for every raw series under the boundary series
+  map<DbPointRecord::_sp, set<string> > rootsByRecord;
+  for (const TimeSeries::_sp& ts : series) {
+    for (const TimeSeries::_sp& root : ts->rootTimeSeries()) {
+      DbPointRecord::_sp dbRecord = dynamic_pointer_cast<DbPointRecord>(root->record());
+      if (dbRecord) {
+        rootsByRecord[dbRecord].insert(root->name());
+      }
+    }
+  }
+  const TimeRange fetchRange(window.start - RTX_BOUNDARY_LOOKBACK, window.end);
+  for (auto& recordRoots : rootsByRecord) {
+    recordRoots.first->willQuery(vector<string>(recordRoots.second.begin(), recordRoots.second.end()), fetchRange);
+  }
+
+  // then evaluate each series once over the window, from cache
+  for (const TimeSeries::_sp& ts : series) {
+    Column c;
+    c.series = ts;
+    try {
+      Point seed = ts->pointAtOrBefore(window.start);
+      vector<Point> points = ts->points(window);
+      if (seed.isValid && (points.empty() || seed.time < points.front().time)) {
+        c.points.reserve(points.size() + 1);
+        c.points.push_back(seed);
+      }
+      c.points.insert(c.points.end(), points.begin(), points.end());
+    } catch (...) {
+      cerr << "boundary table: could not read " << ts->name() << endl;
+      continue; // looked up from the series instead
+    }
+    c.cursor = c.points.size();
+    _columns[ts.get()] = std::move(c);
+  }
+}
+
+Point BoundaryTable::pointAtOrBefore(const TimeSeries::_sp& ts, time_t time) {
+  auto found = _columns.find(ts.get());
+  if (found == _columns.end() || !_window.contains(time)) {
+    return ts->pointAtOrBefore(time);
+  }
+  Column& c = found->second;
+  const vector<Point>& points = c.points;
+
+  if (c.cursor < points.size() && points[c.cursor].time <= time) {
+    // forward from the last lookup: the usual case
+    while (c.cursor + 1 < points.size() && points[c.cursor + 1].time <= time) {
+      ++c.cursor;
+    }
+  }
+  else {
+    auto after = upper_bound(points.begin(), points.end(), time, [](time_t t, const Point& p) { return t < p.time; });
+    c.cursor = (after == points.begin()) ? points.size() : (size_t)(after - points.begin()) - 1;
+  }
+
+  if (c.cursor == points.size()) {
+    return Point();
+  }
+  return points[c.cursor];
+}
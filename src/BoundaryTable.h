@@ -0,0 +1,39 @@
+#ifndef BoundaryTable_h
+#define BoundaryTable_h
+
+#include <stdio.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "TimeSeries.h"
+#include "TimeRange.h"
+
+// points of many series over one window, held in memory for step-by-step lookups. the raw series
+// underneath are fetched per record in batched multi-series queries, then each series is evaluated
+// once over the whole window. lookups in increasing time advance a cursor; anything outside the
+// window or for a series not in the table goes to the series itself.
+
+namespace RTX {
+  class BoundaryTable {
+  public:
+    typedef std::shared_ptr<BoundaryTable> _sp;
+    BoundaryTable(const std::vector<TimeSeries::_sp>& series, TimeRange window);
+
+    const TimeRange& window() const {return _window;};
+    bool contains(time_t time) const {return _window.contains(time);};
+    Point pointAtOrBefore(const TimeSeries::_sp& ts, time_t time);
+
+  private:
+    class Column {
+    public:
+      TimeSeries::_sp series;
+      std::vector<Point> points; // time-ordered. the first may precede the window.
+      size_t cursor; // index of the last point at or before the previous lookup, or points.size()
+    };
+    TimeRange _window;
+    std::unordered_map<TimeSeries*, Column> _columns;
+  };
+}
+
+#endif /* BoundaryTable_h */
@@ -37,7 +37,11 @@ std::ostream& BufferPointRecord::toStream(std::ostream &stream) {
 
 bool BufferPointRecord::registerAndGetIdentifierForSeriesWithUnits(std::string recordName, Units units) {
   // register the recordName internally and generate a buffer and mutex
+  const size_t key = SeriesHandle::intern(recordName)->key();
   std::lock_guard lock(_buffer_readwrite); // get a write lock
+  if (_buffersByKey.size() <= key) {
+    _buffersByKey.resize(key + 1, NULL);
+  }
   if (_keyedBuffers.find(recordName) != _keyedBuffers.end()) {
     // got the name - do the units match?
     Buffer b = _keyedBuffers[recordName];
@@ -46,6 +50,7 @@ bool BufferPointRecord::registerAndGetIdentifierForSeriesWithUnits(std::string r
       return true;
     }
     else {
+      _buffersByKey[key] = NULL;
       _keyedBuffers.erase(recordName);
     }
   }
@@ -56,6 +61,7 @@ bool BufferPointRecord::registerAndGetIdentifierForSeriesWithUnits(std::string r
     b.circularBuffer.set_capacity(_defaultCapacity);
     b.units = units;
     _keyedBuffers[recordName] = b;
+    _buffersByKey[key] = &_keyedBuffers[recordName];
   }
   
   return true;
@@ -70,6 +76,16 @@ IdentifierUnitsList BufferPointRecord::identifiersAndUnits() {
   return list;
 }
 
+BufferPointRecord::Buffer* BufferPointRecord::bufferFor(const string& identifier) {
+  auto it = _keyedBuffers.find(identifier);
+  return (it == _keyedBuffers.end()) ? NULL : &(it->second);
+}
+
+BufferPointRecord::Buffer* BufferPointRecord::bufferFor(const SeriesHandle& series) {
+  return (series.key() < _buffersByKey.size()) ? _buffersByKey[series.key()] : NULL;
+}
+
+
 Point BufferPointRecord::point(const string& identifier, time_t time) {
   
   Point bp = PointRecord::point(identifier,time);
@@ -79,14 +95,25 @@ Point BufferPointRecord::point(const string& identifier, time_t time) {
   
   std::shared_lock lock(_buffer_readwrite); // get a read lock
   
-  auto it = _keyedBuffers.find(identifier);
-  if (it == _keyedBuffers.end()) {
+  Buffer *b = this->bufferFor(identifier);
+  if (!b) {
     // nobody here by that name
     return Point();
   }
-  
-  // get the constituents
-  PointBuffer& buffer = (it->second.circularBuffer);
+  Point p = pointIn(b->circularBuffer, time);
+  if (p.isValid) {
+    PointRecord::addPoint(identifier, p);
+  }
+  return p;
+}
+
+Point BufferPointRecord::point(const SeriesHandle& series, time_t time) {
+  std::shared_lock lock(_buffer_readwrite); // get a read lock
+  Buffer *b = this->bufferFor(series);
+  return b ? pointIn(b->circularBuffer, time) : Point();
+}
+
+Point BufferPointRecord::pointIn(PointBuffer& buffer, time_t time) {
   
   if (buffer.empty()) {
     return Point();
@@ -101,16 +128,10 @@ Point BufferPointRecord::point(const string& identifier, time_t time) {
     PointBuffer::iterator startIterator = buffer.begin();
     PointBuffer::iterator pbIt = std::lower_bound(startIterator, buffer.end(), finder, &Point::comparePointTime);
     if (pbIt != buffer.end() && pbIt->time == time) {
-      Point p = *pbIt;
-      PointRecord::addPoint(identifier, p);
-      return p;
-    }
-    else {
-      return Point();
+      return *pbIt;
     }
   }
   
-  
   return Point();
 }
 
@@ -120,10 +141,28 @@ Point BufferPointRecord::pointBefore(const string& identifier, time_t time, Wher
   
   std::shared_lock lock(_buffer_readwrite); // get a read lock
   
+  Buffer *b = this->bufferFor(identifier);
+  if (!b) {
+    return Point();
+  }
+  Point foundPoint = pointBeforeIn(b->circularBuffer, time, q);
+  if (foundPoint.isValid) {
+    PointRecord::addPoint(identifier, foundPoint);
+  }
+  return foundPoint;
+}
+
+Point BufferPointRecord::pointBefore(const SeriesHandle& series, time_t time, WhereClause q) {
+  std::shared_lock lock(_buffer_readwrite); // get a read lock
+  Buffer *b = this->bufferFor(series);
+  return b ? pointBeforeIn(b->circularBuffer, time, q) : Point();
+}
+
+Point BufferPointRecord::pointBeforeIn(PointBuffer& buffer, time_t time, WhereClause& q) {
+  
   Point foundPoint;
   
-  auto vRange = this->range(identifier);
-  if (!vRange.contains(time)) {
+  if (buffer.empty() || !TimeRange(buffer.front().time, buffer.back().time).contains(time)) {
     // don't bother if its' not in range
     return foundPoint;
   }
@@ -131,42 +170,32 @@ Point BufferPointRecord::pointBefore(const string& identifier, time_t time, Wher
   //TimePointPair_t finder(time, PointPair_t(0,0));
   Point finder(time, 0);
   
-  auto it = _keyedBuffers.find(identifier);
-  if (it != _keyedBuffers.end()) {
-    // get the constituents
-    PointBuffer& buffer = (it->second.circularBuffer);
-    
-    PointBuffer::const_iterator it  = lower_bound(buffer.begin(), buffer.end(), finder, &Point::comparePointTime);
-    if (it != buffer.begin()) {
-      // we're not at the beginning, so there is a point before time
-      if (it != buffer.end()) {
-        // and we're not at the end, so the point is within the continuous buffer
-        // we want the previous point
-        foundPoint = *(--it);
-        PointRecord::addPoint(identifier, foundPoint);
-      }
-      else if ((--it)->time == time - 1) {
-        // edge case where end of buffer is adjacent to requested time
-        foundPoint = *it;
-        PointRecord::addPoint(identifier, foundPoint);
-      }
+  PointBuffer::const_iterator it  = lower_bound(buffer.begin(), buffer.end(), finder, &Point::comparePointTime);
+  if (it != buffer.begin()) {
+    // we're not at the beginning, so there is a point before time
+    if (it != buffer.end()) {
+      // and we're not at the end, so the point is within the continuous buffer
+      // we want the previous point
+      foundPoint = *(--it);
     }
-    
-    if (q.clauses.empty()) {
-      return foundPoint;
+    else if ((--it)->time == time - 1) {
+      // edge case where end of buffer is adjacent to requested time
+      foundPoint = *it;
     }
-    else {
-      // there is a clause! use the time-bound point to start looking back...
-      while (it != buffer.begin() && !q.filter(*it)) {
-        --it;
-      }
-      if (it != buffer.begin()) {
-        foundPoint = *it;
-        PointRecord::addPoint(identifier, foundPoint);
-        return foundPoint;
-      }
+  }
+  
+  if (q.clauses.empty()) {
+    return foundPoint;
+  }
+  else {
+    // there is a clause! use the time-bound point to start looking back...
+    while (it != buffer.begin() && !q.filter(*it)) {
+      --it;
+    }
+    if (it != buffer.begin()) {
+      foundPoint = *it;
+      return foundPoint;
     }
-    
   }
   
   return foundPoint;
@@ -177,10 +206,28 @@ Point BufferPointRecord::pointAfter(const string& identifier, time_t time, Where
   
   std::shared_lock lock(_buffer_readwrite); // get a read lock
   
+  Buffer *b = this->bufferFor(identifier);
+  if (!b) {
+    return Point();
+  }
+  Point foundPoint = pointAfterIn(b->circularBuffer, time, q);
+  if (foundPoint.isValid) {
+    PointRecord::addPoint(identifier, foundPoint); // single point cache layer
+  }
+  return foundPoint;
+}
+
+Point BufferPointRecord::pointAfter(const SeriesHandle& series, time_t time, WhereClause q) {
+  std::shared_lock lock(_buffer_readwrite); // get a read lock
+  Buffer *b = this->bufferFor(series);
+  return b ? pointAfterIn(b->circularBuffer, time, q) : Point();
+}
+
+Point BufferPointRecord::pointAfterIn(PointBuffer& buffer, time_t time, WhereClause& q) {
+  
   Point foundPoint;
   
-  auto vRange = this->range(identifier);
-  if (!vRange.contains(time)) {
+  if (buffer.empty() || !TimeRange(buffer.front().time, buffer.back().time).contains(time)) {
     // don't bother if its' not in range
     return foundPoint;
   }
@@ -188,38 +235,29 @@ Point BufferPointRecord::pointAfter(const string& identifier, time_t time, Where
   //TimePointPair_t finder(time, PointPair_t(0,0));
   Point finder(time, 0);
   
-  auto it = _keyedBuffers.find(identifier);
-  if (it != _keyedBuffers.end()) {
-    // get the constituents
-    PointBuffer& buffer = (it->second.circularBuffer);
-    
-    PointBuffer::const_iterator it = upper_bound(buffer.begin(), buffer.end(), finder, &Point::comparePointTime);
-    if (it != buffer.end()) {
-      // OK we're not at the end, so there is a point after time
-      if (it != buffer.begin() || (it->time == time + 1)) {
-        // exclude the first point of the buffer, since this means that the requested time is outside my range.
-        // either we're not at the beginning, so the point is within the continuous buffer -
-        // or edge case where beginning of buffer is adjacent to requested time
-        foundPoint = *it;
-        PointRecord::addPoint(identifier, foundPoint); // single point cache layer
-      }
+  PointBuffer::const_iterator it = upper_bound(buffer.begin(), buffer.end(), finder, &Point::comparePointTime);
+  if (it != buffer.end()) {
+    // OK we're not at the end, so there is a point after time
+    if (it != buffer.begin() || (it->time == time + 1)) {
+      // exclude the first point of the buffer, since this means that the requested time is outside my range.
+      // either we're not at the beginning, so the point is within the continuous buffer -
+      // or edge case where beginning of buffer is adjacent to requested time
+      foundPoint = *it;
     }
-    
-    if (q.clauses.empty()) {
-      return foundPoint;
+  }
+  
+  if (q.clauses.empty()) {
+    return foundPoint;
+  }
+  else {
+    // there is a clause! use the time-bound point to start looking back...
+    while (it != buffer.end() && !q.filter(*it)) {
+      ++it;
     }
-    else {
-      // there is a clause! use the time-bound point to start looking back...
-      while (it != buffer.end() && !q.filter(*it)) {
-        ++it;
-      }
-      if (it != buffer.end()) {
-        foundPoint = *it;
-        PointRecord::addPoint(identifier, foundPoint);
-        return foundPoint;
-      }
+    if (it != buffer.end()) {
+      foundPoint = *it;
+      return foundPoint;
     }
-    
   }
   
   return foundPoint;
@@ -227,26 +265,27 @@ Point BufferPointRecord::pointAfter(const string& identifier, time_t time, Where
 
 
 std::vector<Point> BufferPointRecord::pointsInRange(const string& identifier, TimeRange range) {
-  
   std::shared_lock lock(_buffer_readwrite); // get a read lock
+  Buffer *b = this->bufferFor(identifier);
+  return b ? pointsIn(b->circularBuffer, range) : std::vector<Point>();
+}
+
+std::vector<Point> BufferPointRecord::pointsInRange(const SeriesHandle& series, TimeRange range) {
+  std::shared_lock lock(_buffer_readwrite); // get a read lock
+  Buffer *b = this->bufferFor(series);
+  return b ? pointsIn(b->circularBuffer, range) : std::vector<Point>();
+}
+
+std::vector<Point> BufferPointRecord::pointsIn(PointBuffer& buffer, TimeRange range) {
   
   std::vector<Point> pointVector;
   
   //TimePointPair_t finder(startTime, PointPair_t(0,0));
   Point finder(range.start, 0);
   
-  auto it = _keyedBuffers.find(identifier);
-  if (it != _keyedBuffers.end()) {
-    // get the constituents
-    PointBuffer& buffer = (it->second.circularBuffer);
-    
-    PointBuffer::const_iterator it = lower_bound(buffer.begin(), buffer.end(), finder, &Point::comparePointTime);
-    while ( (it != buffer.end()) && (it->time <= range.end) ) {
-      Point newPoint = *it;
-      pointVector.push_back(newPoint);
-      it++;
-    }
-  }
+  PointBuffer::const_iterator it = lower_bound(buffer.begin(), buffer.end(), finder, &Point::comparePointTime);
+  PointBuffer::const_iterator last = upper_bound(it, buffer.cend(), Point(range.end, 0), &Point::comparePointTime);
+  pointVector.assign(it, last);
   
   return pointVector;
 }
@@ -269,99 +308,125 @@ void BufferPointRecord::addPoints(const string& identifier, std::vector<Point> p
   }
   
   std::lock_guard lock(_buffer_readwrite); // get a write lock
+  Buffer *b = this->bufferFor(identifier);
+  if (b) {
+    addPointsTo(b->circularBuffer, points);
+  }
+  //else {
+  //  DebugLog << "keyed buffer not found for id: " << identifier << EOL;
+  //}
+}
+
+void BufferPointRecord::addPoints(const SeriesHandle& series, std::vector<Point> points) {
+  if (points.size() == 0) {
+    return;
+  }
   
+  std::lock_guard lock(_buffer_readwrite); // get a write lock
+  Buffer *b = this->bufferFor(series);
+  if (b) {
+    addPointsTo(b->circularBuffer, points);
+  }
+}
+
+void BufferPointRecord::addPointsTo(PointBuffer& buffer, std::vector<Point>& points) {
   // check the cache size, and upgrade if needed.
-  auto it = _keyedBuffers.find(identifier);
-  if (it != _keyedBuffers.end()) {
-    PointBuffer& buffer = (it->second.circularBuffer);
-    size_t capacity = buffer.capacity();
-    if (capacity < points.size()) {
-      // plenty of room
-      buffer.set_capacity(points.size() + capacity);
-    }
-    
-    // figure out the insert order...
-    // if the set we're inserting has to be prepended to the buffer...
-    
-    time_t firstInsertionTime = points.front().time;
-    time_t lastInsertionTime = points.back().time;
-    
-    TimeRange existingRange = BufferPointRecord::range(identifier);
-    
-    // make sure they're in order
-    std::sort(points.begin(), points.end(), &Point::comparePointTime);
+  size_t capacity = buffer.capacity();
+  if (capacity < points.size()) {
+    // plenty of room
+    buffer.set_capacity(points.size() + capacity);
+  }
+  
+  // figure out the insert order...
+  // if the set we're inserting has to be prepended to the buffer...
+  
+  time_t firstInsertionTime = points.front().time;
+  time_t lastInsertionTime = points.back().time;
+  
+  TimeRange existingRange = buffer.empty() ? TimeRange(0,0) : TimeRange(buffer.front().time, buffer.back().time);
+  
+  // make sure they're in order
+  std::sort(points.begin(), points.end(), &Point::comparePointTime);
+  
+  // scoped for clarity
+  {
+    // more gap detection? right on!
+    bool gap = true;
     
-    // scoped for clarity
-    {
-      // more gap detection? right on!
-      bool gap = true;
-      
-      if (firstInsertionTime <= existingRange.end && existingRange.end < lastInsertionTime) {
-        // some of these new points need to be inserted ono the end.
-        // fast-fwd along the new points vector, ignoring any points that will not be appended.
-        gap = false;
-        Point finder(existingRange.end, 0);
-        vector<Point>::const_iterator pIt = upper_bound(points.begin(), points.end(), finder, &Point::comparePointTime);
-        // now insert these trailing points.
-        while (pIt != points.end()) {
-          if (pIt->time > existingRange.end) {
-            //BufferPointRecord::addPoint(identifier, *pIt);
-            // append to circular buffer.
-            buffer.push_back(*pIt);
-          }
-          else {
-            cerr << "BufferPointRecord: inserted points not ordered correctly" << endl;
-          }
-          ++pIt;
+    if (firstInsertionTime <= existingRange.end && existingRange.end < lastInsertionTime) {
+      // some of these new points need to be inserted ono the end.
+      // fast-fwd along the new points vector, ignoring any points that will not be appended.
+      gap = false;
+      Point finder(existingRange.end, 0);
+      vector<Point>::const_iterator pIt = upper_bound(points.begin(), points.end(), finder, &Point::comparePointTime);
+      // now insert these trailing points.
+      while (pIt != points.end()) {
+        if (pIt->time > existingRange.end) {
+          //BufferPointRecord::addPoint(identifier, *pIt);
+          // append to circular buffer.
+          buffer.push_back(*pIt);
         }
-      } // appending
-      
-      if (firstInsertionTime < existingRange.start && existingRange.start <= lastInsertionTime) {
-        // some of the new points need to be pre-pended to the buffer.
-        // insert onto front (reverse iteration)
-        gap = false;
-        vector<Point>::const_reverse_iterator pIt = points.rbegin();
-
-        while (pIt != points.rend()) {
-          // make this smarter? using upper_bound maybe? todo - figure out upper_bound with a reverse_iterator
-          // skip overlapping points.
-          
-          if (pIt->time < existingRange.start) {
-            buffer.push_front(*pIt);
-          }
-          // else { /* skip */ }
-          
-          ++pIt;
+        else {
+          cerr << "BufferPointRecord: inserted points not ordered correctly" << endl;
         }
-      } // prepending
-      
-      if (existingRange.start <= firstInsertionTime && lastInsertionTime <= existingRange.end) {
-        // complete overlap -- why did we even try to add these?
-        gap = false;
-      } // complete overlap
-      
-      // gap means that the points we're trying to insert do not overlap the existing points.
-      // therefore, there's no guarantee of contiguity. so our only option is to clear out the existing cache
-      // and insert the new points all by themselves.
-      if (gap) {
-        // clear the buffer and set the capacity to something more conservative.
-        buffer.clear();
-        buffer.set_capacity(points.size());
+        ++pIt;
+      }
+    } // appending
+    
+    if (firstInsertionTime < existingRange.start && existingRange.start <= lastInsertionTime) {
+      // some of the new points need to be pre-pended to the buffer.
+      // insert onto front (reverse iteration)
+      gap = false;
+      vector<Point>::const_reverse_iterator pIt = points.rbegin();
+
+      while (pIt != points.rend()) {
+        // make this smarter? using upper_bound maybe? todo - figure out upper_bound with a reverse_iterator
+        // skip overlapping points.
         
-        // add new points.
-        for(const Point &p : points) {
-          buffer.push_back(p);
+        if (pIt->time < existingRange.start) {
+          buffer.push_front(*pIt);
         }
-      } // gap
-    }// scoped
-  }
-  //else {
-  //  DebugLog << "keyed buffer not found for id: " << identifier << EOL;
-  //}
+        // else { /* skip */ }
+        
+        ++pIt;
+      }
+    } // prepending
+    
+    if (existingRange.start <= firstInsertionTime && lastInsertionTime <= existingRange.end) {
+      // complete overlap -- why did we even try to add these?
+      gap = false;
+    } // complete overlap
+    
+    // gap means that the points we're trying to insert do not overlap the existing points.
+    // therefore, there's no guarantee of contiguity. so our only option is to clear out the existing cache
+    // and insert the new points all by themselves.
+    if (gap) {
+      // clear the buffer and set the capacity to something more conservative.
+      buffer.clear();
+      buffer.set_capacity(points.size());
+      
+      // add new points.
+      for(const Point &p : points) {
+        buffer.push_back(p);
+      }
+    } // gap
+  }// scoped
 }
 
 
 
+void BufferPointRecord::reserveCapacity(const string& identifier, size_t nAdditional) {
+  std::lock_guard lock(_buffer_readwrite); // get a write lock
+  auto it = _keyedBuffers.find(identifier);
+  if (it != _keyedBuffers.end()) {
+    PointBuffer& buffer = (it->second.circularBuffer);
+    if (buffer.size() + nAdditional > buffer.capacity()) {
+      buffer.set_capacity(buffer.size() + nAdditional);
+    }
+  }
+}
+
+
 void BufferPointRecord::reset() {
   for (auto kb : _keyedBuffers) {
     auto bufferName = kb.first;
@@ -415,3 +480,12 @@ Point BufferPointRecord::lastPoint(const string& id) {
 TimeRange BufferPointRecord::range(const string& id) {
   return TimeRange(BufferPointRecord::firstPoint(id).time, BufferPointRecord::lastPoint(id).time);
 }
+
+TimeRange BufferPointRecord::range(const SeriesHandle& series) {
+  std::shared_lock lock(_buffer_readwrite); // get a read lock
+  Buffer *b = this->bufferFor(series);
+  if (!b || b->circularBuffer.empty()) {
+    return TimeRange(0,0);
+  }
+  return TimeRange(b->circularBuffer.front().time, b->circularBuffer.back().time);
+}
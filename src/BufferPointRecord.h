@@ -52,6 +52,14 @@ namespace RTX {
     virtual void addPoint(const string& identifier, Point point);
     virtual void addPoints(const string& identifier, std::vector<Point> points);
     
+    // handle-keyed variants: no string lookups
+    virtual Point point(const SeriesHandle& series, time_t time);
+    virtual Point pointBefore(const SeriesHandle& series, time_t time, WhereClause q = WhereClause());
+    virtual Point pointAfter(const SeriesHandle& series, time_t time, WhereClause q = WhereClause());
+    virtual std::vector<Point> pointsInRange(const SeriesHandle& series, TimeRange range);
+    virtual void addPoints(const SeriesHandle& series, std::vector<Point> points);
+    virtual TimeRange range(const SeriesHandle& series);
+    
     virtual void reset();
     virtual void reset(const string& identifier);
     
@@ -59,6 +67,7 @@ namespace RTX {
     
     
   protected:
+    void reserveCapacity(const string& identifier, size_t nAdditional); // room to append without evicting
     
   private:
     typedef boost::circular_buffer<Point> PointBuffer;
@@ -68,6 +77,16 @@ namespace RTX {
       PointBuffer circularBuffer;
     };
     std::map<std::string, Buffer> _keyedBuffers;
+    std::vector<Buffer*> _buffersByKey; // series handle key -> entry in _keyedBuffers, set at registration
+    
+    // lookups and buffer operations; callers hold _buffer_readwrite
+    Buffer* bufferFor(const string& identifier);
+    Buffer* bufferFor(const SeriesHandle& series);
+    static Point pointIn(PointBuffer& buffer, time_t time);
+    static Point pointBeforeIn(PointBuffer& buffer, time_t time, WhereClause& q);
+    static Point pointAfterIn(PointBuffer& buffer, time_t time, WhereClause& q);
+    static std::vector<Point> pointsIn(PointBuffer& buffer, TimeRange range);
+    static void addPointsTo(PointBuffer& buffer, std::vector<Point>& points);
     size_t _defaultCapacity;
     std::shared_mutex _buffer_readwrite;
   };
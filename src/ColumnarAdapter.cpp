@@ -0,0 +1,635 @@
+#include "ColumnarAdapter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+#include <boost/filesystem.hpp>
+
+using namespace std;
+using namespace RTX;
+namespace fs = boost::filesystem;
+
+#define RTX_COLUMNAR_DEFAULT_SEGMENT_ROWS (1 << 20)
+#define RTX_COLUMNAR_INDEX_STRIDE 1024
+#define RTX_COLUMNAR_MAX_PENDING 50000
+#define RTX_COLUMNAR_SINGLE_BATCH 256 // single points held before a write
+#define RTX_COLUMNAR_SINGLE_DELAY 1 // seconds a single point may be held
+
+static const string _metaFileName("series.meta");
+static const string _colTime("time"), _colValue("value"), _colQuality("quality"), _colConfidence("confidence"), _colIndex("idx");
+static const vector< pair<string, size_t> > _dataColumns({ {_colTime, sizeof(int64_t)}, {_colValue, sizeof(double)}, {_colQuality, sizeof(uint8_t)}, {_colConfidence, sizeof(double)} }); // name, row width
+
+/******************************************************************************************/
+// segment helpers
+
+Point ColumnarAdapter::Segment::pointAt(size_t i) const {
+  const double *v = reinterpret_cast<const double*>(value.data());
+  const uint8_t *q = reinterpret_cast<const uint8_t*>(quality.data());
+  const double *c = reinterpret_cast<const double*>(confidence.data());
+  return Point((time_t)times()[i], v[i], Point::PointQuality(q[i]), c[i]);
+}
+
+size_t ColumnarAdapter::Segment::lowerBound(time_t t) const {
+  // the sparse index narrows the search to a single stride of the mapped time column
+  size_t k = std::lower_bound(sparseIndex.begin(), sparseIndex.end(), (int64_t)t) - sparseIndex.begin();
+  size_t lo = (k > 0) ? (k - 1) * RTX_COLUMNAR_INDEX_STRIDE : 0;
+  size_t hi = (k < sparseIndex.size()) ? std::min(k * RTX_COLUMNAR_INDEX_STRIDE, count) : count;
+  return std::lower_bound(times() + lo, times() + hi, (int64_t)t) - times();
+}
+
+size_t ColumnarAdapter::Segment::upperBound(time_t t) const {
+  size_t k = std::upper_bound(sparseIndex.begin(), sparseIndex.end(), (int64_t)t) - sparseIndex.begin();
+  size_t lo = (k > 0) ? (k - 1) * RTX_COLUMNAR_INDEX_STRIDE : 0;
+  size_t hi = (k < sparseIndex.size()) ? std::min(k * RTX_COLUMNAR_INDEX_STRIDE, count) : count;
+  return std::upper_bound(times() + lo, times() + hi, (int64_t)t) - times();
+}
+
+void ColumnarAdapter::Segment::unmap() {
+  for (auto col : {&time, &value, &quality, &confidence}) {
+    if (col->is_open()) {
+      col->close();
+    }
+  }
+  mappedCount = 0;
+}
+
+/******************************************************************************************/
+
+ColumnarAdapter::ColumnarAdapter( errCallback_t cb ) : DbAdapter(cb) {
+  _path = "";
+  basePath = "";
+  segmentCapacity = RTX_COLUMNAR_DEFAULT_SEGMENT_ROWS;
+  _inTransaction = false;
+  _metaDirty = false;
+  _nextUid = 1;
+  _connected = false;
+}
+ColumnarAdapter::~ColumnarAdapter() {
+  _RTX_DB_SCOPED_LOCK;
+  if (_connected) {
+    try {
+      this->flushAll();
+      if (_metaDirty) {
+        this->saveMeta();
+      }
+    } catch (exception& e) {
+      cerr << "could not flush columnar store: " << e.what() << endl;
+    }
+  }
+}
+
+const DbAdapter::adapterOptions ColumnarAdapter::options() const {
+  DbAdapter::adapterOptions o;
+
+  o.canAssignUnits = true;
+  o.supportsUnitsColumn = true;
+  o.searchIteratively = false;
+  o.supportsSinglyBoundQuery = true;
+  o.implementationReadonly = false;
+  o.canDoWideQuery = false;
+
+  return o;
+}
+
+std::string ColumnarAdapter::connectionString() {
+  return _path;
+}
+void ColumnarAdapter::setConnectionString(const std::string& con) {
+  _path = con;
+}
+
+void ColumnarAdapter::doConnect() {
+  _RTX_DB_SCOPED_LOCK;
+
+  if (RTX_STRINGS_ARE_EQUAL(_path, "")) {
+    _errCallback("No Directory Specified");
+    return;
+  }
+
+  fs::path root(this->basePath);
+  root /= _path;
+  _rootDir = root.string();
+
+  boost::system::error_code ec;
+  if (!fs::exists(root)) {
+    fs::create_directories(root, ec);
+  }
+  if (ec || !fs::is_directory(root)) {
+    string err = "could not open or create the archive directory: " + _rootDir;
+    throw runtime_error(err);
+  }
+
+  this->loadMeta();
+
+  _errCallback("OK");
+  _connected = true;
+}
+
+
+IdentifierUnitsList ColumnarAdapter::idUnitsList() {
+  _RTX_DB_SCOPED_LOCK;
+  IdentifierUnitsList ids;
+  for (auto& s : _series) {
+    ids.set(s.first, s.second->units);
+  }
+  return ids;
+}
+
+// TRANSACTIONS
+void ColumnarAdapter::beginTransaction() {
+  _RTX_DB_SCOPED_LOCK;
+  _inTransaction = true;
+}
+void ColumnarAdapter::endTransaction() {
+  _RTX_DB_SCOPED_LOCK;
+  if (_inTransaction) {
+    this->flushAll();
+    if (_metaDirty) {
+      this->saveMeta();
+    }
+    _inTransaction = false;
+  }
+}
+
+// READ
+std::vector<Point> ColumnarAdapter::selectRange(const std::string& id, TimeRange range) {
+  vector<Point> points;
+  _RTX_DB_SCOPED_LOCK;
+
+  Series_sp s = this->seriesNamed(id);
+  if (!s) {
+    return points;
+  }
+  this->flush(s);
+
+  for (auto seg : s->segments) {
+    if (seg->count == 0 || seg->last < range.start || seg->first > range.end) {
+      continue;
+    }
+    if (!this->mapSegment(s, seg)) {
+      continue;
+    }
+    size_t i = seg->lowerBound(range.start);
+    size_t j = seg->upperBound(range.end);
+    points.reserve(points.size() + (j - i));
+    for (; i < j; ++i) {
+      points.push_back(seg->pointAt(i));
+    }
+  }
+
+  return points;
+}
+
+Point ColumnarAdapter::selectNext(const std::string& id, time_t time, WhereClause q) {
+  _RTX_DB_SCOPED_LOCK;
+
+  Series_sp s = this->seriesNamed(id);
+  if (!s) {
+    return Point();
+  }
+  this->flush(s);
+
+  for (auto seg : s->segments) {
+    if (seg->count == 0 || seg->last <= time || !this->mapSegment(s, seg)) {
+      continue;
+    }
+    for (size_t i = seg->upperBound(time); i < seg->count; ++i) {
+      Point p = seg->pointAt(i);
+      if (q.clauses.empty() || q.filter(p)) {
+        return p;
+      }
+    }
+  }
+  return Point();
+}
+
+Point ColumnarAdapter::selectPrevious(const std::string& id, time_t time, WhereClause q) {
+  _RTX_DB_SCOPED_LOCK;
+
+  Series_sp s = this->seriesNamed(id);
+  if (!s) {
+    return Point();
+  }
+  this->flush(s);
+
+  for (auto segIt = s->segments.rbegin(); segIt != s->segments.rend(); ++segIt) {
+    Segment_sp seg = *segIt;
+    if (seg->count == 0 || seg->first >= time || !this->mapSegment(s, seg)) {
+      continue;
+    }
+    size_t i = seg->lowerBound(time);
+    while (i > 0) {
+      --i;
+      Point p = seg->pointAt(i);
+      if (q.clauses.empty() || q.filter(p)) {
+        return p;
+      }
+    }
+  }
+  return Point();
+}
+
+// CREATE
+bool ColumnarAdapter::insertIdentifierAndUnits(const std::string& id, Units units) {
+  _RTX_DB_SCOPED_LOCK;
+
+  if (_series.count(id) > 0) {
+    return true;
+  }
+
+  Series_sp s(new Series);
+  s->uid = _nextUid++;
+  s->name = id;
+  s->units = units;
+
+  boost::system::error_code ec;
+  fs::create_directories(this->seriesDir(s), ec);
+  if (ec) {
+    cerr << "could not create series" << endl;
+    return false;
+  }
+  _series[id] = s;
+
+  _metaDirty = true;
+  if (!_inTransaction) {
+    this->saveMeta();
+  }
+  return true;
+}
+
+void ColumnarAdapter::insertSingle(const std::string& id, Point point) {
+  _RTX_DB_SCOPED_LOCK;
+
+  Series_sp s = this->seriesNamed(id);
+  if (!s) {
+    return;
+  }
+  this->append(s, {point});
+
+  // one point at a time is held back, so that a stream of them is written in batches
+  const time_t now = time(NULL);
+  if (s->pendingSince == 0) {
+    s->pendingSince = now;
+  }
+  if (!_inTransaction && (s->pending.size() >= RTX_COLUMNAR_SINGLE_BATCH || now - s->pendingSince >= RTX_COLUMNAR_SINGLE_DELAY)) {
+    this->flush(s);
+  }
+  else if (s->pending.size() >= RTX_COLUMNAR_MAX_PENDING) {
+    this->flush(s);
+  }
+}
+
+void ColumnarAdapter::insertRange(const std::string& id, std::vector<Point> points) {
+  _RTX_DB_SCOPED_LOCK;
+
+  Series_sp s = this->seriesNamed(id);
+  if (!s) {
+    return;
+  }
+  this->append(s, points);
+
+  if (!_inTransaction || s->pending.size() >= RTX_COLUMNAR_MAX_PENDING) {
+    this->flush(s);
+  }
+}
+
+void ColumnarAdapter::insertRows(const std::vector<std::pair<std::string, Point> >& rows) {
+  _RTX_DB_SCOPED_LOCK;
+
+  // group by series, keeping each series' rows in order, then write each series once
+  map<string, vector<Point> > bySeries;
+  for (const auto& row : rows) {
+    bySeries[row.first].push_back(row.second);
+  }
+  for (auto& seriesPoints : bySeries) {
+    Series_sp s = this->seriesNamed(seriesPoints.first);
+    if (!s) {
+      continue;
+    }
+    this->append(s, seriesPoints.second);
+    if (!_inTransaction || s->pending.size() >= RTX_COLUMNAR_MAX_PENDING) {
+      this->flush(s);
+    }
+  }
+}
+
+// UPDATE
+bool ColumnarAdapter::assignUnitsToRecord(const std::string& name, const Units& units) {
+  _RTX_DB_SCOPED_LOCK;
+  Series_sp s = this->seriesNamed(name);
+  if (!s) {
+    return false;
+  }
+  s->units = units;
+  this->saveMeta();
+  return true;
+}
+
+// DELETE
+void ColumnarAdapter::removeRecord(const std::string& id) {
+  _RTX_DB_SCOPED_LOCK;
+  Series_sp s = this->seriesNamed(id);
+  if (!s) {
+    return;
+  }
+  for (auto seg : s->segments) {
+    seg->unmap();
+  }
+  boost::system::error_code ec;
+  fs::remove_all(this->seriesDir(s), ec);
+  _series.erase(id);
+  this->saveMeta();
+}
+
+void ColumnarAdapter::removeAllRecords() {
+  _RTX_DB_SCOPED_LOCK;
+  // drop the data, but keep the series definitions
+  for (auto& sp : _series) {
+    Series_sp s = sp.second;
+    for (auto seg : s->segments) {
+      seg->unmap();
+    }
+    s->segments.clear();
+    s->pending.clear();
+    s->pendingSince = 0;
+    boost::system::error_code ec;
+    fs::remove_all(this->seriesDir(s), ec);
+    fs::create_directories(this->seriesDir(s), ec);
+  }
+}
+
+
+
+#pragma mark private
+
+void ColumnarAdapter::loadMeta() {
+  _series.clear();
+  _nextUid = 1;
+
+  fs::path metaPath = fs::path(_rootDir) / _metaFileName;
+  if (!fs::exists(metaPath)) {
+    return;
+  }
+
+  ifstream metaFile(metaPath.string());
+  string line;
+  while (getline(metaFile, line)) {
+    // uid <tab> units <tab> name
+    size_t t1 = line.find('\t');
+    size_t t2 = (t1 == string::npos) ? string::npos : line.find('\t', t1 + 1);
+    if (t2 == string::npos) {
+      continue;
+    }
+    Series_sp s(new Series);
+    s->uid = stoi(line.substr(0, t1));
+    s->units = Units::unitOfType(line.substr(t1 + 1, t2 - t1 - 1));
+    s->name = line.substr(t2 + 1);
+    this->loadSegments(s);
+    _series[s->name] = s;
+    _nextUid = std::max(_nextUid, s->uid + 1);
+  }
+  _metaDirty = false;
+}
+
+void ColumnarAdapter::saveMeta() {
+  fs::path metaPath = fs::path(_rootDir) / _metaFileName;
+  fs::path tmpPath = metaPath;
+  tmpPath += ".tmp";
+  {
+    ofstream metaFile(tmpPath.string(), ios::trunc);
+    for (auto& sp : _series) {
+      metaFile << sp.second->uid << '\t' << sp.second->units.to_string() << '\t' << sp.second->name << '\n';
+    }
+  }
+  fs::rename(tmpPath, metaPath);
+  _metaDirty = false;
+}
+
+void ColumnarAdapter::loadSegments(Series_sp s) {
+  s->segments.clear();
+  fs::path dir(this->seriesDir(s));
+  if (!fs::is_directory(dir)) {
+    return;
+  }
+
+  vector<int> numbers;
+  for (auto& entry : fs::directory_iterator(dir)) {
+    if (entry.path().extension() == "." + _colTime) {
+      numbers.push_back(stoi(entry.path().stem().string()));
+    }
+  }
+  std::sort(numbers.begin(), numbers.end());
+
+  for (int n : numbers) {
+    Segment_sp seg(new Segment(n));
+    // columns may be torn after a crash. the shortest one is the truth, and a missing one is empty.
+    uintmax_t rows = UINTMAX_MAX;
+    for (const auto& col : _dataColumns) {
+      boost::system::error_code ec;
+      uintmax_t size = fs::file_size(this->columnPath(s, n, col.first), ec);
+      rows = std::min(rows, ec ? 0 : size / col.second);
+    }
+    seg->count = (size_t)rows;
+    // cut the others back to it, so that the next write lands on the same row in every column
+    this->truncateSegment(s, seg);
+    size_t nIndex = (seg->count + RTX_COLUMNAR_INDEX_STRIDE - 1) / RTX_COLUMNAR_INDEX_STRIDE;
+    const string idxPath = this->columnPath(s, n, _colIndex);
+    if (seg->count == 0) {
+      s->segments.push_back(seg);
+      continue;
+    }
+
+    seg->sparseIndex.resize(nIndex);
+    ifstream idx(idxPath, ios::binary);
+    idx.read(reinterpret_cast<char*>(seg->sparseIndex.data()), nIndex * sizeof(int64_t));
+    size_t nRead = idx ? nIndex : (size_t)(idx.gcount() / sizeof(int64_t));
+    idx.close();
+
+    ifstream times(this->columnPath(s, n, _colTime), ios::binary);
+    for (size_t k = nRead; k < nIndex; ++k) {
+      // rebuild a short index from the time column
+      times.seekg(k * RTX_COLUMNAR_INDEX_STRIDE * sizeof(int64_t));
+      times.read(reinterpret_cast<char*>(&seg->sparseIndex[k]), sizeof(int64_t));
+    }
+    if (nRead < nIndex) {
+      // and complete it on disk, since later entries are appended after it
+      ofstream out(idxPath, ios::binary | ios::trunc);
+      out.write(reinterpret_cast<const char*>(seg->sparseIndex.data()), nIndex * sizeof(int64_t));
+    }
+    int64_t lastTime = 0;
+    times.seekg((seg->count - 1) * sizeof(int64_t));
+    times.read(reinterpret_cast<char*>(&lastTime), sizeof(int64_t));
+
+    seg->first = (time_t)seg->sparseIndex.front();
+    seg->last = (time_t)lastTime;
+    s->segments.push_back(seg);
+  }
+}
+
+void ColumnarAdapter::append(Series_sp s, const std::vector<Point>& points) {
+  // append-only: anything at or before the last stored time is rejected.
+  time_t lastTime = 0;
+  if (!s->pending.empty()) {
+    lastTime = s->pending.back().time;
+  }
+  else if (!s->segments.empty()) {
+    lastTime = s->segments.back()->last;
+  }
+
+  size_t invalid = 0, outOfOrder = 0;
+  for (const Point& p : points) {
+    if (p.time <= 0) {
+      ++invalid;
+      continue;
+    }
+    if (p.time <= lastTime) {
+      ++outOfOrder;
+      continue;
+    }
+    s->pending.push_back(p);
+    lastTime = p.time;
+  }
+  if (invalid > 0) {
+    cerr << "columnar store: rejected " << invalid << " points with non-positive times for " << s->name << endl;
+  }
+  if (outOfOrder > 0) {
+    DebugLog << "columnar store: dropped " << outOfOrder << " out-of-order points for " << s->name << EOL;
+  }
+}
+
+void ColumnarAdapter::flushAll() {
+  for (auto& sp : _series) {
+    this->flush(sp.second);
+  }
+}
+
+void ColumnarAdapter::flush(Series_sp s) {
+  if (s->pending.empty()) {
+    return;
+  }
+
+  size_t iPending = 0;
+  while (iPending < s->pending.size()) {
+    if (s->segments.empty() || s->segments.back()->count >= segmentCapacity) {
+      this->rollSegment(s);
+    }
+    Segment_sp seg = s->segments.back();
+    size_t n = std::min(segmentCapacity - seg->count, s->pending.size() - iPending);
+
+    vector<int64_t> t(n);
+    vector<double> v(n), c(n);
+    vector<uint8_t> q(n);
+    vector<int64_t> idx;
+    for (size_t i = 0; i < n; ++i) {
+      const Point& p = s->pending[iPending + i];
+      t[i] = (int64_t)p.time;
+      v[i] = p.value;
+      q[i] = (uint8_t)p.quality;
+      c[i] = p.confidence;
+      if ((seg->count + i) % RTX_COLUMNAR_INDEX_STRIDE == 0) {
+        idx.push_back(t[i]);
+      }
+    }
+
+    auto append = [&](const string& col, const void* data, size_t len) {
+      ofstream out(this->columnPath(s, seg->number, col), ios::binary | ios::app);
+      out.write(reinterpret_cast<const char*>(data), len);
+      if (!out) {
+        throw runtime_error("could not write to columnar store: " + this->columnPath(s, seg->number, col));
+      }
+    };
+    try {
+      append(_colTime, t.data(), n * sizeof(int64_t));
+      append(_colValue, v.data(), n * sizeof(double));
+      append(_colQuality, q.data(), n * sizeof(uint8_t));
+      append(_colConfidence, c.data(), n * sizeof(double));
+      if (!idx.empty()) {
+        append(_colIndex, idx.data(), idx.size() * sizeof(int64_t));
+      }
+    } catch (...) {
+      // take back what reached some columns only, and keep just the points that were not written
+      try {
+        this->truncateSegment(s, seg);
+      } catch (exception& e) {
+        cerr << "columnar store: could not roll back a failed write: " << e.what() << endl;
+      }
+      s->pending.erase(s->pending.begin(), s->pending.begin() + iPending);
+      throw;
+    }
+
+    if (seg->count == 0) {
+      seg->first = (time_t)t.front();
+    }
+    seg->last = (time_t)t.back();
+    seg->count += n;
+    seg->sparseIndex.insert(seg->sparseIndex.end(), idx.begin(), idx.end());
+    iPending += n;
+  }
+
+  s->pending.clear();
+  s->pendingSince = 0;
+}
+
+void ColumnarAdapter::truncateSegment(Series_sp s, Segment_sp seg) {
+  for (const auto& col : _dataColumns) {
+    const string path = this->columnPath(s, seg->number, col.first);
+    if (!fs::exists(path)) {
+      ofstream create(path, ios::binary);
+    }
+    if (fs::file_size(path) != seg->count * col.second) {
+      fs::resize_file(path, seg->count * col.second);
+    }
+  }
+  const uintmax_t idxSize = (seg->count + RTX_COLUMNAR_INDEX_STRIDE - 1) / RTX_COLUMNAR_INDEX_STRIDE * sizeof(int64_t);
+  const string idxPath = this->columnPath(s, seg->number, _colIndex);
+  if (fs::exists(idxPath) && fs::file_size(idxPath) > idxSize) {
+    fs::resize_file(idxPath, idxSize);
+  }
+}
+
+void ColumnarAdapter::rollSegment(Series_sp s) {
+  int n = s->segments.empty() ? 0 : s->segments.back()->number + 1;
+  s->segments.push_back(Segment_sp(new Segment(n)));
+}
+
+bool ColumnarAdapter::mapSegment(Series_sp s, Segment_sp seg) {
+  if (seg->mappedCount == seg->count && seg->time.is_open()) {
+    return true;
+  }
+  seg->unmap();
+  try {
+    seg->time.open(this->columnPath(s, seg->number, _colTime), seg->count * sizeof(int64_t));
+    seg->value.open(this->columnPath(s, seg->number, _colValue), seg->count * sizeof(double));
+    seg->quality.open(this->columnPath(s, seg->number, _colQuality), seg->count * sizeof(uint8_t));
+    seg->confidence.open(this->columnPath(s, seg->number, _colConfidence), seg->count * sizeof(double));
+  } catch (exception& e) {
+    cerr << "could not map segment: " << e.what() << endl;
+    seg->unmap();
+    return false;
+  }
+  seg->mappedCount = seg->count;
+  return true;
+}
+
+ColumnarAdapter::Series_sp ColumnarAdapter::seriesNamed(const std::string& name) {
+  auto it = _series.find(name);
+  if (it == _series.end()) {
+    return Series_sp();
+  }
+  return it->second;
+}
+
+std::string ColumnarAdapter::seriesDir(Series_sp s) {
+  fs::path dir(_rootDir);
+  dir /= "s" + to_string(s->uid);
+  return dir.string();
+}
+
+std::string ColumnarAdapter::columnPath(Series_sp s, int segment, const std::string& column) {
+  stringstream ss;
+  ss << setw(6) << setfill('0') << segment << "." << column;
+  fs::path p(this->seriesDir(s));
+  p /= ss.str();
+  return p.string();
+}
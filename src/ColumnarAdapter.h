@@ -0,0 +1,120 @@
+#ifndef ColumnarAdapter_hpp
+#define ColumnarAdapter_hpp
+
+#include <stdio.h>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include "DbAdapter.h"
+#include "WhereClause.h"
+
+// local, server-less archive. each series is stored as a directory of append-only
+// segments; each segment is a set of fixed-width column files (time, value, quality, confidence)
+// plus a sparse time index. reads memory-map the columns and binary-search them in place.
+//
+// times must be positive and increasing per series: points at or before a series' last time, and
+// points with a time <= 0, are rejected and counted in the log. outside a transaction, writes are
+// batched per series: a range or a batch of rows is appended with one write per column, and single
+// points are held until a batch fills or a later one arrives a second after the first was held.
+// any read, endTransaction or the destructor writes out what is held first.
+
+namespace RTX {
+  class ColumnarAdapter : public DbAdapter {
+  public:
+    ColumnarAdapter( errCallback_t cb );
+    ~ColumnarAdapter();
+
+    const adapterOptions options() const;
+
+    std::string connectionString();
+    void setConnectionString(const std::string& con);
+
+    void doConnect();
+
+    IdentifierUnitsList idUnitsList();
+
+    // TRANSACTIONS
+    void beginTransaction();
+    void endTransaction();
+    bool inTransaction() {return _inTransaction;};
+
+    // READ
+    std::vector<Point> selectRange(const std::string& id, TimeRange range);
+    Point selectNext(const std::string& id, time_t time, WhereClause q = WhereClause());
+    Point selectPrevious(const std::string& id, time_t time, WhereClause q = WhereClause());
+
+    // CREATE
+    bool insertIdentifierAndUnits(const std::string& id, Units units);
+    void insertSingle(const std::string& id, Point point);
+    void insertRange(const std::string& id, std::vector<Point> points);
+    void insertRows(const std::vector<std::pair<std::string, Point> >& rows);
+
+    // UPDATE
+    bool assignUnitsToRecord(const std::string& name, const Units& units);
+
+    // DELETE
+    void removeRecord(const std::string& id);
+    void removeAllRecords();
+
+    std::string basePath;
+    size_t segmentCapacity; // number of rows before a segment is sealed and a new one is started
+
+  private:
+    class Segment {
+    public:
+      Segment(int number) : number(number), count(0), mappedCount(0), first(0), last(0) {};
+      int number;
+      size_t count, mappedCount;
+      time_t first, last;
+      std::vector<int64_t> sparseIndex; // time of every Nth row
+      boost::iostreams::mapped_file_source time, value, quality, confidence;
+
+      const int64_t* times() const { return reinterpret_cast<const int64_t*>(time.data()); };
+      Point pointAt(size_t i) const;
+      size_t lowerBound(time_t t) const; // first row with time >= t
+      size_t upperBound(time_t t) const; // first row with time > t
+      void unmap();
+    };
+    typedef std::shared_ptr<Segment> Segment_sp;
+
+    class Series {
+    public:
+      int uid;
+      std::string name;
+      Units units;
+      std::vector<Segment_sp> segments;
+      std::vector<Point> pending; // appended, not yet flushed to the tail segment
+      time_t pendingSince; // wall time of the oldest held single point; 0 when none are held
+      Series() : uid(0), units(RTX_NO_UNITS), pendingSince(0) {};
+    };
+    typedef std::shared_ptr<Series> Series_sp;
+
+    std::string _path;
+    std::string _rootDir;
+    bool _inTransaction;
+    bool _metaDirty;
+    int _nextUid;
+    std::map<std::string, Series_sp> _series;
+
+    void loadMeta();
+    void saveMeta();
+    void loadSegments(Series_sp s);
+    void flush(Series_sp s);
+    void append(Series_sp s, const std::vector<Point>& points); // to pending, in order; rejects the rest
+    void flushAll();
+    void rollSegment(Series_sp s);
+    void truncateSegment(Series_sp s, Segment_sp seg); // cuts the files back to the segment's rows
+    bool mapSegment(Series_sp s, Segment_sp seg);
+
+    Series_sp seriesNamed(const std::string& name);
+    std::string seriesDir(Series_sp s);
+    std::string columnPath(Series_sp s, int segment, const std::string& column);
+  };
+}
+
+#endif /* ColumnarAdapter_hpp */
@@ -2,6 +2,7 @@
 
 // adaptors
 #include "SqliteAdapter.h"
+#include "ColumnarAdapter.h"
 #include "PiAdapter.h"
 #include "InfluxAdapter.h"
 #include "OdbcAdapter.h"
@@ -15,6 +16,7 @@ SqlitePointRecord::SqlitePointRecord() {
   _adapter = new SqliteAdapter(_errCB);
 }
 SqlitePointRecord::~SqlitePointRecord() {
+  this->disableWriteSpool();
   delete _adapter;
 }
 
@@ -27,10 +29,35 @@ void SqlitePointRecord::setBasePath(const std::string& path) {
 
 /***************************************************************************************/
 
+ColumnarPointRecord::ColumnarPointRecord() {
+  _adapter = new ColumnarAdapter(_errCB);
+}
+ColumnarPointRecord::~ColumnarPointRecord() {
+  this->disableWriteSpool();
+  delete _adapter;
+}
+
+std::string ColumnarPointRecord::basePath() {
+  return ((ColumnarAdapter*)_adapter)->basePath;
+}
+void ColumnarPointRecord::setBasePath(const std::string& path) {
+  ((ColumnarAdapter*)_adapter)->basePath = path;
+}
+
+size_t ColumnarPointRecord::segmentCapacity() {
+  return ((ColumnarAdapter*)_adapter)->segmentCapacity;
+}
+void ColumnarPointRecord::setSegmentCapacity(size_t rows) {
+  ((ColumnarAdapter*)_adapter)->segmentCapacity = rows;
+}
+
+/***************************************************************************************/
+
 PiPointRecord::PiPointRecord() {
   _adapter = new PiAdapter(_errCB);
 }
 PiPointRecord::~PiPointRecord() {
+  this->disableWriteSpool();
   delete _adapter;
 }
 void PiPointRecord::setTagSearchPath(const std::string& path) {
@@ -45,6 +72,12 @@ void PiPointRecord::setConversions(const std::string& conversions) {
 std::string PiPointRecord::conversions() {
   return ((PiAdapter*)_adapter)->valueConversions;
 }
+void PiPointRecord::setWebIdCachePath(const std::string& path) {
+  ((PiAdapter*)_adapter)->webIdCachePath = path;
+}
+std::string PiPointRecord::webIdCachePath() {
+  return ((PiAdapter*)_adapter)->webIdCachePath;
+}
 
 
 /***************************************************************************************/
@@ -54,6 +87,7 @@ InfluxDbPointRecord::InfluxDbPointRecord() {
   _adapter = new InfluxTcpAdapter(_errCB);
 }
 InfluxDbPointRecord::~InfluxDbPointRecord() {
+  this->disableWriteSpool();
   delete _adapter;
 }
 
@@ -67,6 +101,7 @@ InfluxUdpPointRecord::InfluxUdpPointRecord() {
   _adapter = new InfluxUdpAdapter(_errCB);
 }
 InfluxUdpPointRecord::~InfluxUdpPointRecord() {
+  this->disableWriteSpool();
   delete _adapter;
 }
 void InfluxUdpPointRecord::sendInfluxString(time_t time, const string& seriesId, const string& values) {
@@ -80,6 +115,7 @@ OdbcPointRecord::OdbcPointRecord() {
   _adapter = new OdbcAdapter(_errCB);
 }
 OdbcPointRecord::~OdbcPointRecord() {
+  this->disableWriteSpool();
   delete _adapter;
 }
 
@@ -122,4 +158,18 @@ void OdbcPointRecord::setRangeQuery(const std::string& range) {
   ((OdbcAdapter*)_adapter)->setRangeQuery(range);
 }
 
+std::string OdbcPointRecord::wideRangeQuery() {
+  return ((OdbcAdapter*)_adapter)->wideRangeQuery();
+}
+void OdbcPointRecord::setWideRangeQuery(const std::string& wideRange) {
+  ((OdbcAdapter*)_adapter)->setWideRangeQuery(wideRange);
+}
+
+int OdbcPointRecord::maxConnections() {
+  return ((OdbcAdapter*)_adapter)->maxConnections();
+}
+void OdbcPointRecord::setMaxConnections(int n) {
+  ((OdbcAdapter*)_adapter)->setMaxConnections(n);
+}
+
 
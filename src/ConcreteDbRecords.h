@@ -22,6 +22,20 @@ namespace RTX {
   };
   
   
+  class ColumnarPointRecord : public DbPointRecord {
+  public:
+    RTX_BASE_PROPS(ColumnarPointRecord);
+    ColumnarPointRecord();
+    virtual ~ColumnarPointRecord();
+    
+    std::string basePath();
+    void setBasePath(const std::string& path);
+    
+    size_t segmentCapacity();
+    void setSegmentCapacity(size_t rows);
+  };
+  
+  
   class PiPointRecord : public DbPointRecord {
   public:
     RTX_BASE_PROPS(PiPointRecord);
@@ -31,6 +45,8 @@ namespace RTX {
     std::string tagSearchPath();
     void setConversions(const std::string& conversions);
     std::string conversions();
+    void setWebIdCachePath(const std::string& path);
+    std::string webIdCachePath();
   };
   
   
@@ -77,6 +93,12 @@ namespace RTX {
     std::string rangeQuery();
     void setRangeQuery(const std::string& range);
     
+    std::string wideRangeQuery();
+    void setWideRangeQuery(const std::string& wideRange);
+    
+    int maxConnections();
+    void setMaxConnections(int n);
+    
   };
   
 }
@@ -0,0 +1,57 @@
+#include "DbAdapter.h"
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+
+using namespace std;
+using namespace RTX;
+
+#ifndef RTX_DB_IO_THREADS
+  #define RTX_DB_IO_THREADS 8
+#endif
+
+// one executor shared by all adapters, so the number of blocking reads in flight stays bounded
+static boost::asio::thread_pool& __ioExecutor() {
+  static boost::asio::thread_pool pool(RTX_DB_IO_THREADS);
+  return pool;
+}
+
+template<typename T>
+static future<T> __onIoExecutor(function<T()> fn, DbAdapter::cancelToken_t cancel) {
+  auto task = make_shared<packaged_task<T()> >([fn, cancel]()->T {
+    if (cancel && *cancel) {
+      return T();
+    }
+    return fn();
+  });
+  future<T> f = task->get_future();
+  boost::asio::post(__ioExecutor(), [task]() {
+    (*task)();
+  });
+  return f;
+}
+
+
+future<vector<Point> > DbAdapter::selectRangeAsync(const string& id, TimeRange range, cancelToken_t cancel) {
+  return __onIoExecutor<vector<Point> >([=]() {
+    return this->selectRange(id, range);
+  }, cancel);
+}
+
+future<Point> DbAdapter::selectNextAsync(const string& id, time_t time, cancelToken_t cancel) {
+  return __onIoExecutor<Point>([=]() {
+    return this->selectNext(id, time);
+  }, cancel);
+}
+
+future<Point> DbAdapter::selectPreviousAsync(const string& id, time_t time, cancelToken_t cancel) {
+  return __onIoExecutor<Point>([=]() {
+    return this->selectPrevious(id, time);
+  }, cancel);
+}
+
+future<map<string, vector<Point> > > DbAdapter::wideQueryAsync(TimeRange range, cancelToken_t cancel) {
+  return __onIoExecutor<map<string, vector<Point> > >([=]() {
+    return this->wideQuery(range);
+  }, cancel);
+}
@@ -2,6 +2,9 @@
 #define DbAdapter_h
 
 #include <boost/atomic.hpp>
+#include <atomic>
+#include <future>
+#include <memory>
 #include <mutex>
 #include <vector>
 #include <functional>
@@ -32,6 +35,9 @@ namespace RTX {
     };
     
     typedef std::function<void(const std::string)> errCallback_t;
+    typedef std::function<void(const std::string& id, std::vector<Point>& points)> pointsCallback_t;
+    typedef std::shared_ptr<std::atomic<bool> > cancelToken_t; // set to true to abandon a request
+    static cancelToken_t newCancelToken() { return std::make_shared<std::atomic<bool> >(false); };
     
     DbAdapter( errCallback_t cb ) : _errCallback(cb) { };
     virtual ~DbAdapter() { };
@@ -53,17 +59,55 @@ namespace RTX {
     
     // PREFETCH OPTIMIZATION
     virtual std::map<std::string, std::vector<Point> > wideQuery(TimeRange range) { return std::map<std::string, std::vector<Point> >(); };
+    // incremental variant: points are handed to the callback as they are received, in time order per series.
+    virtual void wideQueryChunked(TimeRange range, pointsCallback_t cb) {
+      for (auto& res : this->wideQuery(range)) {
+        cb(res.first, res.second);
+      }
+    };
     
     // READ
     virtual std::vector<Point> selectRange(const std::string& id, TimeRange range) = 0;
     virtual Point selectNext(const std::string& id, time_t time, WhereClause q = WhereClause()) = 0;
     virtual Point selectPrevious(const std::string& id, time_t time, WhereClause q = WhereClause()) = 0;
     virtual std::vector<Point> selectWithQuery(const std::string& query, TimeRange range) { return std::vector<Point>(); };
+    // many series over one range. override where the backend can serve these together or concurrently.
+    virtual std::map<std::string, std::vector<Point> > selectRanges(const std::vector<std::string>& ids, TimeRange range) {
+      std::map<std::string, std::vector<Point> > out;
+      for (const auto& id : ids) {
+        out[id] = this->selectRange(id, range);
+      }
+      return out;
+    };
+    
+    // ASYNC READ
+    // by default the blocking call runs on a shared I/O executor; adapters with native async transport
+    // override these. a cancelled request resolves empty. the adapter must outlive its pending requests.
+    virtual std::future<std::vector<Point> > selectRangeAsync(const std::string& id, TimeRange range, cancelToken_t cancel = cancelToken_t());
+    virtual std::future<Point> selectNextAsync(const std::string& id, time_t time, cancelToken_t cancel = cancelToken_t());
+    virtual std::future<Point> selectPreviousAsync(const std::string& id, time_t time, cancelToken_t cancel = cancelToken_t());
+    virtual std::future<std::map<std::string, std::vector<Point> > > wideQueryAsync(TimeRange range, cancelToken_t cancel = cancelToken_t());
+    
+    // LIVE DATA
+    // backends that can push samples hand them to the callback as they arrive, on an adapter thread.
+    virtual bool subscribe(const std::vector<std::string>& ids, pointsCallback_t cb) { return false; };
+    virtual void unsubscribe() { };
     
     // CREATE
     virtual bool insertIdentifierAndUnits(const std::string& id, Units units) = 0;
     virtual void insertSingle(const std::string& id, Point point) = 0;
     virtual void insertRange(const std::string& id, std::vector<Point> points) = 0;
+    // one point each for many series, such as a simulation step. override where the backend can write them in one statement or request.
+    virtual void insertRows(const std::vector<std::pair<std::string, Point> >& rows) {
+      for (const auto& row : rows) {
+        this->insertSingle(row.first, row.second);
+      }
+    };
+    
+    // true if every write since the last call reached the database. blocks until writes still in flight
+    // are acknowledged. adapters that send in the background, or that log a failed insert instead of
+    // throwing, override this; a failed insert throws otherwise.
+    virtual bool confirmWrites() { return true; };
     
     // UPDATE
     virtual bool assignUnitsToRecord(const std::string& name, const Units& units) = 0;
@@ -7,6 +7,7 @@
 //
 
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <set>
@@ -28,7 +29,7 @@ using namespace std;
 
 /************ request type *******************/
 
-DbPointRecord::request_t::request_t(string id, TimeRange r_range) : range(r_range), id(id) { }
+DbPointRecord::request_t::request_t(string id, TimeRange r_range) : range(r_range), id(id), key(SeriesHandle::intern(id)->key()) { }
 
 bool DbPointRecord::request_t::contains(std::string id, time_t t) {
   if (this->range.start <= t 
@@ -42,6 +43,7 @@ bool DbPointRecord::request_t::contains(std::string id, time_t t) {
 void DbPointRecord::request_t::clear() {
   this->range = TimeRange();
   this->id = "";
+  this->key = SeriesHandle::intern("")->key();
 }
 
 /************ widequery info *******************/
@@ -64,6 +66,7 @@ DbPointRecord::DbPointRecord() : _last_request("",TimeRange()) {
   _adapter = NULL;
   errorMessage = "Not Connected";
   _readOnly = false;
+  _prefetchLimit = RTX_BUFFER_PREFETCH_LIMIT;
   _filterType = OpcNoFilter;
   
   iterativeSearchMaxIterations = 8;
@@ -226,14 +229,18 @@ bool DbPointRecord::registerAndGetIdentifierForSeriesWithUnits(string name, Unit
 
 
 IdentifierUnitsList DbPointRecord::identifiersAndUnits() {
-  std::shared_lock lock(_db_readwrite); // get a read lock
-  time_t now = time(NULL);
-  time_t stale = now - _lastIdRequest;
-  
-  if ((stale < SERIES_LIST_TTL || _adapter->inTransaction()) && !_identifiersAndUnitsCache.get()->empty()) {
-    return _identifiersAndUnitsCache;
+  {
+    std::shared_lock lock(_db_readwrite); // get a read lock
+    time_t now = time(NULL);
+    time_t stale = now - _lastIdRequest;
+    
+    if ((stale < SERIES_LIST_TTL || _adapter->inTransaction()) && !_identifiersAndUnitsCache.get()->empty()) {
+      return _identifiersAndUnitsCache;
+    }
   }
   
+  // refreshing the list replaces the cache that other readers may be copying
+  std::lock_guard lock(_db_readwrite); // get a write lock
   if (checkConnected()) {
     _identifiersAndUnitsCache = _adapter->idUnitsList();
     _lastIdRequest = time(NULL);
@@ -244,12 +251,18 @@ IdentifierUnitsList DbPointRecord::identifiersAndUnits() {
 
 
 void DbPointRecord::beginBulkOperation() {
+  if (_spool) {
+    return; // the drainer runs its own transactions
+  }
   if (checkConnected()) {
     _adapter->beginTransaction();
   }
 }
 
 void DbPointRecord::endBulkOperation() {
+  if (_spool) {
+    return;
+  }
   if (checkConnected()) {
     _adapter->endTransaction();
   }
@@ -258,18 +271,236 @@ void DbPointRecord::endBulkOperation() {
 void DbPointRecord::willQuery(RTX::TimeRange range) {
   if (checkConnected()) {
     // make sure the id list is current:
-    _lastIdRequest = 0;
+    {
+      std::lock_guard lock(_db_readwrite);
+      _lastIdRequest = 0;
+    }
     this->identifiersAndUnits();
     
-    auto fetch = _adapter->wideQuery(range);
-    for (auto res : fetch) {
-      DB_PR_SUPER::addPoints(res.first, res.second);
-    }
+    // results may arrive in several chunks per series. each chunk is prefixed with the last point
+    // of the previous one, so the buffer sees one contiguous run instead of a gap (which would reset it).
+    // past the prefetch limit a series' chunks are dropped, so the buffer stays bounded.
+    map<string, Point> lastDelivered;
+    map<string, size_t> nDelivered;
+    bool limited = false;
+    _adapter->wideQueryChunked(range, [&](const string& id, vector<Point>& points) {
+      if (points.size() == 0) {
+        return;
+      }
+      size_t& count = nDelivered[id];
+      if (count >= _prefetchLimit) {
+        limited = true;
+        return;
+      }
+      if (count + points.size() > _prefetchLimit) {
+        points.resize(_prefetchLimit - count);
+        limited = true;
+      }
+      count += points.size();
+      auto last = lastDelivered.find(id);
+      if (last != lastDelivered.end()) {
+        if (last->second.time < points.front().time) {
+          points.insert(points.begin(), last->second);
+        }
+        this->reserveCapacity(id, points.size());
+      }
+      lastDelivered[id] = points.back();
+      DB_PR_SUPER::addPoints(id, points);
+    });
     // optimization: if the adaptor supports wide query then allow queries to bypass db hits
-    // so cache the range of that query.
-    if (_adapter->options().canDoWideQuery) {
+    // so cache the range of that query. a limited prefetch does not cover the range.
+    if (_adapter->options().canDoWideQuery && !limited) {
+      std::lock_guard lock(_db_readwrite);
+      _wideQuery = WideQueryInfo(range);
+    }
+  }
+}
+
+void DbPointRecord::setPrefetchLimit(size_t pointsPerSeries) {
+  _prefetchLimit = std::max((size_t)1, pointsPerSeries);
+}
+
+size_t DbPointRecord::prefetchLimit() {
+  return _prefetchLimit;
+}
+
+void DbPointRecord::willQuery(const std::vector<std::string>& ids, TimeRange range) {
+  if (checkConnected()) {
+    // the adapter may batch or parallelize these, which a sequence of pointsInRange calls cannot.
+    auto fetch = _adapter->selectRanges(ids, range);
+    for (auto& res : fetch) {
+      if (res.second.size() > _prefetchLimit) {
+        res.second.resize(_prefetchLimit);
+      }
+      DB_PR_SUPER::addPoints(res.first, this->pointsWithOpcFilter(res.second));
+    }
+  }
+}
+
+template<typename T>
+static std::future<T> __ready(T value) {
+  std::promise<T> p;
+  p.set_value(std::move(value));
+  return p.get_future();
+}
+
+std::future<std::vector<Point> > DbPointRecord::pointsInRangeAsync(const string& id, TimeRange range, DbAdapter::cancelToken_t cancel) {
+  // the same cache checks and gap queries as pointsInRange, with the queries in flight at once
+  vector<TimeRange> gaps;
+  {
+    std::shared_lock lock(_db_readwrite); // get a read lock
+    if (this->requestCovers(id, range) || !checkConnected()) {
+      return __ready(DB_PR_SUPER::pointsInRange(id, range));
+    }
+    gaps = this->rangesToFetch(id, range);
+  }
+  if (gaps.empty()) {
+    return __ready(DB_PR_SUPER::pointsInRange(id, range));
+  }
+  vector<future<vector<Point> > > pending;
+  for (const TimeRange& r : gaps) {
+    pending.push_back(_adapter->selectRangeAsync(id, r, cancel));
+  }
+  return std::async(launch::deferred, [this, id, range, cancel, pending = std::move(pending)]() mutable {
+    vector<vector<Point> > fetched;
+    for (auto& f : pending) {
+      fetched.push_back(this->pointsWithOpcFilter(f.get()));
+    }
+    if (cancel && *cancel) {
+      return vector<Point>(); // partial results are not cached
+    }
+    return this->mergeFetched(id, range, fetched);
+  });
+}
+
+std::future<Point> DbPointRecord::pointBeforeAsync(const string& id, time_t time, DbAdapter::cancelToken_t cancel) {
+  return this->pointNearAsync(id, time, false, cancel);
+}
+
+std::future<Point> DbPointRecord::pointAfterAsync(const string& id, time_t time, DbAdapter::cancelToken_t cancel) {
+  return this->pointNearAsync(id, time, true, cancel);
+}
+
+std::future<Point> DbPointRecord::pointNearAsync(const string& id, time_t time, bool after, DbAdapter::cancelToken_t cancel) {
+  Point p = after ? DB_PR_SUPER::pointAfter(id, time) : DB_PR_SUPER::pointBefore(id, time);
+  if (p.isValid || !checkConnected()) {
+    return __ready(p);
+  }
+  if (this->wideQuery().valid()) {
+    // answered from the cache, or not at all
+    return __ready(after ? this->pointAfter(id, time) : this->pointBefore(id, time));
+  }
+  
+  // the search order of pointBefore and pointAfter: iteratively in windows where the adapter prefers it,
+  // then a singly-bounded query where it is supported.
+  const DbAdapter::adapterOptions options = _adapter->options();
+  auto singlyBound = [this, id, time, after, cancel, options]() {
+    if (!options.supportsSinglyBoundQuery || (cancel && *cancel)) {
+      return Point();
+    }
+    auto pending = after ? _adapter->selectNextAsync(id, time, cancel) : _adapter->selectPreviousAsync(id, time, cancel);
+    return this->pointWithOpcFilter(pending.get());
+  };
+  
+  if (!options.searchIteratively) {
+    if (!options.supportsSinglyBoundQuery) {
+      return __ready(Point());
+    }
+    auto pending = after ? _adapter->selectNextAsync(id, time, cancel) : _adapter->selectPreviousAsync(id, time, cancel);
+    return std::async(launch::deferred, [this, pending = std::move(pending)]() mutable {
+      return this->pointWithOpcFilter(pending.get());
+    });
+  }
+  
+  // the first window goes out now; later windows are only needed when it comes back empty
+  const time_t stride = iterativeSearchStride;
+  TimeRange window = after ? TimeRange(time + 1, time + stride) : TimeRange(time - stride, time - 1);
+  auto first = this->pointsInRangeAsync(id, window, cancel);
+  return std::async(launch::deferred, [this, id, window, after, stride, cancel, singlyBound, first = std::move(first)]() mutable {
+    vector<Point> points = first.get();
+    TimeRange r = window;
+    for (int i = 1; points.empty() && i < iterativeSearchMaxIterations && !(cancel && *cancel); ++i) {
+      r.start += after ? stride : -stride;
+      r.end += after ? stride : -stride;
+      points = this->pointsInRangeAsync(id, r, cancel).get();
+    }
+    if (!points.empty()) {
+      return after ? points.front() : points.back();
+    }
+    return singlyBound();
+  });
+}
+
+std::future<void> DbPointRecord::willQueryAsync(TimeRange range, DbAdapter::cancelToken_t cancel) {
+  if (!checkConnected() || !_adapter->options().canDoWideQuery) {
+    return std::async(launch::deferred, []() {});
+  }
+  auto pending = _adapter->wideQueryAsync(range, cancel);
+  return std::async(launch::deferred, [this, range, cancel, pending = std::move(pending)]() mutable {
+    auto fetch = pending.get();
+    if (cancel && *cancel) {
+      return;
+    }
+    // as in willQuery: bounded per series, and a limited prefetch does not cover the range
+    bool limited = false;
+    for (auto& res : fetch) {
+      if (res.second.size() > _prefetchLimit) {
+        res.second.resize(_prefetchLimit);
+        limited = true;
+      }
+      DB_PR_SUPER::addPoints(res.first, this->pointsWithOpcFilter(res.second));
+    }
+    if (!limited) {
+      std::lock_guard lock(_db_readwrite);
       _wideQuery = WideQueryInfo(range);
     }
+  });
+}
+
+bool DbPointRecord::subscribe(const std::vector<std::string>& ids) {
+  if (!checkConnected()) {
+    return false;
+  }
+  return _adapter->subscribe(ids, [this](const string& id, vector<Point>& points) {
+    this->receiveSubscribed(id, points);
+  });
+}
+
+void DbPointRecord::unsubscribe() {
+  // as in subscribe, an adapter that is missing or never connected has nothing to tear down
+  if (_adapter && _adapter->adapterConnected()) {
+    _adapter->unsubscribe();
+  }
+  lock_guard<mutex> lock(_subscriptionMtx);
+  _lastSubscribed.clear();
+}
+
+void DbPointRecord::setSubscriptionDestination(PointRecord::_sp destination) {
+  lock_guard<mutex> lock(_subscriptionMtx);
+  _subscriptionDestination = destination;
+}
+
+void DbPointRecord::receiveSubscribed(const string& id, vector<Point>& points) {
+  vector<Point> filtered = this->pointsWithOpcFilter(points);
+  if (filtered.size() == 0) {
+    return;
+  }
+  PointRecord::_sp destination;
+  vector<Point> cached;
+  {
+    lock_guard<mutex> lock(_subscriptionMtx);
+    // as with chunked prefetch, lead with the previous sample so the buffer sees one contiguous run
+    auto last = _lastSubscribed.find(id);
+    if (last != _lastSubscribed.end() && last->second.time < filtered.front().time) {
+      cached.push_back(last->second);
+    }
+    _lastSubscribed[id] = filtered.back();
+    destination = _subscriptionDestination;
+  }
+  cached.insert(cached.end(), filtered.begin(), filtered.end());
+  DB_PR_SUPER::addPoints(id, cached);
+  if (destination) {
+    destination->addPoints(id, filtered);
   }
 }
 
@@ -291,7 +522,8 @@ Point DbPointRecord::point(const string& id, time_t time) {
   
   // if there is a valid ("alive") wide query, and if the time requested is in range, then the point should be there.
   // if it's not there, it doesn't exist (within TTL anyway)
-  if (_wideQuery.valid() && _wideQuery.range().contains(time)) {
+  WideQueryInfo wide = this->wideQuery();
+  if (wide.valid() && wide.range().contains(time)) {
     return p;
   }
   
@@ -301,12 +533,11 @@ Point DbPointRecord::point(const string& id, time_t time) {
     // if so, and Super couldn't find it, then it's just not here.
     // todo -- check staleness
     
-    if (_last_request.contains(id, time)) {
-      return Point();
-    }
-    
-    if (_wideQuery.valid() && _wideQuery.range().contains(time)) {
-      return Point();
+    {
+      std::shared_lock lock(_db_readwrite);
+      if (_last_request.contains(id, time)) {
+        return Point();
+      }
     }
     
     time_t margin = 60*60*12;
@@ -317,11 +548,14 @@ Point DbPointRecord::point(const string& id, time_t time) {
     vector<Point> pVec = _adapter->selectRange(id, TimeRange(start, end));
     pVec = this->pointsWithOpcFilter(pVec);
     
-    if (pVec.size() > 0) {
-      _last_request = request_t(id, TimeRange(pVec.front().time, pVec.back().time));
-    }
-    else {
-      _last_request = request_t(id,TimeRange());
+    {
+      std::lock_guard lock(_db_readwrite);
+      if (pVec.size() > 0) {
+        _last_request = request_t(id, TimeRange(pVec.front().time, pVec.back().time));
+      }
+      else {
+        _last_request = request_t(id,TimeRange());
+      }
     }
     
     
@@ -356,9 +590,10 @@ Point DbPointRecord::pointBefore(const string& id, time_t time, WhereClause q) {
   // if there is a valid ("alive") wide query, and if the time requested is in range, then the point should be there.
   // The Base buffer class might not catch this, since it depends on a time range based on extant data.
   // so we (partially) reproduce some logic here to get that edge case.
-  if (_wideQuery.valid()) {
+  WideQueryInfo wide = this->wideQuery();
+  if (wide.valid()) {
     // the actual effective range is the superset of the buffered range and the wide query range.
-    TimeRange actualRange = TimeRange::unionOf(_wideQuery.range(), DB_PR_SUPER::range(id));
+    TimeRange actualRange = TimeRange::unionOf(wide.range(), DB_PR_SUPER::range(id));
     
     if (actualRange.contains(time)) {
       // last check...
@@ -421,9 +656,10 @@ Point DbPointRecord::pointAfter(const string& id, time_t time, WhereClause q) {
   
   // if there is a valid ("alive") wide query, and if the time requested is in range, then the point should be there.
   // if it's not there, it doesn't exist (within TTL anyway)
-  if (_wideQuery.valid()) {
+  WideQueryInfo wide = this->wideQuery();
+  if (wide.valid()) {
     // the actual effective range is the superset of the buffered range and the wide query range.
-    TimeRange actualRange = TimeRange::unionOf(_wideQuery.range(), DB_PR_SUPER::range(id));
+    TimeRange actualRange = TimeRange::unionOf(wide.range(), DB_PR_SUPER::range(id));
     
     if (actualRange.contains(time)) {
       // last check...
@@ -523,101 +759,136 @@ Point DbPointRecord::searchNextIteratively(const string& id, time_t time) {
 }
 
 
-std::vector<Point> DbPointRecord::pointsInRange(const string& id, TimeRange qrange) {
-  std::shared_lock lock(_db_readwrite); // get a read lock
-  
-  // limit double-queries
-  if (_last_request.range.containsRange(qrange) && _last_request.id == id) {
-    return DB_PR_SUPER::pointsInRange(id, qrange);
-  }
-  
-  // wide query optimization
-  if (_wideQuery.valid() && _wideQuery.range().intersection(qrange) == TimeRange::intersect_other_internal) {
-    return DB_PR_SUPER::pointsInRange(id, qrange);
+Point DbPointRecord::point(const SeriesHandle& series, time_t time) {
+  Point p = DB_PR_SUPER::point(series, time);
+  if (p.isValid) {
+    return p;
   }
-  else {
-    _wideQuery = WideQueryInfo(); // the intersection did not align, so invalidate this wide query marker. Beyond here we may mutate the cache.
+  return this->point(series.name(), time);
+}
+
+Point DbPointRecord::pointBefore(const SeriesHandle& series, time_t time, WhereClause q) {
+  return this->pointBefore(series.name(), time, q);
+}
+
+Point DbPointRecord::pointAfter(const SeriesHandle& series, time_t time, WhereClause q) {
+  return this->pointAfter(series.name(), time, q);
+}
+
+void DbPointRecord::addPoints(const SeriesHandle& series, std::vector<Point> points) {
+  this->addPoints(series.name(), points);
+}
+
+std::vector<Point> DbPointRecord::pointsInRange(const SeriesHandle& series, TimeRange qrange) {
+  {
+    std::shared_lock lock(_db_readwrite); // get a read lock
+    const bool lastRequestCovers = _last_request.key == series.key() && _last_request.range.containsRange(qrange);
+    const bool wideQueryCovers = _wideQuery.valid() && _wideQuery.range().intersection(qrange) == TimeRange::intersect_other_internal;
+    if (lastRequestCovers || wideQueryCovers) {
+      return DB_PR_SUPER::pointsInRange(series, qrange);
+    }
   }
-  
-  
-  if (!checkConnected()) {
-    return DB_PR_SUPER::pointsInRange(id, qrange);
+  TimeRange::intersect_type intersect = DB_PR_SUPER::range(series).intersection(qrange);
+  if (intersect == TimeRange::intersect_other_internal || intersect == TimeRange::intersect_equal) {
+    return DB_PR_SUPER::pointsInRange(series, qrange);
   }
-  
-  TimeRange range = DB_PR_SUPER::range(id);
-  TimeRange::intersect_type intersect = range.intersection(qrange);
+  // the database is involved, so take the general path
+  return this->pointsInRange(series.name(), qrange);
+}
 
-  // if the requested range is not in memcache, then fetch it.
-  if ( intersect == TimeRange::intersect_other_internal || intersect == TimeRange::intersect_equal ) {
-    return DB_PR_SUPER::pointsInRange(id, qrange);
-  }
-  else {
-    vector<Point> left, middle, right;
-    TimeRange n_range;
+std::vector<Point> DbPointRecord::pointsInRange(const string& id, TimeRange qrange) {
+  vector<vector<Point> > fetched;
+  {
+    std::shared_lock lock(_db_readwrite); // get a read lock
     
-    if (intersect == TimeRange::intersect_left) {
-      // left-fill query
-      n_range.start = qrange.start;
-      n_range.end = range.start;
-      middle = this->pointsWithOpcFilter(_adapter->selectRange(id, n_range));
-      right = DB_PR_SUPER::pointsInRange(id, TimeRange(range.start, qrange.end));
-    }
-    else if (intersect == TimeRange::intersect_right) {
-      // right-fill query
-      n_range.start = range.end;
-      n_range.end = qrange.end;
-      left = DB_PR_SUPER::pointsInRange(id, TimeRange(qrange.start, range.end));
-      middle = this->pointsWithOpcFilter(_adapter->selectRange(id, n_range));
-    }
-    else if (intersect == TimeRange::intersect_other_external){
-      // query overlaps but extends on both sides
-      TimeRange q_left, q_right;
-      
-      q_left.start = qrange.start;
-      q_left.end = range.start;
-      q_right.start = range.end;
-      q_right.end = qrange.end;
-      
-      left = this->pointsWithOpcFilter(_adapter->selectRange(id, q_left));
-      middle = DB_PR_SUPER::pointsInRange(id, range);
-      right = this->pointsWithOpcFilter(_adapter->selectRange(id, q_right));
+    // limit double-queries, and the wide query optimization
+    if (this->requestCovers(id, qrange) || !checkConnected()) {
+      return DB_PR_SUPER::pointsInRange(id, qrange);
     }
-    else {
-      middle = this->pointsWithOpcFilter(_adapter->selectRange(id, qrange));
-    }
-    // db hit
     
-    vector<Point> merged;
-    merged.reserve(middle.size() + left.size() + right.size());
-    merged.insert(merged.end(), left.begin(), left.end());
-    merged.insert(merged.end(), middle.begin(), middle.end());
-    merged.insert(merged.end(), right.begin(), right.end());
-
-    set<time_t> addedTimes;
-    vector<Point> deDuped;
-    deDuped.reserve(merged.size());
-    for(const Point& p : merged) {
-      if (addedTimes.count(p.time) == 0) {
-        addedTimes.insert(p.time);
-        if (qrange.start <= p.time && p.time <= qrange.end) {
-          deDuped.push_back(p);
-        }
-      }
+    // if the requested range is not in memcache, then fetch the parts that are missing.
+    for (const TimeRange& r : this->rangesToFetch(id, qrange)) {
+      fetched.push_back(this->pointsWithOpcFilter(_adapter->selectRange(id, r)));
     }
-    
-    // mutation requires getting a write lock...
-    lock.unlock();
-    {
-      std::lock_guard lock2(_db_readwrite);
-      _last_request = (deDuped.size() > 0) ? request_t(id, qrange) : request_t(id,TimeRange());
+    if (fetched.empty()) {
+      return DB_PR_SUPER::pointsInRange(id, qrange);
+    }
+  }
+  // db hit
+  return this->mergeFetched(id, qrange, fetched);
+}
+
+DbPointRecord::WideQueryInfo DbPointRecord::wideQuery() {
+  std::shared_lock lock(_db_readwrite);
+  return _wideQuery;
+}
+
+bool DbPointRecord::requestCovers(const string& id, TimeRange qrange) {
+  if (_last_request.range.containsRange(qrange) && _last_request.id == id) {
+    return true;
+  }
+  return _wideQuery.valid() && _wideQuery.range().intersection(qrange) == TimeRange::intersect_other_internal;
+}
+
+std::vector<TimeRange> DbPointRecord::rangesToFetch(const string& id, TimeRange qrange) {
+  TimeRange range = DB_PR_SUPER::range(id);
+  switch (range.intersection(qrange)) {
+    case TimeRange::intersect_other_internal:
+    case TimeRange::intersect_equal:
+      return {};
+    case TimeRange::intersect_left: // left-fill query
+      return {TimeRange(qrange.start, range.start)};
+    case TimeRange::intersect_right: // right-fill query
+      return {TimeRange(range.end, qrange.end)};
+    case TimeRange::intersect_other_external: // query overlaps but extends on both sides
+      return {TimeRange(qrange.start, range.start), TimeRange(range.end, qrange.end)};
+    default:
+      return {qrange};
+  }
+}
+
+std::vector<Point> DbPointRecord::mergeFetched(const string& id, TimeRange qrange, const vector<vector<Point> >& fetched) {
+  // fetched points first, so that they win over buffered points at the same time
+  vector<Point> merged;
+  for (const auto& points : fetched) {
+    merged.insert(merged.end(), points.begin(), points.end());
+  }
+  vector<Point> buffered = DB_PR_SUPER::pointsInRange(id, qrange);
+  merged.insert(merged.end(), buffered.begin(), buffered.end());
+  std::stable_sort(merged.begin(), merged.end(), &Point::comparePointTime);
+  
+  vector<Point> deDuped;
+  deDuped.reserve(merged.size());
+  for (const Point& p : merged) {
+    if ((deDuped.empty() || deDuped.back().time != p.time) && qrange.start <= p.time && p.time <= qrange.end) {
+      deDuped.push_back(p);
     }
-    DB_PR_SUPER::addPoints(id, deDuped);
-    return deDuped;
   }
+  
+  // mutation requires getting a write lock...
+  {
+    std::lock_guard lock(_db_readwrite);
+    _wideQuery = WideQueryInfo(); // the request was not covered by the wide query, and the cache is about to change
+    _last_request = (deDuped.size() > 0) ? request_t(id, qrange) : request_t(id,TimeRange());
+  }
+  DB_PR_SUPER::addPoints(id, deDuped);
+  return deDuped;
 }
 
 
 void DbPointRecord::addPoint(const string& id, Point point) {
+  if (_spool) {
+    if (this->readonly()) {
+      return;
+    }
+    {
+      // as without a spool, a lone point only goes to the single-point cache. in the buffer it would read as a gap and reset it.
+      std::lock_guard lock(_db_readwrite);
+      DB_PR_SUPER::addPoint(id, point);
+    }
+    _spool->append(id, {point});
+    return;
+  }
   std::lock_guard lock(_db_readwrite); // get a write lock
   if (!this->readonly() && checkConnected()) {
     DB_PR_SUPER::addPoint(id, point);
@@ -627,6 +898,22 @@ void DbPointRecord::addPoint(const string& id, Point point) {
 
 
 void DbPointRecord::addPoints(const string& id, std::vector<Point> points) {
+  if (_spool) {
+    if (points.size() == 1) {
+      this->addPoint(id, points.front());
+      return;
+    }
+    if (this->readonly()) {
+      return;
+    }
+    {
+      std::lock_guard lock(_db_readwrite);
+      DB_PR_SUPER::addPoints(id, points);
+    }
+    // outside the record lock: a full spool blocks here while the drainer needs that lock to deliver
+    _spool->append(id, points);
+    return;
+  }
   std::lock_guard lock(_db_readwrite); // get a write lock
   if (!this->readonly() && checkConnected()) {
     DB_PR_SUPER::addPoints(id, points);
@@ -634,6 +921,73 @@ void DbPointRecord::addPoints(const string& id, std::vector<Point> points) {
   }
 }
 
+void DbPointRecord::addPointRows(const pointRows_t& rows) {
+  if (_spool) {
+    if (this->readonly()) {
+      return;
+    }
+    {
+      std::lock_guard lock(_db_readwrite);
+      for (const auto& row : rows) {
+        DB_PR_SUPER::addPoint(row.first, row.second);
+      }
+    }
+    _spool->appendRows(rows);
+    return;
+  }
+  std::lock_guard lock(_db_readwrite); // get a write lock
+  if (!this->readonly() && checkConnected()) {
+    for (const auto& row : rows) {
+      DB_PR_SUPER::addPoint(row.first, row.second);
+    }
+    _adapter->insertRows(rows);
+  }
+}
+
+
+#pragma mark - write spool
+
+void DbPointRecord::enableWriteSpool(const std::string& directory, size_t maxBytes, bool replay) {
+  this->disableWriteSpool();
+  _spool.reset(new WriteSpool(directory, maxBytes, replay, [this](const vector<WriteSpool::Entry>& batch)->bool {
+    return this->deliverSpooled(batch);
+  }));
+}
+
+void DbPointRecord::disableWriteSpool() {
+  _spool.reset(); // joins the drainer; undelivered entries stay on disk
+}
+
+bool DbPointRecord::hasWriteSpool() {
+  return (bool)_spool;
+}
+
+bool DbPointRecord::waitForWriteSpool(int seconds) {
+  return _spool ? _spool->waitForDrain(seconds) : true;
+}
+
+bool DbPointRecord::deliverSpooled(const vector<WriteSpool::Entry>& batch) {
+  {
+    std::lock_guard lock(_db_readwrite);
+    if (this->readonly() || !checkConnected()) {
+      return false;
+    }
+  }
+  // the adapter serializes its own writes, so readers of this record are not held up by the network.
+  // delivery is at-least-once: a batch that fails part way is sent again in full, and the spool
+  // moves past it only once the adapter has confirmed every write.
+  pointRows_t rows;
+  for (const auto& entry : batch) {
+    for (const Point& p : entry.points) {
+      rows.push_back(make_pair(entry.id, p));
+    }
+  }
+  _adapter->beginTransaction();
+  _adapter->insertRows(rows);
+  _adapter->endTransaction();
+  return _adapter->confirmWrites();
+}
+
 
 void DbPointRecord::truncate() {
   std::lock_guard lock(_db_readwrite); // get a write lock
@@ -11,12 +11,14 @@
 
 #define DB_PR_SUPER BufferPointRecord
 
+#include <memory>
 #include <set>
 #include <shared_mutex>
 
 #include "BufferPointRecord.h"
 #include "rtxExceptions.h"
 #include "DbAdapter.h"
+#include "WriteSpool.h"
 
 
 namespace RTX {
@@ -51,6 +53,13 @@ namespace RTX {
     //// insert
     void addPoint(const string& id, Point point);
     void addPoints(const string& id, std::vector<Point> points);
+    //// handle-keyed: answered from the cache without string work where possible, otherwise as above
+    Point point(const SeriesHandle& series, time_t time);
+    Point pointBefore(const SeriesHandle& series, time_t time, WhereClause q = WhereClause());
+    Point pointAfter(const SeriesHandle& series, time_t time, WhereClause q = WhereClause());
+    std::vector<Point> pointsInRange(const SeriesHandle& series, TimeRange range);
+    void addPoints(const SeriesHandle& series, std::vector<Point> points);
+    void addPointRows(const pointRows_t& rows);
     //// drop
     void reset();
     void reset(const string& id);
@@ -69,7 +78,33 @@ namespace RTX {
     void beginBulkOperation();
     void endBulkOperation();
     
+    // write spool: inserts are appended to a local log and delivered to the database in the background.
+    // with replay set, anything left undelivered by a previous run is sent first.
+    void enableWriteSpool(const std::string& directory, size_t maxBytes, bool replay = true);
+    void disableWriteSpool(); // subclasses call this before releasing the adapter
+    bool hasWriteSpool();
+    bool waitForWriteSpool(int seconds);
+    
+    // asynchronous reads. the database round trips overlap; filtering and caching of each result
+    // happen in the thread that calls get(). a cancelled request resolves empty.
+    std::future<std::vector<Point> > pointsInRangeAsync(const string& id, TimeRange range, DbAdapter::cancelToken_t cancel = DbAdapter::cancelToken_t());
+    std::future<Point> pointBeforeAsync(const string& id, time_t time, DbAdapter::cancelToken_t cancel = DbAdapter::cancelToken_t());
+    std::future<Point> pointAfterAsync(const string& id, time_t time, DbAdapter::cancelToken_t cancel = DbAdapter::cancelToken_t());
+    std::future<void> willQueryAsync(TimeRange range, DbAdapter::cancelToken_t cancel = DbAdapter::cancelToken_t());
+    
+    // live data: where the adapter can push (OPC UA subscriptions), samples are added to the cache
+    // as they arrive and, if a destination is set, written through to it.
+    bool subscribe(const std::vector<std::string>& ids);
+    void unsubscribe();
+    void setSubscriptionDestination(PointRecord::_sp destination);
+    
     void willQuery(TimeRange range);
+    void willQuery(const std::vector<std::string>& ids, TimeRange range); // prefetch many series together
+    
+    // a prefetch grows each series' buffer by at most this many points. a series that reaches the limit
+    // keeps its earliest points, and reads past them go to the database.
+    void setPrefetchLimit(size_t pointsPerSeries);
+    size_t prefetchLimit();
     
     std::vector<Point> pointsWithQuery(const std::string& query, TimeRange range);
 
@@ -113,6 +148,7 @@ namespace RTX {
     
     Point searchPreviousIteratively(const string& id, time_t time);
     Point searchNextIteratively(const string& id, time_t time);
+    std::future<Point> pointNearAsync(const string& id, time_t time, bool after, DbAdapter::cancelToken_t cancel);
     
     int iterativeSearchStride;
     int iterativeSearchMaxIterations;
@@ -124,6 +160,7 @@ namespace RTX {
     public:
       TimeRange range;
       std::string id;
+      size_t key; // interned handle key of id
       request_t(std::string id, TimeRange range);
       bool contains(std::string id, time_t t);
       void clear();
@@ -144,6 +181,13 @@ namespace RTX {
     
     WideQueryInfo _wideQuery;
     
+    // range reads: whether the last request or the wide query already answers (read lock held), the parts
+    // of a range that the buffer is missing, and the merge of fetched parts into the buffer (takes the write lock).
+    WideQueryInfo wideQuery(); // a copy, under the read lock
+    bool requestCovers(const string& id, TimeRange qrange);
+    std::vector<TimeRange> rangesToFetch(const string& id, TimeRange qrange);
+    std::vector<Point> mergeFetched(const string& id, TimeRange qrange, const std::vector<std::vector<Point> >& fetched);
+    
     
   private:
     bool checkConnected();
@@ -151,6 +195,7 @@ namespace RTX {
     std::vector<Point> pointsWithOpcFilter(std::vector<Point> points);
     
     bool _readOnly;
+    size_t _prefetchLimit;
     bool _badConnection = false;
     std::chrono::time_point<std::chrono::system_clock> _lastFailedAttempt;
     std::set<unsigned int> _opcFilterCodes;
@@ -158,6 +203,13 @@ namespace RTX {
     std::shared_mutex _db_readwrite;
     
     std::function<Point(Point)> _opcFilter;
+    std::unique_ptr<WriteSpool> _spool;
+    bool deliverSpooled(const std::vector<WriteSpool::Entry>& batch);
+    
+    void receiveSubscribed(const std::string& id, std::vector<Point>& points);
+    std::mutex _subscriptionMtx;
+    std::map<std::string, Point> _lastSubscribed;
+    PointRecord::_sp _subscriptionDestination;
     
     
     
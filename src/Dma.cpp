@@ -276,7 +276,7 @@ bool Dma::doesContainReservoir() {
 //}
 
 
-void Dma::initDemandTimeseries(const set<Pipe::_sp> &boundarySet) {
+void Dma::initDemandTimeseries(const set<Pipe::_sp> &boundarySet, bool computeHashedName) {
   // set up a fixed 1-m clock for constant series
   Clock::_sp fixed_minute_clock(new Clock(60));
   
@@ -387,8 +387,9 @@ void Dma::initDemandTimeseries(const set<Pipe::_sp> &boundarySet) {
     this->setDemand(constDma);
   }
   
-  
-  
+  if (!computeHashedName) {
+    return;
+  }
   
   set<string> flowMeasuredPipes, closedBoundaryPipes, tanks, junctions;
   for (auto p : this->measuredBoundaryPipes()) {
@@ -668,6 +669,10 @@ TimeSeries::_sp Dma::boundaryDemand() {
 }
 
 int Dma::allocateDemandToJunctions(time_t time) {
+  return this->allocateDemandToJunctions(time, [](TimeSeries::_sp ts, time_t t) { return ts->pointAtOrBefore(t); });
+}
+
+int Dma::allocateDemandToJunctions(time_t time, pointLookup_t pointAtOrBefore) {
   // get each node's base demand for the current time
   // add the base demands together. this is the total base demand.
   // get the input demand value for the current time - from the demand() method
@@ -689,7 +694,7 @@ int Dma::allocateDemandToJunctions(time_t time) {
   for(Junction::_sp junction : _junctions) {
     
     if ( junction->boundaryFlow() ) {
-      Point dp = junction->boundaryFlow()->pointAtOrBefore(time);
+      Point dp = pointAtOrBefore(junction->boundaryFlow(), time);
       if (dp.isValid) {
         double demand = Units::convertValue(dp.value, junction->boundaryFlow()->units(), myUnits);
         meteredDemand += demand;
@@ -708,7 +713,7 @@ int Dma::allocateDemandToJunctions(time_t time) {
   
   // now we have the total (nominal) base demand for the dma.
   // total demand for the dma (includes metered and unmetered) -- already in myUnits.
-  Point dPoint = this->demand()->pointAtOrBefore(time);
+  Point dPoint = pointAtOrBefore(this->demand(), time);
   if (dPoint.isValid) {
     dmaDemand = dPoint.value;
     allocableDemand = dmaDemand - meteredDemand; // the total unmetered demand
@@ -730,7 +735,7 @@ int Dma::allocateDemandToJunctions(time_t time) {
     if (junction->boundaryFlow()) {
       // junction does have boundary flow...
       // just need to copy the boundary flow into the junction's demand time series
-      Point dp = junction->boundaryFlow()->pointAtOrBefore(time);
+      Point dp = pointAtOrBefore(junction->boundaryFlow(), time);
       if (dp.isValid) {
         Point newDemandPoint = Point::convertPoint(dp, junction->boundaryFlow()->units(), junction->demand()->units());
         newDemandPoint.time = time;
@@ -11,6 +11,7 @@
 
 #include <vector>
 #include <set>
+#include <functional>
 #include "rtxMacros.h"
 #include "TimeSeries.h"
 #include "Junction.h"
@@ -75,7 +76,7 @@ namespace RTX {
     
     virtual void setRecord(PointRecord::_sp record);
     
-    void initDemandTimeseries(const std::set<Pipe::_sp> &boundarySet);
+    void initDemandTimeseries(const std::set<Pipe::_sp> &boundarySet, bool computeHashedName = true); // false keeps a known hashedName
     
     // node accessors
     void addJunction(Junction::_sp junction);
@@ -108,6 +109,8 @@ namespace RTX {
     
     // business logic
     virtual int allocateDemandToJunctions(time_t time);
+    typedef std::function<Point(TimeSeries::_sp, time_t)> pointLookup_t;
+    int allocateDemandToJunctions(time_t time, pointLookup_t pointAtOrBefore); // inputs read through the lookup
     
     std::string hashedName;
     
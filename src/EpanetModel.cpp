@@ -31,18 +31,32 @@ EpanetModel::EpanetModel() : Model() {
 }
 
 EpanetModel::~EpanetModel() {
+  this->stopPipeline();
   this->closeEngine();
   EN_API_CHECK( EN_close(_enModel), "EN_close");
   //  EN_API_CHECK(EN_freeModel(_enModel), "EN_freeModel");
 }
 
 EpanetModel::EpanetModel(const EpanetModel& o) {
+  _enOpened = false;
+  try {
+    this->useEpanetFile(o._modelFile);
+  }
+  catch(const std::string& errStr) {
+    throw RtxException("File Loading Error: " + errStr);
+  }
+  // the wrappers come from the source, so the file must still hold the same elements at the same indexes
+  if (_nodeIndex != o._nodeIndex || _linkIndex != o._linkIndex) {
+    EN_close(_enModel);
+    throw RtxException("File Loading Error: " + o._modelFile + " no longer matches the model being copied");
+  }
+  this->copyRtxWrappers(const_cast<EpanetModel&>(o));
+}
 
-  cout << "copy ctor : EpanetModel" << endl;
-
-  this->useEpanetFile(o._modelFile);
-  this->createRtxWrappers();
-
+EpanetModel::_sp EpanetModel::clone() {
+  EpanetModel::_sp model(new EpanetModel(*this));
+  model->copyConfigurationFrom(*this);
+  return model;
 }
 
 EN_Project EpanetModel::epanetModelPointer() {
@@ -60,6 +74,21 @@ EpanetModel::EpanetModel(const std::string& filename) {
   }
 }
 
+EpanetModel::EpanetModel(const std::string& filename, const std::string& snapshotDirectory) {
+  try {
+    this->useEpanetFile(filename);
+    this->setSnapshotDirectory(snapshotDirectory);
+    if (!this->loadElementSnapshot()) {
+      this->createRtxWrappers();
+      this->saveElementSnapshot();
+    }
+  }
+  catch(const std::string& errStr) {
+    std::cerr << "ERROR: ";
+    throw RtxException("File Loading Error: " + errStr);
+  }
+}
+
 #pragma mark - Loading
 
 void EpanetModel::useEpanetModel(EN_Project model, string path) {
@@ -547,6 +576,112 @@ void EpanetModel::createRtxWrappers() {
 
 }
 
+void EpanetModel::copyRtxWrappers(EpanetModel& source) {
+  // the same elements as createRtxWrappers would make, from the source's wrappers instead of the engine.
+  // curves are shared: nothing changes them once the model is loaded.
+  for (Curve::_sp curve : source.curves()) {
+    this->addCurve(curve);
+  }
+
+  auto copyNode = [](Junction::_sp from, Junction::_sp to) {
+    to->head()->setUnits(from->head()->units());
+    to->pressure()->setUnits(from->pressure()->units());
+    to->demand()->setUnits(from->demand()->units());
+    to->quality()->setUnits(from->quality()->units());
+    to->setElevation(from->elevation());
+    to->setCoordinates(from->coordinates());
+    to->state_quality = from->state_quality;
+    to->setBaseDemand(from->baseDemand());
+    to->setUserDescription(from->userDescription());
+  };
+  auto copyLink = [](Pipe::_sp from, Pipe::_sp to) {
+    to->setDiameter(from->diameter());
+    to->setLength(from->length());
+    to->setRoughness(from->roughness());
+    to->setMinorLoss(from->minorLoss());
+    to->setFixedStatus(from->fixedStatus());
+    to->flow()->setUnits(from->flow()->units());
+    to->setUserDescription(from->userDescription());
+  };
+
+  // in the source's element order, so the element lists line up with the source's
+  for (Element::_sp e : source.elements()) {
+    switch (e->type()) {
+      case Element::TANK:
+      {
+        Tank::_sp from = static_pointer_cast<Tank>(e);
+        Tank::_sp newTank( new Tank(from->name()) );
+        addTank(newTank);
+        newTank->setMinMaxLevel(from->minLevel(), from->maxLevel());
+        newTank->level()->setUnits(from->level()->units());
+        newTank->flowCalc()->setUnits(from->flowCalc()->units());
+        newTank->volumeCalc()->setUnits(from->volumeCalc()->units());
+        newTank->flow()->setUnits(from->flow()->units());
+        newTank->volume()->setUnits(from->volume()->units());
+        newTank->setGeometry(from->geometry());
+        copyNode(from, newTank);
+        break;
+      }
+      case Element::RESERVOIR:
+      {
+        Reservoir::_sp from = static_pointer_cast<Reservoir>(e);
+        Reservoir::_sp newReservoir( new Reservoir(from->name()) );
+        addReservoir(newReservoir);
+        copyNode(from, newReservoir);
+        break;
+      }
+      case Element::JUNCTION:
+      {
+        Junction::_sp from = static_pointer_cast<Junction>(e);
+        Junction::_sp newJunction( new Junction(from->name()) );
+        addJunction(newJunction);
+        copyNode(from, newJunction);
+        break;
+      }
+      case Element::PIPE:
+      case Element::PUMP:
+      case Element::VALVE:
+      {
+        Pipe::_sp from = static_pointer_cast<Pipe>(e);
+        Node::_sp startNode = nodeWithName(from->from()->name());
+        Node::_sp endNode = nodeWithName(from->to()->name());
+        if (! (startNode && endNode) ) {
+          std::cerr << "could not find nodes for link " << from->name() << std::endl;
+          throw "nodes not found";
+        }
+        Pipe::_sp newPipe;
+        if (e->type() == Element::PUMP) {
+          Pump::_sp fromPump = static_pointer_cast<Pump>(e);
+          Pump::_sp newPump( new Pump(from->name()) );
+          newPump->setNodes(startNode, endNode);
+          addPump(newPump);
+          newPump->setHeadCurve(fromPump->headCurve());
+          newPump->setEfficiencyCurve(fromPump->efficiencyCurve());
+          newPipe = newPump;
+        }
+        else if (e->type() == Element::VALVE) {
+          Valve::_sp fromValve = static_pointer_cast<Valve>(e);
+          Valve::_sp newValve( new Valve(from->name()) );
+          newValve->setNodes(startNode, endNode);
+          newValve->valveType = fromValve->valveType;
+          newValve->fixedSetting = fromValve->fixedSetting;
+          addValve(newValve);
+          newPipe = newValve;
+        }
+        else {
+          newPipe.reset( new Pipe(from->name()) );
+          newPipe->setNodes(startNode, endNode);
+          addPipe(newPipe);
+        }
+        copyLink(from, newPipe);
+        break;
+      }
+      default:
+        break;
+    }
+  }
+}
+
 void EpanetModel::overrideControls() {
   // set up counting variables for creating model elements.
   int nodeCount, tankCount;
@@ -690,6 +825,16 @@ void EpanetModel::setReservoirQuality(const string& reservoir, double quality) {
   setNodeValue(EN_SOURCEQUAL, reservoir, quality);
 }
 
+void EpanetModel::setDemandMultiplier(double multiplier) {
+  EN_API_CHECK( EN_setoption(_enModel, EN_DEMANDMULT, multiplier), "EN_setoption(EN_DEMANDMULT)" );
+}
+
+double EpanetModel::demandMultiplier() {
+  double multiplier = 1;
+  EN_API_CHECK( EN_getoption(_enModel, EN_DEMANDMULT, &multiplier), "EN_getoption(EN_DEMANDMULT)" );
+  return multiplier;
+}
+
 void EpanetModel::setTankLevel(const string& tank, double level) {
   // just refer to the reservoir method, since in epanet they are the same thing.
   setReservoirHead(tank, level);
@@ -846,6 +991,63 @@ double EpanetModel::pipeEnergy(const string &name) {
   return getLinkValue(EN_ENERGY, name);
 }
 
+#pragma mark Bulk
+
+void EpanetModel::prepareEngineIndices() {
+  _junctionEnIndex.clear();
+  _junctionDemandCount.clear();
+  _linkEnIndex.clear();
+  
+  for(Junction::_sp junction : this->junctions()) {
+    int nodeIndex = _nodeIndex[junction->name()];
+    int numDemands = 0;
+    EN_API_CHECK( EN_getnumdemands(_enModel, nodeIndex, &numDemands), "EN_getnumdemands()");
+    _junctionEnIndex.push_back(nodeIndex);
+    _junctionDemandCount.push_back(numDemands);
+  }
+  for(Pipe::_sp pipe : _exchangeLinks) {
+    _linkEnIndex.push_back(_linkIndex[pipe->name()]);
+  }
+}
+
+void EpanetModel::getNodeValues(int epanetCode, std::vector<double>& values) {
+  values.resize(_junctionEnIndex.size());
+  for (size_t i = 0; i < _junctionEnIndex.size(); ++i) {
+    EN_API_CHECK(EN_getnodevalue(_enModel, _junctionEnIndex[i], epanetCode, &values[i]), "EN_getnodevalue");
+  }
+}
+
+void EpanetModel::junctionHeads(std::vector<double>& heads) {
+  getNodeValues(EN_HEAD, heads);
+}
+
+void EpanetModel::junctionPressures(std::vector<double>& pressures) {
+  getNodeValues(EN_PRESSURE, pressures);
+}
+
+void EpanetModel::junctionDemands(std::vector<double>& demands) {
+  getNodeValues(EN_DEMAND, demands);
+}
+
+void EpanetModel::linkFlows(std::vector<double>& flows) {
+  flows.resize(_linkEnIndex.size());
+  for (size_t i = 0; i < _linkEnIndex.size(); ++i) {
+    EN_API_CHECK(EN_getlinkvalue(_enModel, _linkEnIndex[i], EN_FLOW, &flows[i]), "EN_getlinkvalue");
+  }
+}
+
+void EpanetModel::setJunctionDemands(const std::vector<double>& demands) {
+  // same convention as setJunctionDemand: the last category carries the total
+  for (size_t i = 0; i < _junctionEnIndex.size() && i < demands.size(); ++i) {
+    const int nodeIndex = _junctionEnIndex[i];
+    const int numDemands = _junctionDemandCount[i];
+    for (int demandIdx = 1; demandIdx < numDemands; demandIdx++) {
+      EN_API_CHECK( EN_setbasedemand(_enModel, nodeIndex, demandIdx, 0.0), "EN_setbasedemand()" );
+    }
+    EN_API_CHECK( EN_setbasedemand(_enModel, nodeIndex, numDemands, demands[i]), "EN_setbasedemand()" );
+  }
+}
+
 #pragma mark - Sim options
 void EpanetModel::enableControls() {
   for (int i = 1; i <= _controlCount; ++i) {
@@ -33,8 +33,10 @@ namespace RTX {
     RTX_BASE_PROPS(EpanetModel);
     EpanetModel();
     EpanetModel(const std::string& filename);
-    EpanetModel(const EpanetModel& o); // copy constructor
+    EpanetModel(const std::string& filename, const std::string& snapshotDirectory); // wrappers from a snapshot when one matches
+    EpanetModel(const EpanetModel& o); // copy constructor: own engine, element wrappers copied from o
     ~EpanetModel();
+    EpanetModel::_sp clone(); // an independent engine with this model's configuration
 //    void loadModelFromFile(const std::string& filename) throw(std::exception);
     virtual void initEngine();
     virtual void closeEngine();
@@ -79,6 +81,15 @@ namespace RTX {
     void setPumpSettingControl(const std::string& pump, double setting, enableControl_t);
     void setValveSetting(const std::string& valve, double setting);
     void setValveSettingControl(const std::string& valve, double setting, enableControl_t);
+    void setDemandMultiplier(double multiplier);
+    double demandMultiplier();
+    
+    // bulk
+    void junctionHeads(std::vector<double>& heads);
+    void junctionPressures(std::vector<double>& pressures);
+    void junctionDemands(std::vector<double>& demands);
+    void linkFlows(std::vector<double>& flows);
+    void setJunctionDemands(const std::vector<double>& demands);
 
     // quality
     void setJunctionQuality(const std::string& junction, double quality);
@@ -112,6 +123,8 @@ namespace RTX {
     double getLinkValue(int epanetCode, const std::string& link);
     void setLinkValue(int epanetCode, const std::string& link, double value);
     void setComment(Element::_sp element, const std::string& comment);
+    virtual void prepareEngineIndices();
+    void getNodeValues(int epanetCode, std::vector<double>& values);
     
     EN_Project _enModel; // protected scope so subclasses can use epanet api
     
@@ -120,10 +133,12 @@ namespace RTX {
     std::map<std::string, int> _linkIndex;
     std::map<std::string, int> _statusControlIndex;
     std::map<std::string, int> _settingControlIndex;
+    std::vector<int> _junctionEnIndex, _junctionDemandCount, _linkEnIndex; // parallel to junctions() and the exchanged links
     // TODO - use boost filesystem instead of std::string path
 //    std::string _modelFile;
     
     void createRtxWrappers();
+    void copyRtxWrappers(EpanetModel& source);
     bool _didConverge(time_t time, int errorCode);
     bool _enOpened;
     int _controlCount;
@@ -1,10 +1,13 @@
 #include <regex>
+#include <set>
+#include <atomic>
+#include <mutex>
+#include <cstring>
 #include <boost/lexical_cast.hpp>
 #include <boost/algorithm/string/replace.hpp>
 
-#include <boost/iostreams/filtering_streambuf.hpp>
-#include <boost/iostreams/copy.hpp>
-#include <boost/iostreams/filter/gzip.hpp>
+#include <charconv>
+#include <zlib.h>
 
 #include <boost/asio.hpp>
 #include <boost/algorithm/string/find.hpp>
@@ -17,8 +20,15 @@
 #include "InfluxClient.hpp"
 
 #include "MetricInfo.h"
+#include "SeriesHandle.h"
 
 #define RTX_INFLUX_CLIENT_TIMEOUT 30
+#define RTX_INFLUX_DEFAULT_CHUNK_SIZE 10000
+#define RTX_INFLUX_DEFAULT_MAX_PARALLEL 8
+#define RTX_INFLUX_DEFAULT_MAX_INFLIGHT 4
+#define RTX_INFLUX_DEFAULT_DATAGRAM_SIZE 1400 // fits a 1500 byte ethernet MTU with room for tunnel headers
+#define RTX_INFLUX_UDP_QUEUE_DATAGRAMS 8192
+#define RTX_INFLUX_STATEMENTS_PER_REQUEST 50
 
 using namespace std;
 using namespace RTX;
@@ -52,11 +62,16 @@ InfluxAdapter::connectionInfo::connectionInfo() {
   port = 0;
   validate = true;
   msec_ratelimit = 0;
+  chunk_size = RTX_INFLUX_DEFAULT_CHUNK_SIZE;
+  max_parallel = RTX_INFLUX_DEFAULT_MAX_PARALLEL;
+  max_inflight = RTX_INFLUX_DEFAULT_MAX_INFLIGHT;
+  datagram_size = RTX_INFLUX_DEFAULT_DATAGRAM_SIZE;
 }
 /***************************************************************************************/
 
 InfluxAdapter::InfluxAdapter( errCallback_t cb ) : DbAdapter(cb) {
   _inTransaction = false;
+  _transactionLineCount = 0;
   _connected = false;
 }
 InfluxAdapter::~InfluxAdapter() {
@@ -87,7 +102,11 @@ void InfluxAdapter::setConnectionString(const std::string& str) {
     {"u", [&](string v){this->conn.user = v;}},
     {"p", [&](string v){this->conn.pass = v;}},
     {"validate", [&](string v){this->conn.validate = boost::lexical_cast<bool>(v);}},
-    {"ratelimit", [&](string v){this->conn.msec_ratelimit = boost::lexical_cast<int>(v);}}
+    {"ratelimit", [&](string v){this->conn.msec_ratelimit = boost::lexical_cast<int>(v);}},
+    {"chunksize", [&](string v){this->conn.chunk_size = boost::lexical_cast<int>(v);}},
+    {"parallel", [&](string v){this->conn.max_parallel = boost::lexical_cast<int>(v);}},
+    {"inflight", [&](string v){this->conn.max_inflight = boost::lexical_cast<int>(v);}},
+    {"datagram", [&](string v){this->conn.datagram_size = boost::lexical_cast<int>(v);}}
   }); 
   
   for (auto kv : kvPairs) {
@@ -111,73 +130,87 @@ void InfluxAdapter::beginTransaction() {
   _inTransaction = true;
   {
     _RTX_DB_SCOPED_LOCK;
-    _transactionLines.clear();
+    _transactionBuffer.clear();
+    _transactionLineCount = 0;
   }
 }
 void InfluxAdapter::endTransaction() {
   if (!_inTransaction) {
     return;
   }
-  this->commitTransactionLines();
+  // out of the transaction first, so that the last send is waited for like any other write outside one
   _inTransaction = false;
+  this->commitTransactionLines();
+  _RTX_DB_SCOPED_LOCK;
+  this->waitForSends(0);
 }
 
 void InfluxAdapter::commitTransactionLines() {
-  {
-    _RTX_DB_SCOPED_LOCK;
-    if (_transactionLines.size() == 0) {
-      return;
-    }
+  _RTX_DB_SCOPED_LOCK;
+  this->sendTransactionBuffer();
+}
+
+void InfluxAdapter::sendTransactionBuffer() {
+  if (_transactionLineCount == 0) {
+    return;
   }
+  // hand the filled buffer off to the sender and keep writing into a recycled one
+  string content = this->takeBuffer();
+  content.swap(_transactionBuffer);
+  _transactionLineCount = 0;
+  this->sendPointsWithString(std::move(content));
+}
+
+void InfluxAdapter::appendTransactionLine(const string& line) {
   {
-    string concatLines;
     _RTX_DB_SCOPED_LOCK;
-    auto curs = _transactionLines.begin();
-    auto end = _transactionLines.end();
-    size_t iLine = 0;
-    while (curs != end) {
-      const string str = *curs;
-      ++iLine;
-      concatLines.append(str);
-      concatLines.append("\n");
-      // check for max lines (must respect max lines per send event)
-      if (iLine >= this->maxTransactionLines()) {
-        // push these lines and clear the queue
-        this->sendPointsWithString(concatLines);
-        concatLines.clear();
-        iLine = 0;
-      }
-      ++curs;
-    }
-    if (iLine > 0) {
-      // push all/remaining points out
-      this->sendPointsWithString(concatLines);
+    _transactionBuffer.append(line);
+    _transactionBuffer.push_back('\n');
+    if (++_transactionLineCount >= this->maxTransactionLines()) {
+      this->sendTransactionBuffer();
     }
-    _transactionLines.clear();
+  }
+  if (!_inTransaction) {
+    this->commitTransactionLines();
+  }
+}
+
+string InfluxAdapter::takeBuffer() {
+  std::lock_guard<std::mutex> lock(_spareBuffersMtx);
+  if (_spareBuffers.empty()) {
+    return string();
+  }
+  string buffer = std::move(_spareBuffers.back());
+  _spareBuffers.pop_back();
+  return buffer;
+}
+
+void InfluxAdapter::recycleBuffer(string&& buffer) {
+  buffer.clear();
+  std::lock_guard<std::mutex> lock(_spareBuffersMtx);
+  if (_spareBuffers.size() < 16) {
+    _spareBuffers.push_back(std::move(buffer));
   }
 }
 
 
 bool InfluxAdapter::insertIdentifierAndUnits(const std::string &id, RTX::Units units) {
   
-  MetricInfo m(id);
+  MetricInfo m = SeriesHandle::intern(id)->metric();
   m.tags.erase("units"); // get rid of units if they are included.
   string properId = m.name();
   
   _idCache.set(properId, units);
+  {
+    _RTX_DB_SCOPED_LOCK;
+    _lineKeys.clear();
+  }
   
   // insert a field key/value for something that we won't ever query again.
   // pay attention to bulk operations here, since we may be inserting new ids en-masse
   string tsNameEscaped = influxIdForTsId(id);
   boost::replace_all(tsNameEscaped, " ", "\\ ");
-  const string content(tsNameEscaped + " exist=true");
-  if (_inTransaction) {
-    _RTX_DB_SCOPED_LOCK;
-    _transactionLines.push_back(content);
-  }
-  else {
-    this->sendPointsWithString(content);
-  }
+  this->appendTransactionLine(tsNameEscaped + " exist=true");
   // no futher validation.
   return true;
 }
@@ -191,27 +224,58 @@ void InfluxAdapter::insertRange(const std::string& id, std::vector<Point> points
   if (points.size() == 0) {
     return;
   }
-  string dbId = influxIdForTsId(id);
-  auto content = this->insertionLinesFromPoints(dbId, points);
+  string tsNameEscaped = influxIdForTsId(id);
+  boost::replace_all(tsNameEscaped, " ", "\\ ");
   
-  if (_inTransaction) {
-    size_t nLines = 0;
-    { // mutex
-      _RTX_DB_SCOPED_LOCK;
-      for (auto s : content) {
-        _transactionLines.push_back(s);
+  { // mutex
+    _RTX_DB_SCOPED_LOCK;
+    // encode in slices so that no request exceeds the per-send line limit
+    const size_t maxLines = this->maxTransactionLines();
+    auto cursor = points.cbegin();
+    while (cursor != points.cend()) {
+      const size_t room = maxLines > _transactionLineCount ? maxLines - _transactionLineCount : 1;
+      const size_t n = std::min(room, (size_t)(points.cend() - cursor));
+      this->appendLinesFromPoints(_transactionBuffer, tsNameEscaped, cursor, cursor + n);
+      _transactionLineCount += n;
+      cursor += n;
+      if (_transactionLineCount >= maxLines) {
+        this->sendTransactionBuffer();
       }
-      nLines = _transactionLines.size();
-    } // end mutex
-    if (nLines > maxTransactionLines()) {
-      this->commitTransactionLines();
     }
-  }
-  else {
-    _transactionLines = content;
+  } // end mutex
+  
+  if (!_inTransaction) {
     this->commitTransactionLines();
   }
+}
+
+
+void InfluxAdapter::insertRows(const std::vector<std::pair<std::string, Point> >& rows) {
+  if (rows.size() == 0) {
+    return;
+  }
+  
+  { // mutex
+    _RTX_DB_SCOPED_LOCK;
+    // every row is encoded into the one transaction buffer; series keys are resolved once and kept
+    const size_t maxLines = this->maxTransactionLines();
+    for (const auto& row : rows) {
+      auto key = _lineKeys.find(row.first);
+      if (key == _lineKeys.end()) {
+        string tsNameEscaped = influxIdForTsId(row.first);
+        boost::replace_all(tsNameEscaped, " ", "\\ ");
+        key = _lineKeys.emplace(row.first, std::move(tsNameEscaped)).first;
+      }
+      this->appendLine(_transactionBuffer, key->second, row.second);
+      if (++_transactionLineCount >= maxLines) {
+        this->sendTransactionBuffer();
+      }
+    }
+  } // end mutex
   
+  if (!_inTransaction) {
+    this->commitTransactionLines();
+  }
 }
 
 
@@ -220,32 +284,12 @@ void InfluxAdapter::sendInfluxString(time_t time, const string& seriesId, const
   string tsNameEscaped = seriesId;
   boost::replace_all(tsNameEscaped, " ", "\\ ");
   
-  stringstream ss;
-  string timeStr = this->formatTimestamp(time);
-  
-  ss << tsNameEscaped << " " << values << " " << timeStr;
-  string data = ss.str();
-  
-  
-  if (_inTransaction) {
-    size_t nLines = 0;
-    {
-      _RTX_DB_SCOPED_LOCK;
-      _transactionLines.push_back(data);
-      nLines = _transactionLines.size();
-    }
-    if (nLines > maxTransactionLines()) {
-      this->commitTransactionLines();
-    }
-  }
-  else {
-    this->sendPointsWithString(data);
-  }
+  this->appendTransactionLine(tsNameEscaped + " " + values + " " + this->formatTimestamp(time));
 }
 
 string InfluxAdapter::influxIdForTsId(const string& id) {
-  // sort named keys into proper order...
-  MetricInfo m(id);
+  // sort named keys into proper order... the parse is cached on the interned handle
+  MetricInfo m = SeriesHandle::intern(id)->metric();
   if (m.tags.count("units")) {
     m.tags.erase("units");
   }
@@ -260,7 +304,28 @@ string InfluxAdapter::influxIdForTsId(const string& id) {
 }
 
 
-vector<string> InfluxAdapter::insertionLinesFromPoints(const string& tsName, vector<Point> points) {
+template<typename T>
+static inline void __appendNumber(string& buffer, T value) {
+  char digits[32];
+  auto res = std::to_chars(digits, digits + sizeof(digits), value);
+  buffer.append(digits, res.ptr - digits);
+}
+
+static inline void __appendLine(string& buffer, const string& tsNameEscaped, const Point& p, const char* suffix) {
+  buffer.append(tsNameEscaped);
+  buffer.append(" value=");
+  __appendNumber(buffer, p.value); // influxdb 0.10+ supports integers, but only when followed by trailing "i"
+  buffer.append(",quality=");
+  __appendNumber(buffer, (int)p.quality);
+  buffer.append("i,confidence=");
+  __appendNumber(buffer, p.confidence);
+  buffer.push_back(' ');
+  __appendNumber(buffer, (int64_t)p.time);
+  buffer.append(suffix);
+  buffer.push_back('\n');
+}
+
+void InfluxAdapter::appendLinesFromPoints(string& buffer, const string& tsNameEscaped, vector<Point>::const_iterator begin, vector<Point>::const_iterator end) {
   /*
    As you can see in the example below, you can post multiple points to multiple series at the same time by separating each point with a new line. Batching points in this manner will result in much higher performance.
    
@@ -270,20 +335,17 @@ vector<string> InfluxAdapter::insertionLinesFromPoints(const string& tsName, vec
    cpu_load_short,direction=in,host=server01,region=us-west value=23422.0 1422568543702900257'
    */
   
-  // escape any spaces in the tsName
-  string tsNameEscaped = tsName;
-  boost::replace_all(tsNameEscaped, " ", "\\ ");
-  vector<string> outData;
+  // lines are appended in place, so a reused buffer costs no allocations once it has grown.
+  const char* suffix = this->timestampSuffix();
+  buffer.reserve(buffer.size() + (end - begin) * (tsNameEscaped.size() + 80));
   
-  for(const Point& p: points) {
-    stringstream ss;
-    string valueStr = to_string(p.value); // influxdb 0.10+ supports integers, but only when followed by trailing "i"
-    string timeStr = this->formatTimestamp(p.time);
-    ss << tsNameEscaped << " value=" << valueStr << "," << "quality=" << (int)p.quality << "i," << "confidence=" << p.confidence << " " << timeStr;
-    outData.push_back(ss.str());
+  for(auto it = begin; it != end; ++it) {
+    __appendLine(buffer, tsNameEscaped, *it, suffix);
   }
-  
-  return outData;
+}
+
+void InfluxAdapter::appendLine(string& buffer, const string& tsNameEscaped, const Point& p) {
+  __appendLine(buffer, tsNameEscaped, p, this->timestampSuffix());
 }
 
 bool InfluxAdapter::assignUnitsToRecord(const std::string& name, const Units& units) {
@@ -348,20 +410,20 @@ std::string InfluxTcpAdapter::Query::nameAndWhereClause() {
 
 
 
-vector<Point> __pointsSingle(json& json);
-
 
 InfluxTcpAdapter::InfluxTcpAdapter( errCallback_t cb) : InfluxAdapter(cb) {
   //_sendTask.reset(new PplxTaskWrapper());
+  _sendsFailed = false;
 }
 
 //
 InfluxTcpAdapter::InfluxTcpAdapter( errCallback_t cb, std::shared_ptr<InfluxClient> rClient ) : InfluxAdapter(cb){
   this->_restClient = rClient;
+  _sendsFailed = false;
 }
 
 InfluxTcpAdapter::~InfluxTcpAdapter() {
-  
+  this->waitForSends(0);
 }
 
 shared_ptr<oatpp::web::client::RequestExecutor> InfluxTcpAdapter::createExecutor() {
@@ -429,6 +491,15 @@ std::string InfluxTcpAdapter::connectionString() {
       << "&u=" << this->conn.user
       << "&p=" << this->conn.pass
       << "&validate=" << (this->conn.validate ? 1 : 0);
+  if (this->conn.chunk_size != RTX_INFLUX_DEFAULT_CHUNK_SIZE) {
+    ss << "&chunksize=" << this->conn.chunk_size;
+  }
+  if (this->conn.max_parallel != RTX_INFLUX_DEFAULT_MAX_PARALLEL) {
+    ss << "&parallel=" << this->conn.max_parallel;
+  }
+  if (this->conn.max_inflight != RTX_INFLUX_DEFAULT_MAX_INFLIGHT) {
+    ss << "&inflight=" << this->conn.max_inflight;
+  }
   return ss.str();
 }
 
@@ -579,11 +650,12 @@ IdentifierUnitsList InfluxTcpAdapter::idUnitsList() {
   }
   // else nothing
   _idCache = ids;
+  _lineKeys.clear();
   return ids;
 }
 
 
-std::map<std::string, std::vector<Point> > InfluxTcpAdapter::wideQuery(TimeRange range) {
+void InfluxTcpAdapter::wideQueryChunked(TimeRange range, pointsCallback_t cb) {
   //_RTX_DB_SCOPED_LOCK;
   
   
@@ -608,16 +680,24 @@ std::map<std::string, std::vector<Point> > InfluxTcpAdapter::wideQuery(TimeRange
   string nextQuery = "SELECT time, value, quality, confidence FROM /.*/ WHERE time > " + to_string(range.end) + "s GROUP BY * order by time asc limit 1";
   
   auto qstr = prevQuery + ";" + ss.str() + ";" + nextQuery;
-  json jsv;
   try {
-    auto response = _restClient->doQueryWithTimePrecision(this->conn.getAuthString(), this->conn.db, encodeQuery(qstr), "s");
-    jsv = jsonFromResponse(response);
+    this->pointsFromChunkedQuery(qstr, [&](map<string, vector<Point> >& chunk) {
+      for (auto& res : chunk) {
+        cb(res.first, res.second);
+      }
+    });
   } catch (const std::exception &err) {
     cerr << "error executing query: " << err.what() << endl;
   }
-  
-  
-  map<string, vector<Point> > fetch = __pointsFromJson(jsv);
+}
+
+std::map<std::string, std::vector<Point> > InfluxTcpAdapter::wideQuery(TimeRange range) {
+  map<string, vector<Point> > fetch;
+  this->wideQueryChunked(range, [&](const string& id, vector<Point>& points) {
+    auto& pointVec = fetch[id];
+    pointVec.insert(pointVec.end(), points.begin(), points.end());
+  });
+  // statements are returned in order (previous, range, next), so each series is already sorted.
   return fetch;
 }
 
@@ -630,15 +710,85 @@ std::vector<Point> InfluxTcpAdapter::selectRange(const std::string& id, TimeRang
   q.where.push_back("time >= " + to_string(range.start) + "s");
   q.where.push_back("time <= " + to_string(range.end) + "s");
   
-  json jsv;
+  vector<Point> points;
   try {
-    auto response = _restClient->doQueryWithTimePrecision(this->conn.getAuthString(), this->conn.db, encodeQuery(q.selectStr()), "s");
-    jsv = jsonFromResponse(response);
+    this->pointsFromChunkedQuery(q.selectStr(), [&](map<string, vector<Point> >& chunk) {
+      if (chunk.size() > 0) {
+        auto& chunkPoints = chunk.begin()->second;
+        points.insert(points.end(), chunkPoints.begin(), chunkPoints.end());
+      }
+    });
   } catch (const std::exception &err) {
     cerr << "error executing query: " << err.what() << endl;
   }
   
-  return __pointsSingle(jsv);
+  return points;
+}
+
+std::map<std::string, std::vector<Point> > InfluxTcpAdapter::selectRanges(const std::vector<std::string>& ids, TimeRange range) {
+  
+  // pack one SELECT per series into multi-statement requests, and run those requests concurrently
+  // across the connection pool. the response is demultiplexed by series name.
+  map<string, vector<Point> > out;
+  map<string, string> requestedIds; // proper id (no units) => caller's id
+  vector<string> statements;
+  
+  for (const auto& id : ids) {
+    string dbId = influxIdForTsId(id);
+    if (dbId.empty()) {
+      continue;
+    }
+    out[id] = vector<Point>();
+    MetricInfo m = SeriesHandle::intern(dbId)->metric();
+    m.tags.erase("units");
+    requestedIds[m.name()] = id;
+    
+    Query q = this->queryPartsFromMetricId(dbId);
+    q.where.push_back("time >= " + to_string(range.start) + "s");
+    q.where.push_back("time <= " + to_string(range.end) + "s");
+    q.groupBy = "*"; // the response names each series by its tags, which the demux below needs
+    statements.push_back(q.selectStr());
+  }
+  
+  vector<string> batches;
+  for (size_t i = 0; i < statements.size(); i += RTX_INFLUX_STATEMENTS_PER_REQUEST) {
+    auto last = std::min(statements.size(), i + RTX_INFLUX_STATEMENTS_PER_REQUEST);
+    batches.push_back(boost::algorithm::join(vector<string>(statements.begin() + i, statements.begin() + last), ";"));
+  }
+  
+  std::mutex outMutex;
+  std::atomic<size_t> nextBatch(0);
+  auto worker = [&]() {
+    size_t iBatch;
+    while ((iBatch = nextBatch++) < batches.size()) {
+      try {
+        this->pointsFromChunkedQuery(batches.at(iBatch), [&](map<string, vector<Point> >& chunk) {
+          std::lock_guard<std::mutex> lock(outMutex);
+          for (auto& res : chunk) {
+            if (requestedIds.count(res.first) == 0) {
+              continue;
+            }
+            auto& pointVec = out[requestedIds.at(res.first)];
+            pointVec.insert(pointVec.end(), res.second.begin(), res.second.end());
+          }
+        });
+      } catch (const std::exception &err) {
+        cerr << "error executing query: " << err.what() << endl;
+      }
+    }
+  };
+  
+  size_t nWorkers = std::min(batches.size(), (size_t)std::max(1, this->conn.max_parallel));
+  vector<std::future<void> > workers;
+  for (size_t i = 1; i < nWorkers; ++i) {
+    workers.push_back(std::async(std::launch::async, worker));
+  }
+  worker();
+  for (auto& w : workers) {
+    w.wait();
+  }
+  
+  return out;
 }
 
 vector<string> _makeSelectStrs(WhereClause q);
@@ -681,15 +831,15 @@ Point InfluxTcpAdapter::selectNext(const std::string& id, time_t time, WhereClau
     }
   }
   
-  json jsv;
+  map<string, vector<Point> > fetch;
   try {
     auto response = _restClient->doQueryWithTimePrecision(this->conn.getAuthString(), this->conn.db, encodeQuery(q.selectStr()), "s");
-    jsv = jsonFromResponse(response);
+    fetch = pointsFromResponse(response);
   } catch (const std::exception &err) {
     cerr << "error executing query: " << err.what() << endl;
   }
   
-  points = __pointsSingle(jsv);
+  points = __pointsSingle(fetch);
   
   if (points.size() == 0) {
     return Point();
@@ -715,15 +865,15 @@ Point InfluxTcpAdapter::selectPrevious(const std::string& id, time_t time, Where
     }
   }
   
-  json jsv;
+  map<string, vector<Point> > fetch;
   try {
     auto response = _restClient->doQueryWithTimePrecision(this->conn.getAuthString(), this->conn.db, encodeQuery(q.selectStr()), "s");
-    jsv = jsonFromResponse(response);
+    fetch = pointsFromResponse(response);
   } catch (const std::exception &err) {
     cerr << "error executing query: " << err.what() << endl;
   }
   
-  points = __pointsSingle(jsv);
+  points = __pointsSingle(fetch);
   
   if (points.size() == 0) {
     return Point();
@@ -769,15 +919,15 @@ vector<Point> InfluxTcpAdapter::selectWithQuery(const std::string& query, TimeRa
   else {
     qStr += " order by asc";
   }
-  json jsv;
+  map<string, vector<Point> > fetch;
   try {
     auto response = _restClient->doQueryWithTimePrecision(this->conn.getAuthString(), this->conn.db, encodeQuery(qStr), "s");
-    jsv = jsonFromResponse(response);
+    fetch = pointsFromResponse(response);
   } catch (const std::exception &err) {
     cerr << "error executing query: " << err.what() << endl;
   }
   
-  auto points = __pointsSingle(jsv);
+  auto points = __pointsSingle(fetch);
   return points;
 }
 
@@ -819,30 +969,52 @@ size_t InfluxTcpAdapter::maxTransactionLines() {
   return 5000;
 }
 
-void InfluxTcpAdapter::sendPointsWithString(const std::string& content) {
-  //INFLUX_ASYNC_SEND.wait(); // wait on previous send if needed.
-  
-  if(sendPointsFuture.valid()){
-    sendPointsFuture.wait();
-    sendPointsFuture.get();
-  }
+static bool __gzip(const string& input, string& output) {
+  z_stream zs;
+  memset(&zs, 0, sizeof(zs));
+  // 16 + MAX_WBITS selects the gzip wrapper, as expected by "Content-Encoding: gzip"
+  if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    return false;
+  }
+  output.resize(deflateBound(&zs, (uLong)input.size()));
+  zs.next_in = (Bytef*)input.data();
+  zs.avail_in = (uInt)input.size();
+  zs.next_out = (Bytef*)&output[0];
+  zs.avail_out = (uInt)output.size();
+  int ret = deflate(&zs, Z_FINISH);
+  output.resize(zs.total_out);
+  deflateEnd(&zs);
+  return ret == Z_STREAM_END;
+}
 
-  sendPointsFuture = std::async(std::launch::async, [&, content]{
-    const string bodyContent(content);
+void InfluxTcpAdapter::waitForSends(size_t maxInFlight) {
+  while (_sendsInFlight.size() > maxInFlight) {
+    auto oldest = std::move(_sendsInFlight.front());
+    _sendsInFlight.pop_front();
+    oldest.get();
+  }
+}
 
-    namespace bio = boost::iostreams;
-    std::stringstream compressed;
-    std::stringstream origin(bodyContent);
-    bio::filtering_streambuf<bio::input> out;
-    out.push(bio::gzip_compressor(bio::gzip_params(bio::gzip::default_compression)));
-    out.push(origin);
-    bio::copy(out, compressed);
-    const string zippedContent(compressed.str());
+void InfluxTcpAdapter::sendPointsWithString(std::string&& content) {
+  // keep a bounded window of requests on the wire. when it is full, the caller blocks
+  // on the oldest send, which throttles producers to the rate the server can absorb.
+  const size_t window = (size_t)std::max(this->conn.max_inflight, 1);
+  this->waitForSends(window - 1);
+  
+  _sendsInFlight.push_back(std::async(std::launch::async, [this](string body){
+    string zippedContent;
+    if (!__gzip(body, zippedContent)) {
+      OATPP_LOGE(TAG, "compressing points failed");
+      this->recycleBuffer(std::move(body));
+      _sendsFailed = true;
+      return;
+    }
+    this->recycleBuffer(std::move(body));
     
-    int code;
+    int code = 0;
     oatpp::String desc;
     try {
-      auto response = _restClient->sendPoints(this->conn.getAuthString(), "gzip", this->conn.db, "s", zippedContent);
+      auto response = _restClient->sendPoints(this->conn.getAuthString(), "gzip", this->conn.db, "s", std::move(zippedContent));
       code = response->getStatusCode();
       desc = response->getStatusDescription();
     } catch (std::exception& e) {
@@ -854,16 +1026,22 @@ void InfluxTcpAdapter::sendPointsWithString(const std::string& content) {
       case 200:
         break;
       default:
-        cout << "INFLUX TCP ADAPTER: Send points to influx: POST returned " << code << " - " << desc->c_str() << EOL << flush;
+        cout << "INFLUX TCP ADAPTER: Send points to influx: POST returned " << code << " - " << (desc ? desc->c_str() : "") << EOL << flush;
+        _sendsFailed = true;
     }
-
-  });
+  }, std::move(content)));
   
   if(!_inTransaction){
-    sendPointsFuture.wait();
-    sendPointsFuture.get();
+    this->waitForSends(0);
   }
+}
 
+bool InfluxTcpAdapter::confirmWrites() {
+  {
+    _RTX_DB_SCOPED_LOCK;
+    this->waitForSends(0);
+  }
+  return !_sendsFailed.exchange(false);
 }
 
 string InfluxTcpAdapter::encodeQuery(string queryString){
@@ -901,8 +1079,27 @@ json InfluxTcpAdapter::jsonFromResponse(const std::shared_ptr<Response> response
 }
 
 
-vector<Point> InfluxTcpAdapter::__pointsSingle(json& json) {
-  auto multi = __pointsFromJson(json);
+map<string, vector<Point> > InfluxTcpAdapter::pointsFromResponse(const std::shared_ptr<Response> response) {
+  if (response == nullptr) {
+    return map<string, vector<Point> >();
+  }
+  
+  int code = response->getStatusCode();
+  if (code == 200) {
+    oatpp::String body = response->readBodyToString();
+    if (!body) {
+      return map<string, vector<Point> >();
+    }
+    return __pointsFromJson(*body);
+  }
+  else {
+    cerr << TAG << ": Connection Error: " << response->getStatusDescription()->c_str() << " - " << response->readBodyToString().getValue("(no body content)").c_str() << endl;
+    return map<string, vector<Point> >();
+  }
+}
+
+
+vector<Point> InfluxTcpAdapter::__pointsSingle(map<string, vector<Point> > multi) {
   if (multi.size() > 0) {
     return multi.begin()->second;
   }
@@ -912,145 +1109,284 @@ vector<Point> InfluxTcpAdapter::__pointsSingle(json& json) {
 }
 
 
-map<string, vector<Point> > InfluxTcpAdapter::__pointsFromJson(json& json) {
-  
-  map<string, vector<Point> > out;
-  
-  // check for correct response format:
-  if (!json.is_object() || 
-      json.size() == 0 ||
-      !json.contains(kRESULTS) ||
-      !json[kRESULTS].is_array() ||
-      json[kRESULTS].size() == 0)
-  {
-    return out;
-  }
-  
-  
-  for (auto &statement : json[kRESULTS]) {
+/*
+ SAX-style reader for influx query responses. Points are emitted straight into per-series vectors
+ without building a json DOM, which for a wide query can be many times the size of the response body.
+ 
+ {"results":[{"statement_id":0,"series":[{"name":"flow","tags":{"units":"gpm"},"columns":["time","value","quality","confidence"],"values":[[1600000000,1.5,192,0],...]}]}]}
+ 
+ depth:  1    2  3                        4  5      ...     6 (tags / columns / values)   7 (row)
+ */
+namespace RTX {
+  class InfluxPointsSaxReader : public nlohmann::json_sax<json> {
+  public:
+    std::map<std::string, std::vector<Point> > out;
     
-    if ( !statement.is_object() || !statement.contains(kSERIES) ) {
-      continue;
-    }
-    auto &seriesArray = statement[kSERIES];
-    for (const auto &series : seriesArray) {
-      // assemble the proper identifier for this series
-      MetricInfo metric("");
-      if (series.count("name") == 0) {
-        OATPP_LOGE(InfluxTcpAdapter::TAG, "Influx returned malformed response. No \"name\" property in series.");
-        OATPP_LOGI(InfluxTcpAdapter::TAG, "Series format returned: %s", series.dump().c_str());
+    bool null() { return this->cell(false, 0); };
+    bool boolean(bool val) { return this->cell(false, 0); };
+    bool number_integer(number_integer_t val) { return this->cell(true, (double)val); };
+    bool number_unsigned(number_unsigned_t val) { return this->cell(true, (double)val); };
+    bool number_float(number_float_t val, const string_t& s) { return this->cell(true, (double)val); };
+    bool binary(binary_t& val) { return true; };
+    
+    bool string(string_t& val) {
+      const size_t d = _stack.size();
+      if (d == 5 && _key == "name") {
+        _metric.measurement = val;
       }
-      metric.measurement = series.at("name");
-      if (series.contains("tags")) {
-        auto tagsObj = series.at("tags");
-        json::iterator tagsIter = tagsObj.begin();
-        while (tagsIter != tagsObj.end()) {
-          auto key = tagsIter.key();
-          string value = tagsIter.value();
-          if (value != "") {
-            metric.tags[key] = value;
-          }
-          ++tagsIter;
+      else if (d == 6 && _container() == "tags") {
+        if (val != "") {
+          _metric.tags[_key] = val;
+        }
+      }
+      else if (d == 6 && _container() == "columns") {
+        _columns.push_back(val);
+      }
+      else if ((d == 3 || d == 1) && _key == kERROR) {
+        OATPP_LOGE(InfluxTcpAdapter::TAG, "Influx returned error: %s", val.c_str());
+      }
+      else if (d == 7 && _container(1) == "values") {
+        ++_iCol; // string cells are not used
+      }
+      return true;
+    };
+    
+    bool start_object(std::size_t elements) {
+      _stack.push_back(_key);
+      if (_stack.size() == 5) {
+        // new series object
+        _metric = MetricInfo("");
+        _columns.clear();
+        _rows.clear();
+        _hasName = false;
+        _mapped = _skipSeries = false;
+      }
+      _key.clear();
+      return true;
+    };
+    
+    bool key(string_t& val) {
+      _key = val;
+      if (_stack.size() == 5 && val == "name") {
+        _hasName = true;
+      }
+      return true;
+    };
+    
+    bool end_object() {
+      if (_stack.size() == 5) {
+        this->commitSeries();
+      }
+      _key = _stack.back();
+      _stack.pop_back();
+      return true;
+    };
+    
+    bool start_array(std::size_t elements) {
+      _stack.push_back(_key);
+      if (_stack.size() == 7 && _container(1) == "values") {
+        // new row
+        _iCol = 0;
+        _t = _v = _q = _c = 0;
+        _hasT = _hasV = _hasQ = _hasC = false;
+        if (!_mapped) {
+          this->mapColumns();
         }
-        Units units = RTX_DIMENSIONLESS;
-        if (metric.tags.count("units") == 0) {
-          OATPP_LOGE(InfluxTcpAdapter::TAG, "Influx returned malformed response. No \"units\" property in tag list.");
-          OATPP_LOGI(InfluxTcpAdapter::TAG, "Tags object format returned: %s", tagsObj.dump().c_str());
+      }
+      return true;
+    };
+    
+    bool end_array() {
+      if (_stack.size() == 7 && _container(1) == "values" && !_skipSeries) {
+        if (_hasT && _hasV) {
+          _rows.push_back(Point((time_t)_t, _v, (_hasQ ? (Point::PointQuality)((int)_q) : Point::opc_rtx_override), (_hasC ? _c : 0)));
         }
         else {
-          units = Units::unitOfType(metric.tags.at("units"));
+          OATPP_LOGW(InfluxTcpAdapter::TAG, "Influx returned malformed row at column count %d", _iCol);
         }
-        metric.tags.erase("units"); // get rid of units if they are included.
       }
-      string properId = metric.name();
-      
-      map<string,int> columnMap;
-      if (series.count("columns") == 0) {
-        OATPP_LOGE(InfluxTcpAdapter::TAG, "Influx returned malformed response. No \"columns\" property in series.");
-        OATPP_LOGI(InfluxTcpAdapter::TAG, "Series format returned: %s", series.dump().c_str());
-      }
-      auto cols = series.at("columns");
-      for (int i = 0; i < cols.size(); ++i) {
-        string colName = cols[i];
-        columnMap[colName] = (int)i;
-      }
-      
-      // check columns are all there
-      bool allColumnsPresent = true;
-      for (const string &key : {"time","value","quality","confidence"}) {
-        if (columnMap.count(key) == 0) {
-          cerr << "column map does not contain key: " << key << endl;
-          allColumnsPresent = false;
+      _key = _stack.back();
+      _stack.pop_back();
+      return true;
+    };
+    
+    bool parse_error(std::size_t position, const std::string& last_token, const nlohmann::detail::exception& ex) {
+      OATPP_LOGE(InfluxTcpAdapter::TAG, "JSON Parse Error: %s", ex.what());
+      return false;
+    };
+    
+    void finish() {
+      // sort only those series that did not arrive in order
+      for (auto &ts : out) {
+        if (_unordered.count(ts.first)) {
+          std::sort(ts.second.begin(), ts.second.end(), Point::comparePointTime);
         }
       }
-      if (!allColumnsPresent) {
-        continue; // skip this parsing iteration
+    };
+    
+  private:
+    std::vector<std::string> _stack; // the key under which each open container was started
+    std::string _key;
+    
+    MetricInfo _metric = MetricInfo("");
+    bool _hasName = false;
+    std::vector<std::string> _columns;
+    int _timeIndex = -1, _valueIndex = -1, _qualityIndex = -1, _confidenceIndex = -1;
+    bool _mapped = false, _skipSeries = false; // columns are mapped once per series; a series that cannot be mapped is dropped
+    std::vector<Point> _rows;
+    std::set<std::string> _unordered;
+    
+    int _iCol = 0;
+    double _t, _v, _q, _c;
+    bool _hasT, _hasV, _hasQ, _hasC;
+    
+    const std::string& _container(size_t up = 0) {
+      return _stack.at(_stack.size() - 1 - up);
+    };
+    
+    void mapColumns() {
+      _mapped = true;
+      _timeIndex = _valueIndex = _qualityIndex = _confidenceIndex = -1;
+      for (int i = 0; i < (int)_columns.size(); ++i) {
+        const auto& col = _columns[i];
+        if (col == "time") _timeIndex = i;
+        else if (col == "value") _valueIndex = i;
+        else if (col == "quality") _qualityIndex = i;
+        else if (col == "confidence") _confidenceIndex = i;
       }
-      
-      const int
-      timeIndex = columnMap["time"],
-      valueIndex = columnMap["value"],
-      qualityIndex = columnMap["quality"],
-      confidenceIndex = columnMap["confidence"];
-      
-      if (series.count("values") == 0) {
-        OATPP_LOGE(InfluxTcpAdapter::TAG, "Influx returned malformed response. No \"values\" property in series.");
-        OATPP_LOGI(InfluxTcpAdapter::TAG, "Series format returned: %s", series.dump().c_str());
+      if (_timeIndex < 0 || _valueIndex < 0 || _qualityIndex < 0 || _confidenceIndex < 0) {
+        OATPP_LOGE(InfluxTcpAdapter::TAG, "Influx returned series \"%s\" without all of: time, value, quality, confidence", _metric.measurement.c_str());
+        _skipSeries = true;
       }
-      const auto &values = series.at("values");
-      
-      auto nValues = values.size();
-      if (nValues == 0) {
-        continue;
+    };
+    
+    bool cell(bool isNumber, double val) {
+      if (_stack.size() != 7 || _container(1) != "values" || _skipSeries) {
+        return true;
       }
-      
-      if (out.count(properId) == 0) {
-        out[properId] = vector<Point>();
+      if (isNumber) {
+        if (_iCol == _timeIndex) { _t = val; _hasT = true; }
+        else if (_iCol == _valueIndex) { _v = val; _hasV = true; }
+        else if (_iCol == _qualityIndex) { _q = val; _hasQ = true; }
+        else if (_iCol == _confidenceIndex) { _c = val; _hasC = true; }
       }
-      
-      auto pointVec = &(out.at(properId));
-      
-      if (nValues > 1) {
-        pointVec->reserve(pointVec->size() + nValues + 2);
+      ++_iCol;
+      return true;
+    };
+    
+    void commitSeries() {
+      if (!_hasName) {
+        OATPP_LOGE(InfluxTcpAdapter::TAG, "Influx returned malformed response. No \"name\" property in series.");
       }
+      if (_metric.tags.count("units") == 0 && _metric.tags.size() > 0) {
+        OATPP_LOGE(InfluxTcpAdapter::TAG, "Influx returned malformed response. No \"units\" property in tag list.");
+      }
+      _metric.tags.erase("units"); // get rid of units if they are included.
       
-      
-      for (const auto &rowV : values) {
-        const auto &row = rowV;
-        // ensure that these values are non-null and castable
-        if (row.at(timeIndex).is_null() || row.at(valueIndex).is_null() || !row.at(timeIndex).is_number() || !row.at(valueIndex).is_number()) {
-          OATPP_LOGW(InfluxTcpAdapter::TAG, "Influx returned malformed row: %s", row.dump().c_str());
-          continue;
+      if (!_rows.empty() && !_skipSeries) {
+        const std::string properId = _metric.name();
+        auto &pointVec = out[properId];
+        bool ordered = pointVec.empty() || pointVec.back().time <= _rows.front().time;
+        for (size_t i = 1; ordered && i < _rows.size(); ++i) {
+          ordered = _rows[i-1].time <= _rows[i].time;
         }
-        time_t t = row.at(timeIndex);
-        double v = row.at(valueIndex);
-        Point::PointQuality q = Point::opc_rtx_override;
-        if (!row.at(qualityIndex).is_null()) {
-          q = (Point::PointQuality)(row.at(qualityIndex));
+        if (!ordered) {
+          _unordered.insert(properId);
         }
-        double c = 0;
-        if (!row.at(confidenceIndex).is_null()) {
-          c = row.at(confidenceIndex);
+        if (pointVec.empty()) {
+          pointVec.swap(_rows);
+        }
+        else {
+          pointVec.insert(pointVec.end(), _rows.begin(), _rows.end());
         }
-        pointVec->push_back(Point(t,v,q,c));
       }
-    }
+      _rows.clear();
+      _timeIndex = _valueIndex = _qualityIndex = _confidenceIndex = -1;
+      _mapped = _skipSeries = false;
+    };
+  };
+}
+
+
+map<string, vector<Point> > InfluxTcpAdapter::__pointsFromJson(const std::string& body) {
+  InfluxPointsSaxReader reader;
+  if (!json::sax_parse(body, &reader)) {
+    return map<string, vector<Point> >();
   }
-  
-  // sort these points
-  for (auto &ts : out) {
-    std::sort(ts.second.begin(), ts.second.end(), Point::comparePointTime);
+  reader.finish();
+  return reader.out;
+}
+
+
+/*
+ chunked responses (chunked=true) are a sequence of complete json documents, one per line,
+ each holding up to chunk_size rows. each line is parsed and handed off as soon as it arrives,
+ so the transient memory is bounded by the chunk size rather than by the size of the result.
+ */
+namespace RTX {
+  class InfluxChunkReader : public oatpp::data::stream::WriteCallback {
+  public:
+    InfluxChunkReader(std::function<void(std::map<std::string, std::vector<Point> >&)> onChunk) : _onChunk(onChunk) {};
+    
+    v_io_size write(const void *data, v_buff_size count, async::Action& action) override {
+      const char *bytes = (const char*)data;
+      const char *end = bytes + count;
+      const char *nl;
+      while ((nl = (const char*)memchr(bytes, '\n', end - bytes)) != NULL) {
+        _line.append(bytes, nl - bytes);
+        this->parseLine();
+        bytes = nl + 1;
+      }
+      _line.append(bytes, end - bytes);
+      return count;
+    };
+    
+    void finish() {
+      this->parseLine();
+    };
+    
+  private:
+    std::string _line;
+    std::function<void(std::map<std::string, std::vector<Point> >&)> _onChunk;
+    
+    void parseLine() {
+      if (_line.find_first_not_of(" \r\t") != std::string::npos) {
+        auto chunk = InfluxTcpAdapter::__pointsFromJson(_line);
+        _onChunk(chunk);
+      }
+      _line.clear();
+    };
+  };
+}
+
+
+void InfluxTcpAdapter::pointsFromChunkedQuery(const std::string& query, std::function<void(map<string, vector<Point> >&)> onChunk) {
+  if (this->conn.chunk_size <= 0) {
+    auto response = _restClient->doQueryWithTimePrecision(this->conn.getAuthString(), this->conn.db, encodeQuery(query), "s");
+    auto fetch = pointsFromResponse(response);
+    onChunk(fetch);
+    return;
   }
   
+  auto response = _restClient->doChunkedQuery(this->conn.getAuthString(), this->conn.db, encodeQuery(query), "s", "true", to_string(this->conn.chunk_size));
+  if (response == nullptr) {
+    return;
+  }
+  if (response->getStatusCode() != 200) {
+    cerr << TAG << ": Connection Error: " << response->getStatusDescription()->c_str() << " - " << response->readBodyToString().getValue("(no body content)").c_str() << endl;
+    return;
+  }
   
-  return out;
+  InfluxChunkReader reader(onChunk);
+  response->transferBody(&reader);
+  reader.finish();
 }
 
 
 
 
 InfluxTcpAdapter::Query InfluxTcpAdapter::queryPartsFromMetricId(const std::string &name) {
-  MetricInfo m(name);
+  MetricInfo m = SeriesHandle::intern(name)->metric();
   
   Query q;
   q.select = {"time", "value", "quality", "confidence"};
@@ -1080,11 +1416,19 @@ std::string InfluxTcpAdapter::formatTimestamp(time_t t) {
 
 
 InfluxUdpAdapter::InfluxUdpAdapter( errCallback_t cb ) : InfluxAdapter(cb) {
-  _sendFuture = std::async(launch::async, [&](){return;});
+  _stopSending = false;
+  _droppedLines = 0;
+  _oversizedLines = 0;
+  _socketThread = std::thread(&InfluxUdpAdapter::socketLoop, this);
 }
 
 InfluxUdpAdapter::~InfluxUdpAdapter() {
-  
+  {
+    std::lock_guard<std::mutex> lock(_queueMtx);
+    _stopSending = true;
+  }
+  _queueCv.notify_all();
+  _socketThread.join();
 }
 
 const DbAdapter::adapterOptions InfluxUdpAdapter::options() const {
@@ -1103,6 +1447,9 @@ const DbAdapter::adapterOptions InfluxUdpAdapter::options() const {
 std::string InfluxUdpAdapter::connectionString() {
   stringstream ss;
   ss << "host=" << this->conn.host << "&port=" << this->conn.port << "&ratelimit=" << this->conn.msec_ratelimit;
+  if (this->conn.datagram_size != RTX_INFLUX_DEFAULT_DATAGRAM_SIZE) {
+    ss << "&datagram=" << this->conn.datagram_size;
+  }
   return ss.str();
 }
 
@@ -1155,33 +1502,107 @@ void InfluxUdpAdapter::removeAllRecords() {
 }
 
 size_t InfluxUdpAdapter::maxTransactionLines() {
-  return 10;
+  // lines are packed into datagrams by the sender, so this only bounds the transaction buffer
+  return 5000;
+}
+
+void InfluxUdpAdapter::sendPointsWithString(std::string&& content) {
+  // pack whole lines into datagrams no larger than the configured payload, so the
+  // network never has to fragment them. a line that alone exceeds the payload is dropped.
+  const size_t payload = (size_t)std::max(this->conn.datagram_size, 64);
+  string datagram;
+  size_t nLines = 0;
+  size_t pos = 0;
+  while (pos < content.size()) {
+    size_t eol = content.find('\n', pos);
+    if (eol == string::npos) {
+      eol = content.size();
+    }
+    const size_t len = eol - pos + 1; // with its newline
+    if (len > payload) {
+      ++_oversizedLines;
+    }
+    else {
+      if (datagram.size() + len > payload) {
+        this->enqueueDatagram(std::move(datagram), nLines);
+        datagram = string();
+        nLines = 0;
+      }
+      if (datagram.capacity() < payload) {
+        datagram.reserve(payload);
+      }
+      datagram.append(content, pos, eol - pos);
+      datagram.push_back('\n');
+      ++nLines;
+    }
+    pos = eol + 1;
+  }
+  if (nLines > 0) {
+    this->enqueueDatagram(std::move(datagram), nLines);
+  }
+  this->recycleBuffer(std::move(content));
 }
 
-void InfluxUdpAdapter::sendPointsWithString(const std::string& content) {
-  if (_sendFuture.valid()) {
-    _sendFuture.wait();
+void InfluxUdpAdapter::enqueueDatagram(std::string&& datagram, size_t nLines) {
+  {
+    std::lock_guard<std::mutex> lock(_queueMtx);
+    // never block the producer. when the socket thread falls behind, new data is shed.
+    if (_datagrams.size() >= RTX_INFLUX_UDP_QUEUE_DATAGRAMS) {
+      _droppedLines += nLines;
+      return;
+    }
+    _datagrams.emplace_back(std::move(datagram), nLines);
   }
-  string body(content);
-  _sendFuture = std::async(launch::async, [&,body]() {
-    using boost::asio::ip::udp;
-    boost::asio::io_service io_service;
-    udp::resolver resolver(io_service);
-    udp::resolver::query query(udp::v4(), this->conn.host, to_string(this->conn.port));
-    udp::endpoint receiver_endpoint = *resolver.resolve(query);
-    udp::socket socket(io_service);
-    socket.open(udp::v4());
+  _queueCv.notify_one();
+}
+
+void InfluxUdpAdapter::socketLoop() {
+  using boost::asio::ip::udp;
+  boost::asio::io_service io_service;
+  udp::socket socket(io_service);
+  udp::endpoint receiver_endpoint;
+  string resolvedFor;
+  
+  while (true) {
+    pair<string, size_t> datagram;
+    {
+      std::unique_lock<std::mutex> lock(_queueMtx);
+      _queueCv.wait(lock, [&]{ return _stopSending || !_datagrams.empty(); });
+      if (_datagrams.empty()) {
+        break; // stopping, and everything queued has been sent
+      }
+      datagram = std::move(_datagrams.front());
+      _datagrams.pop_front();
+    }
+    
     boost::system::error_code err;
-    socket.send_to(boost::asio::buffer(body, body.size()), receiver_endpoint, 0, err);
+    const string target = this->conn.host + ":" + to_string(this->conn.port);
+    if (target != resolvedFor) {
+      udp::resolver resolver(io_service);
+      udp::resolver::query query(udp::v4(), this->conn.host, to_string(this->conn.port));
+      auto endpoints = resolver.resolve(query, err);
+      if (err) {
+        DebugLog << "UDP RESOLVE ERROR: " << err.message() << EOL << flush;
+        _droppedLines += datagram.second;
+        continue;
+      }
+      receiver_endpoint = *endpoints;
+      resolvedFor = target;
+      if (!socket.is_open()) {
+        socket.open(udp::v4());
+      }
+    }
+    
+    socket.send_to(boost::asio::buffer(datagram.first), receiver_endpoint, 0, err);
     if (err) {
       DebugLog << "UDP SEND ERROR: " << err.message() << EOL << flush;
+      _droppedLines += datagram.second;
     }
-    socket.close();
     if (conn.msec_ratelimit > 0) {
       this_thread::sleep_for(chrono::milliseconds(conn.msec_ratelimit));
     }
-  });
-
+  }
+  socket.close();
 }
 
 std::string InfluxUdpAdapter::formatTimestamp(time_t t) {
@@ -2,8 +2,13 @@
 #define InfluxAdapter_hpp
 
 #include <stdio.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <future>
+#include <mutex>
 #include <thread>
+#include <unordered_map>
 
 #include "oatpp/web/client/HttpRequestExecutor.hpp"
 #include "oatpp/network/tcp/client/ConnectionProvider.hpp"
@@ -42,6 +47,7 @@ namespace RTX {
     bool insertIdentifierAndUnits(const std::string& id, Units units);
     void insertSingle(const std::string& id, Point point);
     void insertRange(const std::string& id, std::vector<Point> points);
+    void insertRows(const std::vector<std::pair<std::string, Point> >& rows);
     
     // UPDATE
     bool assignUnitsToRecord(const std::string& name, const Units& units);
@@ -52,8 +58,10 @@ namespace RTX {
   protected:
     // compulsory overrides
     virtual std::string formatTimestamp(time_t t) = 0;
-    virtual void sendPointsWithString(const std::string& content) = 0;
+    virtual void sendPointsWithString(std::string&& content) = 0;
     virtual size_t maxTransactionLines() = 0;
+    virtual const char* timestampSuffix() { return ""; }; // appended to epoch seconds in line protocol
+    virtual void waitForSends(size_t maxInFlight) { }; // for adapters that send in the background
     
     // sub types
     class connectionInfo {
@@ -62,22 +70,40 @@ namespace RTX {
       std::string proto, host, user, pass, db;
       int port;
       int msec_ratelimit;
+      int chunk_size; // rows per chunk for streamed query responses. zero disables chunking.
+      int max_parallel; // concurrent query requests for multi-series reads
+      int max_inflight; // concurrent write requests before insert calls block
+      int datagram_size; // UDP payload bytes per packet
       bool validate;
       std::string getAuthString(){ return user + ":" + pass; }
     };
     connectionInfo conn;
     
-    std::vector<std::string> insertionLinesFromPoints(const std::string& tsName, std::vector<Point> points);
+    void appendLinesFromPoints(std::string& buffer, const std::string& tsNameEscaped, std::vector<Point>::const_iterator begin, std::vector<Point>::const_iterator end);
+    void appendLine(std::string& buffer, const std::string& tsNameEscaped, const Point& p);
     std::string influxIdForTsId(const std::string& id);
     
-    std::vector<std::string> _transactionLines;
+    // line buffers are recycled so that their capacity survives between sends
+    std::string takeBuffer();
+    void recycleBuffer(std::string&& buffer);
+    
+    std::string _transactionBuffer; // newline-terminated line protocol
+    size_t _transactionLineCount;
     IdentifierUnitsList _idCache;
+    std::unordered_map<std::string, std::string> _lineKeys; // id -> escaped series key, for row inserts. cleared when _idCache changes.
     bool _inTransaction;
     
   private:
     void commitTransactionLines();
+    void appendTransactionLine(const std::string& line);
+    void sendTransactionBuffer(); // caller holds the db lock
+    std::vector<std::string> _spareBuffers;
+    std::mutex _spareBuffersMtx;
   };
   
+  class InfluxPointsSaxReader;
+  class InfluxChunkReader;
+  
   class ITaskWrapper {
     // empty implementation for async task sub
   };
@@ -99,19 +125,24 @@ namespace RTX {
     Point selectNext(const std::string& id, time_t time, WhereClause q = WhereClause());
     Point selectPrevious(const std::string& id, time_t time, WhereClause q = WhereClause());
     std::vector<Point> selectWithQuery(const std::string& query, TimeRange range);
+    std::map<std::string, std::vector<Point> > selectRanges(const std::vector<std::string>& ids, TimeRange range);
 
     
     // PREFETCH
     std::map<std::string, std::vector<Point> > wideQuery(TimeRange range);
+    void wideQueryChunked(TimeRange range, pointsCallback_t cb);
     
     // DELETE
     void removeRecord(const std::string& id);
     void removeAllRecords();
     
+    bool confirmWrites();
+    
   protected:
     size_t maxTransactionLines();
-    void sendPointsWithString(const std::string& content);
+    void sendPointsWithString(std::string&& content);
     std::string formatTimestamp(time_t t);
+    void waitForSends(size_t maxInFlight);
     
   private:
     typedef oatpp::web::protocol::http::incoming::Response Response;
@@ -129,15 +160,20 @@ namespace RTX {
     std::shared_ptr<oatpp::data::mapping::ObjectMapper> _objectMapper;
     std::shared_ptr<InfluxClient> _restClient;
     std::shared_ptr<oatpp::web::client::RequestExecutor> createExecutor();
-    std::future<void> sendPointsFuture;
+    std::deque<std::future<void> > _sendsInFlight;
+    std::atomic<bool> _sendsFailed; // a send was not acknowledged since the last confirmWrites
 
     Query queryPartsFromMetricId(const std::string& name);
     
     std::string encodeQuery(std::string queryString);
     nlohmann::json jsonFromResponse(const std::shared_ptr<Response> response);
+    std::map<std::string, std::vector<Point> > pointsFromResponse(const std::shared_ptr<Response> response);
+    void pointsFromChunkedQuery(const std::string& query, std::function<void(std::map<std::string, std::vector<Point> >&)> onChunk);
     
-    static std::map<std::string, std::vector<Point> > __pointsFromJson(nlohmann::json& json);
-    static std::vector<Point> __pointsSingle(nlohmann::json& json);
+    static std::map<std::string, std::vector<Point> > __pointsFromJson(const std::string& body);
+    static std::vector<Point> __pointsSingle(std::map<std::string, std::vector<Point> > multi);
+    friend class InfluxPointsSaxReader;
+    friend class InfluxChunkReader;
   };
   
   
@@ -160,13 +196,25 @@ namespace RTX {
     void removeRecord(const std::string& id);
     void removeAllRecords();
     
+    // lines discarded because the send queue was full or the send failed, and lines too large for one datagram
+    uint64_t droppedLines() {return _droppedLines;};
+    uint64_t oversizedLines() {return _oversizedLines;};
+    
   protected:
     size_t maxTransactionLines();
-    void sendPointsWithString(const std::string& content);
+    void sendPointsWithString(std::string&& content);
     std::string formatTimestamp(time_t t);
+    const char* timestampSuffix() { return "000000000"; };
     
   private:
-    std::future<void> _sendFuture;
+    void enqueueDatagram(std::string&& datagram, size_t nLines);
+    void socketLoop();
+    std::thread _socketThread;
+    std::mutex _queueMtx;
+    std::condition_variable _queueCv;
+    std::deque<std::pair<std::string, size_t> > _datagrams; // payload, line count
+    bool _stopSending;
+    std::atomic<uint64_t> _droppedLines, _oversizedLines;
   };
   
   
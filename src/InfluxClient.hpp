@@ -30,6 +30,7 @@ public:
   API_CALL(HTTP_GET, "query", doCreate, AUTHORIZATION_BASIC(String, authString), QUERY(String, q, "q"))
   API_CALL(HTTP_GET, "query", doQuery, AUTHORIZATION_BASIC(String, authString), QUERY(String, db, "db"), QUERY(String, q, "q"))
   API_CALL(HTTP_GET, "query", doQueryWithTimePrecision, AUTHORIZATION_BASIC(String, authString), QUERY(String, db, "db"), QUERY(String, q, "q"), QUERY(String, epoch, "epoch"))
+  API_CALL(HTTP_GET, "query", doChunkedQuery, AUTHORIZATION_BASIC(String, authString), QUERY(String, db, "db"), QUERY(String, q, "q"), QUERY(String, epoch, "epoch"), QUERY(String, chunked, "chunked"), QUERY(String, chunkSize, "chunk_size"))
   API_CALL(HTTP_POST, "query", removeRecord, AUTHORIZATION_BASIC(String, authString), QUERY(String, q, "q"))
   API_CALL(HTTP_POST, "write", sendPoints, AUTHORIZATION_BASIC(String, authString), HEADER(String, contentEncoding, "Content-Encoding"), QUERY(String, db, "db"), QUERY(String, precision, "precision"), BODY_STRING(String, data))
 
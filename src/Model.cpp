@@ -14,6 +14,9 @@
 #include "Units.h"
 
 #include "DbPointRecord.h"
+#include "ModelSnapshot.h"
+
+#include <boost/filesystem.hpp>
 
 
 #include <boost/config.hpp>
@@ -46,7 +49,20 @@ Model::Model() : _flowUnits(1), _headUnits(1), _pressureUnits(1) {
   this->initObj();
 }
 Model::~Model() {
-  
+  this->stopPipeline();
+}
+
+void Model::stopPipeline() {
+  this->waitForReadAhead(numeric_limits<time_t>::max());
+  {
+    lock_guard<mutex> lock(_writerMtx);
+    _writerStop = true;
+  }
+  _writerCv.notify_all();
+  if (_writerThread.joinable()) {
+    _writerThread.join(); // anything still queued is written first
+  }
+  _writerStop = false; // a later step starts a new writer
 }
 
 void Model::initObj() {
@@ -55,6 +71,8 @@ void Model::initObj() {
   _regularMasterClock.reset( new Clock(3600) );
   _tankResetClock = Clock::_sp();
   _simReportClock = Clock::_sp();
+  _checkpointClock = Clock::_sp();
+  _checkpointLimit = 168; // a week of hourly checkpoints
   _relativeError.reset( new TimeSeries() );
   _iterations.reset( new TimeSeries() );
   _convergence.reset( new TimeSeries() );
@@ -93,7 +111,10 @@ void Model::initObj() {
   _simLogCallback = NULL;
   _didSimulateCallback = NULL;
   
-  _saveStateFuture = async(launch::async, [&](){return;});
+  _pipelineDepth = 0;
+  _readAheadLimit = 0;
+  _boundaryLimit = 0;
+  _writerStop = false;
 }
 
 
@@ -145,6 +166,70 @@ std::string Model::modelHash() {
   return ss.str();
 }
 
+void Model::setSnapshotDirectory(const std::string& directory) {
+  _snapshotDirectory = directory;
+}
+
+std::string Model::snapshotDirectory() {
+  return _snapshotDirectory;
+}
+
+std::string Model::snapshotPath(const std::string& hash, const std::string& extension) {
+  boost::filesystem::path path(_snapshotDirectory);
+  path /= hash + extension;
+  return path.string();
+}
+
+bool Model::loadElementSnapshot() {
+  if (_snapshotDirectory.empty()) {
+    return false;
+  }
+  const string hash = this->modelHash();
+  return ModelSnapshot::loadElements(*this, this->snapshotPath(hash, ".elements"), hash);
+}
+
+void Model::saveElementSnapshot() {
+  if (_snapshotDirectory.empty()) {
+    return;
+  }
+  const string hash = this->modelHash();
+  ModelSnapshot::saveElements(*this, this->snapshotPath(hash, ".elements"), hash);
+}
+
+std::string Model::dmaSnapshotKey(const std::string& hash) {
+  // dmas follow from the network and from which links are measured, closed or ignored
+  set<string> measured, closed, ignored;
+  for (Link::_sp l : this->links()) {
+    Pipe::_sp p = static_pointer_cast<Pipe>(l);
+    if (p->flowMeasure()) {
+      measured.insert(p->name());
+    }
+    if (p->fixedStatus() == Pipe::CLOSED) {
+      closed.insert(p->name());
+    }
+  }
+  for (Pipe::_sp p : _dmaPipesToIgnore) {
+    ignored.insert(p->name());
+  }
+  
+  SHA256_CTX sha256;
+  SHA256_Init(&sha256);
+  SHA256_Update(&sha256, hash.c_str(), hash.length());
+  for (auto names : {&measured, &closed, &ignored}) {
+    SHA256_Update(&sha256, "|", 1);
+    for (const string& name : *names) {
+      SHA256_Update(&sha256, name.c_str(), name.length() + 1); // with the terminator as separator
+    }
+  }
+  unsigned char digest[SHA256_DIGEST_LENGTH];
+  SHA256_Final(digest, &sha256);
+  
+  std::stringstream ss;
+  for(int i=0; i<SHA256_DIGEST_LENGTH; ++i)
+      ss << std::hex << (int)digest[i];
+  return ss.str();
+}
+
 bool Model::shouldRunWaterQuality() {
   return _shouldRunWaterQuality;
 }
@@ -359,6 +444,10 @@ void Model::refreshRecordsForModeledStates() {
 
 }
 
+set<PointRecord::_sp> Model::recordsForModeledStates() {
+  return _recordsForModeledStates;
+}
+
 #pragma mark - Demand dmas
 
 
@@ -367,6 +456,56 @@ void Model::initDMAs() {
   _dmas.clear();
   
   set<Pipe::_sp> boundaryPipes;
+  vector<Dma::_sp> newDmas;
+  
+  // a snapshot made for the same network and measures already has the membership and names
+  string networkHash, dmaKey;
+  if (!_snapshotDirectory.empty()) {
+    networkHash = this->modelHash();
+    dmaKey = this->dmaSnapshotKey(networkHash);
+  }
+  const bool fromSnapshot = !dmaKey.empty() && ModelSnapshot::loadDmas(*this, this->snapshotPath(networkHash, ".dmas"), dmaKey, newDmas);
+  if (fromSnapshot) {
+    // the same boundary candidates the graph search would have collected
+    for (auto link : this->links()) {
+      Pipe::_sp pipe = std::static_pointer_cast<Pipe>(link);
+      if (pipe->type() == Element::PIPE && pipe->fixedStatus() == Pipe::CLOSED) {
+        continue;
+      }
+      if (pipe->flowMeasure() || (pipe->fixedStatus() == Pipe::CLOSED && pipe->type() != Element::PUMP)) {
+        boundaryPipes.insert(pipe);
+      }
+    }
+  }
+  else {
+    newDmas = this->findDmas(boundaryPipes);
+  }
+  
+  // finally, let the dma assemble its aggregators
+  for(const Dma::_sp &dma : newDmas) {
+    dma->initDemandTimeseries(boundaryPipes, !fromSnapshot);
+    dma->demand()->setUnits(this->flowUnits());
+    dma->demand()->setClock(this->_regularMasterClock);
+    this->addDma(dma);
+  }
+  
+  
+  for (auto dma : newDmas) {
+    string hash = dma->hashedName;
+    if (dmaNameHashes.count(hash) > 0) {
+      const string name = dmaNameHashes.at(hash);
+      dma->setName(name);
+      dma->demand()->setName("demand,dma=" + hash);
+    }
+  }
+  
+  if (!dmaKey.empty() && !fromSnapshot) {
+    ModelSnapshot::saveDmas(*this, this->snapshotPath(networkHash, ".dmas"), dmaKey);
+  }
+}
+
+
+vector<Dma::_sp> Model::findDmas(set<Pipe::_sp>& boundaryPipes) {
   
   using namespace boost;
 
@@ -452,27 +591,9 @@ void Model::initDMAs() {
     dma->addJunction(std::static_pointer_cast<Junction>(indexedNodes[nodeIdx]));
   }
   
-  // finally, let the dma assemble its aggregators
-  for(const Dma::_sp &dma : newDmas) {
-    dma->initDemandTimeseries(boundaryPipes);
-    dma->demand()->setUnits(this->flowUnits());
-    dma->demand()->setClock(this->_regularMasterClock);
-    this->addDma(dma);
-  }
-  
-  
-  for (auto dma : newDmas) {
-    string hash = dma->hashedName;
-    if (dmaNameHashes.count(hash) > 0) {
-      const string name = dmaNameHashes.at(hash);
-      dma->setName(name);
-      dma->demand()->setName("demand,dma=" + hash);
-    }
-  }
-  
+  return newDmas;
 }
 
-
 void Model::setDmaShouldDetectClosedLinks(bool detect) {
   _dmaShouldDetectClosedLinks = detect;
 }
@@ -687,6 +808,120 @@ void Model::removeLink(Link::_sp l) {
 }
 
 
+#pragma mark - Configuration
+
+void Model::copyConfigurationFrom(Model& other) {
+  // elements are matched by name
+  for (Junction::_sp j : this->junctions()) {
+    Junction::_sp o = dynamic_pointer_cast<Junction>(other.nodeWithName(j->name()));
+    if (!o) {
+      continue;
+    }
+    j->setBoundaryFlow(o->boundaryFlow());
+    j->setQualitySource(o->qualitySource());
+    j->setHeadMeasure(o->headMeasure());
+    j->setPressureMeasure(o->pressureMeasure());
+    j->setQualityMeasure(o->qualityMeasure());
+  }
+  for (Tank::_sp t : this->tanks()) {
+    Tank::_sp o = dynamic_pointer_cast<Tank>(other.nodeWithName(t->name()));
+    if (!o) {
+      continue;
+    }
+    if (o->levelMeasure()) {
+      t->setLevelMeasure(o->levelMeasure());
+    }
+    else {
+      t->setHeadMeasure(o->headMeasure());
+    }
+    t->setQualityMeasure(o->qualityMeasure());
+  }
+  for (Reservoir::_sp r : this->reservoirs()) {
+    Reservoir::_sp o = dynamic_pointer_cast<Reservoir>(other.nodeWithName(r->name()));
+    if (!o) {
+      continue;
+    }
+    r->setBoundaryHead(o->boundaryHead()); // the head measure
+    r->setBoundaryQuality(o->boundaryQuality()); // the quality source
+    r->setQualityMeasure(o->qualityMeasure());
+  }
+  for (Link::_sp l : this->links()) {
+    Pipe::_sp p = dynamic_pointer_cast<Pipe>(l);
+    Pipe::_sp o = dynamic_pointer_cast<Pipe>(other.linkWithName(l->name()));
+    if (!p || !o) {
+      continue;
+    }
+    p->setFixedStatus(o->fixedStatus());
+    p->setStatusBoundary(o->statusBoundary());
+    p->setSettingBoundary(o->settingBoundary());
+    p->setFlowMeasure(o->flowMeasure());
+    Pump::_sp pump = dynamic_pointer_cast<Pump>(p);
+    Pump::_sp oPump = dynamic_pointer_cast<Pump>(o);
+    if (pump && oPump) {
+      pump->setEnergyMeasure(oPump->energyMeasure());
+    }
+  }
+  
+  // dmas keep the source's demand series, and allocate to this model's junctions
+  _dmas.clear();
+  for (Dma::_sp o : other.dmas()) {
+    Dma::_sp dma(new Dma(o->name()));
+    dma->hashedName = o->hashedName;
+    for (Junction::_sp oj : o->junctions()) {
+      Junction::_sp j = dynamic_pointer_cast<Junction>(this->nodeWithName(oj->name()));
+      if (j) {
+        dma->addJunction(j);
+      }
+    }
+    if (o->demand()) {
+      dma->setDemand(o->demand());
+    }
+    this->addDma(dma);
+  }
+  dmaNameHashes = other.dmaNameHashes;
+  _dmaShouldDetectClosedLinks = other._dmaShouldDetectClosedLinks;
+  _dmaPipesToIgnore.clear();
+  for (Pipe::_sp o : other._dmaPipesToIgnore) {
+    Pipe::_sp p = dynamic_pointer_cast<Pipe>(this->linkWithName(o->name()));
+    if (p) {
+      _dmaPipesToIgnore.push_back(p);
+    }
+  }
+  
+  // clocks are copied, so that engines running at once share nothing but their inputs;
+  // the engine keeps its own time parameters from the model file
+  auto ownClock = [](Clock::_sp c) {
+    if (!c) {
+      return Clock::_sp();
+    }
+    Clock::_sp copy(new Clock(c->period(), c->start()));
+    copy->setName(c->name());
+    return copy;
+  };
+  _regularMasterClock = ownClock(other._regularMasterClock);
+  _simReportClock = ownClock(other._simReportClock);
+  _tankResetClock = ownClock(other._tankResetClock);
+  _checkpointClock = ownClock(other._checkpointClock);
+  _checkpointLimit = other._checkpointLimit;
+  this->setQualityTimeStep(other.qualityTimeStep());
+  try {
+    QualityType qt = other.qualityType();
+    if (qt != UNKNOWN) {
+      this->setQualityOptions(qt, (qt == Trace) ? other.qualityTraceNode() : "");
+    }
+  } catch (const std::exception& e) {
+    // e.g. a chemical: left as the model file has it
+  }
+  this->setShouldRunWaterQuality(other.shouldRunWaterQuality());
+  _initialQuality = other._initialQuality;
+  this->setTanksNeedReset(other.tanksNeedReset());
+  this->setPipelineDepth(other.pipelineDepth());
+  if (other._doesOverrideDemands && !_doesOverrideDemands) {
+    this->overrideControls();
+  }
+}
+
+
 #pragma mark - Engine
 
 void Model::updateEngineWithElementProperties(Element::_sp e) {
@@ -697,27 +932,22 @@ void Model::updateEngineWithElementProperties(Element::_sp e) {
 #pragma mark - Publicly Accessible Simulation Methods
 
 void Model::runSinglePeriod(time_t time) {
-  cerr << "whoops, not implemented" << endl;
-  return;
-  /*
-  // FIXME
-  time_t lastSimulationPeriod, boundaryReset, start;
-  // to run a single period, we need boundary conditions.
-  // so back up to either the most recent set of results, or the most recent boundary-reset event
+  // to run a single period, we need the network state that leads into it.
+  // so back up to either the most recent checkpoint, or the most recent tank-reset event
   // (whichever is nearer) and simulate through the requested time.
-  //lastSimulationPeriod = _masterClock->validTime(time);
-  boundaryReset = _tankResetClock->validTime(time);
-  start = RTX_MAX(lastSimulationPeriod, boundaryReset);
-  
-  // run the simulation to the requested time.
-  runExtendedPeriod(start, time);
-   */
+  this->runExtendedPeriodFromCheckpoint(time, time);
+}
+
+void Model::runExtendedPeriodFromCheckpoint(time_t start, time_t end) {
+  time_t restart = this->restoreNearestCheckpoint(start);
+  this->runExtendedPeriod(restart, end);
 }
 
 
 bool Model::solveInitial(time_t simTime) {
   _regularMasterClock->setStart(simTime);
   this->setCurrentSimulationTime(simTime);
+  this->prepareStateExchange();
   
   if (_willSimulateCallback != NULL) {
     _willSimulateCallback(simTime);
@@ -737,8 +967,9 @@ bool Model::solveAndSaveOutputAtTime(time_t simulationTime) {
   auto t1 = time(NULL);
   
   // get parameters from the RTX elements, and pull them into the simulation
-  
+  this->waitForReadAhead(simulationTime);
   try {
+    this->ensureBoundaryTable(simulationTime);
     setSimulationParameters(simulationTime);
   } catch (const std::string& errorMsg) {
     stringstream ss;
@@ -748,6 +979,8 @@ bool Model::solveAndSaveOutputAtTime(time_t simulationTime) {
     this->logLine(ss.str());
     return false;
   }
+  // overlap the solve with reading the next steps' inputs
+  this->readAheadFrom(simulationTime);
   
   
   auto filterDuration = time(NULL) - t1;
@@ -788,17 +1021,20 @@ bool Model::solveAndSaveOutputAtTime(time_t simulationTime) {
     auto stateRecordsUsed = _recordsForModeledStates;
     // tell each element to update its derived states (simulation-computed values)
     if (!_simReportClock || _simReportClock->isValid(simulationTime)) {
-      if (_saveStateFuture.valid()) {
-        _saveStateFuture.wait();
-      }
       this->fetchSimulationStates();
       
       if (_didSimulateCallback != NULL) {
         this->_didSimulateCallback(simulationTime);
       }
-      _saveStateFuture = async(launch::async, &Model::saveNetworkStates, this, simulationTime, stateRecordsUsed);
+      this->queueNetworkState(this->networkState(), stateRecordsUsed);
       
     }
+    if (_checkpointClock && _checkpointClock->isValid(simulationTime)) {
+      if (_simReportClock && !_simReportClock->isValid(simulationTime)) {
+        this->fetchSimulationStates();
+      }
+      this->saveCheckpoint(simulationTime);
+    }
   }
   return success;
 }
@@ -810,13 +1046,18 @@ bool Model::updateSimulationToTime(time_t updateToTime) {
   }
   
   _shouldCancelSimulation = false;
+  _readAheadSeries = this->boundarySeries();
+  _readAheadLimit = updateToTime;
+  _boundaryLimit = max(_boundaryLimit, updateToTime);
+  bool cancelled = false;
   
   while (this->currentSimulationTime() < updateToTime && !_shouldCancelSimulation) {
     
     {
       lock_guard l(_simulationInProcessMutex);
       if (_shouldCancelSimulation) {
-        return false;
+        cancelled = true;
+        break;
       }
     }
     
@@ -856,6 +1097,15 @@ bool Model::updateSimulationToTime(time_t updateToTime) {
     }
   }
   
+  // reads ahead of a cancelled run are abandoned once they finish
+  this->waitForReadAhead(numeric_limits<time_t>::max());
+  // the next update may see newer measurements for the same times
+  this->clearBoundaryConditions();
+  
+  if (cancelled) {
+    return false;
+  }
+  
   {
     lock_guard l(_simulationInProcessMutex);
     _shouldCancelSimulation = false;
@@ -869,8 +1119,11 @@ bool Model::updateSimulationToTime(time_t updateToTime) {
 
 void Model::runExtendedPeriod(time_t start, time_t end) {
   
+  _boundaryLimit = end;
   this->solveInitial(start);
   this->updateSimulationToTime(end);
+  this->clearBoundaryConditions();
+  this->waitForNetworkStates();
   this->cleanupModelAfterSimulation();
   
   _shouldCancelSimulation = false;
@@ -898,7 +1151,9 @@ void Model::runForecast(time_t start, time_t end) {
   bool success;
   
   
+  this->waitForNetworkStates(); // forecast steps are saved in line; keep them after any queued results
   this->enableControls();
+  this->prepareStateExchange();
   
   // get the record(s) being used
   this->refreshRecordsForModeledStates();
@@ -922,7 +1177,10 @@ void Model::runForecast(time_t start, time_t end) {
     if (success) {
       // tell each element to update its derived states (simulation-computed values)
       if (!_simReportClock || _simReportClock->isValid(simulationTime)) {
-        saveNetworkStates(simulationTime, stateRecordsUsed);
+        this->fetchSimulationStates();
+        NetworkState state = this->networkState();
+        state.time = simulationTime;
+        this->saveNetworkStates(state, stateRecordsUsed);
       }
       // get time to next simulation period
       nextSimulationTime = nextHydraulicStep(simulationTime);
@@ -964,6 +1222,165 @@ void Model::cancelSimulation() {
   _shouldCancelSimulation = true;
 }
 
+#pragma mark - Pipelining
+
+void Model::setPipelineDepth(int depth) {
+  _pipelineDepth = max(depth, 0);
+}
+
+int Model::pipelineDepth() {
+  return _pipelineDepth;
+}
+
+vector<TimeSeries::_sp> Model::boundarySeries() {
+  set<TimeSeries::_sp> series;
+  if (_doesOverrideDemands) {
+    for(Dma::_sp dma : this->dmas()) {
+      series.insert(dma->demand());
+    }
+    for(Junction::_sp j : this->junctions()) {
+      if (j->boundaryFlow()) {
+        series.insert(j->boundaryFlow());
+      }
+    }
+  }
+  for(Reservoir::_sp r : this->reservoirs()) {
+    series.insert(r->boundaryHead());
+    if (this->shouldRunWaterQuality()) {
+      series.insert(r->boundaryQuality());
+    }
+  }
+  for(Tank::_sp t : this->tanks()) {
+    series.insert(t->levelMeasure()); // only read on a reset step
+  }
+  for(Valve::_sp v : this->valves()) {
+    series.insert(v->statusBoundary());
+    series.insert(v->settingBoundary());
+  }
+  for(Pump::_sp p : this->pumps()) {
+    series.insert(p->statusBoundary());
+    series.insert(p->settingBoundary());
+  }
+  for(Pipe::_sp p : this->pipes()) {
+    series.insert(p->statusBoundary());
+  }
+  if (this->shouldRunWaterQuality()) {
+    for(Junction::_sp j : this->junctions()) {
+      series.insert(j->qualitySource());
+    }
+  }
+  series.erase(TimeSeries::_sp());
+  return vector<TimeSeries::_sp>(series.begin(), series.end());
+}
+
+void Model::readAheadFrom(time_t time) {
+  // reading warms the records' caches, so setSimulationParameters for those steps finds its inputs in memory
+  time_t next = _readAhead.empty() ? time : _readAhead.back().first;
+  while (_readAhead.size() < (size_t)_pipelineDepth) {
+    next = _regularMasterClock->timeAfter(next);
+    if (next > _readAheadLimit) {
+      break;
+    }
+    if (_boundaryTable && _boundaryTable->contains(next)) {
+      continue; // already in memory
+    }
+    _readAhead.push_back(make_pair(next, async(launch::async, [series = _readAheadSeries, next]() {
+      for (const TimeSeries::_sp& ts : series) {
+        try {
+          ts->pointAtOrBefore(next);
+        } catch (...) {
+          // the in-line read will report it
+        }
+      }
+    })));
+  }
+}
+
+#define RTX_BOUNDARY_CHUNK (24*60*60) // longest window fetched at once by a run
+
+void Model::prefetchBoundaryConditions(TimeRange window) {
+  _boundaryTable.reset(new BoundaryTable(this->boundarySeries(), window));
+}
+
+void Model::clearBoundaryConditions() {
+  _boundaryTable.reset();
+  _boundaryLimit = 0;
+}
+
+void Model::ensureBoundaryTable(time_t time) {
+  if ((_boundaryTable && _boundaryTable->contains(time)) || _boundaryLimit < time) {
+    return;
+  }
+  this->prefetchBoundaryConditions(TimeRange(time, min(time + RTX_BOUNDARY_CHUNK, _boundaryLimit)));
+}
+
+Point Model::boundaryPoint(const TimeSeries::_sp& ts, time_t time) {
+  if (_boundaryTable) {
+    return _boundaryTable->pointAtOrBefore(ts, time); // falls back to the series outside the window
+  }
+  return ts->pointAtOrBefore(time);
+}
+
+void Model::waitForReadAhead(time_t throughTime) {
+  while (!_readAhead.empty() && _readAhead.front().first <= throughTime) {
+    _readAhead.front().second.wait();
+    _readAhead.pop_front();
+  }
+}
+
+void Model::queueNetworkState(NetworkState&& state, const std::set<PointRecord::_sp>& records) {
+  if (_networkStateSink) {
+    _networkStateSink(std::move(state));
+    return;
+  }
+  if (_pipelineDepth == 0) {
+    this->saveNetworkStates(state, records);
+    return;
+  }
+  unique_lock<mutex> lock(_writerMtx);
+  if (!_writerThread.joinable()) {
+    _writerThread = thread(&Model::writerLoop, this);
+  }
+  // bounded: the solver waits here when the writer falls behind
+  _writerCv.wait(lock, [&]{ return _writerQueue.size() < (size_t)_pipelineDepth; });
+  _writerQueue.emplace_back(std::move(state), records);
+  _writerCv.notify_all();
+}
+
+void Model::writerLoop() {
+  unique_lock<mutex> lock(_writerMtx);
+  while (true) {
+    _writerCv.wait(lock, [&]{ return _writerStop || !_writerQueue.empty(); });
+    if (_writerQueue.empty()) {
+      return;
+    }
+    // deque references survive pushes at the back
+    const NetworkState& state = _writerQueue.front().first;
+    const std::set<PointRecord::_sp>& records = _writerQueue.front().second;
+    lock.unlock();
+    try {
+      this->saveNetworkStates(state, records);
+    } catch (const std::string& errorMsg) {
+      this->logLine("ERROR: Could not save network states :: " + errorMsg);
+    } catch (const std::exception& e) {
+      this->logLine(string("ERROR: Could not save network states :: ") + e.what());
+    }
+    lock.lock();
+    _writerQueue.pop_front();
+    _writerCv.notify_all();
+  }
+}
+
+void Model::setNetworkStateSink(networkStateSink_t sink) {
+  this->waitForNetworkStates();
+  _networkStateSink = sink;
+}
+
+void Model::waitForNetworkStates() {
+  unique_lock<mutex> lock(_writerMtx);
+  _writerCv.wait(lock, [&]{ return _writerQueue.empty(); });
+}
+
 void Model::setReportTimeStep(int seconds) {
   _simReportClock.reset( new Clock(seconds) );
 }
@@ -1040,6 +1457,192 @@ void Model::setTankResetClock(Clock::_sp resetClock) {
   _tankResetClock = resetClock;
 }
 
+Clock::_sp Model::tankResetClock() {
+  return _tankResetClock;
+}
+
+#pragma mark - Checkpoints
+
+void Model::setCheckpointClock(Clock::_sp clock) {
+  _checkpointClock = clock;
+}
+
+Clock::_sp Model::checkpointClock() {
+  return _checkpointClock;
+}
+
+void Model::setCheckpointLimit(size_t count) {
+  lock_guard<mutex> lock(_checkpointMtx);
+  _checkpointLimit = count;
+  while (_checkpoints.size() > _checkpointLimit) {
+    _checkpoints.erase(_checkpoints.begin());
+  }
+}
+
+size_t Model::checkpointLimit() {
+  return _checkpointLimit;
+}
+
+std::vector<time_t> Model::checkpointTimes() {
+  lock_guard<mutex> lock(_checkpointMtx);
+  vector<time_t> times;
+  for (auto& cp : _checkpoints) {
+    times.push_back(cp.first);
+  }
+  return times;
+}
+
+vector<Model::Checkpoint> Model::checkpoints(TimeRange range) {
+  lock_guard<mutex> lock(_checkpointMtx);
+  vector<Checkpoint> found;
+  for (auto it = _checkpoints.lower_bound(range.start); it != _checkpoints.end() && it->first <= range.end; ++it) {
+    found.push_back(it->second);
+  }
+  return found;
+}
+
+void Model::addCheckpoint(const Checkpoint& checkpoint) {
+  lock_guard<mutex> lock(_checkpointMtx);
+  _checkpoints[checkpoint.time] = checkpoint;
+  while (_checkpoints.size() > _checkpointLimit) {
+    _checkpoints.erase(_checkpoints.begin());
+  }
+}
+
+void Model::clearCheckpoints() {
+  lock_guard<mutex> lock(_checkpointMtx);
+  _checkpoints.clear();
+}
+
+void Model::saveCheckpoint(time_t time) {
+  // expects element states fetched for this step
+  if (_checkpointLimit == 0) {
+    return;
+  }
+  Checkpoint cp;
+  cp.time = time;
+  cp.tankLevel.reserve(_tanks.size());
+  for (const Tank::_sp& tank : _tanks) {
+    cp.tankLevel.push_back(this->tankLevel(tank->name()));
+  }
+  cp.linkSetting.reserve(_exchangeLinks.size());
+  cp.linkStatus.reserve(_exchangeLinks.size());
+  for (const Pipe::_sp& link : _exchangeLinks) {
+    cp.linkSetting.push_back((float)link->state_setting);
+    cp.linkStatus.push_back(link->state_status > 0 ? 1 : 0);
+  }
+  if (this->shouldRunWaterQuality()) {
+    for (const Junction::_sp& j : _junctions) {
+      cp.junctionQuality.push_back((float)j->state_quality);
+    }
+    for (const Tank::_sp& t : _tanks) {
+      cp.tankQuality.push_back((float)t->state_quality);
+    }
+    for (const Reservoir::_sp& r : _reservoirs) {
+      cp.reservoirQuality.push_back((float)r->state_quality);
+    }
+  }
+  
+  lock_guard<mutex> lock(_checkpointMtx);
+  _checkpoints[time] = std::move(cp);
+  while (_checkpoints.size() > _checkpointLimit) {
+    _checkpoints.erase(_checkpoints.begin());
+  }
+}
+
+bool Model::restoreCheckpoint(const Checkpoint& cp) {
+  if (_stateExchangeIsStale()) {
+    this->prepareStateExchange();
+  }
+  if (cp.tankLevel.size() != _tanks.size() || cp.linkStatus.size() != _exchangeLinks.size()) {
+    this->logLine("WARN: Checkpoint does not match the network; not restored");
+    return false;
+  }
+  
+  this->setCurrentSimulationTime(cp.time);
+  for (size_t i = 0; i < _tanks.size(); ++i) {
+    _tanks[i]->state_level = cp.tankLevel[i];
+  }
+  this->applyInitialTankLevels();
+  this->setTanksNeedReset(false);
+  
+  // links driven by boundaries get their inputs again when the step is re-solved
+  for (size_t i = 0; i < _exchangeLinks.size(); ++i) {
+    Valve::_sp valve = dynamic_pointer_cast<Valve>(_exchangeLinks[i]);
+    if (valve) {
+      // valve boundaries are applied through controls, which keep the last value when a boundary has none
+      // at a step. put back the values the run had at the checkpoint, as setSimulationParameters would.
+      // valves without boundaries follow their model-file setting and the solver.
+      const Pipe::status_t status = cp.linkStatus[i] ? Pipe::OPEN : Pipe::CLOSED;
+      if (valve->statusBoundary()) {
+        this->setPipeStatusControl(valve->name(), status, enable);
+      }
+      if (valve->settingBoundary()) {
+        if (status == Pipe::CLOSED) {
+          this->setValveSettingControl(valve->name(), 0.0, disable);
+        }
+        else if (!isnan(cp.linkSetting[i])) {
+          this->setValveSettingControl(valve->name(), cp.linkSetting[i], enable);
+        }
+      }
+      continue;
+    }
+    Pump::_sp pump = dynamic_pointer_cast<Pump>(_exchangeLinks[i]);
+    if (!pump) {
+      continue;
+    }
+    if (!pump->statusBoundary()) {
+      this->setPumpStatus(pump->name(), cp.linkStatus[i] ? Pipe::OPEN : Pipe::CLOSED);
+    }
+    if (!pump->settingBoundary() && cp.linkStatus[i] && !isnan(cp.linkSetting[i])) {
+      this->setPumpSetting(pump->name(), cp.linkSetting[i]);
+    }
+  }
+  
+  // node quality only: pipe segments start out mixed at their upstream node's value
+  if (this->shouldRunWaterQuality() && cp.junctionQuality.size() == _junctions.size()) {
+    for (size_t i = 0; i < _junctions.size(); ++i) {
+      _junctions[i]->state_quality = cp.junctionQuality[i];
+    }
+    for (size_t i = 0; i < _tanks.size(); ++i) {
+      _tanks[i]->state_quality = cp.tankQuality[i];
+    }
+    for (size_t i = 0; i < _reservoirs.size(); ++i) {
+      _reservoirs[i]->state_quality = cp.reservoirQuality[i];
+    }
+    this->applyInitialQuality();
+  }
+  return true;
+}
+
+time_t Model::restoreNearestCheckpoint(time_t time) {
+  time_t reset = 0;
+  if (_tankResetClock) {
+    reset = _tankResetClock->isValid(time) ? time : _tankResetClock->timeBefore(time);
+  }
+  
+  Checkpoint cp;
+  bool found = false;
+  {
+    lock_guard<mutex> lock(_checkpointMtx);
+    auto after = _checkpoints.upper_bound(time);
+    if (after != _checkpoints.begin()) {
+      cp = prev(after)->second;
+      found = true;
+    }
+  }
+  if (found && cp.time >= reset && this->restoreCheckpoint(cp)) {
+    return cp.time;
+  }
+  if (_tankResetClock) {
+    return reset; // setSimulationParameters resets the tanks there
+  }
+  
+  // nothing to restart from: tanks start at their measured levels
+  this->setTanksNeedReset(true);
+  return time;
+}
+
 bool Model::tanksNeedReset() {
   return _tanksNeedReset;
 }
@@ -1061,7 +1664,7 @@ void Model::_checkTanksForReset(time_t time) {
   
   for(Tank::_sp tank : this->tanks()) {
     if (tank->levelMeasure()) {
-      Point p = tank->levelMeasure()->pointAtOrBefore(time);
+      Point p = this->boundaryPoint(tank->levelMeasure(), time);
       if (p.isValid) {
         double levelValue = Units::convertValue(p.value, tank->levelMeasure()->units(), headUnits());
         // adjust for model limits (epanet rejects otherwise, for example)
@@ -1199,29 +1802,33 @@ void Model::setSimulationParameters(time_t time) {
   if (_doesOverrideDemands) {
     // by dma, insert demand point into each junction timeseries at the current simulation time
     for(Dma::_sp dma: this->dmas()) {
-      if ( dma->allocateDemandToJunctions(time) ) {
+      if ( dma->allocateDemandToJunctions(time, [this](TimeSeries::_sp ts, time_t t) { return this->boundaryPoint(ts, t); }) ) {
         stringstream ss;
         ss << "ERROR: Invalid demand value for DMA " << dma->name() << "(" << dma->junctions().size() << "junctions)" << " :: " << asctime(timeinfo);
         this->logLine(ss.str());
       }
       else {
-        Point dPoint = dma->demand()->pointAtOrBefore(time);
+        Point dPoint = this->boundaryPoint(dma->demand(), time);
         DebugLog << "*  DMA: " << dma->name() << " demand --> " << dPoint.value << EOL;
       }
       
     }
     // hydraulic junctions - set demand values.
-    for(Junction::_sp junction: this->junctions()) {
-      double demandValue = Units::convertValue(junction->state_demand, junction->demand()->units(), flowUnits());
-      setJunctionDemand(junction->name(), demandValue);
+    if (_stateExchangeIsStale()) {
+      this->prepareStateExchange();
     }
+    _exchangeValues.resize(_junctions.size());
+    for (size_t i = 0; i < _junctions.size(); ++i) {
+      _exchangeValues[i] = _demandToModel[i](_junctions[i]->state_demand);
+    }
+    this->setJunctionDemands(_exchangeValues);
   }
   
   // for reservoirs, set the boundary head
   for(Reservoir::_sp reservoir: this->reservoirs()) {
     if (reservoir->boundaryHead()) {
       // get the head measurement parameter, and pass it through as a state.
-      Point p = reservoir->boundaryHead()->pointAtOrBefore(time);
+      Point p = this->boundaryPoint(reservoir->boundaryHead(), time);
       if (p.isValid) {
         double headValue = Units::convertValue(p.value, reservoir->boundaryHead()->units(), headUnits());
         setReservoirHead( reservoir->name(), headValue );
@@ -1249,7 +1856,7 @@ void Model::setSimulationParameters(time_t time) {
     // status can affect settings and vice-versa; status rules
     Pipe::status_t status = valve->fixedStatus();
     if (valve->statusBoundary()) {
-      Point p = valve->statusBoundary()->pointAtOrBefore(time);
+      Point p = this->boundaryPoint(valve->statusBoundary(), time);
       if (p.isValid) {
         status = Pipe::status_t((int)(p.value));
         setPipeStatusControl( valve->name(), status, enable );
@@ -1264,7 +1871,7 @@ void Model::setSimulationParameters(time_t time) {
     if (valve->settingBoundary()) {
       Units settingUnits = valve->settingBoundary()->units();
       if (status) {
-        Point p = valve->settingBoundary()->pointAtOrBefore(time);
+        Point p = this->boundaryPoint(valve->settingBoundary(), time);
         if (p.isValid) {
           if (settingUnits.isSameDimensionAs(RTX_PSI)) {
             p = Point::convertPoint(p, settingUnits, this->pressureUnits());
@@ -1295,7 +1902,7 @@ void Model::setSimulationParameters(time_t time) {
     // status can affect settings and vice-versa; status rules
     Pipe::status_t status = pump->fixedStatus();
     if (pump->statusBoundary()) {
-      Point p = pump->statusBoundary()->pointAtOrBefore(time);
+      Point p = this->boundaryPoint(pump->statusBoundary(), time);
       if (p.isValid) {
         status = Pipe::status_t((int)(p.value));
         setPumpStatusControl( pump->name(), status, enable );
@@ -1309,7 +1916,7 @@ void Model::setSimulationParameters(time_t time) {
     }
     if (pump->settingBoundary()) {
       if (status == Pipe::OPEN) {
-        Point p = pump->settingBoundary()->pointAtOrBefore(time);
+        Point p = this->boundaryPoint(pump->settingBoundary(), time);
         // edge case where series is in % or purely dimensionless
         if (pump->settingBoundary()->units() == RTX_PERCENT) {
           p.value /= 100.0;
@@ -1336,7 +1943,7 @@ void Model::setSimulationParameters(time_t time) {
   // for pipes, set status
   for(Pipe::_sp pipe: this->pipes()) {
     if (pipe->statusBoundary()) {
-      Point p = pipe->statusBoundary()->pointAtOrBefore(time);
+      Point p = this->boundaryPoint(pipe->statusBoundary(), time);
       if (p.isValid) {
         Pipe::status_t status = Pipe::status_t((int)(p.value));
         setPipeStatusControl(pipe->name(), status, enable);
@@ -1356,7 +1963,7 @@ void Model::setSimulationParameters(time_t time) {
   if (this->shouldRunWaterQuality()) {
     for(Junction::_sp j: this->junctions()) {
       if (j->qualitySource()) {
-        Point p = j->qualitySource()->pointAtOrBefore(time);
+        Point p = this->boundaryPoint(j->qualitySource(), time);
         if (p.isValid) {
           double quality = Units::convertValue(p.value, j->qualitySource()->units(), qualityUnits());
           setJunctionQuality(j->name(), quality);
@@ -1372,7 +1979,7 @@ void Model::setSimulationParameters(time_t time) {
     for(Reservoir::_sp reservoir: this->reservoirs()) {
       if (reservoir->boundaryQuality()) {
         // get the quality measurement parameter, and pass it through as a state.
-        Point p = reservoir->boundaryQuality()->pointAtOrBefore(time);
+        Point p = this->boundaryPoint(reservoir->boundaryQuality(), time);
         if (p.isValid) {
           double qualityValue = Units::convertValue(p.value, reservoir->boundaryQuality()->units(), qualityUnits());
           setReservoirQuality( reservoir->name(), qualityValue );
@@ -1396,18 +2003,25 @@ void Model::fetchSimulationStates() {
   // retrieve results from the hydraulic sim
   // then insert the state values into elements' "short-term" memory
   
+  if (_stateExchangeIsStale()) {
+    this->prepareStateExchange();
+  }
+  const size_t nJunctions = _junctions.size();
+  
   // junctions, tanks, reservoirs
-  for(Junction::_sp junction : junctions()) {
-    double head;
-    head = Units::convertValue(junctionHead(junction->name()), headUnits(), junction->head()->units());
-    junction->state_head = head;
-    
-    double pressure;
-    pressure = Units::convertValue(junctionPressure(junction->name()), pressureUnits(), junction->pressure()->units());
-    junction->state_pressure = pressure;
-    
-    // todo - more fine-grained quality data? at wq step resolution...
-    if (this->shouldRunWaterQuality()) {
+  this->junctionHeads(_exchangeValues);
+  for (size_t i = 0; i < nJunctions; ++i) {
+    _junctions[i]->state_head = _headFromModel[i](_exchangeValues[i]);
+  }
+  
+  this->junctionPressures(_exchangeValues);
+  for (size_t i = 0; i < nJunctions; ++i) {
+    _junctions[i]->state_pressure = _pressureFromModel[i](_exchangeValues[i]);
+  }
+  
+  // todo - more fine-grained quality data? at wq step resolution...
+  if (this->shouldRunWaterQuality()) {
+    for(Junction::_sp junction : _junctions) {
       double quality;
       quality = Units::convertValue(junctionQuality(junction->name()), this->qualityUnits(), junction->quality()->units());
       junction->state_quality = quality;
@@ -1415,9 +2029,9 @@ void Model::fetchSimulationStates() {
   }
   
   if (!_doesOverrideDemands) { // otherwise this state ivar is set by the containing DMA object
-    for(Junction::_sp junction : junctions()) {
-      double demand = Units::convertValue(junctionDemand(junction->name()), flowUnits(), junction->demand()->units());
-      junction->state_demand = demand;
+    this->junctionDemands(_exchangeValues);
+    for (size_t i = 0; i < nJunctions; ++i) {
+      _junctions[i]->state_demand = _demandFromModel[i](_exchangeValues[i]);
     }
   }
   
@@ -1460,13 +2074,12 @@ void Model::fetchSimulationStates() {
   }
   
   // link elements
-  for(Link::_sp link : this->links()) {
-    auto pipe = dynamic_pointer_cast<Pipe>(link);
-    
-    double flow;
-    flow = Units::convertValue(pipeFlow(pipe->name()), flowUnits(), pipe->flow()->units());
-    pipe->state_flow = flow;
-    
+  this->linkFlows(_exchangeValues);
+  for (size_t i = 0; i < _exchangeLinks.size(); ++i) {
+    _exchangeLinks[i]->state_flow = _linkFlowFromModel[i](_exchangeValues[i]);
+  }
+  
+  for(Pipe::_sp pipe : _exchangeLinks) {
     double setting = pipeSetting(pipe->name());
     pipe->state_setting = setting;
     
@@ -1481,88 +2094,222 @@ void Model::fetchSimulationStates() {
     // nothing extra
   }
   
+  lock_guard<mutex> lock(_networkStateMtx);
+  this->fillNetworkState(_networkState);
+}
+
+void Model::fillNetworkState(NetworkState& state) {
+  if (_stateExchangeIsStale()) {
+    this->prepareStateExchange();
+  }
+  state.time = this->currentSimulationTime();
+  state.resize(_junctions.size(), _reservoirs.size(), _tanks.size(), _exchangeLinks.size());
+  const bool quality = this->shouldRunWaterQuality();
+  
+  for (size_t i = 0; i < _junctions.size(); ++i) {
+    const Junction::_sp& j = _junctions[i];
+    state.junctionHead[i] = j->state_head;
+    state.junctionPressure[i] = j->state_pressure;
+    state.junctionDemand[i] = j->state_demand;
+    state.junctionQuality[i] = quality ? j->state_quality : NAN;
+  }
+  for (size_t i = 0; i < _reservoirs.size(); ++i) {
+    state.reservoirHead[i] = _reservoirs[i]->state_head;
+    state.reservoirQuality[i] = quality ? _reservoirs[i]->state_quality : NAN;
+  }
+  for (size_t i = 0; i < _tanks.size(); ++i) {
+    const Tank::_sp& t = _tanks[i];
+    state.tankHead[i] = t->state_head;
+    state.tankLevel[i] = t->state_level;
+    state.tankVolume[i] = t->state_volume;
+    state.tankFlow[i] = t->state_flow;
+    state.tankQuality[i] = quality ? t->state_quality : NAN;
+    state.tankInletQuality[i] = quality ? t->state_inlet_quality : NAN;
+  }
+  for (size_t i = 0; i < _exchangeLinks.size(); ++i) {
+    const Pipe::_sp& p = _exchangeLinks[i];
+    state.linkFlow[i] = p->state_flow;
+    state.linkSetting[i] = p->state_setting;
+    state.linkStatus[i] = p->state_status;
+    state.linkEnergy[i] = p->state_energy;
+    state.linkQuality[i] = quality ? p->state_quality() : NAN;
+  }
+}
+
+NetworkState Model::networkState() {
+  lock_guard<mutex> lock(_networkStateMtx);
+  return _networkState;
+}
+
+
+#pragma mark - Bulk State Exchange
+
+Model::UnitsConversion::UnitsConversion(const Units& from, const Units& to) {
+  // same affine map as Units::convertValue, folded into a single multiply-add
+  if (from.isSameDimensionAs(to)) {
+    _scale = from.conversion() / to.conversion();
+    _offset = from.offset() * _scale - to.offset();
+  }
+  else {
+    cerr << "Units are not dimensionally consistent" << endl;
+    _scale = 0;
+    _offset = 0;
+  }
+}
+
+bool Model::_stateExchangeIsStale() {
+  return _headFromModel.size() != _junctions.size() || _exchangeLinks.size() != _links.size();
+}
+
+void Model::prepareStateExchange() {
+  _headFromModel.clear();
+  _pressureFromModel.clear();
+  _demandFromModel.clear();
+  _demandToModel.clear();
+  _linkFlowFromModel.clear();
+  _exchangeLinks.clear();
+  
+  for(Junction::_sp junction : _junctions) {
+    _headFromModel.push_back(UnitsConversion(headUnits(), junction->head()->units()));
+    _pressureFromModel.push_back(UnitsConversion(pressureUnits(), junction->pressure()->units()));
+    _demandFromModel.push_back(UnitsConversion(flowUnits(), junction->demand()->units()));
+    _demandToModel.push_back(UnitsConversion(junction->demand()->units(), flowUnits()));
+  }
+  for(auto& linkPair : _links) {
+    Pipe::_sp pipe = dynamic_pointer_cast<Pipe>(linkPair.second);
+    _exchangeLinks.push_back(pipe);
+    _linkFlowFromModel.push_back(UnitsConversion(flowUnits(), pipe->flow()->units()));
+  }
+  _exchangeValues.reserve(max(_junctions.size(), _exchangeLinks.size()));
   
+  this->prepareEngineIndices();
+}
+
+void Model::junctionHeads(std::vector<double>& heads) {
+  heads.resize(_junctions.size());
+  for (size_t i = 0; i < _junctions.size(); ++i) {
+    heads[i] = junctionHead(_junctions[i]->name());
+  }
+}
+
+void Model::junctionPressures(std::vector<double>& pressures) {
+  pressures.resize(_junctions.size());
+  for (size_t i = 0; i < _junctions.size(); ++i) {
+    pressures[i] = junctionPressure(_junctions[i]->name());
+  }
+}
+
+void Model::junctionDemands(std::vector<double>& demands) {
+  demands.resize(_junctions.size());
+  for (size_t i = 0; i < _junctions.size(); ++i) {
+    demands[i] = junctionDemand(_junctions[i]->name());
+  }
+}
+
+void Model::linkFlows(std::vector<double>& flows) {
+  flows.resize(_exchangeLinks.size());
+  for (size_t i = 0; i < _exchangeLinks.size(); ++i) {
+    flows[i] = pipeFlow(_exchangeLinks[i]->name());
+  }
+}
+
+void Model::setJunctionDemands(const std::vector<double>& demands) {
+  for (size_t i = 0; i < _junctions.size() && i < demands.size(); ++i) {
+    setJunctionDemand(_junctions[i]->name(), demands[i]);
+  }
 }
 
 
 void Model::saveNetworkStates(time_t simtime, std::set<PointRecord::_sp> bulkRecords) {
+  NetworkState state;
+  this->fillNetworkState(state);
+  state.time = simtime;
+  this->saveNetworkStates(state, bulkRecords);
+}
+
+void Model::saveNetworkStates(const NetworkState& state, std::set<PointRecord::_sp> bulkRecords) {
+  const time_t simtime = state.time;
   struct tm * timeinfo = localtime (&simtime);
   OATPP_LOGD("Model", "saving network states: %s", put_time(timeinfo, "%c"));
 //  cout << "*** saving network states ***" << asctime(timeinfo) << " - " << simtime << EOL << flush;
   auto t1 = time(NULL);
+  
+  if (_stateExchangeIsStale()) {
+    this->prepareStateExchange();
+  }
+  if (state.junctionCount() != _junctions.size() || state.reservoirCount() != _reservoirs.size() || state.tankCount() != _tanks.size() || state.linkCount() != _exchangeLinks.size()) {
+    this->logLine("ERROR: Network state does not match the model's elements; not saved");
+    return;
+  }
 
   for(PointRecord::_sp r: bulkRecords) {
     r->beginBulkOperation();
   }
-  // retrieve results from the hydraulic sim
-  // then insert the state values into elements' time series.
+  // collect the state values by destination record, so that each record receives the whole step
+  // in one call and can write it as a single statement or request.
+  map<PointRecord::_sp, PointRecord::pointRows_t> rowsByRecord;
+  auto put = [&](TimeSeries::_sp ts, double value) {
+    PointRecord::_sp r = ts->record();
+    if (r) {
+      rowsByRecord[r].push_back(make_pair(ts->name(), Point(simtime, value)));
+    }
+    else {
+      ts->insert(Point(simtime, value));
+    }
+  };
+  
   // junctions, tanks, reservoirs
-  for(Junction::_sp junction : junctions()) {
-    junction->head()->insert(Point(simtime, junction->state_head));
-    junction->pressure()->insert(Point(simtime, junction->state_pressure));
+  const bool quality = this->shouldRunWaterQuality();
+  for (size_t i = 0; i < _junctions.size(); ++i) {
+    const Junction::_sp& junction = _junctions[i];
+    put(junction->head(), state.junctionHead[i]);
+    put(junction->pressure(), state.junctionPressure[i]);
     // todo - more fine-grained quality data? at wq step resolution...
-    if (this->shouldRunWaterQuality()) {
-      junction->quality()->insert(Point(simtime, junction->state_quality));
+    if (quality) {
+      put(junction->quality(), state.junctionQuality[i]);
     }
+    put(junction->demand(), state.junctionDemand[i]);
   }
   
-  for(Junction::_sp junction : junctions()) {
-    junction->demand()->insert(Point(simtime, junction->state_demand));
-  }
-  
-  for(Reservoir::_sp reservoir : reservoirs()) {
-    reservoir->head()->insert(Point(simtime, reservoir->state_head));
-    if (this->shouldRunWaterQuality()) {
-      reservoir->quality()->insert(Point(simtime, reservoir->state_quality));
+  for (size_t i = 0; i < _reservoirs.size(); ++i) {
+    const Reservoir::_sp& reservoir = _reservoirs[i];
+    put(reservoir->head(), state.reservoirHead[i]);
+    if (quality) {
+      put(reservoir->quality(), state.reservoirQuality[i]);
     }
   }
   
-  for(Tank::_sp tank : tanks()) {
-    tank->head()->insert(Point(simtime, tank->state_head));
-    tank->level()->insert(Point(simtime, tank->state_level));
-    tank->volume()->insert(Point(simtime,tank->state_volume));
-    tank->flow()->insert(Point(simtime,tank->state_flow));
-    if (this->shouldRunWaterQuality()) {
-      tank->quality()->insert(Point(simtime, tank->state_quality));
-      if (!isnan(tank->state_inlet_quality)) {
-        tank->inletQuality()->insert(Point(simtime, tank->state_inlet_quality));
+  for (size_t i = 0; i < _tanks.size(); ++i) {
+    const Tank::_sp& tank = _tanks[i];
+    put(tank->head(), state.tankHead[i]);
+    put(tank->level(), state.tankLevel[i]);
+    put(tank->volume(), state.tankVolume[i]);
+    put(tank->flow(), state.tankFlow[i]);
+    if (quality) {
+      put(tank->quality(), state.tankQuality[i]);
+      if (!isnan(state.tankInletQuality[i])) {
+        put(tank->inletQuality(), state.tankInletQuality[i]);
       }
     }
   }
   
-  
-  // pipe elements
-  
-  if (this->shouldRunWaterQuality()) {
-    for(Pipe::_sp pipe : pipes()) {
-      pipe->quality()->insert(Point(simtime, pipe->state_quality()));
-    }
-    for(Valve::_sp valve : valves()) {
-      valve->quality()->insert(Point(simtime, valve->state_quality()));
+  // pipes, valves and pumps
+  for (size_t i = 0; i < _exchangeLinks.size(); ++i) {
+    const Pipe::_sp& pipe = _exchangeLinks[i];
+    if (quality) {
+      put(pipe->quality(), state.linkQuality[i]);
     }
-    for(Pump::_sp pump : pumps()) {
-      pump->quality()->insert(Point(simtime, pump->state_quality()));
+    put(pipe->flow(), state.linkFlow[i]);
+    put(pipe->setting(), state.linkSetting[i]);
+    put(pipe->status(), state.linkStatus[i]);
+    if (pipe->type() == Element::PUMP) {
+      Pump::_sp pump = static_pointer_cast<Pump>(pipe);
+      put(pump->energy(), state.linkEnergy[i]);
     }
   }
   
-  for(Pipe::_sp pipe : pipes()) {
-    pipe->flow()->insert(Point(simtime, pipe->state_flow));
-    pipe->setting()->insert(Point(simtime, pipe->state_setting));
-    pipe->status()->insert(Point(simtime, pipe->state_status));
-  }
-  
-  for(Valve::_sp valve : valves()) {
-    valve->flow()->insert(Point(simtime, valve->state_flow));
-    valve->setting()->insert(Point(simtime, valve->state_setting));
-    valve->status()->insert(Point(simtime, valve->state_status));
-  }
-  
-  // pump energy
-  for(Pump::_sp pump : pumps()) {
-    pump->flow()->insert(Point(simtime, pump->state_flow));
-    pump->energy()->insert(Point(simtime, pump->state_energy));
-    pump->setting()->insert(Point(simtime, pump->state_setting));
-    pump->status()->insert(Point(simtime, pump->state_status));
+  for(auto& recordRows : rowsByRecord) {
+    recordRows.first->addPointRows(recordRows.second);
   }
   
   
@@ -13,7 +13,11 @@
 #include <map>
 #include <time.h>
 
+#include <condition_variable>
+#include <deque>
 #include <future>
+#include <mutex>
+#include <thread>
 
 #include "rtxExceptions.h"
 #include "Element.h"
@@ -28,6 +32,8 @@
 #include "PointRecord.h"
 #include "Units.h"
 #include "Curve.h"
+#include "NetworkState.h"
+#include "BoundaryTable.h"
 #include "rtxMacros.h"
 
 
@@ -65,13 +71,19 @@ namespace RTX {
     virtual void useModelFromPath(const std::string& path);
     virtual string modelFile();
     virtual string modelHash();
+    
+    // with a directory set, element wrappers and DMAs are read back from snapshot files keyed by modelHash()
+    // when one matches, and written out after they are built. empty (the default) turns this off.
+    void setSnapshotDirectory(const std::string& directory);
+    std::string snapshotDirectory();
     virtual void overrideControls();
     virtual std::string getProjectionString();
     virtual void setProjectionString(std::string projectionString);
     
     /// simulation methods
-    void runSinglePeriod(time_t time);
+    void runSinglePeriod(time_t time); // from the nearest checkpoint or tank reset through `time`
     void runExtendedPeriod(time_t start, time_t end);
+    void runExtendedPeriodFromCheckpoint(time_t start, time_t end); // restarts at or before `start`, then runs to `end`
     void runForecast(time_t start, time_t end);
     
     bool solveAndSaveOutputAtTime(time_t simulationTime);
@@ -80,9 +92,33 @@ namespace RTX {
     bool updateSimulationToTime(time_t time);
     virtual void cleanupModelAfterSimulation() {};
     
-    void cancelSimulation();
+    void cancelSimulation(); // steps already solved are still written
+    
+    // pipelining: while a step solves, boundary inputs for up to `depth` upcoming clock steps are read
+    // ahead, and up to `depth` solved steps are held for the background writer. zero (the default) runs
+    // every stage in line. read-ahead only reads the boundary series, on other threads while the solver
+    // runs; their records lock their caches, so the series may be shared with other models running at once.
+    // nothing may change a boundary series' source, record or units while a pipelined run is going.
+    void setPipelineDepth(int depth);
+    int pipelineDepth();
+    void waitForNetworkStates(); // returns once every queued step has been written
+    std::vector<TimeSeries::_sp> boundarySeries(); // the series read by setSimulationParameters
+    
+    // boundary inputs for a window fetched up front in batched queries, then looked up per step from memory.
+    // runs fill this themselves a chunk at a time; a prefetched window is kept until cleared or a run ends.
+    void prefetchBoundaryConditions(TimeRange window);
+    void clearBoundaryConditions();
     
     void refreshRecordsForModeledStates();
+    std::set<PointRecord::_sp> recordsForModeledStates(); // as of the last refresh
+    
+    // with a sink set, solved steps are handed to it instead of being written to the state records
+    typedef std::function<void(NetworkState&&)> networkStateSink_t;
+    void setNetworkStateSink(networkStateSink_t sink);
+    
+    // take on the simulation setup of another model of the same network: element inputs and measures,
+    // DMAs, clocks and options. the input series are shared with the source; clocks and state series are not.
+    void copyConfigurationFrom(Model& other);
     
     // these were considered but never used / implemented
 //    void setStorage(PointRecord::_sp record);
@@ -151,6 +187,9 @@ namespace RTX {
     virtual void setQualityTimeStep(int seconds);
     int qualityTimeStep();
     
+    virtual void setDemandMultiplier(double multiplier) { }; // global scaling of every junction demand
+    virtual double demandMultiplier() { return 1; };
+    
     void setInitialQualityConditionsFromHotStart(time_t time);
     void setInitialJunctionUniformQuality(double qual);
     double initialUniformQuality();
@@ -165,9 +204,32 @@ namespace RTX {
     TimeSeries::_sp convergence() {return _convergence; }
     
     void setTankResetClock(Clock::_sp resetClock);
+    Clock::_sp tankResetClock();
     
     void setTanksNeedReset(bool reset);
     bool tanksNeedReset();
+    
+    // the engine state a run needs to restart at a solved step. levels and settings are in model units;
+    // quality is in each element's units, and empty when water quality is not run.
+    class Checkpoint {
+    public:
+      time_t time;
+      vector<double> tankLevel; // indexed like tanks()
+      vector<float> linkSetting; // indexed like links()
+      vector<unsigned char> linkStatus;
+      vector<float> junctionQuality, tankQuality, reservoirQuality;
+    };
+    
+    // checkpoints are taken at solved steps that fall on the clock. the oldest are dropped past the limit.
+    void setCheckpointClock(Clock::_sp clock);
+    Clock::_sp checkpointClock();
+    void setCheckpointLimit(size_t count);
+    size_t checkpointLimit();
+    std::vector<time_t> checkpointTimes();
+    std::vector<Checkpoint> checkpoints(TimeRange range);
+    void addCheckpoint(const Checkpoint& checkpoint); // e.g. one taken by another engine of the same network
+    void clearCheckpoints(); // after a change to inputs that were already simulated
+    time_t restoreNearestCheckpoint(time_t time); // returns the time a run should start from
         
     virtual std::ostream& toStream(std::ostream &stream);
 
@@ -228,6 +290,9 @@ namespace RTX {
     void setSimulationParameters(time_t time);
     void fetchSimulationStates();
     void saveNetworkStates(time_t time, std::set<PointRecord::_sp> bulkOperationRecords);
+    void saveNetworkStates(const NetworkState& state, std::set<PointRecord::_sp> bulkOperationRecords);
+    void fillNetworkState(NetworkState& state); // from the elements' current state values
+    NetworkState networkState(); // copy of the state from the most recent fetchSimulationStates
     
     
     
@@ -264,6 +329,14 @@ namespace RTX {
     virtual void setPumpSettingControl(const std::string& pump, double setting, enableControl_t) { };
     virtual void setValveSetting(const string& valve, double setting) { };
     virtual void setValveSettingControl(const string& valve, double setting, enableControl_t) { };
+    
+    // bulk state exchange. values are in model units, ordered like junctions() and links().
+    // the defaults loop over the per-element accessors; engines override with resolved indices.
+    virtual void junctionHeads(std::vector<double>& heads);
+    virtual void junctionPressures(std::vector<double>& pressures);
+    virtual void junctionDemands(std::vector<double>& demands);
+    virtual void linkFlows(std::vector<double>& flows);
+    virtual void setJunctionDemands(const std::vector<double>& demands);
 
   protected:
     
@@ -275,19 +348,42 @@ namespace RTX {
     
     virtual void setCurrentSimulationTime(time_t time);
     
+    // element lists and unit conversions used by the bulk state exchange; resolved once per run
+    void prepareStateExchange();
+    virtual void prepareEngineIndices() { };
+    std::vector<Pipe::_sp> _exchangeLinks;
+    
     double nodeDirectDistance(Node::_sp n1, Node::_sp n2);
     double toRadians(double degrees);
     
     void logLine(const std::string& line);
     
+    // waits for read-ahead and joins the background writer, which may still be saving steps through this
+    // model. a derived class calls this first thing in its destructor, before any of its own state goes.
+    void stopPipeline();
+    
     string _modelFile;
     
+    bool loadElementSnapshot();
+    void saveElementSnapshot();
+    
   private:
     void initObj();
     string _name;
     bool _shouldRunWaterQuality;
     bool _tanksNeedReset;
     void _checkTanksForReset(time_t time);
+    
+    class UnitsConversion {
+    public:
+      UnitsConversion(const Units& from, const Units& to);
+      double operator()(double value) const { return value * _scale + _offset; };
+    private:
+      double _scale, _offset;
+    };
+    std::vector<UnitsConversion> _headFromModel, _pressureFromModel, _demandFromModel, _demandToModel, _linkFlowFromModel;
+    std::vector<double> _exchangeValues;
+    bool _stateExchangeIsStale();
     // master list access
     void add(Junction::_sp newJunction);
     void add(Pipe::_sp newPipe);
@@ -316,6 +412,12 @@ namespace RTX {
     Clock::_sp _regularMasterClock, _simReportClock;
     TimeSeries::_sp _relativeError, _iterations, _convergence, _heartbeat, _simWallTime, _saveWallTime, _filterWallTime;
     Clock::_sp _tankResetClock;
+    Clock::_sp _checkpointClock;
+    size_t _checkpointLimit;
+    std::map<time_t, Checkpoint> _checkpoints;
+    std::mutex _checkpointMtx;
+    void saveCheckpoint(time_t time);
+    bool restoreCheckpoint(const Checkpoint& checkpoint);
     int _qualityTimeStep;
     bool _doesOverrideDemands;
     bool _shouldCancelSimulation;
@@ -325,8 +427,31 @@ namespace RTX {
     double _initialQuality;
     RTX_Logging_Callback_Block _simLogCallback;
     std::function<void(time_t)> _didSimulateCallback, _willSimulateCallback;
-    std::future<void> _saveStateFuture;
+    int _pipelineDepth;
+    std::vector<TimeSeries::_sp> _readAheadSeries;
+    time_t _readAheadLimit;
+    std::deque<std::pair<time_t, std::future<void> > > _readAhead;
+    void readAheadFrom(time_t time);
+    void waitForReadAhead(time_t throughTime);
+    BoundaryTable::_sp _boundaryTable;
+    time_t _boundaryLimit;
+    void ensureBoundaryTable(time_t time);
+    Point boundaryPoint(const TimeSeries::_sp& ts, time_t time);
+    std::thread _writerThread;
+    std::mutex _writerMtx;
+    std::condition_variable _writerCv;
+    std::deque<std::pair<NetworkState, std::set<PointRecord::_sp> > > _writerQueue; // the front entry stays queued while it is written
+    bool _writerStop;
+    void queueNetworkState(NetworkState&& state, const std::set<PointRecord::_sp>& records);
+    networkStateSink_t _networkStateSink;
+    void writerLoop();
+    NetworkState _networkState;
+    std::mutex _networkStateMtx;
     std::string _projectionString;
+    std::string _snapshotDirectory;
+    std::string snapshotPath(const std::string& hash, const std::string& extension);
+    std::string dmaSnapshotKey(const std::string& hash);
+    vector<Dma::_sp> findDmas(set<Pipe::_sp>& boundaryPipes); // connected components between measured or closed links
     
   };
   
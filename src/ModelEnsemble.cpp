@@ -0,0 +1,160 @@
+#include "ModelEnsemble.h"
+
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "ConstantTimeSeries.h"
+
+using namespace std;
+using namespace RTX;
+
+ModelEnsemble::Scenario::Scenario(const string& name) : name(name) {
+  demandMultiplier = 1;
+}
+
+ModelEnsemble::ModelEnsemble(EpanetModel::_sp model) : _model(model) {
+  _workerCount = max(1, (int)thread::hardware_concurrency());
+  _cancel = false;
+  _baseDemandMultiplier = 1;
+}
+
+void ModelEnsemble::setWorkerCount(int count) {
+  _workerCount = max(1, count);
+}
+
+int ModelEnsemble::workerCount() {
+  return _workerCount;
+}
+
+void ModelEnsemble::addScenario(const Scenario& scenario) {
+  _scenarios.push_back(scenario);
+}
+
+vector<ModelEnsemble::Scenario> ModelEnsemble::scenarios() {
+  return _scenarios;
+}
+
+void ModelEnsemble::clearScenarios() {
+  _scenarios.clear();
+}
+
+void ModelEnsemble::cancel() {
+  _cancel = true;
+}
+
+vector<string> ModelEnsemble::run(time_t start, time_t end) {
+  _cancel = false;
+
+  // every member starts where the model is now, unless its tanks are about to be reset from measurements
+  map<string, double> tankLevels;
+  if (!_model->tanksNeedReset()) {
+    for (Tank::_sp tank : _model->tanks()) {
+      tankLevels[tank->name()] = _model->tankLevel(tank->name());
+    }
+  }
+
+  _baseDemandMultiplier = _model->demandMultiplier();
+
+  atomic<size_t> next(0);
+  mutex failedMtx;
+  vector<string> failed;
+  auto fail = [&](const Scenario& s, const string& why) {
+    lock_guard<mutex> l(failedMtx);
+    cerr << "ensemble member " << s.name << " failed: " << why << endl;
+    failed.push_back(s.name);
+  };
+
+  vector<thread> workers;
+  const size_t nWorkers = min((size_t)_workerCount, _scenarios.size());
+  for (size_t iWorker = 0; iWorker < nWorkers; ++iWorker) {
+    workers.push_back(thread([&]() {
+      EpanetModel::_sp engine;
+      string cloneError;
+      try {
+        engine = _model->clone();
+      } catch (const std::exception& e) {
+        cloneError = e.what();
+      } catch (const string& e) {
+        cloneError = e;
+      } catch (...) {
+        cloneError = "unknown error";
+      }
+      bool configured = true; // a fresh clone already has the model's configuration
+      for (size_t i = next++; i < _scenarios.size() && !_cancel; i = next++) {
+        const Scenario& scenario = _scenarios[i];
+        if (!engine) {
+          fail(scenario, "could not clone the model: " + cloneError);
+          continue;
+        }
+        try {
+          if (!configured) {
+            engine->copyConfigurationFrom(*_model); // undo the last member's overrides
+          }
+          configured = false;
+          this->runMember(engine, scenario, start, end, tankLevels);
+        } catch (const std::exception& e) {
+          fail(scenario, e.what());
+        } catch (const string& e) {
+          fail(scenario, e);
+        } catch (...) {
+          fail(scenario, "unknown error");
+        }
+      }
+    }));
+  }
+  for (thread& worker : workers) {
+    worker.join();
+  }
+
+  return failed;
+}
+
+void ModelEnsemble::runMember(EpanetModel::_sp engine, const Scenario& scenario, time_t start, time_t end, const map<string, double>& tankLevels) {
+
+  // overrides are constant boundaries, so each step applies them the same way as measured ones
+  for (auto& valveSetting : scenario.valveSettings) {
+    Valve::_sp valve = dynamic_pointer_cast<Valve>(engine->linkWithName(valveSetting.first));
+    if (!valve) {
+      cerr << "ensemble member " << scenario.name << ": no valve " << valveSetting.first << endl;
+      continue;
+    }
+    ConstantTimeSeries::_sp setting(new ConstantTimeSeries);
+    setting->setName(valve->name() + ".scenario.setting");
+    setting->setValue(valveSetting.second);
+    valve->setSettingBoundary(setting);
+  }
+  for (auto& pumpStatus : scenario.pumpStatuses) {
+    Pump::_sp pump = dynamic_pointer_cast<Pump>(engine->linkWithName(pumpStatus.first));
+    if (!pump) {
+      cerr << "ensemble member " << scenario.name << ": no pump " << pumpStatus.first << endl;
+      continue;
+    }
+    ConstantTimeSeries::_sp status(new ConstantTimeSeries);
+    status->setName(pump->name() + ".scenario.status");
+    status->setValue((double)pumpStatus.second);
+    pump->setStatusBoundary(status);
+  }
+
+  // set for every member, so that one without a record does not write into the record of whichever
+  // member ran on this engine before it. a null record gives each series a fresh in-memory one.
+  PointRecord::_sp record = scenario.record;
+  for (Element::_sp e : engine->elements()) {
+    e->setRecord(record);
+  }
+  for (Tank::_sp t : engine->tanks()) {
+    t->level()->setRecord(record);
+    t->volume()->setRecord(record);
+    t->flow()->setRecord(record);
+    t->inletQuality()->setRecord(record);
+  }
+  engine->setRecordForSimulationStats(record);
+
+  engine->initEngine();
+  engine->setDemandMultiplier(_baseDemandMultiplier * scenario.demandMultiplier);
+  for (auto& tankLevel : tankLevels) {
+    engine->setTankLevel(tankLevel.first, tankLevel.second);
+  }
+
+  engine->runForecast(start, end);
+}
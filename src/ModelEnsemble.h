@@ -0,0 +1,58 @@
+#ifndef ModelEnsemble_h
+#define ModelEnsemble_h
+
+#include <stdio.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "EpanetModel.h"
+#include "PointRecord.h"
+
+// many what-if runs of one configured model at once. each worker thread gets its own engine cloned
+// from the model, and takes scenarios from a shared list until none are left: the clone takes the
+// model's configuration again, applies the scenario's overrides and runs a forecast into the
+// scenario's record.
+
+namespace RTX {
+  class ModelEnsemble {
+  public:
+    typedef std::shared_ptr<ModelEnsemble> _sp;
+
+    class Scenario {
+    public:
+      Scenario(const std::string& name = "");
+      std::string name;
+      double demandMultiplier; // on top of the model's own
+      std::map<std::string, double> valveSettings; // by valve name, in model units
+      std::map<std::string, Pipe::status_t> pumpStatuses; // by pump name
+      PointRecord::_sp record; // receives this member's states and simulation stats. without one, they are discarded
+    };
+
+    ModelEnsemble(EpanetModel::_sp model);
+
+    void setWorkerCount(int count); // engines running at once. defaults to the hardware thread count
+    int workerCount();
+
+    void addScenario(const Scenario& scenario);
+    std::vector<Scenario> scenarios();
+    void clearScenarios();
+
+    // runForecast over [start,end) for every scenario. returns the names of members that failed.
+    std::vector<std::string> run(time_t start, time_t end);
+    void cancel(); // members already running finish
+
+  private:
+    EpanetModel::_sp _model;
+    std::vector<Scenario> _scenarios;
+    int _workerCount;
+    std::atomic<bool> _cancel;
+    double _baseDemandMultiplier;
+
+    void runMember(EpanetModel::_sp engine, const Scenario& scenario, time_t start, time_t end, const std::map<std::string, double>& tankLevels);
+  };
+}
+
+#endif /* ModelEnsemble_h */
@@ -0,0 +1,433 @@
+#include "ModelSnapshot.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include "Model.h"
+
+using namespace std;
+using namespace RTX;
+
+#define RTX_MODEL_SNAPSHOT_VERSION 1
+
+static const char _elementsMagic[4] = {'R','T','X','E'};
+static const char _dmasMagic[4] = {'R','T','X','D'};
+
+// layout: magic, uint32 version, key, then the sections below. strings are a uint32 length and
+// the bytes; everything else is written raw, in native byte order.
+
+template<typename T>
+static void _put(ostream& out, const T& value) {
+  out.write((const char*)&value, sizeof(T));
+}
+
+static void _putString(ostream& out, const string& str) {
+  _put(out, (uint32_t)str.size());
+  out.write(str.data(), str.size());
+}
+
+static void _putHeader(ostream& out, const char magic[4], const string& key) {
+  out.write(magic, 4);
+  _put(out, (uint32_t)RTX_MODEL_SNAPSHOT_VERSION);
+  _putString(out, key);
+}
+
+// reads from the mapped file. a read past the end sets the failure flag and returns zeros.
+class _SnapshotReader {
+public:
+  _SnapshotReader(const char* data, size_t size) : _p(data), _end(data + size), _ok(true) { };
+  bool ok() const { return _ok; };
+  template<typename T> T get() {
+    T value = T();
+    if (!this->has(sizeof(T))) {
+      return value;
+    }
+    memcpy(&value, _p, sizeof(T));
+    _p += sizeof(T);
+    return value;
+  };
+  string getString() {
+    uint32_t n = this->get<uint32_t>();
+    if (!this->has(n)) {
+      return string();
+    }
+    string str(_p, n);
+    _p += n;
+    return str;
+  };
+  // a count of records of at least `minBytesEach`. one that the rest of the file cannot hold fails
+  // here, before anything is allocated for it.
+  uint32_t getCount(size_t minBytesEach) {
+    uint32_t n = this->get<uint32_t>();
+    if (_ok && (size_t)(_end - _p) / minBytesEach < n) {
+      _ok = false;
+    }
+    return _ok ? n : 0;
+  };
+  bool header(const char magic[4], const string& key) {
+    if (!this->has(4) || memcmp(_p, magic, 4) != 0) {
+      _ok = false;
+      return false;
+    }
+    _p += 4;
+    if (this->get<uint32_t>() != RTX_MODEL_SNAPSHOT_VERSION || this->getString() != key) {
+      _ok = false;
+    }
+    return _ok;
+  };
+private:
+  bool has(size_t n) {
+    if (!_ok || (size_t)(_end - _p) < n) {
+      _ok = false;
+    }
+    return _ok;
+  };
+  const char* _p;
+  const char* _end;
+  bool _ok;
+};
+
+static bool _writeAtomically(const string& path, const function<void(ostream&)>& write) {
+  // written beside the target then renamed, so a reader never maps a partial file
+  const string tmpPath = path + ".tmp";
+  {
+    ofstream out(tmpPath, ios::binary | ios::trunc);
+    if (!out) {
+      cerr << "snapshot: could not write " << path << endl;
+      return false;
+    }
+    write(out);
+    if (!out) {
+      cerr << "snapshot: could not write " << path << endl;
+      return false;
+    }
+  }
+  boost::system::error_code ec;
+  boost::filesystem::rename(tmpPath, path, ec);
+  return !ec;
+}
+
+static bool _mapFile(const string& path, boost::iostreams::mapped_file_source& file) {
+  boost::system::error_code ec;
+  if (!boost::filesystem::exists(path, ec) || boost::filesystem::file_size(path, ec) == 0) {
+    return false;
+  }
+  try {
+    file.open(path);
+  } catch (const std::exception& e) {
+    cerr << "snapshot: could not map " << path << ": " << e.what() << endl;
+    return false;
+  }
+  return file.is_open();
+}
+
+#pragma mark - Elements
+
+bool ModelSnapshot::saveElements(Model& model, const string& path, const string& key) {
+  return _writeAtomically(path, [&](ostream& out) {
+    _putHeader(out, _elementsMagic, key);
+
+    map<Curve::_sp, int32_t> curveIndex;
+    vector<Curve::_sp> curves = model.curves();
+    _put(out, (uint32_t)curves.size());
+    for (size_t i = 0; i < curves.size(); ++i) {
+      curveIndex[curves[i]] = (int32_t)i;
+      _putString(out, curves[i]->name);
+      _put(out, (uint32_t)curves[i]->curveData.size());
+      for (auto& xy : curves[i]->curveData) {
+        _put(out, xy.first);
+        _put(out, xy.second);
+      }
+    }
+    auto indexOf = [&](Curve::_sp c) -> int32_t {
+      return (c && curveIndex.count(c)) ? curveIndex[c] : -1;
+    };
+
+    vector<Node::_sp> nodes;
+    vector<Pipe::_sp> links;
+    for (Element::_sp e : model.elements()) {
+      Node::_sp n = dynamic_pointer_cast<Node>(e);
+      if (n) {
+        nodes.push_back(n);
+      }
+      Pipe::_sp p = dynamic_pointer_cast<Pipe>(e);
+      if (p) {
+        links.push_back(p);
+      }
+    }
+
+    map<Node::_sp, uint32_t> nodeIndex;
+    _put(out, (uint32_t)nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      Junction::_sp j = static_pointer_cast<Junction>(nodes[i]);
+      nodeIndex[j] = (uint32_t)i;
+      _put(out, (uint8_t)j->type());
+      _putString(out, j->name());
+      _put(out, j->elevation());
+      _put(out, j->coordinates().longitude);
+      _put(out, j->coordinates().latitude);
+      _put(out, j->state_quality);
+      _put(out, j->baseDemand());
+      _putString(out, j->userDescription());
+      if (j->type() == Element::TANK) {
+        Tank::_sp t = static_pointer_cast<Tank>(j);
+        _put(out, t->minLevel());
+        _put(out, t->maxLevel());
+        _put(out, indexOf(t->geometry()));
+      }
+    }
+
+    _put(out, (uint32_t)links.size());
+    for (Pipe::_sp p : links) {
+      _put(out, (uint8_t)p->type());
+      _putString(out, p->name());
+      _put(out, nodeIndex[p->from()]);
+      _put(out, nodeIndex[p->to()]);
+      _put(out, p->diameter());
+      _put(out, p->length());
+      _put(out, p->roughness());
+      _put(out, p->minorLoss());
+      _put(out, (uint8_t)(p->fixedStatus() == Pipe::CLOSED));
+      _putString(out, p->userDescription());
+      if (p->type() == Element::VALVE) {
+        Valve::_sp v = static_pointer_cast<Valve>(p);
+        _put(out, (int32_t)v->valveType);
+        _put(out, v->fixedSetting);
+      }
+      else if (p->type() == Element::PUMP) {
+        Pump::_sp pump = static_pointer_cast<Pump>(p);
+        _put(out, indexOf(pump->headCurve()));
+        _put(out, indexOf(pump->efficiencyCurve()));
+      }
+    }
+  });
+}
+
+bool ModelSnapshot::loadElements(Model& model, const string& path, const string& key) {
+  boost::iostreams::mapped_file_source file;
+  if (!_mapFile(path, file)) {
+    return false;
+  }
+  _SnapshotReader in(file.data(), file.size());
+  if (!in.header(_elementsMagic, key)) {
+    return false;
+  }
+
+  // everything is read and checked before the model sees any of it
+  vector<Curve::_sp> curves(in.getCount(8));
+  for (Curve::_sp& curve : curves) {
+    curve.reset(new Curve);
+    curve->name = in.getString();
+    curve->inputUnits = RTX_DIMENSIONLESS;
+    curve->outputUnits = RTX_DIMENSIONLESS;
+    uint32_t nPoints = in.getCount(2 * sizeof(double));
+    for (uint32_t iPoint = 0; iPoint < nPoints && in.ok(); ++iPoint) {
+      double x = in.get<double>();
+      curve->curveData[x] = in.get<double>();
+    }
+  }
+  auto curveAt = [&](int32_t idx) -> Curve::_sp {
+    return (idx >= 0 && (size_t)idx < curves.size()) ? curves[idx] : Curve::_sp();
+  };
+
+  vector<Junction::_sp> nodes(in.getCount(49));
+  for (size_t i = 0; i < nodes.size() && in.ok(); ++i) {
+    uint8_t type = in.get<uint8_t>();
+    string name = in.getString();
+    switch (type) {
+      case Element::TANK:
+        nodes[i].reset( new Tank(name) );
+        break;
+      case Element::RESERVOIR:
+        nodes[i].reset( new Reservoir(name) );
+        break;
+      case Element::JUNCTION:
+        nodes[i].reset( new Junction(name) );
+        break;
+      default:
+        return false;
+    }
+    Junction::_sp j = nodes[i];
+    j->setElevation(in.get<double>());
+    double lon = in.get<double>();
+    j->setCoordinates(Node::location_t(lon, in.get<double>()));
+    j->state_quality = in.get<double>();
+    j->setBaseDemand(in.get<double>());
+    j->setUserDescription(in.getString());
+    if (type == Element::TANK) {
+      Tank::_sp t = static_pointer_cast<Tank>(j);
+      double minLevel = in.get<double>();
+      t->setMinMaxLevel(minLevel, in.get<double>());
+      Curve::_sp volumeCurve = curveAt(in.get<int32_t>());
+      if (volumeCurve) {
+        volumeCurve->inputUnits = model.headUnits();
+        volumeCurve->outputUnits = model.volumeUnits();
+      }
+      t->setGeometry(volumeCurve);
+    }
+  }
+
+  vector<Pipe::_sp> links(in.getCount(50));
+  for (size_t i = 0; i < links.size() && in.ok(); ++i) {
+    uint8_t type = in.get<uint8_t>();
+    string name = in.getString();
+    uint32_t from = in.get<uint32_t>(), to = in.get<uint32_t>();
+    if (from >= nodes.size() || to >= nodes.size()) {
+      return false;
+    }
+    switch (type) {
+      case Element::PIPE:
+        links[i].reset( new Pipe(name) );
+        break;
+      case Element::PUMP:
+        links[i].reset( new Pump(name) );
+        break;
+      case Element::VALVE:
+        links[i].reset( new Valve(name) );
+        break;
+      default:
+        return false;
+    }
+    Pipe::_sp p = links[i];
+    p->setNodes(nodes[from], nodes[to]);
+    p->setDiameter(in.get<double>());
+    p->setLength(in.get<double>());
+    p->setRoughness(in.get<double>());
+    p->setMinorLoss(in.get<double>());
+    if (in.get<uint8_t>()) {
+      p->setFixedStatus(Pipe::CLOSED);
+    }
+    p->setUserDescription(in.getString());
+    if (type == Element::VALVE) {
+      Valve::_sp v = static_pointer_cast<Valve>(p);
+      v->valveType = in.get<int32_t>();
+      v->fixedSetting = in.get<double>();
+    }
+    else if (type == Element::PUMP) {
+      Pump::_sp pump = static_pointer_cast<Pump>(p);
+      Curve::_sp headCurve = curveAt(in.get<int32_t>());
+      Curve::_sp effCurve = curveAt(in.get<int32_t>());
+      if (headCurve) {
+        headCurve->inputUnits = model.flowUnits();
+        headCurve->outputUnits = model.headUnits();
+        pump->setHeadCurve(headCurve);
+      }
+      if (effCurve) {
+        effCurve->inputUnits = model.flowUnits();
+        effCurve->outputUnits = RTX_DIMENSIONLESS;
+        pump->setEfficiencyCurve(effCurve);
+      }
+    }
+  }
+
+  if (!in.ok()) {
+    cerr << "snapshot: " << path << " is truncated; ignoring it" << endl;
+    return false;
+  }
+
+  // hand over, with the same units the model file would have given
+  for (Curve::_sp curve : curves) {
+    model.addCurve(curve);
+  }
+  for (Junction::_sp j : nodes) {
+    switch (j->type()) {
+      case Element::TANK:
+      {
+        Tank::_sp t = static_pointer_cast<Tank>(j);
+        model.addTank(t);
+        t->level()->setUnits(model.headUnits());
+        t->flowCalc()->setUnits(model.flowUnits());
+        t->volumeCalc()->setUnits(model.volumeUnits());
+        t->flow()->setUnits(model.flowUnits());
+        t->volume()->setUnits(model.volumeUnits());
+        break;
+      }
+      case Element::RESERVOIR:
+        model.addReservoir(static_pointer_cast<Reservoir>(j));
+        break;
+      default:
+        model.addJunction(j);
+        break;
+    }
+    j->head()->setUnits(model.headUnits());
+    j->pressure()->setUnits(model.pressureUnits());
+    j->demand()->setUnits(model.flowUnits());
+    j->quality()->setUnits(model.qualityUnits());
+  }
+  for (Pipe::_sp p : links) {
+    switch (p->type()) {
+      case Element::PUMP:
+        model.addPump(static_pointer_cast<Pump>(p));
+        break;
+      case Element::VALVE:
+        model.addValve(static_pointer_cast<Valve>(p));
+        break;
+      default:
+        model.addPipe(p);
+        break;
+    }
+    p->flow()->setUnits(model.flowUnits());
+  }
+  return true;
+}
+
+#pragma mark - DMAs
+
+bool ModelSnapshot::saveDmas(Model& model, const string& path, const string& key) {
+  return _writeAtomically(path, [&](ostream& out) {
+    _putHeader(out, _dmasMagic, key);
+    map<Node::_sp, uint32_t> nodeIndex;
+    for (Node::_sp n : model.nodes()) {
+      uint32_t i = (uint32_t)nodeIndex.size();
+      nodeIndex[n] = i;
+    }
+    vector<Dma::_sp> dmas = model.dmas();
+    _put(out, (uint32_t)dmas.size());
+    for (Dma::_sp dma : dmas) {
+      _putString(out, dma->hashedName);
+      set<Junction::_sp> junctions = dma->junctions();
+      _put(out, (uint32_t)junctions.size());
+      for (Junction::_sp j : junctions) {
+        _put(out, nodeIndex[j]);
+      }
+    }
+  });
+}
+
+bool ModelSnapshot::loadDmas(Model& model, const string& path, const string& key, vector<Dma::_sp>& dmas) {
+  boost::iostreams::mapped_file_source file;
+  if (!_mapFile(path, file)) {
+    return false;
+  }
+  _SnapshotReader in(file.data(), file.size());
+  if (!in.header(_dmasMagic, key)) {
+    return false;
+  }
+
+  vector<Node::_sp> nodes = model.nodes();
+  vector<Dma::_sp> loaded(in.getCount(8));
+  for (size_t iDma = 0; iDma < loaded.size() && in.ok(); ++iDma) {
+    loaded[iDma].reset( new Dma("dma " + to_string(iDma)) );
+    loaded[iDma]->hashedName = in.getString();
+    uint32_t nJunctions = in.getCount(sizeof(uint32_t));
+    for (uint32_t i = 0; i < nJunctions && in.ok(); ++i) {
+      uint32_t idx = in.get<uint32_t>();
+      if (idx >= nodes.size()) {
+        return false;
+      }
+      loaded[iDma]->addJunction(static_pointer_cast<Junction>(nodes[idx]));
+    }
+  }
+  if (!in.ok()) {
+    cerr << "snapshot: " << path << " is truncated; ignoring it" << endl;
+    return false;
+  }
+  dmas = loaded;
+  return true;
+}
@@ -0,0 +1,30 @@
+#ifndef ModelSnapshot_h
+#define ModelSnapshot_h
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "Dma.h"
+
+// binary copies of what a model builds on load, so a restart can read them back instead of
+// rebuilding: the element wrappers made from the model file, and the DMAs found from its
+// measures. each file carries a format version and the key it was made for; a file that
+// does not match is ignored. files are read through a memory mapping.
+
+namespace RTX {
+  class Model;
+
+  class ModelSnapshot {
+  public:
+    // curves, nodes and links, in the model's element order. units come from the model on load.
+    static bool saveElements(Model& model, const std::string& path, const std::string& key);
+    static bool loadElements(Model& model, const std::string& path, const std::string& key);
+
+    // dma membership and hashed names. the returned dmas have no demand series yet.
+    static bool saveDmas(Model& model, const std::string& path, const std::string& key);
+    static bool loadDmas(Model& model, const std::string& path, const std::string& key, std::vector<Dma::_sp>& dmas);
+  };
+}
+
+#endif /* ModelSnapshot_h */
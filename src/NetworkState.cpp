@@ -0,0 +1,185 @@
+#include "NetworkState.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+using namespace std;
+using namespace RTX;
+
+#define RTX_NETWORK_STATE_VERSION 1
+
+static const char _stateMagic[4] = {'R','T','X','S'};
+
+// layout: magic, uint32 version, int64 time, uint32 array count, then per array
+// uint64 length followed by the raw doubles. native byte order.
+
+NetworkState::NetworkState() {
+  time = 0;
+}
+
+NetworkState::NetworkState(size_t nJunctions, size_t nReservoirs, size_t nTanks, size_t nLinks) {
+  time = 0;
+  this->resize(nJunctions, nReservoirs, nTanks, nLinks);
+}
+
+vector<vector<double>*> NetworkState::arrays() {
+  return {&junctionHead, &junctionPressure, &junctionDemand, &junctionQuality,
+    &reservoirHead, &reservoirQuality,
+    &tankHead, &tankLevel, &tankVolume, &tankFlow, &tankQuality, &tankInletQuality,
+    &linkFlow, &linkSetting, &linkStatus, &linkEnergy, &linkQuality};
+}
+
+vector<const vector<double>*> NetworkState::arrays() const {
+  auto mutableArrays = const_cast<NetworkState*>(this)->arrays();
+  return vector<const vector<double>*>(mutableArrays.begin(), mutableArrays.end());
+}
+
+void NetworkState::resize(size_t nJunctions, size_t nReservoirs, size_t nTanks, size_t nLinks) {
+  for (auto v : {&junctionHead, &junctionPressure, &junctionDemand, &junctionQuality}) {
+    v->resize(nJunctions, NAN);
+  }
+  for (auto v : {&reservoirHead, &reservoirQuality}) {
+    v->resize(nReservoirs, NAN);
+  }
+  for (auto v : {&tankHead, &tankLevel, &tankVolume, &tankFlow, &tankQuality, &tankInletQuality}) {
+    v->resize(nTanks, NAN);
+  }
+  for (auto v : {&linkFlow, &linkSetting, &linkStatus, &linkEnergy, &linkQuality}) {
+    v->resize(nLinks, NAN);
+  }
+}
+
+bool NetworkState::sameShapeAs(const NetworkState& other) const {
+  auto mine = this->arrays();
+  auto theirs = other.arrays();
+  for (size_t i = 0; i < mine.size(); ++i) {
+    if (mine[i]->size() != theirs[i]->size()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+NetworkState NetworkState::difference(const NetworkState& other) const {
+  NetworkState diff(*this);
+  if (!this->sameShapeAs(other)) {
+    diff.resize(0, 0, 0, 0);
+    return diff;
+  }
+  auto out = diff.arrays();
+  auto theirs = other.arrays();
+  for (size_t i = 0; i < out.size(); ++i) {
+    vector<double>& v = *out[i];
+    const vector<double>& o = *theirs[i];
+    for (size_t j = 0; j < v.size(); ++j) {
+      v[j] -= o[j];
+    }
+  }
+  return diff;
+}
+
+double NetworkState::maxAbsDifference(const NetworkState& other) const {
+  if (!this->sameShapeAs(other)) {
+    return NAN;
+  }
+  double maxDiff = 0;
+  auto mine = this->arrays();
+  auto theirs = other.arrays();
+  for (size_t i = 0; i < mine.size(); ++i) {
+    const vector<double>& v = *mine[i];
+    const vector<double>& o = *theirs[i];
+    for (size_t j = 0; j < v.size(); ++j) {
+      const double d = fabs(v[j] - o[j]);
+      if (d > maxDiff) { // false for NAN
+        maxDiff = d;
+      }
+    }
+  }
+  return maxDiff;
+}
+
+void NetworkState::serialize(ostream& out) const {
+  const uint32_t version = RTX_NETWORK_STATE_VERSION;
+  const int64_t t = time;
+  auto all = this->arrays();
+  const uint32_t nArrays = (uint32_t)all.size();
+  out.write(_stateMagic, sizeof(_stateMagic));
+  out.write((const char*)&version, sizeof(version));
+  out.write((const char*)&t, sizeof(t));
+  out.write((const char*)&nArrays, sizeof(nArrays));
+  for (auto v : all) {
+    const uint64_t n = v->size();
+    out.write((const char*)&n, sizeof(n));
+    out.write((const char*)v->data(), n * sizeof(double));
+  }
+}
+
+// bytes left in a seekable stream, or -1 if the stream cannot tell
+static streamoff __remainingBytes(istream& in) {
+  const streampos here = in.tellg();
+  if (here == streampos(-1)) {
+    in.clear();
+    return -1;
+  }
+  in.seekg(0, ios::end);
+  const streampos end = in.tellg();
+  in.seekg(here);
+  if (end == streampos(-1) || !in) {
+    in.clear();
+    in.seekg(here);
+    return -1;
+  }
+  return (streamoff)(end - here);
+}
+
+bool NetworkState::deserialize(istream& in, NetworkState& state) {
+  char magic[4];
+  uint32_t version, nArrays;
+  int64_t t;
+  if (!in.read(magic, sizeof(magic)) || memcmp(magic, _stateMagic, sizeof(magic)) != 0) {
+    return false;
+  }
+  if (!in.read((char*)&version, sizeof(version)) || version != RTX_NETWORK_STATE_VERSION) {
+    return false;
+  }
+  in.read((char*)&t, sizeof(t));
+  in.read((char*)&nArrays, sizeof(nArrays));
+  auto all = state.arrays();
+  if (!in || nArrays != all.size()) {
+    return false;
+  }
+  // the lengths are not trusted: each must fit in what is left of the stream. a stream that cannot
+  // tell is read in bounded blocks, so that a corrupt length fails at the end of the data instead
+  // of allocating for it up front.
+  const size_t block = 1 << 16;
+  for (auto v : all) {
+    uint64_t n;
+    if (!in.read((char*)&n, sizeof(n)) || n > (uint64_t)numeric_limits<streamoff>::max() / sizeof(double)) {
+      return false;
+    }
+    const streamoff remaining = __remainingBytes(in);
+    if (remaining >= 0 && (streamoff)(n * sizeof(double)) > remaining) {
+      return false;
+    }
+    if (remaining >= 0) {
+      v->resize((size_t)n);
+      if (n > 0 && !in.read((char*)v->data(), n * sizeof(double))) {
+        return false;
+      }
+      continue;
+    }
+    v->clear();
+    for (uint64_t done = 0; done < n; ) {
+      const size_t count = (size_t)min<uint64_t>(block, n - done);
+      v->resize((size_t)done + count);
+      if (!in.read((char*)(v->data() + done), count * sizeof(double))) {
+        return false;
+      }
+      done += count;
+    }
+  }
+  state.time = (time_t)t;
+  return true;
+}
@@ -0,0 +1,49 @@
+#ifndef NetworkState_h
+#define NetworkState_h
+
+#include <stdio.h>
+#include <iostream>
+#include <memory>
+#include <time.h>
+#include <vector>
+
+// simulated state of a whole network at one time step. each quantity is a contiguous array
+// indexed in the model's element order, so a snapshot is cheap to copy, compare, hand to another
+// thread or write to disk. values are in each element's state series units.
+
+namespace RTX {
+  class NetworkState {
+  public:
+    typedef std::shared_ptr<NetworkState> _sp;
+    NetworkState();
+    NetworkState(size_t nJunctions, size_t nReservoirs, size_t nTanks, size_t nLinks);
+
+    time_t time;
+
+    // indexed like Model::junctions(), reservoirs() and tanks()
+    std::vector<double> junctionHead, junctionPressure, junctionDemand, junctionQuality;
+    std::vector<double> reservoirHead, reservoirQuality;
+    std::vector<double> tankHead, tankLevel, tankVolume, tankFlow, tankQuality, tankInletQuality;
+    // indexed like Model::links()
+    std::vector<double> linkFlow, linkSetting, linkStatus, linkEnergy, linkQuality;
+
+    void resize(size_t nJunctions, size_t nReservoirs, size_t nTanks, size_t nLinks); // new values are NAN
+    size_t junctionCount() const {return junctionHead.size();};
+    size_t reservoirCount() const {return reservoirHead.size();};
+    size_t tankCount() const {return tankHead.size();};
+    size_t linkCount() const {return linkFlow.size();};
+    bool sameShapeAs(const NetworkState& other) const;
+
+    NetworkState difference(const NetworkState& other) const; // this minus other, element by element
+    double maxAbsDifference(const NetworkState& other) const; // NAN values are skipped; NAN if the shapes differ
+
+    void serialize(std::ostream& out) const;
+    static bool deserialize(std::istream& in, NetworkState& state); // false on a bad header or a short read
+
+  private:
+    std::vector<std::vector<double>*> arrays();
+    std::vector<const std::vector<double>*> arrays() const;
+  };
+}
+
+#endif /* NetworkState_h */
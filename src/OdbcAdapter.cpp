@@ -1,5 +1,7 @@
 #include "OdbcAdapter.h"
 
+#include <boost/algorithm/string/trim.hpp>
+
 using namespace std;
 using namespace RTX;
 
@@ -9,6 +11,8 @@ using boost::local_time::time_zone_ptr;
 const time_t _rtx_odbc_connect_timeout(5);
 
 #define RTX_ODBC_MAX_RETRY 5
+#define RTX_ODBC_DEFAULT_MAX_CONNECTIONS 4
+#define RTX_ODBC_TAGS_PER_STATEMENT 100 // well under the parameter limits of common drivers
 
 string __extract_error(string function, SQLHANDLE handle, SQLSMALLINT type);
 string __extract_error(string function, SQLHANDLE handle, SQLSMALLINT type) {
@@ -58,34 +62,25 @@ OdbcAdapter::OdbcAdapter( errCallback_t cb ) : DbAdapter(cb) {
   std::string nyc("EST-5EDT,M4.1.0,M10.5.0");
   _specifiedTimeZoneString = nyc;
   _specifiedTimeZone.reset(new posix_time_zone(nyc));
+  _zoneOffsets = PointRecordTime::zoneOffsets(_specifiedTimeZone);
   
   _timeFormat = PointRecordTime::UTC;
-  _handles.SCADAenv = NULL;
-  _handles.SCADAdbc = NULL;
+  _env = NULL;
+  _poolOpen = 0;
+  _poolGeneration = 0;
+  _maxConnections = RTX_ODBC_DEFAULT_MAX_CONNECTIONS;
   
   // sample queries as default
   _querySyntax.rangeSelect = "SELECT date_col, value_col, quality_col FROM data_tbl WHERE tagname_col = ? AND date_col >= ? AND date_col <= ? ORDER BY date_col ASC";
   _querySyntax.metaSelect = "SELECT tagname_col FROM tag_list_tbl ORDER BY tagname_col ASC";
-  
-  SQLRETURN sqlRet;
+  // multi-tag queries are opt-in, e.g.
+  // "SELECT tagname_col, date_col, value_col, quality_col FROM data_tbl WHERE tagname_col IN (?) AND date_col >= ? AND date_col <= ? ORDER BY date_col ASC"
+  _querySyntax.wideSelect = "";
   
   /* Allocate an environment handle */
-  __SQL_CHECK(SQLAllocHandle(SQL_HANDLE_ENV, SQL_NULL_HANDLE, &_handles.SCADAenv), "SQLAllocHandle", _handles.SCADAenv, SQL_HANDLE_ENV);
+  __SQL_CHECK(SQLAllocHandle(SQL_HANDLE_ENV, SQL_NULL_HANDLE, &_env), "SQLAllocHandle", _env, SQL_HANDLE_ENV);
   /* We want ODBC 3 support */
-  __SQL_CHECK(SQLSetEnvAttr(_handles.SCADAenv, SQL_ATTR_ODBC_VERSION, (void *) SQL_OV_ODBC3, 0), "SQLSetEnvAttr", _handles.SCADAenv, SQL_HANDLE_ENV);
-  /* Allocate a connection handle */
-  __SQL_CHECK(SQLAllocHandle(SQL_HANDLE_DBC, _handles.SCADAenv, &_handles.SCADAdbc), "SQLAllocHandle", _handles.SCADAenv, SQL_HANDLE_ENV);
-  /* Connect to the DSN, checking for connectivity */
-  //"Attempting to Connect to SCADA..."
-  
-  // readonly
-  SQLUINTEGER mode = SQL_MODE_READ_ONLY;
-  __SQL_CHECK(SQLSetConnectAttr(_handles.SCADAdbc, SQL_ATTR_ACCESS_MODE, &mode, SQL_IS_UINTEGER), "SQLSetConnectAttr", _handles.SCADAdbc, SQL_HANDLE_DBC);
-  
-  // timeouts
-  SQLUINTEGER timeout = 5;
-  sqlRet = __SQL_CHECK(SQLSetConnectAttr(_handles.SCADAdbc, SQL_ATTR_LOGIN_TIMEOUT, &timeout, 0/*ignored*/), "SQLSetConnectAttr", _handles.SCADAdbc, SQL_HANDLE_DBC);
-  sqlRet = __SQL_CHECK(SQLSetConnectAttr(_handles.SCADAdbc, SQL_ATTR_CONNECTION_TIMEOUT, &timeout, 0/*ignored*/), "SQLSetConnectAttr", _handles.SCADAdbc, SQL_HANDLE_DBC);
+  __SQL_CHECK(SQLSetEnvAttr(_env, SQL_ATTR_ODBC_VERSION, (void *) SQL_OV_ODBC3, 0), "SQLSetEnvAttr", _env, SQL_HANDLE_ENV);
   
   this->initDsnList();
 
@@ -96,12 +91,35 @@ OdbcAdapter::~OdbcAdapter() {
     _connectFuture.wait();
   }
   // make sure handles are free
-  if (_handles.SCADAdbc != NULL) {
-    SQLDisconnect(_handles.SCADAdbc);
+  this->resetPool();
+  SQLFreeHandle(SQL_HANDLE_ENV, _env);
+}
+
+OdbcAdapter::OdbcSqlHandle::~OdbcSqlHandle() {
+  this->freeRangeStatement();
+  this->freeWideStatement();
+  if (SCADAdbc != NULL) {
+    SQLDisconnect(SCADAdbc);
+    SQLFreeHandle(SQL_HANDLE_DBC, SCADAdbc);
   }
-  //  SQLFreeStmt(_handles.rangeStatement, SQL_CLOSE);
-  SQLFreeHandle(SQL_HANDLE_DBC, _handles.SCADAdbc);
-  SQLFreeHandle(SQL_HANDLE_ENV, _handles.SCADAenv);
+}
+
+void OdbcAdapter::OdbcSqlHandle::freeWideStatement() {
+  if (wideStmt != NULL) {
+    SQLFreeStmt(wideStmt, SQL_CLOSE);
+    SQLFreeHandle(SQL_HANDLE_STMT, wideStmt);
+    wideStmt = NULL;
+  }
+  preparedWide.clear();
+}
+
+void OdbcAdapter::OdbcSqlHandle::freeRangeStatement() {
+  if (rangeStmt != NULL) {
+    SQLFreeStmt(rangeStmt, SQL_CLOSE);
+    SQLFreeHandle(SQL_HANDLE_STMT, rangeStmt);
+    rangeStmt = NULL;
+  }
+  preparedRange.clear();
 }
 
 void OdbcAdapter::initDsnList() {
@@ -112,7 +130,7 @@ void OdbcAdapter::initDsnList() {
   SQLSMALLINT dsn_ret;
   SQLSMALLINT desc_ret;
   SQLUSMALLINT direction = SQL_FETCH_FIRST;
-  while(SQL_SUCCEEDED(sqlRet = SQLDataSources(_handles.SCADAenv, direction, dsnChar, sizeof(dsnChar), &dsn_ret, desc, sizeof(desc), &desc_ret))) {
+  while(SQL_SUCCEEDED(sqlRet = SQLDataSources(_env, direction, dsnChar, sizeof(dsnChar), &dsn_ret, desc, sizeof(desc), &desc_ret))) {
     direction = SQL_FETCH_NEXT;
     string thisDsn = string((char*)dsnChar);
     _dsnList.push_back(thisDsn);
@@ -130,7 +148,7 @@ const DbAdapter::adapterOptions OdbcAdapter::options() const {
   o.searchIteratively = true;
   o.supportsSinglyBoundQuery = false;
   o.implementationReadonly = true;
-  o.canDoWideQuery = false;
+  o.canDoWideQuery = !_querySyntax.wideSelect.empty();
   
   return o;
 }
@@ -167,20 +185,35 @@ void OdbcAdapter::setRangeQuery(const std::string& range) {
   _querySyntax.rangeSelect = range;
 }
 
+std::string OdbcAdapter::wideRangeQuery() {
+  return _querySyntax.wideSelect;
+}
+
+void OdbcAdapter::setWideRangeQuery(const std::string& wideRange) {
+  _querySyntax.wideSelect = wideRange;
+}
+
 
 void OdbcAdapter::doConnect() {
   _RTX_DB_SCOPED_LOCK;
-  
-  if (_connected) {
-    SQLDisconnect(_handles.SCADAdbc);
-    SQLFreeHandle(SQL_HANDLE_DBC, _handles.SCADAdbc);
-    /* Allocate a connection handle */
-    __SQL_CHECK(SQLAllocHandle(SQL_HANDLE_DBC, _handles.SCADAenv, &_handles.SCADAdbc), "SQLAllocHandle", _handles.SCADAenv, SQL_HANDLE_ENV);
-    SQLUINTEGER mode = SQL_MODE_READ_ONLY;
-    __SQL_CHECK(SQLSetConnectAttr(_handles.SCADAdbc, SQL_ATTR_ACCESS_MODE, &mode, SQL_IS_UINTEGER), "SQLSetConnectAttr", _handles.SCADAdbc, SQL_HANDLE_DBC);
+  this->connectPool();
+}
+
+void OdbcAdapter::reconnect(int generation) {
+  _RTX_DB_SCOPED_LOCK;
+  {
+    lock_guard<mutex> lock(_poolMtx);
+    if (_connected && generation != _poolGeneration) {
+      return; // another caller has already rebuilt the pool
+    }
   }
+  this->connectPool();
+}
+
+void OdbcAdapter::connectPool() {
+  // start the pool over. connections leased right now are dropped when they are returned.
+  this->resetPool();
   
-  _connected = false;
   if (RTX_STRINGS_ARE_EQUAL(_connection.driver, "") ||
       RTX_STRINGS_ARE_EQUAL(_connection.connectionString, "") ) {
     _errCallback("Incomplete Connection Information");
@@ -198,24 +231,17 @@ void OdbcAdapter::doConnect() {
     return;
   }
   else {
+    OdbcSqlHandle_sp handle = this->newConnection();
+    if (!handle) {
+      return;
+    }
     // first connection attempt. wait for "timeout" seconds
     // async connection timeout
-    _connectFuture = std::async(launch::async, [&]() -> bool {
-      string connStr = "DRIVER={" + _connection.driver + "};" + _connection.connectionString;
-      SQLCHAR outConStr[1024];
-      SQLSMALLINT outConStrLen;
-      
+    _connectFuture = std::async(launch::async, [this, handle]() -> bool {
       _isConnecting = true;
-      bool connection_ok = false;
-      try {
-        SQLRETURN connectRet = SQLDriverConnect(_handles.SCADAdbc, NULL, (SQLCHAR*)connStr.c_str(), strlen(connStr.c_str()), outConStr, 1024, &outConStrLen, SQL_DRIVER_COMPLETE);
-        __SQL_CHECK(connectRet, "SQLDriverConnect", _handles.SCADAdbc, SQL_HANDLE_DBC);
-        connection_ok = true;
+      bool connection_ok = this->connectHandle(handle);
+      if (connection_ok) {
         _errCallback("Connected");
-      } catch (string err) {
-        connection_ok = false;
-        cerr << err << endl;
-        _errCallback(err);
       }
       _isConnecting = false;
       return connection_ok;
@@ -226,11 +252,18 @@ void OdbcAdapter::doConnect() {
     future_status stat = _connectFuture.wait_for(timeout);
     if (stat == future_status::timeout) {
       // timed out. bad connection.
-      _connected = false;
       _errCallback("Timeout");
     }
-    else if (stat == future_status::ready) {
-      _connected = _connectFuture.get();
+    else if (stat == future_status::ready && _connectFuture.get()) {
+      // the validated connection seeds the pool; more are opened on demand
+      {
+        lock_guard<mutex> lock(_poolMtx);
+        handle->generation = _poolGeneration;
+        ++_poolOpen;
+        _idle.push_back(handle);
+        _connected = true;
+      }
+      _poolCv.notify_all();
     }
   }
   
@@ -239,7 +272,6 @@ void OdbcAdapter::doConnect() {
 
 
 IdentifierUnitsList OdbcAdapter::idUnitsList() {
-  _RTX_DB_SCOPED_LOCK;
   SQLHSTMT getIdsStmt = 0;
   IdentifierUnitsList ids;
   
@@ -252,7 +284,13 @@ IdentifierUnitsList OdbcAdapter::idUnitsList() {
   SQLLEN tagLengthInd;
   SQLRETURN retcode;
   
-  retcode = SQLAllocHandle(SQL_HANDLE_STMT, _handles.SCADAdbc, &getIdsStmt);
+  OdbcSqlHandle_sp handle = this->leaseConnection();
+  if (!handle) {
+    _errCallback("Could not read Tag table");
+    return ids;
+  }
+  
+  retcode = SQLAllocHandle(SQL_HANDLE_STMT, handle->SCADAdbc, &getIdsStmt);
   retcode = SQLExecDirect(getIdsStmt, (SQLCHAR*)metaQ.c_str(), SQL_NTS);
   
   if (!SQL_SUCCEEDED(retcode)) {
@@ -268,6 +306,7 @@ IdentifierUnitsList OdbcAdapter::idUnitsList() {
   
   SQLFreeStmt(getIdsStmt, SQL_CLOSE);
   SQLFreeHandle(SQL_HANDLE_STMT, getIdsStmt);
+  this->returnConnection(handle, this->isAlive(handle));
   
   return ids;
 }
@@ -286,46 +325,197 @@ void OdbcAdapter::endTransaction() {
 
 // READ
 std::vector<Point> OdbcAdapter::selectRange(const std::string& id, TimeRange range) {
-  // construct the static query text
-  string q = this->stringQueryForRange(id, range);
+  const auto dates = this->dateStringsForRange(range);
   vector<Point> points;
-  SQLHSTMT rangeStmt = 0;
   
   bool fetchSuccess = false;
   int iFetchAttempt = 0;
+  OdbcSqlHandle_sp handle;
   do {
-    // execute the query and get a result set
-    {
-      _RTX_DB_SCOPED_LOCK;
-      if (!SQL_SUCCEEDED(SQLAllocHandle(SQL_HANDLE_STMT, _handles.SCADAdbc, &rangeStmt))) {
-        // FIXME - do something like return a range of bad points?
-        cerr << "could not allocate sql handle" << endl;
-        _errCallback(__extract_error("SQLAllocHandle", _handles.SCADAdbc, SQL_HANDLE_STMT));
-        return points;
+    // execute the prepared query on a pooled connection and get a result set
+    if (!handle) {
+      const int generation = this->poolGeneration();
+      handle = this->leaseConnection();
+      if (!handle) {
+        // nothing to lease: not connected, or the server refused another connection
+        this->reconnect(generation);
+        ++iFetchAttempt;
+        continue;
+      }
+    }
+    if (this->prepareRangeStatement(*handle)) {
+      SQLHSTMT rangeStmt = handle->rangeStmt;
+      // binding is local to the driver; only SQLExecute goes over the wire
+      const string* params[3] = {&id, &dates.first, &dates.second};
+      SQLLEN paramInd[3] = {SQL_NTS, SQL_NTS, SQL_NTS};
+      SQLSMALLINT nParams = 0;
+      SQLNumParams(rangeStmt, &nParams);
+      for (SQLUSMALLINT i = 0; i < 3 && i < nParams; ++i) {
+        SQLULEN len = max<SQLULEN>(params[i]->size(), 1);
+        SQLBindParameter(rangeStmt, i + 1, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_VARCHAR, len, 0, (SQLPOINTER)params[i]->c_str(), 0, &paramInd[i]);
       }
-      if (SQL_SUCCEEDED(SQLExecDirect(rangeStmt, (SQLCHAR*)q.c_str(), SQL_NTS))) {
+      if (SQL_SUCCEEDED(SQLExecute(rangeStmt))) {
         fetchSuccess = true;
-        points = this->pointsFromStatement(rangeStmt);
+        points = this->pointsFromStatement(rangeStmt, handle->block);
       }
-      if(!fetchSuccess) {
-        cerr << __extract_error("SQLExecDirect", rangeStmt, SQL_HANDLE_STMT) << endl;
-        cerr << "query did not succeed: " << q << endl;
+      else {
+        cerr << __extract_error("SQLExecute", rangeStmt, SQL_HANDLE_STMT) << endl;
+        cerr << "query did not succeed: " << handle->preparedRange << " [" << id << ", " << dates.first << ", " << dates.second << "]" << endl;
       }
-      SQLFreeStmt(rangeStmt, SQL_CLOSE);
-      SQLFreeHandle(SQL_HANDLE_STMT, rangeStmt);
+      SQLFreeStmt(rangeStmt, SQL_CLOSE); // close the cursor but keep the statement prepared
+      SQLFreeStmt(rangeStmt, SQL_RESET_PARAMS);
     }
-    
-    if(!fetchSuccess) {
-      // do something more intelligent here. re-check connection?
-      this->doConnect();
+    // a failed query is retried on the same connection, unless the driver reports it dead
+    if (!fetchSuccess && !this->isAlive(handle)) {
+      this->returnConnection(handle, false);
+      handle.reset();
     }
     ++iFetchAttempt;
   } while (!fetchSuccess && iFetchAttempt < RTX_ODBC_MAX_RETRY);
   
+  if (handle) {
+    this->returnConnection(handle, true);
+  }
   return points;
 
 }
 
+std::map<std::string, std::vector<Point> > OdbcAdapter::selectRanges(const std::vector<std::string>& ids, TimeRange range) {
+  // independent queries, spread over the connection pool. with a multi-tag template each
+  // task covers a batch of tags in one statement; otherwise each task is a single range query.
+  map<string, vector<Point> > results;
+  mutex resultsMtx;
+  atomic<size_t> nextTask(0);
+  
+  const bool wide = !this->wideRangeQuery().empty();
+  const size_t perTask = wide ? RTX_ODBC_TAGS_PER_STATEMENT : 1;
+  const size_t nTasks = (ids.size() + perTask - 1) / perTask;
+  
+  auto worker = [&]() {
+    size_t k;
+    while ((k = nextTask++) < nTasks) {
+      map<string, vector<Point> > part;
+      if (wide) {
+        vector<string> batch(ids.begin() + k * perTask, ids.begin() + min(ids.size(), (k + 1) * perTask));
+        part = this->selectWide(batch, range);
+      }
+      else {
+        part[ids[k]] = this->selectRange(ids[k], range);
+      }
+      lock_guard<mutex> lock(resultsMtx);
+      for (auto& series : part) {
+        results[series.first] = std::move(series.second);
+      }
+    }
+  };
+  
+  const size_t nWorkers = min(nTasks, (size_t)max(this->maxConnections(), 1));
+  vector<future<void> > workers;
+  for (size_t k = 0; k < nWorkers; ++k) {
+    workers.push_back(std::async(launch::async, worker));
+  }
+  for (auto& w : workers) {
+    w.get();
+  }
+  return results;
+}
+
+std::map<std::string, std::vector<Point> > OdbcAdapter::wideQuery(TimeRange range) {
+  if (this->wideRangeQuery().empty()) {
+    return map<string, vector<Point> >();
+  }
+  vector<string> ids;
+  for (const auto& tag : *(this->idUnitsList().get())) {
+    ids.push_back(tag.first);
+  }
+  return this->selectRanges(ids, range);
+}
+
+std::map<std::string, std::vector<Point> > OdbcAdapter::selectWide(const std::vector<std::string>& ids, TimeRange range) {
+  const auto dates = this->dateStringsForRange(range);
+  map<string, vector<Point> > results;
+  
+  bool fetchSuccess = false;
+  int iFetchAttempt = 0;
+  OdbcSqlHandle_sp handle;
+  do {
+    if (!handle) {
+      const int generation = this->poolGeneration();
+      handle = this->leaseConnection();
+      if (!handle) {
+        this->reconnect(generation);
+        ++iFetchAttempt;
+        continue;
+      }
+    }
+    if (this->prepareWideStatement(*handle, ids.size())) {
+      SQLHSTMT wideStmt = handle->wideStmt;
+      // parameters: one per tag, then start and end
+      vector<SQLLEN> paramInd(ids.size() + 2, SQL_NTS);
+      SQLUSMALLINT iParam = 0;
+      auto bind = [&](const string& value) {
+        SQLULEN len = max<SQLULEN>(value.size(), 1);
+        SQLBindParameter(wideStmt, iParam + 1, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_VARCHAR, len, 0, (SQLPOINTER)value.c_str(), 0, &paramInd[iParam]);
+        ++iParam;
+      };
+      for (const string& id : ids) {
+        bind(id);
+      }
+      bind(dates.first);
+      bind(dates.second);
+      
+      if (SQL_SUCCEEDED(SQLExecute(wideStmt))) {
+        fetchSuccess = true;
+        results.clear();
+        for (const string& id : ids) {
+          results[id] = vector<Point>();
+        }
+        // demultiplex on the tag column. fixed-width tag columns come back space-padded.
+        ScadaRecordBlock& block = handle->block;
+        ScadaTagBlock& tags = *handle->tagBlock;
+        const auto zone = this->zoneOffsets();
+        SQLRETURN ret;
+        while (SQL_SUCCEEDED(ret = SQLFetch(wideStmt))) {
+          for (SQLULEN i = 0; i < block.rowsFetched; ++i) {
+            Point p;
+            if (tags.tagInd[i] == SQL_NULL_DATA || !this->pointFromRow(block, i, *zone, p)) {
+              continue;
+            }
+            string tag((char*)tags.tag[i]);
+            boost::trim_right(tag);
+            auto series = results.find(tag);
+            if (series != results.end()) {
+              series->second.push_back(p);
+            }
+          }
+        }
+        if (ret != SQL_NO_DATA) {
+          cerr << __extract_error("SQLFetch", wideStmt, SQL_HANDLE_STMT) << endl;
+        }
+        for (auto& series : results) {
+          std::sort(series.second.begin(), series.second.end(), &Point::comparePointTime);
+        }
+      }
+      else {
+        cerr << __extract_error("SQLExecute", wideStmt, SQL_HANDLE_STMT) << endl;
+        cerr << "query did not succeed: " << _querySyntax.wideSelect << " [" << ids.size() << " tags, " << dates.first << ", " << dates.second << "]" << endl;
+      }
+      SQLFreeStmt(wideStmt, SQL_CLOSE);
+      SQLFreeStmt(wideStmt, SQL_RESET_PARAMS);
+    }
+    if (!fetchSuccess && !this->isAlive(handle)) {
+      this->returnConnection(handle, false);
+      handle.reset();
+    }
+    ++iFetchAttempt;
+  } while (!fetchSuccess && iFetchAttempt < RTX_ODBC_MAX_RETRY);
+  
+  if (handle) {
+    this->returnConnection(handle, true);
+  }
+  return results;
+}
+
 Point OdbcAdapter::selectNext(const std::string& id, time_t time, WhereClause q) {
   return Point(); // unsupported
 }
@@ -395,6 +585,7 @@ PointRecordTime::time_format_t OdbcAdapter::timeFormat() {
 }
 
 std::string OdbcAdapter::timeZoneString() {
+  lock_guard<mutex> lock(_poolMtx);
   return _specifiedTimeZoneString;
 }
 
@@ -402,8 +593,12 @@ void OdbcAdapter::setTimeZoneString(const std::string& tzStr) {
   try {
     time_zone_ptr newTimeZone(new posix_time_zone(tzStr));
     if (newTimeZone) {
+      // pool workers convert rows with the zone, so it changes under the pool lock
+      auto offsets = PointRecordTime::zoneOffsets(newTimeZone);
+      lock_guard<mutex> lock(_poolMtx);
       _specifiedTimeZoneString = tzStr;
       _specifiedTimeZone = newTimeZone;
+      _zoneOffsets = offsets;
     }
   } catch (...) {
     _errCallback("Invalid TZ");
@@ -413,9 +608,137 @@ void OdbcAdapter::setTimeZoneString(const std::string& tzStr) {
 
 
 
-std::string OdbcAdapter::stringQueryForRange(const std::string& id, TimeRange range) {
-  
-  string query = _querySyntax.rangeSelect;
+#pragma mark - connection pool
+
+OdbcAdapter::OdbcSqlHandle_sp OdbcAdapter::newConnection() {
+  OdbcSqlHandle_sp handle(new OdbcSqlHandle);
+  try {
+    /* Allocate a connection handle */
+    __SQL_CHECK(SQLAllocHandle(SQL_HANDLE_DBC, _env, &handle->SCADAdbc), "SQLAllocHandle", _env, SQL_HANDLE_ENV);
+    
+    // readonly
+    SQLUINTEGER mode = SQL_MODE_READ_ONLY;
+    __SQL_CHECK(SQLSetConnectAttr(handle->SCADAdbc, SQL_ATTR_ACCESS_MODE, &mode, SQL_IS_UINTEGER), "SQLSetConnectAttr", handle->SCADAdbc, SQL_HANDLE_DBC);
+    
+    // timeouts
+    SQLUINTEGER timeout = 5;
+    __SQL_CHECK(SQLSetConnectAttr(handle->SCADAdbc, SQL_ATTR_LOGIN_TIMEOUT, &timeout, 0/*ignored*/), "SQLSetConnectAttr", handle->SCADAdbc, SQL_HANDLE_DBC);
+    __SQL_CHECK(SQLSetConnectAttr(handle->SCADAdbc, SQL_ATTR_CONNECTION_TIMEOUT, &timeout, 0/*ignored*/), "SQLSetConnectAttr", handle->SCADAdbc, SQL_HANDLE_DBC);
+  } catch (string err) {
+    cerr << err << endl;
+    _errCallback(err);
+    return OdbcSqlHandle_sp();
+  }
+  return handle;
+}
+
+bool OdbcAdapter::connectHandle(OdbcSqlHandle_sp handle) {
+  string connStr = "DRIVER={" + _connection.driver + "};" + _connection.connectionString;
+  SQLCHAR outConStr[1024];
+  SQLSMALLINT outConStrLen;
+  try {
+    SQLRETURN connectRet = SQLDriverConnect(handle->SCADAdbc, NULL, (SQLCHAR*)connStr.c_str(), strlen(connStr.c_str()), outConStr, 1024, &outConStrLen, SQL_DRIVER_COMPLETE);
+    __SQL_CHECK(connectRet, "SQLDriverConnect", handle->SCADAdbc, SQL_HANDLE_DBC);
+  } catch (string err) {
+    cerr << err << endl;
+    _errCallback(err);
+    return false;
+  }
+  return true;
+}
+
+bool OdbcAdapter::isAlive(OdbcSqlHandle_sp handle) {
+  // answered by the driver from its own state, without a round trip
+  SQLINTEGER dead = SQL_CD_FALSE;
+  if (SQL_SUCCEEDED(SQLGetConnectAttr(handle->SCADAdbc, SQL_ATTR_CONNECTION_DEAD, &dead, 0, NULL))) {
+    return dead != SQL_CD_TRUE;
+  }
+  return true; // not supported by the driver; failures will show up on execute instead
+}
+
+OdbcAdapter::OdbcSqlHandle_sp OdbcAdapter::leaseConnection() {
+  unique_lock<mutex> lock(_poolMtx);
+  while (_connected) {
+    if (!_idle.empty()) {
+      OdbcSqlHandle_sp handle = _idle.back();
+      _idle.pop_back();
+      if (this->isAlive(handle)) {
+        return handle;
+      }
+      --_poolOpen; // dropped; its destructor disconnects
+      continue;
+    }
+    if (_poolOpen < max(_maxConnections, 1)) {
+      // grow the pool. connect outside the lock so that other callers can still lease and return.
+      ++_poolOpen;
+      const int generation = _poolGeneration;
+      lock.unlock();
+      OdbcSqlHandle_sp handle = this->newConnection();
+      bool ok = handle && this->connectHandle(handle);
+      lock.lock();
+      if (ok && generation == _poolGeneration) {
+        handle->generation = generation;
+        return handle;
+      }
+      if (generation == _poolGeneration) {
+        --_poolOpen;
+      }
+      _poolCv.notify_one();
+      return OdbcSqlHandle_sp();
+    }
+    _poolCv.wait(lock);
+  }
+  return OdbcSqlHandle_sp();
+}
+
+void OdbcAdapter::returnConnection(OdbcSqlHandle_sp handle, bool healthy) {
+  {
+    lock_guard<mutex> lock(_poolMtx);
+    if (handle->generation == _poolGeneration) {
+      if (healthy) {
+        _idle.push_back(handle);
+      }
+      else {
+        --_poolOpen;
+      }
+    }
+  }
+  _poolCv.notify_one();
+}
+
+void OdbcAdapter::resetPool() {
+  vector<OdbcSqlHandle_sp> idle;
+  {
+    lock_guard<mutex> lock(_poolMtx);
+    ++_poolGeneration; // connections still leased are dropped when they come back
+    _poolOpen = 0;
+    _connected = false;
+    idle.swap(_idle);
+  }
+  _poolCv.notify_all();
+}
+
+int OdbcAdapter::poolGeneration() {
+  lock_guard<mutex> lock(_poolMtx);
+  return _poolGeneration;
+}
+
+int OdbcAdapter::maxConnections() {
+  return _maxConnections;
+}
+
+void OdbcAdapter::setMaxConnections(int n) {
+  {
+    lock_guard<mutex> lock(_poolMtx);
+    _maxConnections = max(n, 1);
+  }
+  _poolCv.notify_all();
+}
+
+
+#pragma mark - queries
+
+std::pair<std::string, std::string> OdbcAdapter::dateStringsForRange(TimeRange range) {
   string startStr,endStr;
   
   if (this->timeFormat() == PointRecordTime::UTC) {
@@ -423,65 +746,140 @@ std::string OdbcAdapter::stringQueryForRange(const std::string& id, TimeRange ra
     endStr = PointRecordTime::utcDateStringFromUnix(range.end+1); // because wonderware does fractional seconds
   }
   else {
-    startStr = PointRecordTime::localDateStringFromUnix(range.start-1, _specifiedTimeZone);
-    endStr = PointRecordTime::localDateStringFromUnix(range.end+1, _specifiedTimeZone);
+    time_zone_ptr tz;
+    {
+      lock_guard<mutex> lock(_poolMtx);
+      tz = _specifiedTimeZone;
+    }
+    startStr = PointRecordTime::localDateStringFromUnix(range.start-1, tz);
+    endStr = PointRecordTime::localDateStringFromUnix(range.end+1, tz);
   }
   
-  boost::replace_first(query, "?", id);
-  boost::replace_first(query, "?", startStr);
-  boost::replace_first(query, "?", endStr);
-  
-  return query;
+  return make_pair(startStr, endStr);
 }
 
 
-std::vector<Point> OdbcAdapter::pointsFromStatement(SQLHSTMT statement) {
-  vector<ScadaRecord> records;
-  vector<Point> points;
+bool OdbcAdapter::prepareRangeStatement(OdbcSqlHandle& handle) {
+  // the template's placeholders are (tag, start, end). quoting was needed when values were
+  // spliced into the text; bound parameters are quoted by the driver.
+  string query = _querySyntax.rangeSelect;
+  boost::replace_all(query, "'?'", "?");
   
-  // make sure output columns are bound. we're not sure where this statement is coming from.
-  this->bindOutputColumns(statement, &_tempRecord);
+  if (handle.rangeStmt != NULL && RTX_STRINGS_ARE_EQUAL(query, handle.preparedRange)) {
+    return true;
+  }
+  handle.freeRangeStatement();
   
+  if (!SQL_SUCCEEDED(SQLAllocHandle(SQL_HANDLE_STMT, handle.SCADAdbc, &handle.rangeStmt))) {
+    cerr << "could not allocate sql handle" << endl;
+    _errCallback(__extract_error("SQLAllocHandle", handle.SCADAdbc, SQL_HANDLE_DBC));
+    handle.rangeStmt = NULL;
+    return false;
+  }
   try {
-    if (statement == NULL) {
-      throw string("Connection not initialized.");
-    }
-    while (SQL_SUCCEEDED(SQLFetch(statement))) {
-      records.push_back(_tempRecord);
-    }
+    __SQL_CHECK(SQLPrepare(handle.rangeStmt, (SQLCHAR*)query.c_str(), SQL_NTS), "SQLPrepare", handle.rangeStmt, SQL_HANDLE_STMT);
+    this->bindOutputColumns(handle.rangeStmt, handle.block);
+  } catch (string err) {
+    cerr << err << endl;
+    cerr << "could not prepare query: " << query << endl;
+    handle.freeRangeStatement();
+    return false;
   }
-  catch(string errorMessage) {
-    cerr << errorMessage << endl;
-    cerr << "Could not get data from db connection\n";
-    cerr << "Attempting to reconnect..." << endl;
-    this->doConnect();
-    cerr << "Connection returned " << this->adapterConnected() << endl;
+  handle.preparedRange = query;
+  return true;
+}
+
+
+bool OdbcAdapter::prepareWideStatement(OdbcSqlHandle& handle, size_t nTags) {
+  // placeholders are (tag list, start, end). the first one is expanded to a marker per tag,
+  // so "tag IN (?)" becomes "tag IN (?,?,?)".
+  string query = _querySyntax.wideSelect;
+  boost::replace_all(query, "'?'", "?");
+  size_t listPos = query.find('?');
+  if (listPos == string::npos || nTags == 0) {
+    return false;
   }
+  string markers("?");
+  for (size_t i = 1; i < nTags; ++i) {
+    markers += ",?";
+  }
+  query.replace(listPos, 1, markers);
   
-  __SQL_CHECK(SQLFreeStmt(statement, SQL_UNBIND), "SQL_UNBIND", statement, SQL_HANDLE_STMT);
+  if (handle.wideStmt != NULL && RTX_STRINGS_ARE_EQUAL(query, handle.preparedWide)) {
+    return true;
+  }
+  handle.freeWideStatement();
+  if (!handle.tagBlock) {
+    handle.tagBlock.reset(new ScadaTagBlock);
+  }
   
-  for(const ScadaRecord& record : records) {
-    Point p;
-    time_t t;
-    if (_timeFormat == PointRecordTime::UTC) {
-      t = PointRecordTime::time(record.time);
-    }
-    else {
-      t = PointRecordTime::timeFromZone(record.time, _specifiedTimeZone);
-    }
-    double v = record.value;
-    Point::PointQuality q = Point::opc_good;
-    q = (Point::PointQuality)record.quality;
-    
-    if (record.valueInd > 0) {
-      // ok
-      p = Point(t, v, q, 0.);
-      points.push_back(p);
-    }
-    else {
-      // nothing
+  if (!SQL_SUCCEEDED(SQLAllocHandle(SQL_HANDLE_STMT, handle.SCADAdbc, &handle.wideStmt))) {
+    cerr << "could not allocate sql handle" << endl;
+    _errCallback(__extract_error("SQLAllocHandle", handle.SCADAdbc, SQL_HANDLE_DBC));
+    handle.wideStmt = NULL;
+    return false;
+  }
+  try {
+    __SQL_CHECK(SQLPrepare(handle.wideStmt, (SQLCHAR*)query.c_str(), SQL_NTS), "SQLPrepare", handle.wideStmt, SQL_HANDLE_STMT);
+    __SQL_CHECK(SQLBindCol(handle.wideStmt, 1, SQL_C_CHAR, handle.tagBlock->tag, RTX_ODBC_TAG_LENGTH, handle.tagBlock->tagInd), "SQLBindCol", handle.wideStmt, SQL_HANDLE_STMT);
+    this->bindOutputColumns(handle.wideStmt, handle.block, 2);
+  } catch (string err) {
+    cerr << err << endl;
+    cerr << "could not prepare query: " << _querySyntax.wideSelect << endl;
+    handle.freeWideStatement();
+    return false;
+  }
+  handle.preparedWide = query;
+  return true;
+}
+
+
+std::shared_ptr<const PointRecordTime::ZoneOffsets> OdbcAdapter::zoneOffsets() {
+  lock_guard<mutex> lock(_poolMtx);
+  return _zoneOffsets;
+}
+
+bool OdbcAdapter::pointFromRow(const ScadaRecordBlock& block, SQLULEN i, const PointRecordTime::ZoneOffsets& zone, Point& point) {
+  if (block.rowStatus[i] != SQL_ROW_SUCCESS && block.rowStatus[i] != SQL_ROW_SUCCESS_WITH_INFO) {
+    return false;
+  }
+  if (block.timeInd[i] == SQL_NULL_DATA || block.valueInd[i] == SQL_NULL_DATA) {
+    return false;
+  }
+  time_t t;
+  if (_timeFormat == PointRecordTime::UTC) {
+    t = PointRecordTime::time(block.time[i]);
+  }
+  else {
+    t = PointRecordTime::timeFromZone(block.time[i], zone);
+  }
+  Point::PointQuality q = Point::opc_good;
+  if (block.qualityInd[i] != SQL_NULL_DATA) {
+    q = (Point::PointQuality)block.quality[i];
+  }
+  point = Point(t, block.value[i], q, 0.);
+  return true;
+}
+
+
+std::vector<Point> OdbcAdapter::pointsFromStatement(SQLHSTMT statement, ScadaRecordBlock& block) {
+  vector<Point> points;
+  const auto zone = this->zoneOffsets(); // one snapshot for the statement
+  
+  // each fetch fills a whole rowset into the bound column arrays
+  SQLRETURN ret;
+  while (SQL_SUCCEEDED(ret = SQLFetch(statement))) {
+    for (SQLULEN i = 0; i < block.rowsFetched; ++i) {
+      Point p;
+      if (this->pointFromRow(block, i, *zone, p)) {
+        points.push_back(p);
+      }
     }
   }
+  if (ret != SQL_NO_DATA) {
+    cerr << __extract_error("SQLFetch", statement, SQL_HANDLE_STMT) << endl;
+    cerr << "Could not get data from db connection" << endl;
+  }
   
   // make sure the points are sorted
   std::sort(points.begin(), points.end(), &Point::comparePointTime);
@@ -489,12 +887,15 @@ std::vector<Point> OdbcAdapter::pointsFromStatement(SQLHSTMT statement) {
 }
 
 
-void OdbcAdapter::bindOutputColumns(SQLHSTMT statement, ScadaRecord* record) {
-  __SQL_CHECK(SQLBindCol(statement, 1, SQL_TYPE_TIMESTAMP, &(record->time), NULL, &(record->timeInd) ), "SQLBindCol", statement, SQL_HANDLE_STMT);
-  __SQL_CHECK(SQLBindCol(statement, 2, SQL_DOUBLE, &(record->value), 0, &(record->valueInd) ), "SQLBindCol", statement, SQL_HANDLE_STMT);
-  __SQL_CHECK(SQLBindCol(statement, 3, SQL_INTEGER, &(record->quality), 0, &(record->qualityInd) ), "SQLBindCol", statement, SQL_HANDLE_STMT);
+void OdbcAdapter::bindOutputColumns(SQLHSTMT statement, ScadaRecordBlock& block, SQLUSMALLINT firstColumn) {
+  // column-wise array binding. a driver without rowset support substitutes a smaller array size
+  // (returning SQL_SUCCESS_WITH_INFO), and rowsFetched reports what it actually delivered.
+  __SQL_CHECK(SQLSetStmtAttr(statement, SQL_ATTR_ROW_BIND_TYPE, (SQLPOINTER)SQL_BIND_BY_COLUMN, 0), "SQLSetStmtAttr", statement, SQL_HANDLE_STMT);
+  __SQL_CHECK(SQLSetStmtAttr(statement, SQL_ATTR_ROW_ARRAY_SIZE, (SQLPOINTER)(SQLULEN)RTX_ODBC_FETCH_ROWS, 0), "SQLSetStmtAttr", statement, SQL_HANDLE_STMT);
+  __SQL_CHECK(SQLSetStmtAttr(statement, SQL_ATTR_ROW_STATUS_PTR, block.rowStatus, 0), "SQLSetStmtAttr", statement, SQL_HANDLE_STMT);
+  __SQL_CHECK(SQLSetStmtAttr(statement, SQL_ATTR_ROWS_FETCHED_PTR, &block.rowsFetched, 0), "SQLSetStmtAttr", statement, SQL_HANDLE_STMT);
+  
+  __SQL_CHECK(SQLBindCol(statement, firstColumn, SQL_C_TYPE_TIMESTAMP, block.time, sizeof(SQL_TIMESTAMP_STRUCT), block.timeInd), "SQLBindCol", statement, SQL_HANDLE_STMT);
+  __SQL_CHECK(SQLBindCol(statement, firstColumn + 1, SQL_C_DOUBLE, block.value, sizeof(double), block.valueInd), "SQLBindCol", statement, SQL_HANDLE_STMT);
+  __SQL_CHECK(SQLBindCol(statement, firstColumn + 2, SQL_C_LONG, block.quality, sizeof(SQLINTEGER), block.qualityInd), "SQLBindCol", statement, SQL_HANDLE_STMT);
 }
-
-
-
-
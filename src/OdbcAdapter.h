@@ -7,6 +7,9 @@
 #include <string>
 #include <future>
 #include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
 
 #include "DbAdapter.h"
 #include "PointRecordTime.h"
@@ -14,6 +17,9 @@
 #include <sql.h>
 #include <sqlext.h>
 
+#define RTX_ODBC_FETCH_ROWS 1024
+#define RTX_ODBC_TAG_LENGTH 256
+
 namespace RTX {
   class OdbcAdapter : public DbAdapter {
   public:
@@ -34,8 +40,12 @@ namespace RTX {
     void endTransaction();
     bool inTransaction() {return _inTransaction;};
     
+    // PREFETCH
+    std::map<std::string, std::vector<Point> > wideQuery(TimeRange range);
+    
     // READ
     std::vector<Point> selectRange(const std::string& id, TimeRange range);
+    std::map<std::string, std::vector<Point> > selectRanges(const std::vector<std::string>& ids, TimeRange range);
     Point selectNext(const std::string& id, time_t time, WhereClause q = WhereClause());
     Point selectPrevious(const std::string& id, time_t time, WhereClause q = WhereClause());
     
@@ -64,12 +74,16 @@ namespace RTX {
     void setMetaQuery(const std::string& meta);
     std::string rangeQuery();
     void setRangeQuery(const std::string& range);
+    std::string wideRangeQuery();
+    void setWideRangeQuery(const std::string& wideRange); // empty disables multi-tag queries
+    int maxConnections();
+    void setMaxConnections(int n); // size of the connection pool, i.e. how many queries may run at once
     
   private:
     //** types **//
     class OdbcQuery {
     public:
-      std::string metaSelect, rangeSelect;
+      std::string metaSelect, rangeSelect, wideSelect;
     };
     
     class OdbcConnection {
@@ -78,41 +92,80 @@ namespace RTX {
       std::string connectionString;
     };
     
-    class OdbcSqlHandle {
+    class ScadaRecordBlock {
     public:
-      SQLHENV SCADAenv;
-      SQLHDBC SCADAdbc;
+      // column-wise fetch buffers, one element per row of a rowset
+      SQL_TIMESTAMP_STRUCT time[RTX_ODBC_FETCH_ROWS];
+      double value[RTX_ODBC_FETCH_ROWS];
+      SQLINTEGER quality[RTX_ODBC_FETCH_ROWS];
+      SQLLEN timeInd[RTX_ODBC_FETCH_ROWS], valueInd[RTX_ODBC_FETCH_ROWS], qualityInd[RTX_ODBC_FETCH_ROWS];
+      SQLUSMALLINT rowStatus[RTX_ODBC_FETCH_ROWS];
+      SQLULEN rowsFetched;
     };
     
-    class ScadaRecord {
+    class ScadaTagBlock {
     public:
-      //SQLCHAR tagName[MAX_SCADA_TAG];
-      SQL_TIMESTAMP_STRUCT time;
-      double value;
-      int quality;
-      SQLLEN timeInd, valueInd, qualityInd;
-      bool compareRecords(const ScadaRecord& left, const ScadaRecord& right);
+      // tag column for multi-tag queries; the remaining columns go to a ScadaRecordBlock
+      SQLCHAR tag[RTX_ODBC_FETCH_ROWS][RTX_ODBC_TAG_LENGTH];
+      SQLLEN tagInd[RTX_ODBC_FETCH_ROWS];
+    };
+    
+    // one pooled connection, with its own prepared statement and fetch buffers
+    class OdbcSqlHandle {
+    public:
+      OdbcSqlHandle() : SCADAdbc(NULL), rangeStmt(NULL), wideStmt(NULL), generation(0) {};
+      ~OdbcSqlHandle(); // disconnects and frees the handles
+      SQLHDBC SCADAdbc;
+      SQLHSTMT rangeStmt; // prepared range query, kept until the template changes
+      SQLHSTMT wideStmt; // prepared multi-tag query, kept until the template or the tag count changes
+      std::string preparedRange, preparedWide;
+      int generation;
+      ScadaRecordBlock block;
+      std::unique_ptr<ScadaTagBlock> tagBlock; // allocated on first multi-tag query
+      void freeRangeStatement();
+      void freeWideStatement();
     };
+    typedef std::shared_ptr<OdbcSqlHandle> OdbcSqlHandle_sp;
     
     
     //** ivars **//
     OdbcConnection _connection;
     OdbcQuery _querySyntax;
-    OdbcSqlHandle _handles;
-    ScadaRecord _tempRecord;
+    SQLHENV _env;
+    std::mutex _poolMtx;
+    std::condition_variable _poolCv;
+    std::vector<OdbcSqlHandle_sp> _idle;
+    int _poolOpen; // idle + leased connections of the current generation
+    int _poolGeneration; // bumped on reconnect so that stale leases are dropped when returned
+    int _maxConnections;
     std::atomic<bool> _isConnecting;
     std::future<bool> _connectFuture;
     std::vector<std::string> _dsnList;
     std::string _specifiedTimeZoneString;
     boost::local_time::time_zone_ptr _specifiedTimeZone;
+    std::shared_ptr<const PointRecordTime::ZoneOffsets> _zoneOffsets; // per-row conversion table for _specifiedTimeZone. the zone members are guarded by _poolMtx
     PointRecordTime::time_format_t _timeFormat;
     std::atomic<bool> _inTransaction;
     
     //** methods **//
     void initDsnList();
-    std::string stringQueryForRange(const std::string& id, TimeRange range);
-    std::vector<Point> pointsFromStatement(SQLHSTMT statement);
-    void bindOutputColumns(SQLHSTMT statement, ScadaRecord* record);
+    OdbcSqlHandle_sp newConnection();
+    bool connectHandle(OdbcSqlHandle_sp handle);
+    bool isAlive(OdbcSqlHandle_sp handle);
+    OdbcSqlHandle_sp leaseConnection(); // null if no connection could be had
+    void returnConnection(OdbcSqlHandle_sp handle, bool healthy);
+    void resetPool(); // also marks the adapter disconnected
+    int poolGeneration();
+    void connectPool(); // under _dbMtx
+    void reconnect(int generation); // rebuilds the pool, unless it has been rebuilt since the caller saw this generation
+    bool prepareRangeStatement(OdbcSqlHandle& handle);
+    bool prepareWideStatement(OdbcSqlHandle& handle, size_t nTags);
+    std::map<std::string, std::vector<Point> > selectWide(const std::vector<std::string>& ids, TimeRange range);
+    std::pair<std::string, std::string> dateStringsForRange(TimeRange range);
+    std::shared_ptr<const PointRecordTime::ZoneOffsets> zoneOffsets(); // under _poolMtx, with the time zone
+    bool pointFromRow(const ScadaRecordBlock& block, SQLULEN row, const PointRecordTime::ZoneOffsets& zone, Point& point);
+    std::vector<Point> pointsFromStatement(SQLHSTMT statement, ScadaRecordBlock& block);
+    void bindOutputColumns(SQLHSTMT statement, ScadaRecordBlock& block, SQLUSMALLINT firstColumn = 1);
   };
 }
 
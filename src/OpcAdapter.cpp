@@ -2,18 +2,51 @@
 
 #include <open62541.h>
 
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <regex>
+#include <sstream>
+
+#include <boost/lexical_cast.hpp>
+
 using namespace RTX;
 using namespace std;
 
+#define RTX_OPC_HISTORY_NODES_PER_REQUEST 100
+#define RTX_OPC_HISTORY_VALUES_PER_NODE 10000 // per response; the rest comes back through continuation points
+#define RTX_OPC_DEFAULT_PUBLISHING_INTERVAL 1000
+
+
+OpcAdapter::connectionInfo::connectionInfo() {
+  proto = "opc.tcp";
+  host = "localhost";
+  port = 4840;
+  validate = false;
+}
+
+string OpcAdapter::connectionInfo::endpoint() {
+  stringstream ss;
+  ss << proto << "://" << host << ":" << port;
+  return ss.str();
+}
+
 
 OpcAdapter::OpcAdapter(errCallback_t cb) : DbAdapter(cb) {
   _client = UA_Client_new(UA_ClientConfig_standard);
-  
-  
+  _connected = false;
+  _subscriptionId = 0;
+  _publishing = false;
+  publishingInterval = RTX_OPC_DEFAULT_PUBLISHING_INTERVAL;
 }
 
 
 OpcAdapter::~OpcAdapter() {
+  this->unsubscribe();
+  for (auto& node : _nodes) {
+    UA_NodeId_deleteMembers(&node.second);
+  }
   UA_Client_delete(_client);
 }
 
@@ -31,22 +64,49 @@ const DbAdapter::adapterOptions OpcAdapter::options() const {
 }
 
 string OpcAdapter::connectionString() {
-  
+  stringstream ss;
+  ss << "proto=" << _conn.proto << "&host=" << _conn.host << "&port=" << _conn.port;
+  if (!_conn.user.empty()) {
+    ss << "&u=" << _conn.user << "&p=" << _conn.pass;
+  }
+  return ss.str();
 }
 
 void OpcAdapter::setConnectionString(const std::string &con) {
+  _RTX_DB_SCOPED_LOCK;
   
+  regex kvReg("([^=]+)=([^&\\s]+)&?"); // key - value pair
+  const map<string, function<void(string)> >
+  kvSetters({
+    {"proto", [&](string v){this->_conn.proto = v;}},
+    {"host", [&](string v){this->_conn.host = v;}},
+    {"port", [&](string v){this->_conn.port = boost::lexical_cast<int>(v);}},
+    {"u", [&](string v){this->_conn.user = v;}},
+    {"p", [&](string v){this->_conn.pass = v;}},
+    {"validate", [&](string v){this->_conn.validate = boost::lexical_cast<bool>(v);}}
+  });
+  
+  for (auto it = sregex_iterator(con.begin(), con.end(), kvReg); it != sregex_iterator(); ++it) {
+    const string key = (*it)[1], value = (*it)[2];
+    if (kvSetters.count(key) > 0) {
+      kvSetters.at(key)(value);
+    }
+    else {
+      cerr << "key not recognized: " << key << " - skipping." << '\n' << flush;
+    }
+  }
 }
 
 void OpcAdapter::doConnect() {
   _RTX_DB_SCOPED_LOCK;
   
   if (!_connected) {
+    const string endpoint = _conn.endpoint();
     
     UA_EndpointDescription* endpointArray = NULL;
     size_t endpointArraySize = 0;
     
-    UA_StatusCode retval = UA_Client_getEndpoints(_client, "opc.tcp://localhost:16664", &endpointArraySize, &endpointArray);
+    UA_StatusCode retval = UA_Client_getEndpoints(_client, endpoint.c_str(), &endpointArraySize, &endpointArray);
     if(retval != UA_STATUSCODE_GOOD) {
       UA_Array_delete(endpointArray, endpointArraySize, &UA_TYPES[UA_TYPES_ENDPOINTDESCRIPTION]);
       stringstream msg;
@@ -63,7 +123,12 @@ void OpcAdapter::doConnect() {
     }
     UA_Array_delete(endpointArray,endpointArraySize, &UA_TYPES[UA_TYPES_ENDPOINTDESCRIPTION]);
     
-    UA_Client_connect_username(_client, "opc.tcp://localhost:16664", "user1", "password");
+    if (_conn.user.empty()) {
+      retval = UA_Client_connect(_client, endpoint.c_str());
+    }
+    else {
+      retval = UA_Client_connect_username(_client, endpoint.c_str(), _conn.user.c_str(), _conn.pass.c_str());
+    }
     if(retval != UA_STATUSCODE_GOOD) {
       stringstream msg;
       msg << retval;
@@ -116,9 +181,13 @@ IdentifierUnitsList OpcAdapter::idUnitsList() {
       }
       /* TODO: distinguish further types */
       
-      char nodeId[2560];
-      sprintf(nodeId, "%.*s", (int)ref->displayName.text.length, ref->displayName.text.data);
-      _nodes[string(nodeId)] = ref->nodeId.nodeId;
+      const string name((const char*)ref->displayName.text.data, ref->displayName.text.length);
+      // deep copy: string and guid identifiers point into the response, which is released below
+      if (_nodes.count(name) > 0) {
+        UA_NodeId_deleteMembers(&_nodes[name]);
+      }
+      UA_NodeId_copy(&ref->nodeId.nodeId, &_nodes[name]);
+      ids.set(name, RTX_DIMENSIONLESS);
       
     }
   }
@@ -130,7 +199,17 @@ IdentifierUnitsList OpcAdapter::idUnitsList() {
 
 
 vector<Point> OpcAdapter::selectRange(const std::string &id, RTX::TimeRange range) {
+  auto history = this->selectRanges({id}, range);
+  if (history[id].size() > 0) {
+    return history[id];
+  }
+  
+  // no history on this node; fall back to its current value
+  _RTX_DB_SCOPED_LOCK;
   Point p;
+  if (_nodes.count(id) == 0) {
+    return vector<Point>();
+  }
   UA_NodeId thisNodeId = _nodes.at(id);
   
   UA_StatusCode retval;
@@ -146,10 +225,297 @@ vector<Point> OpcAdapter::selectRange(const std::string &id, RTX::TimeRange rang
   }
   UA_Variant_delete(val);
   
-  return {p};
+  return p.isValid ? vector<Point>({p}) : vector<Point>();
+}
+
+Point OpcAdapter::selectNext(const std::string& id, time_t time, WhereClause q) {
+  return Point(); // unsupported
+}
+
+Point OpcAdapter::selectPrevious(const std::string& id, time_t time, WhereClause q) {
+  return Point(); // unsupported
+}
+
+map<string, vector<Point> > OpcAdapter::selectRanges(const vector<string>& ids, TimeRange range) {
+  _RTX_DB_SCOPED_LOCK;
+  map<string, vector<Point> > out;
+  vector<string> known;
+  for (const string& id : ids) {
+    out[id] = vector<Point>();
+    if (_nodes.count(id) > 0) {
+      known.push_back(id);
+    }
+  }
+  
+  for (size_t i = 0; i < known.size(); i += RTX_OPC_HISTORY_NODES_PER_REQUEST) {
+    vector<string> batch(known.begin() + i, known.begin() + min(known.size(), i + RTX_OPC_HISTORY_NODES_PER_REQUEST));
+    this->historyRead(batch, range, out);
+  }
+  
+  return out;
+}
+
+
+void OpcAdapter::historyRead(const vector<string>& ids, TimeRange range, map<string, vector<Point> >& out) {
+  // one continuation point per node. nodes the server has not finished are asked again, together.
+  vector<UA_ByteString> continuation(ids.size(), UA_BYTESTRING_NULL);
+  vector<size_t> reading(ids.size());
+  iota(reading.begin(), reading.end(), 0);
+  
+  while (reading.size() > 0) {
+    UA_HistoryReadRequest req;
+    UA_HistoryReadRequest_init(&req);
+    UA_ReadRawModifiedDetails *details = UA_ReadRawModifiedDetails_new();
+    details->isReadModified = false;
+    details->startTime = __uaTime(range.start);
+    details->endTime = __uaTime(range.end);
+    details->numValuesPerNode = RTX_OPC_HISTORY_VALUES_PER_NODE;
+    details->returnBounds = false;
+    req.historyReadDetails.encoding = UA_EXTENSIONOBJECT_DECODED;
+    req.historyReadDetails.content.decoded.type = &UA_TYPES[UA_TYPES_READRAWMODIFIEDDETAILS];
+    req.historyReadDetails.content.decoded.data = details;
+    req.timestampsToReturn = UA_TIMESTAMPSTORETURN_SOURCE;
+    req.nodesToRead = (UA_HistoryReadValueId*)UA_Array_new(reading.size(), &UA_TYPES[UA_TYPES_HISTORYREADVALUEID]);
+    req.nodesToReadSize = reading.size();
+    for (size_t k = 0; k < reading.size(); ++k) {
+      UA_NodeId_copy(&_nodes.at(ids[reading[k]]), &req.nodesToRead[k].nodeId);
+      UA_ByteString_copy(&continuation[reading[k]], &req.nodesToRead[k].continuationPoint);
+    }
+    
+    UA_HistoryReadResponse resp;
+    __UA_Client_Service(_client, &req, &UA_TYPES[UA_TYPES_HISTORYREADREQUEST], &resp, &UA_TYPES[UA_TYPES_HISTORYREADRESPONSE]);
+    
+    vector<size_t> unfinished;
+    if (resp.responseHeader.serviceResult != UA_STATUSCODE_GOOD) {
+      stringstream msg;
+      msg << "HistoryRead failed: " << resp.responseHeader.serviceResult;
+      _errCallback(msg.str());
+    }
+    else {
+      for (size_t k = 0; k < resp.resultsSize && k < reading.size(); ++k) {
+        const UA_HistoryReadResult& r = resp.results[k];
+        const size_t n = reading[k];
+        UA_ByteString_deleteMembers(&continuation[n]);
+        if (r.statusCode & 0x80000000) {
+          continue; // bad status: no history for this node
+        }
+        if (r.historyData.encoding == UA_EXTENSIONOBJECT_DECODED && r.historyData.content.decoded.type == &UA_TYPES[UA_TYPES_HISTORYDATA]) {
+          const UA_HistoryData *data = (const UA_HistoryData*)r.historyData.content.decoded.data;
+          vector<Point>& points = out[ids[n]];
+          points.reserve(points.size() + data->dataValuesSize);
+          for (size_t j = 0; j < data->dataValuesSize; ++j) {
+            Point p = __pointFromDataValue(&data->dataValues[j]);
+            if (p.isValid) {
+              points.push_back(p);
+            }
+          }
+        }
+        if (r.continuationPoint.length > 0) {
+          UA_ByteString_copy(&r.continuationPoint, &continuation[n]);
+          unfinished.push_back(n);
+        }
+      }
+    }
+    
+    UA_HistoryReadRequest_deleteMembers(&req);
+    UA_HistoryReadResponse_deleteMembers(&resp);
+    reading = unfinished;
+  }
+  
+  for (auto& cp : continuation) {
+    UA_ByteString_deleteMembers(&cp);
+  }
+}
+
+
+// TRANSACTIONS
+void OpcAdapter::beginTransaction() {
+  return; // unsupported
+}
+
+void OpcAdapter::endTransaction() {
+  return; // unsupported
+}
+
+
+// CREATE
+bool OpcAdapter::insertIdentifierAndUnits(const std::string& id, Units units) {
+  return false; // unsupported
+}
+
+void OpcAdapter::insertSingle(const std::string& id, Point point) {
+  return; // unsupported
+}
+
+void OpcAdapter::insertRange(const std::string& id, std::vector<Point> points) {
+  return; // unsupported
+}
+
+
+// UPDATE
+bool OpcAdapter::assignUnitsToRecord(const std::string& name, const Units& units) {
+  return false; // unsupported
+}
+
+
+// DELETE
+void OpcAdapter::removeRecord(const std::string& id) {
+  return; // unsupported
+}
+
+void OpcAdapter::removeAllRecords() {
+  return; // unsupported
+}
+
+
+#pragma mark - Subscriptions
+
+bool OpcAdapter::subscribe(const vector<string>& ids, pointsCallback_t cb) {
+  this->unsubscribe();
+  {
+    _RTX_DB_SCOPED_LOCK;
+    if (!_connected) {
+      return false;
+    }
+    UA_SubscriptionSettings settings = UA_SubscriptionSettings_standard;
+    settings.requestedPublishingInterval = publishingInterval;
+    if (UA_Client_Subscriptions_new(_client, settings, &_subscriptionId) != UA_STATUSCODE_GOOD) {
+      _subscriptionId = 0;
+      _errCallback("Could not create subscription");
+      return false;
+    }
+    for (const string& id : ids) {
+      if (_nodes.count(id) == 0) {
+        continue;
+      }
+      UA_UInt32 monId = 0;
+      if (UA_Client_Subscriptions_addMonitoredItem(_client, _subscriptionId, _nodes.at(id), UA_ATTRIBUTEID_VALUE, &OpcAdapter::__onDataChange, this, &monId) == UA_STATUSCODE_GOOD) {
+        _monitoredIds[monId] = id;
+      }
+    }
+    if (_monitoredIds.empty()) {
+      UA_Client_Subscriptions_remove(_client, _subscriptionId);
+      _subscriptionId = 0;
+      return false;
+    }
+    _subscriptionCb = cb;
+  }
+  
+  {
+    lock_guard<mutex> lock(_publishMtx);
+    _publishing = true;
+  }
+  _publishThread = thread(&OpcAdapter::publishLoop, this);
+  return true;
 }
 
+void OpcAdapter::unsubscribe() {
+  {
+    lock_guard<mutex> lock(_publishMtx);
+    _publishing = false;
+  }
+  _publishCv.notify_all();
+  if (_publishThread.joinable()) {
+    _publishThread.join();
+  }
+  
+  _RTX_DB_SCOPED_LOCK;
+  if (_subscriptionId != 0) {
+    UA_Client_Subscriptions_remove(_client, _subscriptionId);
+    _subscriptionId = 0;
+  }
+  _monitoredIds.clear();
+  _pendingSamples.clear();
+}
 
+void OpcAdapter::publishLoop() {
+  while (true) {
+    map<string, vector<Point> > samples;
+    {
+      _RTX_DB_SCOPED_LOCK;
+      // data change notifications are dispatched to __onDataChange from inside this call
+      if (UA_Client_Subscriptions_manuallySendPublishRequest(_client) != UA_STATUSCODE_GOOD) {
+        _errCallback("Publish request failed");
+      }
+      samples.swap(_pendingSamples);
+    }
+    for (auto& idPoints : samples) {
+      sort(idPoints.second.begin(), idPoints.second.end(), &Point::comparePointTime);
+      _subscriptionCb(idPoints.first, idPoints.second);
+    }
+    
+    unique_lock<mutex> lock(_publishMtx);
+    if (_publishCv.wait_for(lock, chrono::milliseconds(publishingInterval), [&]{ return !_publishing; })) {
+      return;
+    }
+  }
+}
+
+void OpcAdapter::__onDataChange(UA_UInt32 monId, UA_DataValue *value, void *context) {
+  OpcAdapter *adapter = (OpcAdapter*)context;
+  auto it = adapter->_monitoredIds.find(monId);
+  if (it == adapter->_monitoredIds.end()) {
+    return;
+  }
+  Point p = __pointFromDataValue(value);
+  if (p.isValid) {
+    adapter->_pendingSamples[it->second].push_back(p);
+  }
+}
 
 
+#pragma mark - Conversions
 
+UA_DateTime OpcAdapter::__uaTime(time_t t) {
+  return UA_DATETIME_UNIX_EPOCH + (UA_DateTime)t * UA_DATETIME_SEC;
+}
+
+Point OpcAdapter::__pointFromDataValue(const UA_DataValue *value) {
+  if (!value->hasValue || !UA_Variant_isScalar(&value->value)) {
+    return Point();
+  }
+  
+  const UA_DataType *type = value->value.type;
+  const void *data = value->value.data;
+  double v;
+  if (type == &UA_TYPES[UA_TYPES_DOUBLE]) {
+    v = *(const UA_Double*)data;
+  }
+  else if (type == &UA_TYPES[UA_TYPES_FLOAT]) {
+    v = *(const UA_Float*)data;
+  }
+  else if (type == &UA_TYPES[UA_TYPES_BOOLEAN]) {
+    v = *(const UA_Boolean*)data ? 1. : 0.;
+  }
+  else if (type == &UA_TYPES[UA_TYPES_INT16]) {
+    v = *(const UA_Int16*)data;
+  }
+  else if (type == &UA_TYPES[UA_TYPES_UINT16]) {
+    v = *(const UA_UInt16*)data;
+  }
+  else if (type == &UA_TYPES[UA_TYPES_INT32]) {
+    v = *(const UA_Int32*)data;
+  }
+  else if (type == &UA_TYPES[UA_TYPES_UINT32]) {
+    v = *(const UA_UInt32*)data;
+  }
+  else if (type == &UA_TYPES[UA_TYPES_INT64]) {
+    v = (double)*(const UA_Int64*)data;
+  }
+  else if (type == &UA_TYPES[UA_TYPES_UINT64]) {
+    v = (double)*(const UA_UInt64*)data;
+  }
+  else {
+    return Point();
+  }
+  
+  time_t t = time(NULL);
+  if (value->hasSourceTimestamp && value->sourceTimestamp > UA_DATETIME_UNIX_EPOCH) {
+    t = (time_t)((value->sourceTimestamp - UA_DATETIME_UNIX_EPOCH) / UA_DATETIME_SEC);
+  }
+  else if (value->hasServerTimestamp && value->serverTimestamp > UA_DATETIME_UNIX_EPOCH) {
+    t = (time_t)((value->serverTimestamp - UA_DATETIME_UNIX_EPOCH) / UA_DATETIME_SEC);
+  }
+  const bool good = !value->hasStatus || value->status == UA_STATUSCODE_GOOD;
+  return Point(t, v, good ? Point::opc_good : Point::opc_bad);
+}
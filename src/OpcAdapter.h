@@ -6,16 +6,17 @@
 #include <list>
 #include <string>
 #include <future>
+#include <thread>
+#include <condition_variable>
 #include <boost/atomic.hpp>
 
 #include "DbAdapter.h"
-#include "PointRecordTime.h"
-
-#include <sql.h>
-#include <sqlext.h>
 
 #include <open62541.h>
 
+// read-only OPC UA adapter, built with RTX_WITH_OPC against the open62541 0.2 client API.
+// the connection string is tokenized like influx's: "host=plc.local&port=4840&u=user&p=pass"
+
 namespace RTX {
   class OpcAdapter : public DbAdapter {
   public:
@@ -37,8 +38,9 @@ namespace RTX {
     
     // READ
     std::vector<Point> selectRange(const std::string& id, TimeRange range);
-    Point selectNext(const std::string& id, time_t time);
-    Point selectPrevious(const std::string& id, time_t time);
+    std::map<std::string, std::vector<Point> > selectRanges(const std::vector<std::string>& ids, TimeRange range); // batched HistoryRead
+    Point selectNext(const std::string& id, time_t time, WhereClause q = WhereClause());
+    Point selectPrevious(const std::string& id, time_t time, WhereClause q = WhereClause());
     
     // CREATE
     bool insertIdentifierAndUnits(const std::string& id, Units units);
@@ -53,7 +55,12 @@ namespace RTX {
     void removeAllRecords();
     
     
+    // LIVE DATA
+    bool subscribe(const std::vector<std::string>& ids, pointsCallback_t cb);
+    void unsubscribe();
+    
     // opc-specific methods
+    int publishingInterval; /// milliseconds between subscription publish cycles
     
   private:
     class connectionInfo {
@@ -62,6 +69,7 @@ namespace RTX {
       std::string proto, host, user, pass;
       int port;
       bool validate;
+      std::string endpoint(); // proto://host:port
     };
     connectionInfo _conn;
     
@@ -69,6 +77,24 @@ namespace RTX {
     
     std::map<std::string, UA_NodeId> _nodes;
     
+    void historyRead(const std::vector<std::string>& ids, TimeRange range, std::map<std::string, std::vector<Point> >& out);
+    
+    // subscription state. the client is not thread safe, so publish cycles run under the db lock
+    // and samples collected during a cycle are handed on after it is released.
+    UA_UInt32 _subscriptionId;
+    std::map<UA_UInt32, std::string> _monitoredIds;
+    std::map<std::string, std::vector<Point> > _pendingSamples;
+    pointsCallback_t _subscriptionCb;
+    std::thread _publishThread;
+    std::mutex _publishMtx;
+    std::condition_variable _publishCv;
+    bool _publishing;
+    void publishLoop();
+    
+    static void __onDataChange(UA_UInt32 monId, UA_DataValue *value, void *context);
+    static Point __pointFromDataValue(const UA_DataValue *value);
+    static UA_DateTime __uaTime(time_t t);
+    
   };
 }
 
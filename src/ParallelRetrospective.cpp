@@ -0,0 +1,267 @@
+#include "ParallelRetrospective.h"
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+using namespace RTX;
+
+ParallelRetrospective::ParallelRetrospective(EpanetModel::_sp model) : _model(model) {
+  _workerCount = max(1, (int)thread::hardware_concurrency());
+  _minimumChunk = 24*60*60;
+  _overlap = -1; // chosen from the model at run time
+  _cancel = false;
+}
+
+void ParallelRetrospective::setWorkerCount(int count) {
+  _workerCount = max(1, count);
+}
+
+int ParallelRetrospective::workerCount() {
+  return _workerCount;
+}
+
+void ParallelRetrospective::setMinimumChunkDuration(time_t seconds) {
+  _minimumChunk = max((time_t)0, seconds);
+}
+
+time_t ParallelRetrospective::minimumChunkDuration() {
+  return _minimumChunk;
+}
+
+void ParallelRetrospective::setSeamOverlap(time_t seconds) {
+  _overlap = max((time_t)0, seconds);
+}
+
+time_t ParallelRetrospective::seamOverlap() {
+  return this->overlap();
+}
+
+time_t ParallelRetrospective::overlap() {
+  if (_overlap >= 0) {
+    return _overlap;
+  }
+  // hydraulics only carry link statuses across a reset; quality carries the water in the pipes
+  return _model->shouldRunWaterQuality() ? 24*60*60 : (time_t)_model->hydraulicTimeStep();
+}
+
+vector<TimeRange> ParallelRetrospective::chunks(time_t start, time_t end) {
+  vector<TimeRange> ranges;
+  time_t chunkStart = start;
+  Clock::_sp resetClock = _model->tankResetClock();
+  if (resetClock && end - start > 1) {
+    for (time_t seam : resetClock->timeValuesInRange(TimeRange(start + 1, end - 1))) {
+      if (seam - chunkStart >= _minimumChunk && end - seam >= _minimumChunk) {
+        ranges.push_back(TimeRange(chunkStart, seam));
+        chunkStart = seam;
+      }
+    }
+  }
+  ranges.push_back(TimeRange(chunkStart, end));
+  return ranges;
+}
+
+void ParallelRetrospective::cancel() {
+  _cancel = true;
+  lock_guard<mutex> lock(_mtx);
+  for (EpanetModel::_sp engine : _running) {
+    engine->cancelSimulation();
+  }
+  _cv.notify_all();
+}
+
+vector<TimeRange> ParallelRetrospective::run(time_t start, time_t end) {
+  _cancel = false;
+  vector<TimeRange> notWritten;
+  vector<TimeRange> ranges = this->chunks(start, end);
+
+  if (ranges.size() < 2) {
+    // no reset inside the range: nothing runs independently
+    {
+      lock_guard<mutex> lock(_mtx);
+      _running.push_back(_model);
+    }
+    _model->runExtendedPeriod(start, end);
+    lock_guard<mutex> lock(_mtx);
+    _running.clear();
+    if (_cancel) {
+      notWritten.push_back(TimeRange(start, end)); // any steps solved before the cancel are written
+    }
+    return notWritten;
+  }
+
+  // the first chunk starts where the model is now, unless its tanks are about to be reset from measurements
+  map<string, double> tankLevels;
+  if (!_model->tanksNeedReset()) {
+    for (Tank::_sp tank : _model->tanks()) {
+      tankLevels[tank->name()] = _model->tankLevel(tank->name());
+    }
+  }
+
+  vector<Chunk> chunks(ranges.size());
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    chunks[i].range = ranges[i];
+    chunks[i].done = false;
+    chunks[i].failed = false;
+  }
+
+  // solved chunks wait in memory for the ones before them, so only a few may run ahead of the writer
+  const size_t nWorkers = min((size_t)_workerCount, chunks.size());
+  const size_t window = 2 * nWorkers;
+  size_t written = 0;
+  atomic<size_t> next(0);
+
+  vector<thread> workers;
+  for (size_t iWorker = 0; iWorker < nWorkers; ++iWorker) {
+    workers.push_back(thread([&]() {
+      EpanetModel::_sp engine;
+      string cloneError;
+      try {
+        engine = _model->clone();
+        // the clone has its own clocks, but read-ahead and writer threads would only add readers of
+        // the shared input records to each worker; states leave through the sink, not the writer
+        engine->setPipelineDepth(0);
+      } catch (const std::exception& e) {
+        cloneError = e.what();
+      } catch (const string& e) {
+        cloneError = e;
+      } catch (...) {
+        cloneError = "unknown error";
+      }
+      for (size_t i = next++; i < chunks.size(); i = next++) {
+        Chunk& chunk = chunks[i];
+        {
+          unique_lock<mutex> lock(_mtx);
+          _cv.wait(lock, [&]{ return _cancel || i < written + window; });
+          if (engine && !_cancel) {
+            _running.push_back(engine);
+          }
+        }
+        bool ok = false;
+        if (!engine) {
+          cerr << "retrospective chunk " << i << " failed: could not clone the model: " << cloneError << endl;
+        }
+        else if (!_cancel) {
+          try {
+            this->runChunk(engine, chunk, i == 0, i + 1 == chunks.size(), tankLevels);
+            ok = !_cancel;
+          } catch (const std::exception& e) {
+            cerr << "retrospective chunk " << i << " failed: " << e.what() << endl;
+          } catch (const string& e) {
+            cerr << "retrospective chunk " << i << " failed: " << e << endl;
+          } catch (...) {
+            cerr << "retrospective chunk " << i << " failed: unknown error" << endl;
+          }
+        }
+        {
+          lock_guard<mutex> lock(_mtx);
+          _running.erase(std::remove(_running.begin(), _running.end(), engine), _running.end());
+          chunk.failed = !ok;
+          chunk.done = true;
+        }
+        _cv.notify_all();
+      }
+    }));
+  }
+
+  // merge in time order, as each chunk and all before it are done
+  _model->refreshRecordsForModeledStates();
+  const set<PointRecord::_sp> records = _model->recordsForModeledStates();
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    {
+      unique_lock<mutex> lock(_mtx);
+      _cv.wait(lock, [&]{ return chunks[i].done; });
+    }
+    if (chunks[i].failed) {
+      notWritten.push_back(chunks[i].range);
+    }
+    else {
+      this->writeChunk(chunks[i], records);
+    }
+    Chunk empty;
+    empty.range = chunks[i].range;
+    empty.done = empty.failed = true;
+    chunks[i] = std::move(empty); // release the chunk's states
+    {
+      lock_guard<mutex> lock(_mtx);
+      written = i + 1;
+    }
+    _cv.notify_all();
+  }
+
+  for (thread& worker : workers) {
+    worker.join();
+  }
+  return notWritten;
+}
+
+void ParallelRetrospective::runChunk(EpanetModel::_sp engine, Chunk& chunk, bool isFirst, bool isLast, const map<string, double>& tankLevels) {
+  const TimeRange range = chunk.range;
+  // the step at a seam belongs to the chunk after it
+  auto keep = [&](time_t t) {
+    return t >= range.start && (t < range.end || (isLast && t == range.end));
+  };
+
+  engine->initEngine();
+  time_t runStart = range.start;
+  if (isFirst) {
+    engine->setTanksNeedReset(_model->tanksNeedReset());
+    for (auto& tankLevel : tankLevels) {
+      engine->setTankLevel(tankLevel.first, tankLevel.second);
+    }
+  }
+  else {
+    runStart -= this->overlap();
+    engine->setTanksNeedReset(true); // and again at the seam, on the reset clock
+  }
+
+  engine->clearCheckpoints();
+  engine->setNetworkStateSink([&](NetworkState&& state) {
+    if (keep(state.time)) {
+      chunk.states.push_back(std::move(state));
+    }
+  });
+  try {
+    engine->runExtendedPeriod(runStart, range.end);
+  } catch (...) {
+    engine->setNetworkStateSink(nullptr);
+    throw;
+  }
+  engine->setNetworkStateSink(nullptr);
+
+  // simulation stats and checkpoints go to the model as well
+  const TimeRange run(runStart, range.end);
+  Model& m = *engine; // the engine's per-step overloads hide these
+  vector< pair<TimeSeries::_sp, vector<Point>*> > stats = {
+    {m.relativeError(), &chunk.relativeError},
+    {m.iterations(), &chunk.iterations},
+    {m.convergence(), &chunk.convergence}
+  };
+  for (auto& stat : stats) {
+    for (const Point& p : stat.first->points(run)) {
+      if (keep(p.time)) {
+        stat.second->push_back(p);
+      }
+    }
+    stat.first->resetCache();
+  }
+  for (const Model::Checkpoint& cp : engine->checkpoints(range)) {
+    if (keep(cp.time)) {
+      chunk.checkpoints.push_back(cp);
+    }
+  }
+}
+
+void ParallelRetrospective::writeChunk(Chunk& chunk, const set<PointRecord::_sp>& records) {
+  Model& m = *_model;
+  for (const NetworkState& state : chunk.states) {
+    m.saveNetworkStates(state, records);
+  }
+  m.relativeError()->insertPoints(chunk.relativeError);
+  m.iterations()->insertPoints(chunk.iterations);
+  m.convergence()->insertPoints(chunk.convergence);
+  for (const Model::Checkpoint& cp : chunk.checkpoints) {
+    m.addCheckpoint(cp);
+  }
+}
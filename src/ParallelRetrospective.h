@@ -0,0 +1,71 @@
+#ifndef ParallelRetrospective_h
+#define ParallelRetrospective_h
+
+#include <stdio.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "EpanetModel.h"
+#include "TimeRange.h"
+
+// runExtendedPeriod over a long range, split in time. tanks are reset from measurements on the
+// model's tank reset clock, so the range is cut at reset times into chunks that do not depend on
+// each other. each worker thread solves chunks on its own engine cloned from the model; the calling
+// thread writes the chunks into the model's records in time order.
+//
+// at a seam the later chunk owns the reset step. a chunk starts a little before its seam so that
+// link statuses and water quality are warmed up, and the warm-up steps are dropped; the step at the
+// end of a chunk is dropped too, since the next chunk solves it after its reset.
+
+namespace RTX {
+  class ParallelRetrospective {
+  public:
+    typedef std::shared_ptr<ParallelRetrospective> _sp;
+
+    ParallelRetrospective(EpanetModel::_sp model);
+
+    void setWorkerCount(int count); // engines running at once. defaults to the hardware thread count
+    int workerCount();
+
+    // chunks are cut only at reset times at least this far apart. defaults to one day
+    void setMinimumChunkDuration(time_t seconds);
+    time_t minimumChunkDuration();
+
+    // warm-up before each seam. by default one hydraulic step, or a day when water quality is run
+    void setSeamOverlap(time_t seconds);
+    time_t seamOverlap();
+
+    std::vector<TimeRange> chunks(time_t start, time_t end);
+
+    // returns the chunks that were not written in full, because they failed or were cancelled
+    std::vector<TimeRange> run(time_t start, time_t end);
+    void cancel(); // running chunks stop at their next step and are not written
+
+  private:
+    class Chunk {
+    public:
+      TimeRange range;
+      bool done, failed;
+      std::vector<NetworkState> states;
+      std::vector<Point> relativeError, iterations, convergence;
+      std::vector<Model::Checkpoint> checkpoints;
+    };
+
+    EpanetModel::_sp _model;
+    int _workerCount;
+    time_t _minimumChunk, _overlap;
+    std::atomic<bool> _cancel;
+    std::mutex _mtx;
+    std::condition_variable _cv;
+    std::vector<EpanetModel::_sp> _running;
+
+    time_t overlap();
+    void runChunk(EpanetModel::_sp engine, Chunk& chunk, bool isFirst, bool isLast, const std::map<std::string, double>& tankLevels);
+    void writeChunk(Chunk& chunk, const std::set<PointRecord::_sp>& records);
+  };
+}
+
+#endif /* ParallelRetrospective_h */
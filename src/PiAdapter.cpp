@@ -1,8 +1,12 @@
 #include "PiAdapter.h"
 
+#include <atomic>
+#include <fstream>
+#include <future>
 #include <iostream>
 #include <regex>
 #include <boost/lexical_cast.hpp>
+#include <boost/filesystem.hpp>
 
 #include "PointRecordTime.h"
 
@@ -31,6 +35,19 @@ using jsv = web::json::value;
 
 #define PI_TIMEOUT 3
 
+#ifndef PI_STREAMSET_SIZE
+  // webIds per streamset request. each one lands in the query string, so this bounds the url length
+  #define PI_STREAMSET_SIZE 50
+#endif
+
+#ifndef PI_BATCH_SIZE
+  // sub-requests carried in one call to the batch endpoint
+  #define PI_BATCH_SIZE 10
+#endif
+
+#define PI_DEFAULT_MAX_PARALLEL 4
+#define PI_POINTS_PAGE_SIZE 10000
+
 const string kOSI_REST("OSIsoft.REST");
 const string kFULL_VERSION("FullVersion");
 const string kWebId("WebId");
@@ -43,6 +60,10 @@ const string kValue("Value");
 const string kGood("Good");
 const string kQuest("Questionable");
 const string kSubst("Substituted");
+const string kMethod("Method");
+const string kResource("Resource");
+const string kStatus("Status");
+const string kContent("Content");
 
 
 const char* t_fmt = "%Y-%m-%dT%H:%M:%SZ";
@@ -112,13 +133,23 @@ PiAdapter::PiAdapter(errCallback_t cb) : DbAdapter(cb) {
   _conn.dataServer = "PISRV1";
   _conn.user = "user";
   _conn.pass = "pass";
+  _conn.max_parallel = PI_DEFAULT_MAX_PARALLEL;
   
   tagSearchPath = "";
+  webIdCachePath = "";
   valueConversions = "Active=1&Inactive=0&On=1&Off=0";
+  _watchStop = false;
 }
 
 PiAdapter::~PiAdapter() { 
-  
+  {
+    lock_guard<mutex> lock(_watchMtx);
+    _watchStop = true;
+  }
+  _watchCv.notify_all();
+  if (_watchThread.joinable()) {
+    _watchThread.join();
+  }
 }
 
 const DbAdapter::adapterOptions PiAdapter::options() const {
@@ -137,6 +168,9 @@ const DbAdapter::adapterOptions PiAdapter::options() const {
 std::string PiAdapter::connectionString() {
   stringstream ss;
   ss << "proto=" << this->_conn.proto << "&host=" << this->_conn.host << "&port=" << this->_conn.port << "&api=" << this->_conn.apiPath << "&dataserver=" << this->_conn.dataServer << "&u=" << this->_conn.user << "&p=" << this->_conn.pass;
+  if (this->_conn.max_parallel != PI_DEFAULT_MAX_PARALLEL) {
+    ss << "&parallel=" << this->_conn.max_parallel;
+  }
   return ss.str();
 }
 
@@ -154,7 +188,8 @@ void PiAdapter::setConnectionString(const std::string& str) {
     {"api", [&](string v){this->_conn.apiPath = v;}},
     {"dataserver", [&](string v){this->_conn.dataServer = v;}},
     {"u", [&](string v){this->_conn.user = v;}},
-    {"p", [&](string v){this->_conn.pass = v;}}
+    {"p", [&](string v){this->_conn.pass = v;}},
+    {"parallel", [&](string v){this->_conn.max_parallel = max(1, boost::lexical_cast<int>(v));}}
   }); 
   
   auto kvPairs = _kvFromDelimited(str);
@@ -220,6 +255,7 @@ void PiAdapter::doConnect() {
     string webId = dj[kWebId].as_string();
     cout << "PI DATA SERVER WEB ID: " << webId << endl;
     _conn.dsWebId = webId;
+    this->loadWebIdCache();
     _connected = true;
     _errCallback("Connected");
   }
@@ -236,29 +272,54 @@ IdentifierUnitsList PiAdapter::idUnitsList() {
   _RTX_DB_SCOPED_LOCK;
   
   IdentifierUnitsList ids;
-  _webIdLookup.clear();
-  
-  auto uriPointsB = uriBase()
-  .append_path("dataservers")
-  .append_path(_conn.dsWebId)
-  .append_path("points")
-  .append_query("maxCount",10000)
-  .append_query("selectedFields=Items.WebId;Items.Name;Items.Descriptor;Items.EngineeringUnits");
-  
-  if (this->tagSearchPath != "") {
-    uriPointsB.append_query("nameFilter",this->tagSearchPath);
-  }
-  
-  jsv j = jsonFromRequest(uriPointsB.to_uri(), methods::GET);
-  if (j.has_field(kItems)) {
-    for(auto i : j[kItems].as_array()) {
+  map<string,string> lookup;
+  bool complete = false;
+  
+  // page through the point list; a short page means we have seen everything
+  for (size_t startIndex = 0; ; startIndex += PI_POINTS_PAGE_SIZE) {
+    auto uriPointsB = uriBase()
+    .append_path("dataservers")
+    .append_path(_conn.dsWebId)
+    .append_path("points")
+    .append_query("startIndex",startIndex)
+    .append_query("maxCount",PI_POINTS_PAGE_SIZE)
+    .append_query("selectedFields=Items.WebId;Items.Name;Items.Descriptor;Items.EngineeringUnits");
+    
+    if (this->tagSearchPath != "") {
+      uriPointsB.append_query("nameFilter",this->tagSearchPath);
+    }
+    
+    jsv j = jsonFromRequest(uriPointsB.to_uri(), methods::GET);
+    if (!j.has_field(kItems)) {
+      break;
+    }
+    auto items = j[kItems].as_array();
+    for(auto i : items) {
       if (i.has_field(kName) && i.has_field(kWebId)) {
         string name = i[kName].as_string();
         string webId = i[kWebId].as_string();
-        _webIdLookup[name] = webId;
+        lookup[name] = webId;
         ids.set(name, RTX_DIMENSIONLESS);
       }
     }
+    if (items.size() < PI_POINTS_PAGE_SIZE) {
+      complete = true;
+      break;
+    }
+  }
+  
+  if (complete) {
+    _webIdLookup = lookup;
+    this->saveWebIdCache();
+  }
+  else if (ids.count() == 0) {
+    // server listing failed. fall back on what we resolved earlier or loaded from disk
+    for (auto& nameWebId : _webIdLookup) {
+      ids.set(nameWebId.first, RTX_DIMENSIONLESS);
+    }
+  }
+  else {
+    _webIdLookup.insert(lookup.begin(), lookup.end());
   }
   
   return ids;
@@ -273,19 +334,115 @@ void PiAdapter::endTransaction() {
 
 // READ
 std::vector<Point> PiAdapter::selectRange(const std::string& id, TimeRange range) {
-  _RTX_DB_SCOPED_LOCK;
   vector<Point> points;
+  string webId;
+  {
+    _RTX_DB_SCOPED_LOCK;
+    if (_webIdLookup.count(id) > 0) {
+      webId = _webIdLookup[id];
+    }
+  }
+  if (webId.empty()) {
+    auto resolved = this->resolveWebIds({id});
+    if (resolved.count(id) == 0) {
+      cerr << "PI RECORD ERROR: id " << id << " not in cache" << endl;
+      return points;
+    }
+    webId = resolved.at(id);
+  }
   
-  if (_webIdLookup.count(id) == 0) {
-    cerr << "PI RECORD ERROR: id " << id << " not in cache" << endl;
-    return points;
+  jsv j = jsonFromRequest(this->recordedUri(webId, range), methods::GET);
+  return this->pointsFromRecorded(j);
+}
+
+std::future<std::vector<Point> > PiAdapter::selectRangeAsync(const std::string& id, TimeRange range, cancelToken_t cancel) {
+  string webId;
+  {
+    _RTX_DB_SCOPED_LOCK;
+    if (_webIdLookup.count(id) > 0) {
+      webId = _webIdLookup[id];
+    }
+  }
+  if (webId.empty()) {
+    // resolving the WebId is a blocking round trip of its own
+    return DbAdapter::selectRangeAsync(id, range, cancel);
   }
   
+  auto result = make_shared<promise<vector<Point> > >();
+  auto f = result->get_future();
+  auto done = make_shared<atomic<bool> >(false);
+  pplx::cancellation_token token = this->watchCancel(cancel, done);
+  jsonFromRequestAsync(this->recordedUri(webId, range), methods::GET, jsv::null(), token).then([this, result, cancel, done](pplx::task<jsv> t) {
+    *done = true;
+    vector<Point> points;
+    try {
+      jsv j = t.get();
+      if (!(cancel && *cancel)) {
+        points = this->pointsFromRecorded(j);
+      }
+    }
+    catch (std::exception &e) {
+      if (!(cancel && *cancel)) {
+        cerr << "exception in GET: " << e.what() << endl;
+      }
+    }
+    result->set_value(points);
+  });
+  return f;
+}
+
+pplx::cancellation_token PiAdapter::watchCancel(cancelToken_t cancel, shared_ptr<atomic<bool> > done) {
+  if (!cancel) {
+    return pplx::cancellation_token::none();
+  }
+  watchedRequest w;
+  w.cancel = cancel;
+  w.done = done;
+  pplx::cancellation_token token = w.cts.get_token();
+  {
+    lock_guard<mutex> lock(_watchMtx);
+    _watched.push_back(w);
+    if (!_watchThread.joinable()) {
+      _watchThread = thread(&PiAdapter::watchRequests, this);
+    }
+  }
+  _watchCv.notify_all();
+  return token;
+}
+
+void PiAdapter::watchRequests() {
+  unique_lock<mutex> lock(_watchMtx);
+  while (!_watchStop) {
+    if (_watched.empty()) {
+      _watchCv.wait(lock, [this]{ return _watchStop || !_watched.empty(); });
+      continue;
+    }
+    _watchCv.wait_for(lock, chrono::milliseconds(20));
+    for (auto it = _watched.begin(); it != _watched.end(); ) {
+      if (*(it->cancel) && !*(it->done)) {
+        it->cts.cancel();
+        it = _watched.erase(it);
+      }
+      else if (*(it->done)) {
+        it = _watched.erase(it);
+      }
+      else {
+        ++it;
+      }
+    }
+  }
+  // anything still in flight is abandoned with the adapter
+  for (auto& w : _watched) {
+    w.cts.cancel();
+  }
+  _watched.clear();
+}
+
+web::http::uri PiAdapter::recordedUri(const std::string& webId, TimeRange range) {
   auto startStr = PointRecordTime::utcDateStringFromUnix(range.start,t_fmt);
   auto endStr = PointRecordTime::utcDateStringFromUnix(range.end,t_fmt);
-  string webId = _webIdLookup[id];
   
-  auto uriRange = uriBase()
+  return uriBase()
   .append_path("streams")
   .append_path(webId)
   .append_path("recorded")
@@ -293,15 +450,16 @@ std::vector<Point> PiAdapter::selectRange(const std::string& id, TimeRange range
   .append_query("endTime",endStr)
   .append_query("maxCount",PI_MAX_POINT_COUNT)
   .to_uri();
-  
-  jsv j = jsonFromRequest(uriRange, methods::GET);
-  
+}
+
+std::vector<Point> PiAdapter::pointsFromRecorded(const web::json::value& j) {
+  vector<Point> points;
   if (!j.has_field(kItems)) {
     cerr << "PI RECORD COULD NOT FIND ITEMS in response: " << j.serialize() << endl;
     return points;
   }
   
-  for (auto pjs : j[kItems].as_array()) {
+  for (auto pjs : j.at(kItems).as_array()) {
     Point p = _pointFromJson(pjs);
     if (p.isValid) {
       points.push_back(p);
@@ -310,6 +468,194 @@ std::vector<Point> PiAdapter::selectRange(const std::string& id, TimeRange range
   
   return points;
 }
+
+std::map<std::string, std::vector<Point> > PiAdapter::selectRanges(const std::vector<std::string>& ids, TimeRange range) {
+  map<string, vector<Point> > result;
+  vector<pair<string,string> > streams; // name, webId
+  vector<string> missing;
+  {
+    _RTX_DB_SCOPED_LOCK;
+    for (const string& id : ids) {
+      result[id] = vector<Point>();
+      auto it = _webIdLookup.find(id);
+      if (it != _webIdLookup.end()) {
+        streams.push_back(make_pair(id, it->second));
+      }
+      else {
+        missing.push_back(id);
+      }
+    }
+  }
+  if (!missing.empty()) {
+    for (auto& nameWebId : this->resolveWebIds(missing)) {
+      streams.push_back(nameWebId);
+    }
+  }
+  
+  // each HTTP call is a batch of streamset sub-requests; calls run concurrently up to the connection limit
+  const size_t perCall = PI_STREAMSET_SIZE * PI_BATCH_SIZE;
+  const size_t nCalls = (streams.size() + perCall - 1) / perCall;
+  const size_t nWorkers = min(nCalls, (size_t)_conn.max_parallel);
+  atomic<size_t> nextCall(0);
+  mutex resultMtx;
+  vector<future<void> > workers;
+  for (size_t w = 0; w < nWorkers; ++w) {
+    workers.push_back(async(launch::async, [&]() {
+      for (size_t i = nextCall++; i < nCalls; i = nextCall++) {
+        auto first = streams.begin() + i * perCall;
+        auto last = streams.begin() + min(streams.size(), (i + 1) * perCall);
+        auto part = this->recordedForStreams(vector<pair<string,string> >(first, last), range);
+        lock_guard<mutex> lock(resultMtx);
+        for (auto& idPoints : part) {
+          result[idPoints.first] = std::move(idPoints.second);
+        }
+      }
+    }));
+  }
+  for (auto& w : workers) {
+    w.get();
+  }
+  
+  return result;
+}
+
+std::map<std::string, std::vector<Point> > PiAdapter::recordedForStreams(const std::vector<std::pair<std::string, std::string> >& streams, TimeRange range) {
+  map<string, vector<Point> > result;
+  map<string,string> nameForWebId;
+  
+  auto startStr = PointRecordTime::utcDateStringFromUnix(range.start,t_fmt);
+  auto endStr = PointRecordTime::utcDateStringFromUnix(range.end,t_fmt);
+  
+  jsv batch = jsv::object();
+  for (size_t i = 0; i < streams.size(); i += PI_STREAMSET_SIZE) {
+    auto uriSet = uriBase()
+    .append_path("streamsets")
+    .append_path("recorded");
+    for (size_t s = i; s < min(streams.size(), i + PI_STREAMSET_SIZE); ++s) {
+      uriSet.append_query("webId", streams[s].second);
+      nameForWebId[streams[s].second] = streams[s].first;
+    }
+    uriSet.append_query("startTime",startStr)
+    .append_query("endTime",endStr)
+    .append_query("maxCount",PI_MAX_POINT_COUNT)
+    .append_query("selectedFields=Items.WebId;Items.Items.Timestamp;Items.Items.Value;Items.Items.Good;Items.Items.Questionable;Items.Items.Substituted");
+    
+    jsv sub = jsv::object();
+    sub[kMethod] = jsv::string("GET");
+    sub[kResource] = jsv::string(uriSet.to_string());
+    batch[to_string(i / PI_STREAMSET_SIZE)] = sub;
+  }
+  
+  auto uriBatch = uriBase().append_path("batch").to_uri();
+  jsv j = jsonFromRequest(uriBatch, methods::POST, batch);
+  if (!j.is_object()) {
+    return result;
+  }
+  
+  for (auto& response : j.as_object()) {
+    const jsv& r = response.second;
+    if (!r.has_field(kStatus) || r.at(kStatus).as_integer() != status_codes::OK || !r.has_field(kContent) || !r.at(kContent).has_field(kItems)) {
+      cerr << "PI RECORD STREAMSET REQUEST FAILED: " << r.serialize() << endl;
+      continue;
+    }
+    for (auto stream : r.at(kContent).at(kItems).as_array()) {
+      if (!stream.has_field(kWebId) || !stream.has_field(kItems) || nameForWebId.count(stream[kWebId].as_string()) == 0) {
+        continue;
+      }
+      vector<Point>& points = result[nameForWebId.at(stream[kWebId].as_string())];
+      for (auto pjs : stream[kItems].as_array()) {
+        Point p = _pointFromJson(pjs);
+        if (p.isValid) {
+          points.push_back(p);
+        }
+      }
+    }
+  }
+  
+  return result;
+}
+
+std::map<std::string, std::string> PiAdapter::resolveWebIds(const std::vector<std::string>& names) {
+  // tags not seen in the point listing (or not yet cached) are looked up by path, many per batch call
+  map<string,string> resolved;
+  
+  for (size_t i = 0; i < names.size(); i += PI_BATCH_SIZE * PI_STREAMSET_SIZE) {
+    jsv batch = jsv::object();
+    for (size_t n = i; n < min(names.size(), i + PI_BATCH_SIZE * PI_STREAMSET_SIZE); ++n) {
+      auto uriPoint = uriBase()
+      .append_path("points")
+      .append_query("path", "\\\\" + _conn.dataServer + "\\" + names[n])
+      .append_query("selectedFields=WebId;Name");
+      jsv sub = jsv::object();
+      sub[kMethod] = jsv::string("GET");
+      sub[kResource] = jsv::string(uriPoint.to_string());
+      batch[to_string(n)] = sub;
+    }
+    
+    auto uriBatch = uriBase().append_path("batch").to_uri();
+    jsv j = jsonFromRequest(uriBatch, methods::POST, batch);
+    if (!j.is_object()) {
+      continue;
+    }
+    for (auto& response : j.as_object()) {
+      const jsv& r = response.second;
+      if (r.has_field(kStatus) && r.at(kStatus).as_integer() == status_codes::OK && r.has_field(kContent) && r.at(kContent).has_field(kWebId)) {
+        const size_t n = boost::lexical_cast<size_t>(response.first);
+        resolved[names.at(n)] = r.at(kContent).at(kWebId).as_string();
+      }
+    }
+  }
+  
+  if (!resolved.empty()) {
+    _RTX_DB_SCOPED_LOCK;
+    for (auto& nameWebId : resolved) {
+      _webIdLookup[nameWebId.first] = nameWebId.second;
+    }
+    this->saveWebIdCache();
+  }
+  
+  return resolved;
+}
+
+// cache file: first line is the data server WebId, then one "name<TAB>webId" per line.
+// a cache written against a different data server is ignored.
+void PiAdapter::loadWebIdCache() {
+  if (webIdCachePath.empty()) {
+    return;
+  }
+  ifstream in(webIdCachePath);
+  string line;
+  if (!getline(in, line) || line != _conn.dsWebId) {
+    return;
+  }
+  while (getline(in, line)) {
+    const size_t tab = line.find('\t');
+    if (tab != string::npos) {
+      _webIdLookup[line.substr(0, tab)] = line.substr(tab + 1);
+    }
+  }
+}
+
+void PiAdapter::saveWebIdCache() {
+  if (webIdCachePath.empty() || _conn.dsWebId.empty()) {
+    return;
+  }
+  const string tmpPath = webIdCachePath + ".tmp";
+  {
+    ofstream out(tmpPath, ios::trunc);
+    out << _conn.dsWebId << '\n';
+    for (auto& nameWebId : _webIdLookup) {
+      out << nameWebId.first << '\t' << nameWebId.second << '\n';
+    }
+    if (!out) {
+      cerr << "PI RECORD: could not write WebId cache " << tmpPath << endl;
+      return;
+    }
+  }
+  boost::system::error_code ec;
+  boost::filesystem::rename(tmpPath, webIdCachePath, ec);
+}
+
 Point PiAdapter::selectNext(const std::string& id, time_t time, WhereClause q) {
   return Point();
 }
@@ -346,33 +692,39 @@ void PiAdapter::removeAllRecords() {
 }
 
 
-web::json::value PiAdapter::jsonFromRequest(web::http::uri uri, web::http::method withMethod) {
-  jsv js = jsv::object();
+web::json::value PiAdapter::jsonFromRequest(web::http::uri uri, web::http::method withMethod, const web::json::value& body) {
   try {
-    string auth = _conn.user + ":" + _conn.pass;
-    std::vector<unsigned char> bytes(auth.begin(), auth.end());
-    string userpass = utility::conversions::to_base64(bytes);
-    
-    http_client_config config;
-    config.set_validate_certificates(PI_SSL_VALIDATE);
-    config.set_timeout(std::chrono::seconds(PI_TIMEOUT));
-    //    credentials cred(_conn.user,_conn.pass);
-    //    config.set_credentials(cred);
-    http_client client(uri, config);
-    http_request req(methods::GET);
-    req.headers().add("Authorization", "Basic " + userpass);
-    http_response r = client.request(req).get(); // waits for response
-    if (r.status_code() == status_codes::OK) {
-      js = r.extract_json().get();
-    }
-    else {
-      cerr << "CONNECTION ERROR: " << r.reason_phrase() << EOL;
-    }
+    return jsonFromRequestAsync(uri, withMethod, body).get(); // waits for response
   }
   catch (std::exception &e) {
     cerr << "exception in GET: " << e.what() << endl;
   }
-  return js;
+  return jsv::object();
+}
+
+pplx::task<web::json::value> PiAdapter::jsonFromRequestAsync(web::http::uri uri, web::http::method withMethod, const web::json::value& body, pplx::cancellation_token token) {
+  string auth = _conn.user + ":" + _conn.pass;
+  std::vector<unsigned char> bytes(auth.begin(), auth.end());
+  string userpass = utility::conversions::to_base64(bytes);
+  
+  http_client_config config;
+  config.set_validate_certificates(PI_SSL_VALIDATE);
+  config.set_timeout(std::chrono::seconds(PI_TIMEOUT));
+  //    credentials cred(_conn.user,_conn.pass);
+  //    config.set_credentials(cred);
+  http_client client(uri, config);
+  http_request req(withMethod);
+  req.headers().add("Authorization", "Basic " + userpass);
+  if (!body.is_null()) {
+    req.set_body(body);
+  }
+  return client.request(req, token).then([](http_response r) -> pplx::task<jsv> {
+    if (r.status_code() == status_codes::OK) {
+      return r.extract_json();
+    }
+    cerr << "CONNECTION ERROR: " << r.reason_phrase() << EOL;
+    return pplx::task_from_result(jsv::object());
+  });
 }
 
 web::http::uri_builder PiAdapter::uriBase() {
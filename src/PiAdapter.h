@@ -5,6 +5,11 @@
 
 #include "DbAdapter.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #include <cpprest/uri.h>
 #include <cpprest/json.h>
 #include <cpprest/http_client.h>
@@ -30,6 +35,8 @@ namespace RTX {
     
     // READ
     std::vector<Point> selectRange(const std::string& id, TimeRange range);
+    std::map<std::string, std::vector<Point> > selectRanges(const std::vector<std::string>& ids, TimeRange range);
+    std::future<std::vector<Point> > selectRangeAsync(const std::string& id, TimeRange range, cancelToken_t cancel = cancelToken_t());
     Point selectNext(const std::string& id, time_t time, WhereClause q = WhereClause());
     Point selectPrevious(const std::string& id, time_t time, WhereClause q = WhereClause());
     
@@ -49,6 +56,7 @@ namespace RTX {
     // PI_SPECIFIC details
     std::string tagSearchPath;
     std::string valueConversions; /// use for text-field conversions to numerical type... "Active=1&Inactive=0".
+    std::string webIdCachePath; /// if set, the name->WebId map is saved here and reused after a restart
     
     
     
@@ -57,6 +65,7 @@ namespace RTX {
       // these are set through connection string parser
       std::string proto, host, apiPath, dataServer, user, pass;
       int port;
+      int max_parallel; // concurrent HTTP requests for multi-tag reads
       // these are determined through a successful connection
       std::string dsWebId;
     };
@@ -64,9 +73,32 @@ namespace RTX {
     
     std::map<std::string, std::string> _webIdLookup; // name->webId
     std::map<std::string, double> _conversions;
-    web::json::value jsonFromRequest(web::http::uri uri, web::http::method withMethod);
+    web::json::value jsonFromRequest(web::http::uri uri, web::http::method withMethod, const web::json::value& body = web::json::value::null());
+    pplx::task<web::json::value> jsonFromRequestAsync(web::http::uri uri, web::http::method withMethod, const web::json::value& body = web::json::value::null(), pplx::cancellation_token token = pplx::cancellation_token::none());
+    web::http::uri recordedUri(const std::string& webId, TimeRange range);
+    std::vector<Point> pointsFromRecorded(const web::json::value& j);
     web::http::uri_builder uriBase();
+    
+    void loadWebIdCache();
+    void saveWebIdCache();
+    std::map<std::string, std::string> resolveWebIds(const std::vector<std::string>& names);
+    std::map<std::string, std::vector<Point> > recordedForStreams(const std::vector<std::pair<std::string, std::string> >& streams, TimeRange range);
 
+    // requests in flight are cancelled through pplx when their cancel token is set. a watcher thread polls
+    // the tokens, since a DbAdapter cancel token is only a flag.
+    struct watchedRequest {
+      cancelToken_t cancel;
+      pplx::cancellation_token_source cts;
+      std::shared_ptr<std::atomic<bool> > done;
+    };
+    std::mutex _watchMtx;
+    std::condition_variable _watchCv;
+    std::vector<watchedRequest> _watched;
+    std::thread _watchThread;
+    bool _watchStop;
+    pplx::cancellation_token watchCancel(cancelToken_t cancel, std::shared_ptr<std::atomic<bool> > done);
+    void watchRequests();
+    
     std::map<std::string,std::string> _kvFromDelimited(const std::string& str);
     Point _pointFromJson(const web::json::value& j);
     
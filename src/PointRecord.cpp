@@ -40,6 +40,7 @@ std::ostream& PointRecord::toStream(std::ostream &stream) {
 
 bool PointRecord::registerAndGetIdentifierForSeriesWithUnits(std::string recordName, Units units) {
   
+  std::lock_guard<std::shared_mutex> lock(_cacheMtx);
   _idsCache.set(recordName, units);
   
   if (_singlePointCache.find(recordName) == _singlePointCache.end()) {
@@ -49,6 +50,7 @@ bool PointRecord::registerAndGetIdentifierForSeriesWithUnits(std::string recordN
 }
 
 IdentifierUnitsList PointRecord::identifiersAndUnits() {
+  std::shared_lock<std::shared_mutex> lock(_cacheMtx);
   return _idsCache;
 }
 
@@ -61,11 +63,10 @@ bool PointRecord::exists(const std::string &name, const RTX::Units &units) {
 Point PointRecord::point(const string& identifier, time_t time) {
   // return the cached point if it is valid
   
-  if (_singlePointCache.find(identifier) != _singlePointCache.end()) {
-    Point p = _singlePointCache[identifier];
-    if (p.time == time) {
-      return p;
-    }
+  std::shared_lock<std::shared_mutex> lock(_cacheMtx);
+  auto cached = _singlePointCache.find(identifier);
+  if (cached != _singlePointCache.end() && cached->second.time == time) {
+    return cached->second;
   }
   
   return Point();
@@ -111,6 +112,7 @@ TimeRange PointRecord::range(const string& id) {
 
 void PointRecord::addPoint(const string& identifier, Point point) {
   // Cache this single point
+  std::lock_guard<std::shared_mutex> lock(_cacheMtx);
   _singlePointCache[identifier] = point;
 }
 
@@ -119,6 +121,12 @@ void PointRecord::addPoints(const string& identifier, std::vector<Point> points)
   
 }
 
+void PointRecord::addPointRows(const pointRows_t& rows) {
+  for (const auto& row : rows) {
+    this->addPoint(row.first, row.second);
+  }
+}
+
 
 void PointRecord::reset() {
   
@@ -15,6 +15,7 @@
 #include <deque>
 #include <fstream>
 #include <map>
+#include <shared_mutex>
 
 
 #include "Point.h"
@@ -24,6 +25,7 @@
 #include "TimeRange.h"
 #include "IdentifierUnitsList.h"
 #include "WhereClause.h"
+#include "SeriesHandle.h"
 
 
 using std::string;
@@ -79,6 +81,9 @@ namespace RTX {
     virtual std::vector<Point> pointsInRange(const string& identifier, TimeRange range);
     virtual void addPoint(const string& identifier, Point point);
     virtual void addPoints(const string& identifier, std::vector<Point> points);
+    // result sink: one point each for many series, typically a whole simulation step
+    typedef std::vector<std::pair<std::string, Point> > pointRows_t;
+    virtual void addPointRows(const pointRows_t& rows);
     virtual void reset(); // clear memcache for all ids
     virtual void reset(const string& identifier); // clear memcache for just this id
     virtual void invalidate(const string& identifier) {reset(identifier);}; // alias here, override for database implementations
@@ -87,6 +92,15 @@ namespace RTX {
     virtual TimeRange range(const string& id);
     virtual bool supportsQualifiedQuery() { return false; };
     
+    // handle-keyed access for hot paths. by default these forward to the name-keyed calls;
+    // buffered records find the series through the handle's integer key instead.
+    virtual Point point(const SeriesHandle& series, time_t time) { return this->point(series.name(), time); };
+    virtual Point pointBefore(const SeriesHandle& series, time_t time, WhereClause q = WhereClause()) { return this->pointBefore(series.name(), time, q); };
+    virtual Point pointAfter(const SeriesHandle& series, time_t time, WhereClause q = WhereClause()) { return this->pointAfter(series.name(), time, q); };
+    virtual std::vector<Point> pointsInRange(const SeriesHandle& series, TimeRange range) { return this->pointsInRange(series.name(), range); };
+    virtual void addPoints(const SeriesHandle& series, std::vector<Point> points) { this->addPoints(series.name(), points); };
+    virtual TimeRange range(const SeriesHandle& series) { return this->range(series.name()); };
+    
     virtual std::ostream& toStream(std::ostream &stream);
     
     virtual void beginBulkOperation() {};
@@ -96,6 +110,7 @@ namespace RTX {
   protected:
     std::map<std::string,Point> _singlePointCache;
     IdentifierUnitsList _idsCache;
+    std::shared_mutex _cacheMtx; // guards the two caches above, which many simulations may read at once
     
   private:
     std::string _name;
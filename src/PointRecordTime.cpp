@@ -1,6 +1,13 @@
 #include "PointRecordTime.h"
+#include <algorithm>
+#include <map>
+#include <mutex>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/algorithm/string/replace.hpp>
+#include <boost/weak_ptr.hpp>
+
+#define RTX_TZ_FIRST_YEAR 1970
+#define RTX_TZ_LAST_YEAR 2100
 
 
 using namespace RTX;
@@ -22,69 +29,115 @@ struct tm PointRecordTime::tmFromSql(SQL_TIMESTAMP_STRUCT sqlTime) {
 }
 
 
+// days since 1970-01-01 of a proleptic gregorian date (H. Hinnant's days_from_civil)
+static inline long long __daysFromCivil(int y, int m, int d) {
+  y -= m <= 2;
+  const long long era = (y >= 0 ? y : y - 399) / 400;
+  const unsigned yoe = (unsigned)(y - era * 400);
+  const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (long long)doe - 719468;
+}
+
+time_t PointRecordTime::timeFromCivil(int year, int month, int day, int hour, int minute, int second) {
+  return (time_t)(__daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second);
+}
+
+
 time_t PointRecordTime::time(SQL_TIMESTAMP_STRUCT sqlTime) {
   
-  ptime pTimeEpoch = boost::posix_time::ptime(boost::gregorian::date(1970,1,1));
-  
-  time_t uTime;
-  struct tm tmTime = PointRecordTime::tmFromSql(sqlTime);
-  
-  // Portability note: mktime is essentially universally available. timegm is rather rare. fortunately, boost has some capabilities here.
-  // uTime = timegm(&tmTime);
-  
-  boost::posix_time::ptime pt = boost::posix_time::ptime_from_tm(tmTime);
-  boost::posix_time::time_duration::sec_type x = (pt - pTimeEpoch).total_seconds();
-  uTime = time_t(x);
-  
-  // back convert for a check
-  SQL_TIMESTAMP_STRUCT sqlTimeCheck = PointRecordTime::sqlTime(uTime);
-  if ( sqlTimeCheck.year == sqlTime.year &&
-      sqlTimeCheck.month == sqlTime.month &&
-      sqlTimeCheck.day == sqlTime.day &&
-      sqlTimeCheck.hour == sqlTime.hour &&
-      sqlTimeCheck.minute == sqlTime.minute &&
-      sqlTimeCheck.second == sqlTime.second) {
-  }
-  else {
+  // Portability note: timegm is rather rare, so the calendar arithmetic is done here directly.
+  if (sqlTime.month < 1 || sqlTime.month > 12 || sqlTime.day < 1 || sqlTime.day > 31 ||
+      sqlTime.hour > 23 || sqlTime.minute > 59 || sqlTime.second > 60) {
     cerr << "time not formed correctly" << endl;
   }
-  
-  return uTime;
+  return PointRecordTime::timeFromCivil(sqlTime.year, sqlTime.month, sqlTime.day, sqlTime.hour, sqlTime.minute, sqlTime.second);
 }
 
 time_t PointRecordTime::timeFromZone(SQL_TIMESTAMP_STRUCT sqlTime, const time_zone_ptr& localtz) {
-  
-  time_t uTime;
+  return PointRecordTime::timeFromZone(sqlTime, *PointRecordTime::zoneOffsets(localtz));
+}
+
+time_t PointRecordTime::timeFromZone(SQL_TIMESTAMP_STRUCT sqlTime, const ZoneOffsets& offsets) {
   // use a specified-timezone time input, and output unix epoch UTC
-  struct tm tmTime = PointRecordTime::tmFromSql(sqlTime);
-  ptime t = boost::posix_time::ptime_from_tm(tmTime);
-  ptime pTimeEpoch = boost::posix_time::ptime(boost::gregorian::date(1970,1,1));
+  const time_t wallClock = PointRecordTime::timeFromCivil(sqlTime.year, sqlTime.month, sqlTime.day, sqlTime.hour, sqlTime.minute, sqlTime.second);
+  return offsets.utcFromLocal(wallClock);
+}
+
+
+#pragma mark - Zone offsets
+
+PointRecordTime::ZoneOffsets::ZoneOffsets(const time_zone_ptr& tz) {
+  _baseOffset = tz ? (time_t)tz->base_utc_offset().total_seconds() : 0;
+  _dstOffset = (tz && tz->has_dst()) ? (time_t)tz->dst_offset().total_seconds() : 0;
+  if (!tz || !tz->has_dst()) {
+    return;
+  }
   
-  if(t.is_not_a_date_time()) return 0;
-  local_date_time lt(t.date(), t.time_of_day(), localtz, local_date_time::NOT_DATE_TIME_ON_ERROR);
-  ptime unixTime = lt.utc_time();
+  const ptime epoch(boost::gregorian::date(1970,1,1));
+  for (int year = RTX_TZ_FIRST_YEAR; year <= RTX_TZ_LAST_YEAR; ++year) {
+    // boost gives the start in standard local time and the end in daylight local time
+    const time_t start = (time_t)(tz->dst_local_start_time(year) - epoch).total_seconds();
+    const time_t end = (time_t)(tz->dst_local_end_time(year) - epoch).total_seconds();
+    // on the local side daylight time begins after the skipped hour, so that wall-clock times inside it read as standard time
+    _localTransitions.push_back(make_pair(start + _dstOffset, true));
+    _localTransitions.push_back(make_pair(end, false));
+    _utcTransitions.push_back(make_pair(start - _baseOffset, true));
+    _utcTransitions.push_back(make_pair(end - _baseOffset - _dstOffset, false));
+  }
+  // southern-hemisphere zones end daylight time before they start it within a calendar year
+  sort(_localTransitions.begin(), _localTransitions.end());
+  sort(_utcTransitions.begin(), _utcTransitions.end());
+}
+
+bool PointRecordTime::ZoneOffsets::isDst(const vector<pair<time_t, bool> >& transitions, time_t t) const {
+  if (transitions.empty()) {
+    return false;
+  }
+  auto it = upper_bound(transitions.begin(), transitions.end(), make_pair(t, true));
+  if (it == transitions.begin()) {
+    return !it->second; // before the first transition, the opposite of what it switches to
+  }
+  return (it - 1)->second;
+}
+
+time_t PointRecordTime::ZoneOffsets::utcFromLocal(time_t localSeconds) const {
+  // a repeated hour at the end of daylight time resolves to its first (daylight) occurrence,
+  // and a skipped hour at the start is read as standard time.
+  const time_t offset = _baseOffset + (this->isDst(_localTransitions, localSeconds) ? _dstOffset : 0);
+  return localSeconds - offset;
+}
+
+time_t PointRecordTime::ZoneOffsets::localFromUtc(time_t utcSeconds) const {
+  const time_t offset = _baseOffset + (this->isDst(_utcTransitions, utcSeconds) ? _dstOffset : 0);
+  return utcSeconds + offset;
+}
+
+std::shared_ptr<const PointRecordTime::ZoneOffsets> PointRecordTime::zoneOffsets(const time_zone_ptr& tz) {
+  // keyed by zone object; the weak reference catches an address being reused by a new zone
+  typedef pair<boost::weak_ptr<time_zone>, std::shared_ptr<const ZoneOffsets> > entry_t;
+  static map<const time_zone*, entry_t> cache;
+  static mutex cacheMtx;
   
-  boost::posix_time::time_duration::sec_type x = (unixTime - pTimeEpoch).total_seconds();
-  uTime = time_t(x);
-  return uTime;
+  lock_guard<mutex> lock(cacheMtx);
+  auto it = cache.find(tz.get());
+  if (it != cache.end() && it->second.first.lock() == tz) {
+    return it->second.second;
+  }
+  auto offsets = std::make_shared<const ZoneOffsets>(tz);
+  cache[tz.get()] = make_pair(boost::weak_ptr<time_zone>(tz), offsets);
+  return offsets;
 }
 
 string PointRecordTime::localDateStringFromUnix(time_t unixTime, const boost::local_time::time_zone_ptr& localtz) {
   
-  boost::posix_time::ptime pt = boost::posix_time::from_time_t(unixTime);
-  
-  local_date_time localTime(pt,localtz);
-  
-  string s;
-  ostringstream datetime_ss;
-  boost::posix_time::time_facet * p_time_output = new boost::posix_time::time_facet;
-  // locale takes ownership of the p_time_output facet
-  datetime_ss.imbue (locale(datetime_ss.getloc(), p_time_output));
-  (*p_time_output).format("%Y-%m-%d %H:%M:%S"); // date time
-  datetime_ss << localTime.local_time();
-  s = datetime_ss.str().c_str();
-  // don't explicitly delete p_time_output
-  return s;
+  const time_t local = PointRecordTime::zoneOffsets(localtz)->localFromUtc(unixTime);
+  const ptime pt = boost::posix_time::from_time_t(local);
+  const auto ymd = pt.date().year_month_day();
+  const auto tod = pt.time_of_day();
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d:%02d", (int)ymd.year, (int)ymd.month, (int)ymd.day, (int)tod.hours(), (int)tod.minutes(), (int)tod.seconds());
+  return string(buf);
   
 }
 
@@ -135,8 +188,48 @@ string PointRecordTime::utcDateStringFromUnix(time_t unixTime, const char *fmt)
 }
 
 
+static inline bool __digits(const char *p, int n, int& out) {
+  out = 0;
+  for (int i = 0; i < n; ++i) {
+    if (p[i] < '0' || p[i] > '9') {
+      return false;
+    }
+    out = out * 10 + (p[i] - '0');
+  }
+  return true;
+}
+
 time_t PointRecordTime::timeFromIso8601(const std::string& tstr) {
   
+  // fixed-layout fast path: YYYY-MM-DD[T ]hh:mm:ss, then optional fraction and zone designator
+  const char *s = tstr.c_str();
+  int y, mo, d, h, mi, sec;
+  if (tstr.size() >= 19 &&
+      __digits(s, 4, y) && s[4] == '-' && __digits(s+5, 2, mo) && s[7] == '-' && __digits(s+8, 2, d) &&
+      (s[10] == 'T' || s[10] == ' ') &&
+      __digits(s+11, 2, h) && s[13] == ':' && __digits(s+14, 2, mi) && s[16] == ':' && __digits(s+17, 2, sec)) {
+    time_t t = PointRecordTime::timeFromCivil(y, mo, d, h, mi, sec);
+    size_t i = 19;
+    if (i < tstr.size() && (s[i] == '.' || s[i] == ',')) {
+      ++i;
+      while (i < tstr.size() && s[i] >= '0' && s[i] <= '9') {
+        ++i; // sub-second precision is truncated
+      }
+    }
+    if (i == tstr.size() || (s[i] == 'Z' && i + 1 == tstr.size())) {
+      return t;
+    }
+    int oh, om = 0;
+    if ((s[i] == '+' || s[i] == '-') && __digits(s+i+1, 2, oh)) {
+      const size_t rest = tstr.size() - (i + 3);
+      if (rest == 0 || (rest == 3 && s[i+3] == ':' && __digits(s+i+4, 2, om)) || (rest == 2 && __digits(s+i+3, 2, om))) {
+        const time_t offset = oh * 3600 + om * 60;
+        return (s[i] == '+') ? t - offset : t + offset;
+      }
+    }
+  }
+  
+  // anything else goes through the general parser
   string t_str(tstr);
   boost::replace_all(t_str,"Z","");
   
@@ -146,7 +239,3 @@ time_t PointRecordTime::timeFromIso8601(const std::string& tstr) {
   time_t uTime = time_t(x);
   return uTime;
 }
-
-
-
-
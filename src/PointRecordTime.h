@@ -10,6 +10,8 @@
 #define __epanet_rtx__PointRecordTime__
 
 #include <iostream>
+#include <memory>
+#include <vector>
 #include <time.h>
 #include <sqltypes.h>
 
@@ -23,14 +25,31 @@ namespace RTX {
     
   public:
     typedef enum { UTC = 0, LOCAL = 1 } time_format_t;
+    
+    // daylight-saving transitions of one time zone, tabulated once so that per-row conversion
+    // is a binary search instead of a boost local_time construction.
+    class ZoneOffsets {
+    public:
+      ZoneOffsets(const boost::local_time::time_zone_ptr& tz);
+      time_t utcFromLocal(time_t localSeconds) const; // local wall-clock seconds, counted as if they were UTC
+      time_t localFromUtc(time_t utcSeconds) const;
+    private:
+      bool isDst(const std::vector<std::pair<time_t, bool> >& transitions, time_t t) const;
+      time_t _baseOffset, _dstOffset;
+      std::vector<std::pair<time_t, bool> > _localTransitions, _utcTransitions; // time, dst in effect from then on
+    };
+    static std::shared_ptr<const ZoneOffsets> zoneOffsets(const boost::local_time::time_zone_ptr& tz); // cached per zone
+    
+    static time_t timeFromCivil(int year, int month, int day, int hour, int minute, int second);
     static tm tmFromSql(SQL_TIMESTAMP_STRUCT sqlTime);
     static time_t time(SQL_TIMESTAMP_STRUCT sqlTime);
     static time_t timeFromZone(SQL_TIMESTAMP_STRUCT sqlTime, const boost::local_time::time_zone_ptr& localtz);
+    static time_t timeFromZone(SQL_TIMESTAMP_STRUCT sqlTime, const ZoneOffsets& offsets);
     static SQL_TIMESTAMP_STRUCT sqlTime(time_t uTime, time_format_t format = UTC);
     static std::string localDateStringFromUnix(time_t unixTime, const boost::local_time::time_zone_ptr& localtz);
     static std::string utcDateStringFromUnix(time_t unixTime, const char *format = "%Y-%m-%d %H:%M:%S");
     
-    static time_t timeFromIso8601(const std::string& tstr);
+    static time_t timeFromIso8601(const std::string& tstr); // "YYYY-MM-DD[T ]hh:mm:ss[.fff][Z|+hh:mm]"
     
   };
 }
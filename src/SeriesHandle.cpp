@@ -0,0 +1,31 @@
+#include "SeriesHandle.h"
+
+#include <unordered_map>
+
+using namespace std;
+using namespace RTX;
+
+SeriesHandle::_sp SeriesHandle::intern(const string& name) {
+  static unordered_map<string, _sp> table;
+  static mutex tableMtx;
+  
+  lock_guard<mutex> lock(tableMtx);
+  auto it = table.find(name);
+  if (it != table.end()) {
+    return it->second;
+  }
+  _sp handle = make_shared<SeriesHandle>(name, table.size());
+  table[name] = handle;
+  return handle;
+}
+
+SeriesHandle::SeriesHandle(const string& name, size_t key) : _name(name), _key(key) {
+  
+}
+
+const MetricInfo& SeriesHandle::metric() {
+  call_once(_metricOnce, [this]() {
+    _metric.reset(new MetricInfo(_name));
+  });
+  return *_metric;
+}
@@ -0,0 +1,34 @@
+#ifndef SeriesHandle_h
+#define SeriesHandle_h
+
+#include <stdio.h>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "MetricInfo.h"
+
+// interned identity of a series name. there is one handle per distinct name for the life of the
+// process, so hot paths can index by its integer key instead of hashing or comparing strings.
+
+namespace RTX {
+  class SeriesHandle {
+  public:
+    typedef std::shared_ptr<SeriesHandle> _sp;
+    static _sp intern(const std::string& name);
+    
+    const std::string& name() const {return _name;};
+    size_t key() const {return _key;}; // dense, assigned in order of first use
+    const MetricInfo& metric(); // "measurement,tag=value" parsed on first use
+    
+    SeriesHandle(const std::string& name, size_t key); // use intern()
+    
+  private:
+    const std::string _name;
+    const size_t _key;
+    std::once_flag _metricOnce;
+    std::unique_ptr<MetricInfo> _metric;
+  };
+}
+
+#endif /* SeriesHandle_h */
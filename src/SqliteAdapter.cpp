@@ -25,6 +25,7 @@ const string _selectRangeStr = "SELECT time,value,quality,confidence FROM points
 const string _selectNextStr = "SELECT time,value,quality,confidence FROM points INNER JOIN meta USING(series_id) WHERE name = ? AND time > ? order by time asc LIMIT 1";
 const string _selectPreviousStr = "SELECT time,value,quality,confidence FROM points INNER JOIN meta USING(series_id) WHERE name = ? AND time < ? order by time desc LIMIT 1";
 const string _insertSingleStr = "INSERT INTO points(time,series_id,value,quality,confidence) VALUES (?,?,?,?,?)";
+#define RTX_SQLITE_ROWS_PER_INSERT 150 // 5 parameters per row, under the 999 limit of older sqlite builds
 const string _selectFirstStr = "SELECT time,value,quality,confidence FROM points INNER JOIN meta USING(series_id) WHERE name = ? order by time asc limit 1";
 const string _selectLastStr = "SELECT time,value,quality,confidence FROM points INNER JOIN meta USING(series_id) WHERE name = ? order by time desc limit 1";
 const string _selectNamesStr = "select series_id,name,units from meta order by name asc";
@@ -63,6 +64,7 @@ SqliteAdapter::SqliteAdapter( errCallback_t cb ) : DbAdapter(cb) {
   _path = "";
   basePath = "";
   _inTransaction = false;
+  _insertFailed = false;
   _transactionStackCount = 0;
   _maxTransactionStackCount = 50000;
   _connected = false;
@@ -295,6 +297,73 @@ void SqliteAdapter::insertRange(const std::string& id, std::vector<Point> points
   this->endTransaction();
 }
 
+void SqliteAdapter::insertRows(const std::vector<std::pair<std::string, Point> >& rows) {
+  if (rows.size() == 0) {
+    return;
+  }
+  const bool ownTransaction = !_inTransaction;
+  if (ownTransaction) {
+    this->beginTransaction();
+  }
+  {
+    _RTX_DB_SCOPED_LOCK;
+    sqlite3 *db = _db->connection().get();
+    // one multi-row statement per chunk; the full-size statement is prepared once and reused
+    sqlite3_stmt *fullChunk = NULL;
+    for (size_t first = 0; first < rows.size(); first += RTX_SQLITE_ROWS_PER_INSERT) {
+      const size_t n = min((size_t)RTX_SQLITE_ROWS_PER_INSERT, rows.size() - first);
+      sqlite3_stmt *stmt = (n == RTX_SQLITE_ROWS_PER_INSERT) ? fullChunk : NULL;
+      if (!stmt) {
+        string sql = _insertSingleStr;
+        for (size_t i = 1; i < n; ++i) {
+          sql += ",(?,?,?,?,?)";
+        }
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+          cerr << "could not prepare insert: " << sqlite3_errmsg(db) << endl;
+          _insertFailed = true;
+          break;
+        }
+        if (n == RTX_SQLITE_ROWS_PER_INSERT) {
+          fullChunk = stmt;
+        }
+      }
+      int iParam = 1;
+      for (size_t i = first; i < first + n; ++i) {
+        const Point& p = rows[i].second;
+        sqlite3_bind_int64(stmt, iParam++, (sqlite3_int64)p.time);
+        sqlite3_bind_int(stmt, iParam++, _metaCache[rows[i].first]);
+        sqlite3_bind_double(stmt, iParam++, p.value);
+        sqlite3_bind_int(stmt, iParam++, (int)p.quality);
+        sqlite3_bind_double(stmt, iParam++, p.confidence);
+      }
+      if (sqlite3_step(stmt) != SQLITE_DONE) {
+        cerr << "could not insert rows: " << sqlite3_errmsg(db) << endl;
+        _insertFailed = true;
+      }
+      if (stmt == fullChunk) {
+        sqlite3_reset(stmt);
+      }
+      else {
+        sqlite3_finalize(stmt);
+      }
+    }
+    sqlite3_finalize(fullChunk);
+  }
+  if (ownTransaction) {
+    this->endTransaction();
+  }
+  else {
+    this->checkTransactions();
+  }
+}
+
+bool SqliteAdapter::confirmWrites() {
+  _RTX_DB_SCOPED_LOCK;
+  const bool failed = _insertFailed;
+  _insertFailed = false;
+  return !failed;
+}
+
 // UPDATE
 bool SqliteAdapter::assignUnitsToRecord(const std::string& name, const Units& units) {
   
@@ -40,6 +40,8 @@ namespace RTX {
     bool insertIdentifierAndUnits(const std::string& id, Units units);
     void insertSingle(const std::string& id, Point point);
     void insertRange(const std::string& id, std::vector<Point> points);
+    void insertRows(const std::vector<std::pair<std::string, Point> >& rows);
+    bool confirmWrites();
     
     // UPDATE
     bool assignUnitsToRecord(const std::string& name, const Units& units);
@@ -55,6 +57,7 @@ namespace RTX {
     std::string _path;
     
     bool _inTransaction;
+    bool _insertFailed; // a row insert was logged as failed since the last confirmWrites
     int _transactionStackCount;
     int _maxTransactionStackCount;
     void checkTransactions();
@@ -35,6 +35,7 @@ TimeSeries::TimeSeries() : _valid(true) {
 
 TimeSeries::TimeSeries(const std::string& name, const RTX::Units& units) {
   _name = name;
+  _handle = SeriesHandle::intern(name);
   _units = units;
   _points.reset( new PointRecord() );
   _points->registerAndGetIdentifierForSeriesWithUnits(name, units);
@@ -60,6 +61,7 @@ void TimeSeries::setValid(bool v) {
 
 void TimeSeries::setName(const std::string& name) {
   _name = name;
+  _handle = SeriesHandle::intern(name);
   _points->registerAndGetIdentifierForSeriesWithUnits(name, this->units());
 }
 
@@ -81,7 +83,7 @@ void TimeSeries::insert(Point thisPoint) {
 }
 
 void TimeSeries::insertPoints(std::vector<Point> points) {
-  _points->addPoints(name(), points);
+  _points->addPoints(*_handle, points);
 }
 
 Point TimeSeries::point(time_t time) {
@@ -113,7 +115,7 @@ std::vector< Point > TimeSeries::points(TimeRange range) {
     this->record()->registerAndGetIdentifierForSeriesWithUnits(this->name(), this->units());
   }
 
-  points = this->record()->pointsInRange(this->name(), range);
+  points = this->record()->pointsInRange(*_handle, range);
   return points;
 }
 
@@ -146,28 +148,28 @@ Point TimeSeries::pointBefore(time_t time) {
   if (time == 0) {
     return Point();
   }
-  return this->record()->pointBefore(this->name(), time);
+  return this->record()->pointBefore(*_handle, time);
 }
 
 Point TimeSeries::pointAfter(time_t time) {
   if (time == 0) {
     return Point();
   }
-  return this->record()->pointAfter(this->name(), time);
+  return this->record()->pointAfter(*_handle, time);
 }
 
 Point TimeSeries::pointBefore(time_t time, WhereClause q) {
   if (time == 0) {
     return Point();
   }
-  return this->record()->pointBefore(this->name(), time, q);
+  return this->record()->pointBefore(*_handle, time, q);
 }
 
 Point TimeSeries::pointAfter(time_t time, WhereClause q) {
   if (time == 0) {
     return Point();
   }
-  return this->record()->pointAfter(this->name(), time, q);
+  return this->record()->pointAfter(*_handle, time, q);
 }
 
 Point TimeSeries::pointAtOrBefore(time_t time) {
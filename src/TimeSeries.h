@@ -137,6 +137,7 @@ namespace RTX {
   private:
     PointRecord::_sp _points;
     std::string _name, _userDescription;
+    SeriesHandle::_sp _handle; // interned _name, for record lookups
     Units _units;
     std::pair<time_t, time_t> _validTimeRange;
     time_t _expectedPeriod;
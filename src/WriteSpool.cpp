@@ -0,0 +1,310 @@
+#include "WriteSpool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <boost/filesystem.hpp>
+
+using namespace std;
+using namespace RTX;
+namespace fs = boost::filesystem;
+
+#define RTX_SPOOL_SEGMENT_BYTES (64 << 20)
+#define RTX_SPOOL_BATCH_POINTS 50000
+#define RTX_SPOOL_MAX_BACKOFF 60
+#define RTX_SPOOL_POINT_BYTES (sizeof(int64_t) + sizeof(double) + sizeof(uint8_t) + sizeof(double))
+
+static const string _spoolExtension(".spool");
+static const string _cursorFileName("cursor");
+
+// record layout: uint32 id length, uint32 point count, id bytes, then per point
+// int64 time, double value, uint8 quality, double confidence.
+
+WriteSpool::WriteSpool(const string& directory, size_t maxBytes, bool replay, sink_t sink) : _dir(directory), _maxBytes(maxBytes), _sink(sink) {
+  _stop = false;
+  _pending = 0;
+  this->recover(replay);
+  _drainer = thread(&WriteSpool::drainLoop, this);
+}
+
+WriteSpool::~WriteSpool() {
+  {
+    lock_guard<mutex> lock(_mtx);
+    _stop = true;
+  }
+  _cvPending.notify_all();
+  _cvSpace.notify_all();
+  if (_drainer.joinable()) {
+    _drainer.join();
+  }
+  _out.close();
+}
+
+string WriteSpool::segmentPath(int segment) {
+  char name[32];
+  snprintf(name, sizeof(name), "%08d", segment);
+  return (fs::path(_dir) / (name + _spoolExtension)).string();
+}
+
+void WriteSpool::recover(bool replay) {
+  boost::system::error_code ec;
+  fs::create_directories(_dir, ec);
+
+  vector<int> segments;
+  for (fs::directory_iterator it(_dir, ec), end; !ec && it != end; it.increment(ec)) {
+    const fs::path p = it->path();
+    if (p.extension().string() == _spoolExtension) {
+      try {
+        segments.push_back(stoi(p.stem().string()));
+      } catch (...) {
+        // not one of ours
+      }
+    }
+  }
+  sort(segments.begin(), segments.end());
+
+  const fs::path cursorPath = fs::path(_dir) / _cursorFileName;
+  if (!replay) {
+    for (int s : segments) {
+      fs::remove(segmentPath(s), ec);
+    }
+    segments.clear();
+    fs::remove(cursorPath, ec);
+  }
+
+  _readSegment = segments.empty() ? 0 : segments.front();
+  _readOffset = 0;
+  ifstream cursor(cursorPath.string());
+  int seg;
+  uint64_t off;
+  if (cursor >> seg >> off && seg >= _readSegment) {
+    _readSegment = seg;
+    _readOffset = off;
+  }
+
+  for (int s : segments) {
+    if (s >= _readSegment) {
+      _pending += fs::file_size(segmentPath(s), ec);
+    }
+  }
+  _pending -= min((size_t)_readOffset, _pending);
+  _firstSegment = segments.empty() ? _readSegment : segments.front();
+  this->removeDrainedSegments();
+
+  // always write into a fresh segment, so a torn tail from a crash is confined to a sealed one
+  const int last = segments.empty() ? _readSegment : max(segments.back(), _readSegment);
+  this->openSegment(last + 1);
+}
+
+void WriteSpool::openSegment(int segment) {
+  _out.close();
+  _writeSegment = segment;
+  _writeOffset = 0;
+  _out.open(segmentPath(segment), ios::binary | ios::out | ios::trunc);
+  if (!_out) {
+    cerr << "write spool: could not open " << segmentPath(segment) << endl;
+  }
+}
+
+void WriteSpool::saveCursor() {
+  const fs::path cursorPath = fs::path(_dir) / _cursorFileName;
+  const fs::path tmpPath = fs::path(_dir) / (_cursorFileName + ".tmp");
+  {
+    ofstream out(tmpPath.string(), ios::trunc);
+    out << _readSegment << " " << _readOffset << endl;
+  }
+  boost::system::error_code ec;
+  fs::rename(tmpPath, cursorPath, ec);
+}
+
+void WriteSpool::removeDrainedSegments() {
+  boost::system::error_code ec;
+  while (_firstSegment < _readSegment) {
+    fs::remove(segmentPath(_firstSegment), ec);
+    ++_firstSegment;
+  }
+}
+
+size_t WriteSpool::pendingBytes() {
+  lock_guard<mutex> lock(_mtx);
+  return _pending;
+}
+
+static void encodeRecord(string& buffer, const string& id, const Point* points, size_t count) {
+  const size_t start = buffer.size();
+  buffer.resize(start + 2 * sizeof(uint32_t) + id.size() + count * RTX_SPOOL_POINT_BYTES);
+  char *cursor = &buffer[start];
+  const uint32_t header[2] = {(uint32_t)id.size(), (uint32_t)count};
+  memcpy(cursor, header, sizeof(header)); cursor += sizeof(header);
+  memcpy(cursor, id.data(), id.size()); cursor += id.size();
+  for (size_t i = 0; i < count; ++i) {
+    const Point& p = points[i];
+    const int64_t t = p.time;
+    const uint8_t q = p.quality;
+    memcpy(cursor, &t, sizeof(t)); cursor += sizeof(t);
+    memcpy(cursor, &p.value, sizeof(double)); cursor += sizeof(double);
+    memcpy(cursor, &q, sizeof(q)); cursor += sizeof(q);
+    memcpy(cursor, &p.confidence, sizeof(double)); cursor += sizeof(double);
+  }
+}
+
+void WriteSpool::append(const string& id, const vector<Point>& points) {
+  if (points.size() == 0) {
+    return;
+  }
+  string record;
+  encodeRecord(record, id, points.data(), points.size());
+  this->write(record);
+}
+
+void WriteSpool::appendRows(const vector<pair<string, Point> >& rows) {
+  if (rows.size() == 0) {
+    return;
+  }
+  // a record per row, all in one write
+  string records;
+  records.reserve(rows.size() * (2 * sizeof(uint32_t) + rows.front().first.size() + RTX_SPOOL_POINT_BYTES));
+  for (const auto& row : rows) {
+    encodeRecord(records, row.first, &row.second, 1);
+  }
+  this->write(records);
+}
+
+void WriteSpool::write(const string& records) {
+  unique_lock<mutex> lock(_mtx);
+  // bounded: hold the producer until the drainer has made room. a single write larger than
+  // the limit is still accepted into an empty spool rather than blocking forever.
+  _cvSpace.wait(lock, [&]{ return _stop || _pending == 0 || _pending + records.size() <= _maxBytes; });
+  if (_writeOffset >= RTX_SPOOL_SEGMENT_BYTES) {
+    this->openSegment(_writeSegment + 1);
+  }
+  _out.write(records.data(), records.size());
+  _out.flush();
+  if (!_out) {
+    cerr << "write spool: could not append to " << segmentPath(_writeSegment) << endl;
+    _out.clear();
+    return;
+  }
+  _writeOffset += records.size();
+  _pending += records.size();
+  _cvPending.notify_one();
+}
+
+bool WriteSpool::waitForDrain(int seconds) {
+  unique_lock<mutex> lock(_mtx);
+  return _cvSpace.wait_for(lock, chrono::seconds(seconds), [&]{ return _pending == 0; });
+}
+
+size_t WriteSpool::readBatch(vector<Entry>& batch, int& segment, uint64_t& offset, int limitSegment, uint64_t limitOffset) {
+  size_t consumed = 0, nPoints = 0;
+  vector<char> payload;
+
+  while (nPoints < RTX_SPOOL_BATCH_POINTS) {
+    if (segment > limitSegment || (segment == limitSegment && offset >= limitOffset)) {
+      break;
+    }
+    const bool sealed = segment < limitSegment;
+    uint64_t end = limitOffset;
+    if (sealed) {
+      boost::system::error_code ec;
+      end = fs::file_size(segmentPath(segment), ec);
+      if (ec) {
+        end = 0;
+      }
+    }
+
+    ifstream in(segmentPath(segment), ios::binary);
+    in.seekg(offset);
+    while (nPoints < RTX_SPOOL_BATCH_POINTS && offset < end) {
+      uint32_t header[2];
+      uint64_t recordSize = 0;
+      if (end - offset >= sizeof(header) && in.read((char*)header, sizeof(header))) {
+        recordSize = sizeof(header) + header[0] + (uint64_t)header[1] * RTX_SPOOL_POINT_BYTES;
+      }
+      if (recordSize == 0 || offset + recordSize > end) {
+        // torn record at the end of a segment that was being written when the process stopped
+        consumed += end - offset;
+        offset = end;
+        break;
+      }
+      payload.resize(recordSize - sizeof(header));
+      in.read(payload.data(), payload.size());
+
+      Entry e;
+      const char *cursor = payload.data();
+      e.id.assign(cursor, header[0]); cursor += header[0];
+      e.points.reserve(header[1]);
+      for (uint32_t i = 0; i < header[1]; ++i) {
+        int64_t t;
+        double v, c;
+        uint8_t q;
+        memcpy(&t, cursor, sizeof(t)); cursor += sizeof(t);
+        memcpy(&v, cursor, sizeof(v)); cursor += sizeof(v);
+        memcpy(&q, cursor, sizeof(q)); cursor += sizeof(q);
+        memcpy(&c, cursor, sizeof(c)); cursor += sizeof(c);
+        e.points.push_back(Point((time_t)t, v, Point::PointQuality(q), c));
+      }
+      nPoints += e.points.size();
+      batch.push_back(std::move(e));
+      consumed += recordSize;
+      offset += recordSize;
+    }
+
+    if (sealed && offset >= end) {
+      ++segment;
+      offset = 0;
+    }
+    else {
+      break;
+    }
+  }
+  return consumed;
+}
+
+void WriteSpool::drainLoop() {
+  int backoff = 0; // seconds
+  while (true) {
+    int segment, limitSegment;
+    uint64_t offset, limitOffset;
+    {
+      unique_lock<mutex> lock(_mtx);
+      _cvPending.wait(lock, [&]{ return _stop || _pending > 0; });
+      if (_stop) {
+        return;
+      }
+      segment = _readSegment;
+      offset = _readOffset;
+      limitSegment = _writeSegment;
+      limitOffset = _writeOffset;
+    }
+
+    vector<Entry> batch;
+    size_t consumed = this->readBatch(batch, segment, offset, limitSegment, limitOffset);
+    bool delivered = true;
+    if (batch.size() > 0) {
+      try {
+        delivered = _sink(batch);
+      } catch (std::exception& e) {
+        cerr << "write spool: " << e.what() << endl;
+        delivered = false;
+      }
+    }
+
+    unique_lock<mutex> lock(_mtx);
+    if (!delivered) {
+      // the read position is unchanged, so the same batch is offered again after the wait
+      backoff = (backoff == 0) ? 1 : min(backoff * 2, RTX_SPOOL_MAX_BACKOFF);
+      _cvPending.wait_for(lock, chrono::seconds(backoff), [&]{ return _stop; });
+      continue;
+    }
+    backoff = 0;
+    _readSegment = segment;
+    _readOffset = offset;
+    // nothing readable behind the write position means the byte count drifted; resync it
+    _pending = (consumed == 0) ? 0 : _pending - min(consumed, _pending);
+    this->saveCursor();
+    this->removeDrainedSegments();
+    _cvSpace.notify_all();
+  }
+}
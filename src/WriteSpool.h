@@ -0,0 +1,66 @@
+#ifndef WriteSpool_hpp
+#define WriteSpool_hpp
+
+#include <stdio.h>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Point.h"
+
+// on-disk write-ahead log for database destinations. appends go to a local segment file
+// and return immediately; a background thread drains entries to a sink in batches,
+// retrying with backoff while the sink is failing. the read position is persisted, so
+// entries that were not yet delivered are replayed when the spool is reopened.
+
+namespace RTX {
+  class WriteSpool {
+  public:
+    class Entry {
+    public:
+      std::string id;
+      std::vector<Point> points;
+    };
+    typedef std::function<bool(const std::vector<Entry>& batch)> sink_t; // return false to retry the batch later
+
+    WriteSpool(const std::string& directory, size_t maxBytes, bool replay, sink_t sink);
+    ~WriteSpool(); // stops the drainer. undelivered entries stay on disk.
+
+    void append(const std::string& id, const std::vector<Point>& points); // blocks while the spool is full
+    void appendRows(const std::vector<std::pair<std::string, Point> >& rows); // one point each for many series
+    bool waitForDrain(int seconds); // true if everything appended so far has been delivered
+
+    size_t pendingBytes();
+    size_t maxBytes() {return _maxBytes;};
+    const std::string& directory() {return _dir;};
+
+  private:
+    std::string _dir;
+    size_t _maxBytes;
+    sink_t _sink;
+
+    std::mutex _mtx;
+    std::condition_variable _cvPending, _cvSpace;
+    std::ofstream _out;
+    int _writeSegment, _readSegment, _firstSegment;
+    uint64_t _writeOffset, _readOffset;
+    size_t _pending;
+    bool _stop;
+    std::thread _drainer;
+
+    void recover(bool replay);
+    void openSegment(int segment);
+    void write(const std::string& records);
+    void saveCursor();
+    void removeDrainedSegments();
+    void drainLoop();
+    size_t readBatch(std::vector<Entry>& batch, int& segment, uint64_t& offset, int limitSegment, uint64_t limitOffset);
+    std::string segmentPath(int segment);
+  };
+}
+
+#endif /* WriteSpool_hpp */
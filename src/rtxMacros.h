@@ -49,6 +49,10 @@ namespace RTX {
 #define RTX_BUFFER_DEFAULT_CACHESIZE 100
 #endif
 
+#ifndef RTX_BUFFER_PREFETCH_LIMIT
+#define RTX_BUFFER_PREFETCH_LIMIT 100000
+#endif
+
 
 #ifdef DEBUG
 #define DebugLog std::cout
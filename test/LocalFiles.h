@@ -0,0 +1,30 @@
+//
+//  LocalFiles.h
+//  rtx-tests
+//
+//  files and directories that a test writes to the working directory, removed before and after it.
+//
+
+#ifndef LocalFiles_h
+#define LocalFiles_h
+
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+// declare it before the records and models that use the files, so that they close first.
+class LocalFiles {
+public:
+  LocalFiles(const std::vector<std::string>& paths) : _paths(paths) { this->remove(); };
+  ~LocalFiles() { this->remove(); };
+private:
+  std::vector<std::string> _paths;
+  void remove() {
+    boost::system::error_code ec;
+    for (const std::string& path : _paths) {
+      boost::filesystem::remove_all(path, ec);
+    }
+  };
+};
+
+#endif /* LocalFiles_h */
@@ -0,0 +1,198 @@
+//
+//  TestAdapter.h
+//  rtx-tests
+//
+//  in-memory database adapter, for exercising DbPointRecord paths that no local backend takes.
+//
+
+#ifndef TestAdapter_h
+#define TestAdapter_h
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "DbAdapter.h"
+#include "DbPointRecord.h"
+
+class TestAdapter : public RTX::DbAdapter {
+public:
+  TestAdapter(errCallback_t cb) : DbAdapter(cb) {
+    _connected = false;
+    opts.supportsUnitsColumn = true;
+    opts.canAssignUnits = true;
+    opts.searchIteratively = false;
+    opts.supportsSinglyBoundQuery = true;
+    opts.implementationReadonly = false;
+    opts.canDoWideQuery = true;
+    chunkSize = 0;
+    nRangeQueries = 0;
+    nUnsubscribes = 0;
+    nRowInserts = 0;
+    failWrites = false;
+    _writeFailed = false;
+  };
+
+  adapterOptions opts;
+  size_t chunkSize; // wide query results are delivered in chunks of this many points per series. 0 is one chunk
+  std::map<std::string, std::vector<RTX::Point> > series;
+  std::atomic<int> nRangeQueries;
+  std::atomic<int> nUnsubscribes;
+  std::atomic<int> nRowInserts;
+  pointsCallback_t subscriber; // pushes samples to a subscribed record
+  std::atomic<bool> failWrites; // inserts are lost, and reported only by confirmWrites, as a remote sink would
+
+  const adapterOptions options() const { return opts; };
+  std::string connectionString() { return _conn; };
+  void setConnectionString(const std::string& con) { _conn = con; };
+  void doConnect() { _connected = true; };
+
+  RTX::IdentifierUnitsList idUnitsList() {
+    RTX::IdentifierUnitsList ids;
+    for (auto& s : series) {
+      ids.set(s.first, RTX_DIMENSIONLESS);
+    }
+    return ids;
+  };
+
+  void beginTransaction() { };
+  void endTransaction() { };
+
+  std::map<std::string, std::vector<RTX::Point> > wideQuery(RTX::TimeRange range) {
+    std::map<std::string, std::vector<RTX::Point> > out;
+    for (auto& s : series) {
+      out[s.first] = this->pointsIn(s.first, range);
+    }
+    return out;
+  };
+
+  void wideQueryChunked(RTX::TimeRange range, pointsCallback_t cb) {
+    // chunks of all series are interleaved, as a streamed response would be
+    auto all = this->wideQuery(range);
+    bool more = true;
+    for (size_t offset = 0; more; offset += chunkSize) {
+      more = false;
+      for (auto& res : all) {
+        if (offset >= res.second.size()) {
+          continue;
+        }
+        size_t n = chunkSize == 0 ? res.second.size() : std::min(chunkSize, res.second.size() - offset);
+        std::vector<RTX::Point> chunk(res.second.begin() + offset, res.second.begin() + offset + n);
+        cb(res.first, chunk);
+        more = more || (chunkSize > 0 && offset + n < res.second.size());
+      }
+    }
+  };
+
+  std::vector<RTX::Point> selectRange(const std::string& id, RTX::TimeRange range) {
+    ++nRangeQueries;
+    return this->pointsIn(id, range);
+  };
+
+  // backends without singly bound queries resolve these empty, as PI and ODBC do
+  RTX::Point selectNext(const std::string& id, time_t time, RTX::WhereClause q = RTX::WhereClause()) {
+    if (!opts.supportsSinglyBoundQuery) {
+      return RTX::Point();
+    }
+    for (const RTX::Point& p : series[id]) {
+      if (p.time > time) {
+        return p;
+      }
+    }
+    return RTX::Point();
+  };
+  RTX::Point selectPrevious(const std::string& id, time_t time, RTX::WhereClause q = RTX::WhereClause()) {
+    if (!opts.supportsSinglyBoundQuery) {
+      return RTX::Point();
+    }
+    const std::vector<RTX::Point>& points = series[id];
+    for (auto it = points.rbegin(); it != points.rend(); ++it) {
+      if (it->time < time) {
+        return *it;
+      }
+    }
+    return RTX::Point();
+  };
+
+  bool subscribe(const std::vector<std::string>& ids, pointsCallback_t cb) {
+    subscriber = cb;
+    return true;
+  };
+  void unsubscribe() {
+    subscriber = pointsCallback_t();
+    ++nUnsubscribes;
+  };
+
+  bool insertIdentifierAndUnits(const std::string& id, RTX::Units units) {
+    series[id];
+    return true;
+  };
+  void insertSingle(const std::string& id, RTX::Point point) {
+    if (this->writeLost()) {
+      return;
+    }
+    series[id].push_back(point);
+  };
+  void insertRange(const std::string& id, std::vector<RTX::Point> points) {
+    if (this->writeLost()) {
+      return;
+    }
+    series[id].insert(series[id].end(), points.begin(), points.end());
+  };
+  void insertRows(const std::vector<std::pair<std::string, RTX::Point> >& rows) {
+    ++nRowInserts;
+    for (const auto& row : rows) {
+      this->insertSingle(row.first, row.second);
+    }
+  };
+  bool confirmWrites() {
+    return !_writeFailed.exchange(false);
+  };
+  bool assignUnitsToRecord(const std::string& name, const RTX::Units& units) { return true; };
+  void removeRecord(const std::string& id) { series.erase(id); };
+  void removeAllRecords() { series.clear(); };
+
+private:
+  std::string _conn;
+  std::atomic<bool> _writeFailed;
+
+  bool writeLost() {
+    if (failWrites) {
+      _writeFailed = true;
+    }
+    return failWrites;
+  };
+
+  std::vector<RTX::Point> pointsIn(const std::string& id, RTX::TimeRange range) {
+    std::vector<RTX::Point> out;
+    auto s = series.find(id);
+    if (s == series.end()) {
+      return out;
+    }
+    for (const RTX::Point& p : s->second) {
+      if (p.time >= range.start && p.time <= range.end) {
+        out.push_back(p);
+      }
+    }
+    return out;
+  };
+};
+
+
+class TestPointRecord : public RTX::DbPointRecord {
+public:
+  typedef std::shared_ptr<TestPointRecord> _sp;
+  TestPointRecord() {
+    _adapter = new TestAdapter(_errCB);
+  };
+  ~TestPointRecord() {
+    this->disableWriteSpool();
+    delete _adapter;
+  };
+  TestAdapter& adapter() { return *(TestAdapter*)_adapter; };
+};
+
+
+#endif /* TestAdapter_h */
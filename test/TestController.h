@@ -14,6 +14,7 @@
 #include "oatpp/core/macro/codegen.hpp"
 #include "oatpp/core/Types.hpp"
 #include <sstream>
+#include <regex>
 #include OATPP_CODEGEN_BEGIN(DTO)
 
 /**
@@ -82,10 +83,71 @@ public:
     } else if(q.compare("show%20series") == 0 ){
       results = "{\"results\":[{\"statement_id\":0,\"series\":[{\"columns\":[\"key\"],\"values\":[[\"Cluster1.WTR_CrkerSprgs_PRV_DisPres_P,units=psi\"],[\"Cluster1.WTR_DryCreekRd_PRV_DisPres_P,units=psi\"],[\"Cluster1.WTR_DryForkRd_PRV_DisPres_P,units=psi\"],[\"Cluster1.WTR_EatonCrkRd_PRV_DisPres_P,units=psi\"],[\"concentration,tag=Cluster1.WTR_38thAve_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_8thAve_CHM_CL2ResHach_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_8thAve_CHM_CL2ResProm_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_Airport_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_BatteryLn_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_BenAllen_RES_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_BkChBsPrk_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_BkChPk_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_BluBeryHil_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_Bonnafield_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_Bordeaux_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_BrntHghlnd_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_Brookmont_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_BullRun_RES_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_CaneRidge_RES_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_CentFarms_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_ClfdlKnbhl_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_EstesRd_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_Fairmd_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_GenelleDr_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_GranyWhite_RES_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_GranyWhite_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_HardingPl_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_HarpthTrce_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_Hillview_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_Hillwood_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_HilsborPrk_RES_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_HilwoodPrk_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_HndRn_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_HuntCanRdg_WPS_CR_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_HuntCanRdg_WPS_HR_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_IntrchgCty_RES_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_JclynHolow_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_Joelton_RES_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_Kinhawk_RES_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_KrHaringtn_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_LaurelRidg_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_LoveCircle_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_MillsRd_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_NrthmbrLnd_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_Oakhill_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_Oakwood_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_Ocala_RES_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_OldHickory_RES_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_OldHickory_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_Omohundro_WPS_CL2ResEast_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_Omohundro_WPS_CL2ResWest_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_Otterwood_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_PorterRd_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_PowellAve_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_RiceRoad_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_RollFork_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_Rxborough2_RES_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_Rxborough_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_Shepardwod_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_SherwdFrst_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_Southerland_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_Stanford_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_SwissAve_RES_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_TmpsonLane_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_Treemont_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_TrntyHlApt_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_TyneValEst_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_UnionHill_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_Villacrest_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_VirginaAve_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_WarnerPark_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_WhitesCrk_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_WstMeadEst_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_WstMeadFrm_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_WstMeadHls_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_WstMeadPrk_WPS_CL2Res_P,units=mg/L\"],[\"concentration,tag=Cluster1.WTR_WvrlyBlmnt_WPS_CL2Res_P,units=mg/L\"],[\"flow,tag=Cluster1.WTR_38thAve_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_Airport_PRV_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_Airport_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_BatteryLn_HardingPl_WPS_FlwSum_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_BatteryLn_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_BkChBsPrk_WPS_FlwSum_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_BkChBsPrk_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_BkChPk_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_BluBeryHil_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_Bonnafield_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_Bordeaux_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_Brentwood_FLW_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_BrntHghlnd_RES_DmdFlw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_BrntHghlnd_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_Brookmont_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_CaneRidge_RES_DmdFlw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_CentFarms_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_ClfdlKnbhl_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_EstesRd_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_Fairmd_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_GenelleDr_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_GranyWhite_RES_DmdFlw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_GranyWhite_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_HardingPl_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_HarpthTrce_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_Hillview_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_Hillwood_WPS_FlwSum_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_Hillwood_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_HilwoodPrk_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_HndRn_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_HuntCanRdg_RES_DmdFlw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_HuntCanRdg_WPS_CR_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_HuntCanRdg_WPS_FlwSum_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_HuntCanRdg_WPS_HR_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_JclynHolow_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_KrHaringtn_WPS_FinFlw1_P,units=mgd\"],[\"flow,tag=Cluster1.WTR_KrHaringtn_WPS_FinFlw2_P,units=mgd\"],[\"flow,tag=Cluster1.WTR_KrHaringtn_WPS_Flw_P,units=mgd\"],[\"flow,tag=Cluster1.WTR_LaurelRidg_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_LoveCircle_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_MillsRd_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_NrthmbrLnd_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_Oakhill_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_Oakwood_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_OldHickory_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_Oman_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_Omohundro_WPS_BWFlw1_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_Omohundro_WPS_FinFlw1_P,units=mgd\"],[\"flow,tag=Cluster1.WTR_Omohundro_WPS_FinFlw2_P,units=mgd\"],[\"flow,tag=Cluster1.WTR_Omohundro_WPS_Flw_P,units=mgd\"],[\"flow,tag=Cluster1.WTR_Otterwood_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_PorterRd_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_PowellAve_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_RiceRoad_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_RollFork_RES_DmdFlw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_RollFork_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_Rxborough_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_Shepardwod_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_SherwdFrst_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_Southerland_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_Stanford_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_ThorntonGrv_PRV_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_TmpsonLane_EstesRd_WPS_FlwSum_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_TmpsonLane_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_Treemont_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_TrntyHlApt_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_TyneValEst_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_UnionHill_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_Villacrest_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_VirginaAve_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_WarnerPark_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_WhitesCrk_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_WstMeadEst_RES_DmdFlw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_WstMeadEst_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_WstMeadFrm_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_WstMeadHls_RES_DmdFlw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_WstMeadHls_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_WstMeadPrk_WPS_Flw_P,units=gpm\"],[\"flow,tag=Cluster1.WTR_WvrlyBlmnt_WPS_Flw_P,units=gpm\"],[\"level,tag=Cluster1.WTR_38thAve_WPS_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_8thAve_RES_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_8thAve_RES_Res2Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_BenAllen_RES_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_BkChBsPrk_RES_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_Bordeaux_RES_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_BrntHghlnd_RES_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_BullRun_RES_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_CaneRidge_RES_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_GranyWhite_RES_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_HarpthTrce_WPS_WP_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_HilsborPrk_RES_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_IntrchgCty_RES_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_Joelton_RES_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_Kinhawk_RES_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_KrHaringtn_WPS_ClrWl1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_KrHaringtn_WPS_ClrWl2Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_LaurelRidg_WPS_TVE_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_LoveCircle_RES_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_MillsRd_RES_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_NrthmbrLnd_WPS_HGP_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_Oakhill2_RES_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_Oakhill_WPS_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_Ocala_RES_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_OldHickory_RES_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_Omohundro_WPS_BWRes1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_Omohundro_WPS_ClrWl1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_Omohundro_WPS_ClrWl2Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_Omohundro_WPS_ClrWl3Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_Omohundro_WPS_ClrWl4Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_RiceRoad_WPS_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_RollFork_RES_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_Rxborough2_RES_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_SwissAve_RES_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_TrinityLne_RES_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_UnionHill_WPS_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_WhitesCrk_RES_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_WstMeadEst_RES_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_WstMeadHls_RES_Res1Lvl_P,units=ft\"],[\"level,tag=Cluster1.WTR_WstMeadPrk_RES_Res1Lvl_P,units=ft\"],[\"ph,tag=Cluster1.WTR_PowellAve_WPS_H2OPH_P,units=dimensionless\"],[\"position,tag=Cluster1.WTR_8thAve_RES_EfVPos_P,units=%\"],[\"position,tag=Cluster1.WTR_8thAve_RES_IVPos_P,units=%\"],[\"position,tag=Cluster1.WTR_Oakhill_WPS_VPos_P,units=%\"],[\"pressure,tag=Cluster1.WTR_38thAve_WPS_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_38thAve_WPS_MainPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_38thAve_WPS_SucPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_Airport_PRV_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_Airport_PRV_InPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_Airport_WPS_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_Airport_WPS_SucPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_AmalieDr_PRV_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_BarnesRd_PRV_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_BatteryLn_WPS_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_BatteryLn_WPS_SucPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_BellRd_PRV_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_BenAllen_RES_MainPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_BkChBsPrk_WPS_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_BkChBsPrk_WPS_SucPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_BkChPk_WPS_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_BkChPk_WPS_SucPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_BluBeryHil_WPS_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_BluBeryHil_WPS_SucPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_Bonnafield_WPS_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_Bonnafield_WPS_SucPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_Bordeaux_WPS_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_Bordeaux_WPS_SucPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_BriarvleRd_PRV_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_BriarvleRd_PRV_InPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_BrileyPkwy_PRV_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_BrntHghlnd_WPS_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_BrntHghlnd_WPS_SucPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_BrntwoodSq_PRV_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_Brookmont_WPS_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_Brookmont_WPS_SucPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_BullRun_RES_MainPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_CampbellRd_PRV_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_CaneRidge_PRV_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_CaneRidge_PRV_InPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_CentFarms_WPS_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_CentFarms_WPS_SucPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_ChsapeakDr_PRV_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_ClfdlKnbhl_WPS_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_ClfdlKnbhl_WPS_SucPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_CloverGlen_PRV_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_CloverGlen_PRV_InPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_EstesRd_WPS_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_EstesRd_WPS_SucPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_Fairmd_WPS_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_Fairmd_WPS_SucPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_GenelleDr_WPS_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_GenelleDr_WPS_SucPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_GranyWhite_RES_MainPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_GranyWhite_WPS_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_GranyWhite_WPS_SucPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_HardingPl_WPS_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_HardingPl_WPS_SucPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_HarpthTrce_WPS_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_HarpthTrce_WPS_SucPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_HearthtnLn_PRV_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_Hillview_WPS_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_Hillview_WPS_SucPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_Hillwood_WPS_DisPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_Hillwood_WPS_SucPres_P,units=psi\"],[\"pressure,tag=Cluster1.WTR_HilsborPrk_RES_MainPres_P,units=psi\"],[\"speed,tag=Cluster1.WTR_Hillwood_WPS_Pmp_SPEED,units=%\"],[\"speed,tag=Cluster1.WTR_HilwoodPrk_WPS_Pmp_SPEED,units=%\"],[\"speed,tag=Cluster1.WTR_HndRn_WPS_Pmp_SPEED,units=%\"],[\"speed,tag=Cluster1.WTR_HuntCanRdg_WPS_CR_Pmp_SPEED,units=%\"],[\"speed,tag=Cluster1.WTR_HuntCanRdg_WPS_HR_Pmp_SPEED,units=%\"],[\"speed,tag=Cluster1.WTR_JclynHolow_WPS_Pmp_SPEED,units=%\"],[\"speed,tag=Cluster1.WTR_KrHaringtn_WPS_Pmp1HS_Speed,units=%\"],[\"speed,tag=Cluster1.WTR_KrHaringtn_WPS_Pmp2HS_Speed,units=%\"],[\"speed,tag=Cluster1.WTR_KrHaringtn_WPS_Pmp3HS_Speed,units=%\"],[\"speed,tag=Cluster1.WTR_KrHaringtn_WPS_Pmp4HS_Speed,units=%\"],[\"speed,tag=Cluster1.WTR_KrHaringtn_WPS_Pmp_SPEED,units=%\"],[\"speed,tag=Cluster1.WTR_LaurelRidg_WPS_Pmp_SPEED,units=%\"],[\"speed,tag=Cluster1.WTR_LoveCircle_WPS_Pmp_SPEED,units=%\"],[\"speed,tag=Cluster1.WTR_MillsRd_WPS_Pmp_SPEED,units=%\"],[\"speed,tag=Cluster1.WTR_NrthmbrLnd_WPS_Pmp_SPEED,units=%\"],[\"speed,tag=Cluster1.WTR_Oakhill_WPS_Pmp_SPEED,units=%\"],[\"speed,tag=Cluster1.WTR_Oakwood_WPS_Pmp_SPEED,units=%\"],[\"speed,tag=Cluster1.WTR_OldHickory_WPS_Pmp_SPEED,units=%\"],[\"speed,tag=Cluster1.WTR_WvrlyBlmnt_WPS_Pmp_SPEED,units=%\"],[\"status,tag=Cluster1.WTR_38thAve_WPS_Gen_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_38thAve_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_38thAve_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_38thAve_WPS_Pmp3_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_38thAve_WPS_Pmp4_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_38thAve_WPS_RES_V1_OP,units=dimensionless\"],[\"status,tag=Cluster1.WTR_38thAve_WPS_RES_V1_STATVLV,units=dimensionless\"],[\"status,tag=Cluster1.WTR_8thAve_RES_EstCPmp_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_8thAve_RES_EstUPmp_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Airport_WPS_Gen_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Airport_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Airport_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Airport_WPS_Pmp3_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Airport_WPS_Pmp4_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Airport_WPS_SurgV_OP,units=dimensionless\"],[\"status,tag=Cluster1.WTR_AshlandCtyHw_VLV_V1_OP,units=dimensionless\"],[\"status,tag=Cluster1.WTR_AshlandCtyHw_VLV_V1_STATVLV,units=dimensionless\"],[\"status,tag=Cluster1.WTR_BatteryLn_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_BatteryLn_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_BatteryLn_WPS_Pmp3_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_BatteryLn_WPS_Pmp4_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_BenAllen_RES_V1_OP,units=dimensionless\"],[\"status,tag=Cluster1.WTR_BenAllen_RES_V1_STATVLV,units=dimensionless\"],[\"status,tag=Cluster1.WTR_BkChBsPrk_RES_V1_OP,units=dimensionless\"],[\"status,tag=Cluster1.WTR_BkChBsPrk_RES_V1_STATVLV,units=dimensionless\"],[\"status,tag=Cluster1.WTR_BkChBsPrk_WPS_Gen_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_BkChBsPrk_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_BkChBsPrk_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_BkChPk_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_BkChPk_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_BkChPk_WPS_Pmp3_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_BluBeryHil_WPS_Gen_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_BluBeryHil_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_BluBeryHil_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Bonnafield_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Bordeaux_RES_V1_OP,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Bordeaux_RES_V1_STATVLV,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Bordeaux_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Bordeaux_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Bordeaux_WPS_Pmp3_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_BrntHghlnd_RES_V1_OP,units=dimensionless\"],[\"status,tag=Cluster1.WTR_BrntHghlnd_RES_V1_STATVLV,units=dimensionless\"],[\"status,tag=Cluster1.WTR_BrntHghlnd_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_BrntHghlnd_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Brookmont_WPS_Gen_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Brookmont_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Brookmont_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Brookmont_WPS_Pmp3_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_BullRun_RES_V1_OP,units=dimensionless\"],[\"status,tag=Cluster1.WTR_BullRun_RES_V1_STATVLV,units=dimensionless\"],[\"status,tag=Cluster1.WTR_CaneRidge_RES_V1_OP,units=dimensionless\"],[\"status,tag=Cluster1.WTR_CaneRidge_RES_V1_STATVLV,units=dimensionless\"],[\"status,tag=Cluster1.WTR_CentFarms_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_CentFarms_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_CentFarms_WPS_Pmp3_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_CentFarms_WPS_Pmp4_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_ClfdlKnbhl_WPS_Gen_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_ClfdlKnbhl_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_ClfdlKnbhl_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_EstesRd_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_EstesRd_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Fairmd_WPS_Gen_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Fairmd_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Fairmd_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Fairmd_WPS_Pmp3_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_GenelleDr_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_GranyWhite_RES_V1_OP,units=dimensionless\"],[\"status,tag=Cluster1.WTR_GranyWhite_RES_V1_STATVLV,units=dimensionless\"],[\"status,tag=Cluster1.WTR_GranyWhite_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_GranyWhite_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_GranyWhite_WPS_Pmp3_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_GranyWhite_WPS_Pmp4_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_HardingPl_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_HardingPl_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_HardingPl_WPS_Pmp3_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_HarpthTrce_WPS_Gen_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_HarpthTrce_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_HarpthTrce_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_HarpthTrce_WPS_Pmp3_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_HarpthTrce_WPS_RES_V1_OP,units=dimensionless\"],[\"status,tag=Cluster1.WTR_HarpthTrce_WPS_RES_V1_STATVLV,units=dimensionless\"],[\"status,tag=Cluster1.WTR_HillsborRd_VLV_V1_OP,units=dimensionless\"],[\"status,tag=Cluster1.WTR_HillsborRd_VLV_V1_STATVLV,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Hillview_WPS_Gen_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Hillview_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Hillview_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Hillwood_WPS_Gen_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Hillwood_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Hillwood_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Hillwood_WPS_Pmp3_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_HilsborPrk_RES_V1_OP,units=dimensionless\"],[\"status,tag=Cluster1.WTR_HilsborPrk_RES_V1_STATVLV,units=dimensionless\"],[\"status,tag=Cluster1.WTR_HilwoodPrk_WPS_Gen_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_HilwoodPrk_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_HilwoodPrk_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_HndRn_WPS_Gen_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_HndRn_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_HndRn_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_HuntCanRdg_WPS_CR_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_HuntCanRdg_WPS_CR_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_HuntCanRdg_WPS_Gen_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_HuntCanRdg_WPS_HR_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Shepardwod_WPS_Pmp3_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_SherwdFrst_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_SherwdFrst_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_SherwdFrst_WPS_Pmp3_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Southerland_WPS_Gen_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Southerland_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Southerland_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Southerland_WPS_Pmp3_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Stanford_WPS_Gen_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Stanford_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Stanford_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_SwissAve_RES_V1_OP,units=dimensionless\"],[\"status,tag=Cluster1.WTR_SwissAve_RES_V1_STATVLV,units=dimensionless\"],[\"status,tag=Cluster1.WTR_TmpsonLane_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_TmpsonLane_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_TmpsonLane_WPS_Pmp3_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_TmpsonLane_WPS_Pmp4_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_TmpsonLane_WPS_SurgeVlv_OP,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Treemont_WPS_Gen_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Treemont_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Treemont_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Treemont_WPS_Pmp3_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_TrinityLne_RES_V1_OP,units=dimensionless\"],[\"status,tag=Cluster1.WTR_TrinityLne_RES_V1_STATVLV,units=dimensionless\"],[\"status,tag=Cluster1.WTR_TrntyHlApt_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_TrntyHlApt_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_TyneValEst_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_TyneValEst_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_UnionHill_WPS_Gen_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_UnionHill_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_UnionHill_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_UnionHill_WPS_Pmp3_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Villacrest_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Villacrest_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_Villacrest_WPS_Pmp3_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_VirginaAve_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_VirginaAve_WPS_Pmp2_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_VirginaAve_WPS_Pmp3_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_WarnerPark_WPS_Pmp1_RUN,units=dimensionless\"],[\"status,tag=Cluster1.WTR_WarnerPark_WPS_Pmp2_RUN,units=dimensionless\"],[\"temperature,tag=Cluster1.WTR_PowellAve_WPS_H2OTEMP_P,units=farenheit\"]]}]}]}";
 
+    } else if(q.find("SELECT%20") == 0){
+      results = selectResults(urlDecode(q));
     }
     return createResponse(Status::CODE_200, results);
   }
   
+  /**
+   * Stand-in for range queries: each ';'-separated SELECT gets one hour of minutely points,
+   * named by its FROM clause. as with influx, tags are returned only for a GROUP BY * statement,
+   * and are taken from its WHERE clause.
+   */
+  static std::string selectResults(const std::string& query) {
+    std::stringstream ss;
+    std::regex fromReg("FROM \"([^\"]+)\"");
+    std::regex tagReg("\"([^\"]+)\"='([^']*)'");
+    std::regex startReg("time >= (\\d+)s");
+    std::smatch m;
+    ss << "{\"results\":[";
+    size_t iStatement = 0, pos = 0;
+    while (pos != std::string::npos) {
+      size_t next = query.find(';', pos);
+      std::string stmt = query.substr(pos, (next == std::string::npos) ? std::string::npos : next - pos);
+      pos = (next == std::string::npos) ? next : next + 1;
+      if (iStatement > 0) {
+        ss << ",";
+      }
+      ss << "{\"statement_id\":" << iStatement++;
+      if (std::regex_search(stmt, m, fromReg)) {
+        ss << ",\"series\":[{\"name\":\"" << m[1] << "\"";
+        if (stmt.find("GROUP BY *") != std::string::npos) {
+          ss << ",\"tags\":{";
+          bool first = true;
+          for (auto it = std::sregex_iterator(stmt.begin(), stmt.end(), tagReg); it != std::sregex_iterator(); ++it) {
+            ss << (first ? "" : ",") << "\"" << (*it)[1] << "\":\"" << (*it)[2] << "\"";
+            first = false;
+          }
+          ss << "}";
+        }
+        long start = std::regex_search(stmt, m, startReg) ? std::stol(m[1]) : 0;
+        ss << ",\"columns\":[\"time\",\"value\",\"quality\",\"confidence\"],\"values\":[";
+        for (int i = 0; i < 60; ++i) {
+          ss << (i > 0 ? "," : "") << "[" << (start + 60 * i) << "," << (i * 0.5) << ",192,0]";
+        }
+        ss << "]}]";
+      }
+      ss << "}";
+    }
+    ss << "]}";
+    return ss.str();
+  }
+  
+  static std::string urlDecode(const std::string& str) {
+    std::string out;
+    for (size_t i = 0; i < str.length(); ++i) {
+      if (str[i] == '%' && i + 2 < str.length()) {
+        out += (char)std::stoi(str.substr(i + 1, 2), nullptr, 16);
+        i += 2;
+      }
+      else {
+        out += str[i];
+      }
+    }
+    return out;
+  }
+  
 };
 
 #include OATPP_CODEGEN_END(ApiController) ///End Codegen
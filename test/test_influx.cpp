@@ -148,5 +148,57 @@ BOOST_AUTO_TEST_CASE(influx_id_list){
   /* wait all server threads finished */
   std::this_thread::sleep_for(std::chrono::seconds(1));
   
+}
+BOOST_AUTO_TEST_CASE(influx_multi_series_read){
+  /* Register test components */
+  Components component;
+
+  /* Create client-server test runner */
+  oatpp::test::web::ClientServerTestRunner runner;
+
+  /* Add TestController endpoints to the router of the test server */
+  runner.addController(std::make_shared<TestController>());
+
+  /* Run test */
+  runner.run([this, &runner] {
+    OATPP_COMPONENT(std::shared_ptr<oatpp::network::ClientConnectionProvider>, clientConnectionProvider);
+    OATPP_COMPONENT(std::shared_ptr<oatpp::data::mapping::ObjectMapper>, objectMapper);
+    auto requestExecutor = oatpp::web::client::HttpRequestExecutor::createShared(clientConnectionProvider);
+    auto client = InfluxClient::createShared(requestExecutor, objectMapper);
+
+    auto _errCB = [&](const std::string& msg)->void {
+      string errorMessage = msg;
+    };
+    InfluxTcpAdapter adapter(_errCB, client);
+    auto list = adapter.idUnitsList();
+    vector<string> ids;
+    for (auto idUnits : *list.get()) {
+      ids.push_back(idUnits.first);
+    }
+    BOOST_REQUIRE_GT(ids.size(), 0);
+    
+    const TimeRange range(3600, 7200);
+    
+    // packed and concurrent, against one request per series
+    auto fetch = adapter.selectRanges(ids, range);
+    BOOST_CHECK_EQUAL(fetch.size(), ids.size());
+    for (auto id : ids) {
+      const vector<Point> expected = adapter.selectRange(id, range);
+      BOOST_CHECK_MESSAGE(expected.size() > 0, "no points for " + id);
+      BOOST_REQUIRE_MESSAGE(fetch.count(id) == 1, "no result for " + id);
+      const vector<Point>& actual = fetch.at(id);
+      BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+      for (size_t i = 0; i < expected.size(); ++i) {
+        BOOST_CHECK_EQUAL(actual[i].time, expected[i].time);
+        BOOST_CHECK_EQUAL(actual[i].value, expected[i].value);
+        BOOST_CHECK_EQUAL(actual[i].quality, expected[i].quality);
+      }
+    }
+
+  }, std::chrono::minutes(2) /* test timeout */);
+
+  /* wait all server threads finished */
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+  
 }
 BOOST_AUTO_TEST_SUITE_END()
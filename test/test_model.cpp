@@ -0,0 +1,405 @@
+#include "test_main.h"
+#include "LocalFiles.h"
+#include "TestAdapter.h"
+
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <set>
+
+#include "BufferPointRecord.h"
+#include "EpanetModel.h"
+#include "ModelEnsemble.h"
+#include "ModelSnapshot.h"
+#include "ParallelRetrospective.h"
+
+using namespace RTX;
+using namespace std;
+
+// a reservoir pumping into a small loop-free network with a tank, a valve and a demand pattern
+static string writeNetwork(const string& path) {
+  ofstream inp(path, ios::trunc);
+  inp <<
+  "[TITLE]\n"
+  "rtx test network\n"
+  "[JUNCTIONS]\n"
+  " J0 10 0\n"
+  " J1 50 0\n"
+  " J2 40 100 PAT1\n"
+  " J3 40 50 PAT1\n"
+  "[RESERVOIRS]\n"
+  " R1 100\n"
+  "[TANKS]\n"
+  " T1 60 10 0 20 50 0\n"
+  "[PIPES]\n"
+  " P1 J0 J1 1000 12 100 0 Open\n"
+  " P2 J1 J2 1000 8 100 0 Open\n"
+  " P3 J3 T1 500 8 100 0 Open\n"
+  "[PUMPS]\n"
+  " PU1 R1 J0 HEAD C1\n"
+  "[VALVES]\n"
+  " V1 J2 J3 8 TCV 5 0\n"
+  "[PATTERNS]\n"
+  " PAT1 1.0 1.2 1.4 1.2 1.0 0.8\n"
+  "[CURVES]\n"
+  " C1 500 80\n"
+  "[TIMES]\n"
+  " Duration 24:00\n"
+  " Hydraulic Timestep 1:00\n"
+  " Pattern Timestep 1:00\n"
+  " Report Timestep 1:00\n"
+  "[OPTIONS]\n"
+  " Units GPM\n"
+  " Headloss H-W\n"
+  "[END]\n";
+  return path;
+}
+
+static const time_t modelStart = 1514764800; // 2018-01-01
+
+// flow measures on the pump and on P2 split the network into DMAs
+static void measureFlows(Model& model) {
+  for (const string name : {"PU1", "P2"}) {
+    Pipe::_sp p = dynamic_pointer_cast<Pipe>(model.linkWithName(name));
+    BOOST_REQUIRE(p);
+    TimeSeries::_sp flow(new TimeSeries);
+    flow->setName("flow,asset=" + name);
+    flow->setUnits(RTX_GALLON_PER_MINUTE);
+    p->setFlowMeasure(flow);
+  }
+}
+
+static set<string> dmaHashes(Model& model) {
+  set<string> hashes;
+  for (Dma::_sp dma : model.dmas()) {
+    hashes.insert(dma->hashedName);
+  }
+  return hashes;
+}
+
+// every element's states go to `record`
+static void recordStates(Model& model, PointRecord::_sp record) {
+  for (Element::_sp e : model.elements()) {
+    e->setRecord(record);
+  }
+  for (Tank::_sp t : model.tanks()) {
+    t->level()->setRecord(record);
+  }
+}
+
+// V1 is shut for two hours in the middle of the run, through its status boundary
+static void scheduleValve(Model& model) {
+  Valve::_sp valve = dynamic_pointer_cast<Valve>(model.linkWithName("V1"));
+  BOOST_REQUIRE(valve);
+  TimeSeries::_sp status(new TimeSeries);
+  status->setName("status,asset=V1");
+  status->setUnits(RTX_DIMENSIONLESS);
+  status->setRecord(PointRecord::_sp(new BufferPointRecord));
+  status->insertPoints({Point(modelStart, 1), Point(modelStart + 2*3600, 0), Point(modelStart + 4*3600, 1)});
+  valve->setStatusBoundary(status);
+}
+
+// T1 is measured at a constant level, and reset to it every two hours
+static void resetTankEveryTwoHours(Model& model) {
+  Tank::_sp tank = dynamic_pointer_cast<Tank>(model.nodeWithName("T1"));
+  BOOST_REQUIRE(tank);
+  TimeSeries::_sp level(new TimeSeries);
+  level->setName("level,asset=T1,measured");
+  level->setUnits(RTX_FOOT);
+  level->setRecord(PointRecord::_sp(new BufferPointRecord));
+  vector<Point> points;
+  for (time_t t = modelStart - 3600; t <= modelStart + 8*3600; t += 3600) {
+    points.push_back(Point(t, 12));
+  }
+  level->insertPoints(points);
+  tank->setLevelMeasure(level);
+  model.setTankResetClock(Clock::_sp(new Clock(2*3600)));
+}
+
+static string readFile(const string& path) {
+  ifstream in(path, ios::binary);
+  return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+static void writeFile(const string& path, const string& bytes) {
+  ofstream out(path, ios::binary | ios::trunc);
+  out << bytes;
+}
+
+// states are saved a step at a time, and a buffer record keeps no more than the last of them
+static PointRecord::_sp memoryRecord() {
+  TestPointRecord::_sp record(new TestPointRecord);
+  record->setConnectionString("memory");
+  record->dbConnect();
+  return record;
+}
+
+////////////////////////
+// model
+BOOST_AUTO_TEST_SUITE(model)
+
+BOOST_AUTO_TEST_CASE(model_ensemble_members) {
+  
+  LocalFiles files({"local-ensemble.inp"});
+  EpanetModel::_sp model(new EpanetModel(writeNetwork("local-ensemble.inp")));
+  model->initEngine();
+  
+  ModelEnsemble ensemble(model);
+  ensemble.setWorkerCount(2);
+  ModelEnsemble::Scenario base("base"), doubled("doubled");
+  doubled.demandMultiplier = 2;
+  base.record = memoryRecord();
+  doubled.record = memoryRecord();
+  ensemble.addScenario(base);
+  ensemble.addScenario(doubled);
+  
+  const TimeRange range(modelStart, modelStart + 5*3600);
+  BOOST_CHECK(ensemble.run(range.start, range.end + 1).empty());
+  
+  // each step's solution is saved, not the state the member started from
+  Junction::_sp j2 = dynamic_pointer_cast<Junction>(model->nodeWithName("J2"));
+  BOOST_REQUIRE(j2);
+  auto baseDemand = base.record->pointsInRange(j2->demand()->name(), range);
+  auto doubledDemand = doubled.record->pointsInRange(j2->demand()->name(), range);
+  BOOST_REQUIRE_EQUAL(baseDemand.size(), 6);
+  BOOST_REQUIRE_EQUAL(doubledDemand.size(), 6);
+  BOOST_CHECK(baseDemand[0].value > 0);
+  BOOST_CHECK_CLOSE(baseDemand[2].value, 1.4 * baseDemand[0].value, 1e-3); // on the pattern
+  for (size_t i = 0; i < baseDemand.size(); ++i) {
+    BOOST_CHECK_EQUAL(baseDemand[i].time, doubledDemand[i].time);
+    BOOST_CHECK_CLOSE(doubledDemand[i].value, 2 * baseDemand[i].value, 1e-3);
+  }
+  
+  // the members' tank levels moved away from the level they started at
+  Tank::_sp t1 = dynamic_pointer_cast<Tank>(model->nodeWithName("T1"));
+  BOOST_REQUIRE(t1);
+  auto levels = doubled.record->pointsInRange(t1->level()->name(), range);
+  BOOST_REQUIRE(!levels.empty());
+  BOOST_CHECK(fabs(levels.back().value - levels.front().value) > 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(model_snapshot_roundtrip) {
+  
+  const string dir("local-snapshots");
+  LocalFiles files({"local-snapshot.inp", dir});
+  boost::filesystem::create_directories(dir);
+  const string path = writeNetwork("local-snapshot.inp");
+  
+  // built from the model file, and written out
+  EpanetModel::_sp built(new EpanetModel(path, dir));
+  measureFlows(*built);
+  built->initDMAs();
+  const string hash = built->modelHash();
+  BOOST_REQUIRE(boost::filesystem::exists(boost::filesystem::path(dir) / (hash + ".elements")));
+  BOOST_REQUIRE(boost::filesystem::exists(boost::filesystem::path(dir) / (hash + ".dmas")));
+  
+  // read back
+  EpanetModel::_sp loaded(new EpanetModel(path, dir));
+  measureFlows(*loaded);
+  loaded->initDMAs();
+  
+  BOOST_CHECK_EQUAL(loaded->junctions().size(), built->junctions().size());
+  BOOST_CHECK_EQUAL(loaded->tanks().size(), built->tanks().size());
+  BOOST_CHECK_EQUAL(loaded->reservoirs().size(), built->reservoirs().size());
+  BOOST_CHECK_EQUAL(loaded->pipes().size(), built->pipes().size());
+  BOOST_CHECK_EQUAL(loaded->pumps().size(), built->pumps().size());
+  BOOST_CHECK_EQUAL(loaded->valves().size(), built->valves().size());
+  BOOST_CHECK_EQUAL(loaded->nodes().size(), 6);
+  BOOST_CHECK_EQUAL(loaded->links().size(), 5);
+  
+  auto builtCurves = built->curves(), loadedCurves = loaded->curves();
+  BOOST_REQUIRE_EQUAL(loadedCurves.size(), builtCurves.size());
+  for (size_t i = 0; i < builtCurves.size(); ++i) {
+    BOOST_CHECK_EQUAL(loadedCurves[i]->name, builtCurves[i]->name);
+    BOOST_CHECK(loadedCurves[i]->curveData == builtCurves[i]->curveData);
+  }
+  Pump::_sp pump = dynamic_pointer_cast<Pump>(loaded->linkWithName("PU1"));
+  BOOST_REQUIRE(pump);
+  BOOST_CHECK(pump->headCurve());
+  
+  BOOST_CHECK(!dmaHashes(*built).empty());
+  BOOST_CHECK(dmaHashes(*loaded) == dmaHashes(*built));
+}
+
+BOOST_AUTO_TEST_CASE(model_snapshot_rejects_bad_files) {
+  
+  const string dir("local-snapshots-bad");
+  LocalFiles files({"local-snapshot-bad.inp", dir});
+  boost::filesystem::create_directories(dir);
+  EpanetModel::_sp model(new EpanetModel(writeNetwork("local-snapshot-bad.inp")));
+  measureFlows(*model);
+  model->initDMAs();
+  const size_t nNodes = model->nodes().size(), nLinks = model->links().size(), nCurves = model->curves().size();
+  
+  const string elementsPath = dir + "/good.elements", dmasPath = dir + "/good.dmas";
+  BOOST_REQUIRE(ModelSnapshot::saveElements(*model, elementsPath, "key"));
+  BOOST_REQUIRE(ModelSnapshot::saveDmas(*model, dmasPath, "key"));
+  const string elements = readFile(elementsPath), dmas = readFile(dmasPath);
+  BOOST_REQUIRE(elements.size() > 16);
+  
+  // truncated
+  writeFile(dir + "/short.elements", elements.substr(0, elements.size() - 10));
+  BOOST_CHECK(!ModelSnapshot::loadElements(*model, dir + "/short.elements", "key"));
+  writeFile(dir + "/short.dmas", dmas.substr(0, dmas.size() - 2));
+  vector<Dma::_sp> loaded;
+  BOOST_CHECK(!ModelSnapshot::loadDmas(*model, dir + "/short.dmas", "key", loaded));
+  
+  // another format version
+  string otherVersion(elements);
+  otherVersion[4] = (char)(otherVersion[4] + 1);
+  writeFile(dir + "/version.elements", otherVersion);
+  BOOST_CHECK(!ModelSnapshot::loadElements(*model, dir + "/version.elements", "key"));
+  
+  // made for another model
+  BOOST_CHECK(!ModelSnapshot::loadElements(*model, elementsPath, "other key"));
+  
+  // a count that the file cannot hold
+  string corrupt(elements);
+  const size_t curveCount = 4 + 4 + 4 + 3; // magic, version, key length, "key"
+  const uint32_t huge = 0x7fffffff;
+  corrupt.replace(curveCount, sizeof(huge), (const char*)&huge, sizeof(huge));
+  writeFile(dir + "/corrupt.elements", corrupt);
+  BOOST_CHECK(!ModelSnapshot::loadElements(*model, dir + "/corrupt.elements", "key"));
+  
+  // nothing was handed to the model along the way
+  BOOST_CHECK_EQUAL(model->nodes().size(), nNodes);
+  BOOST_CHECK_EQUAL(model->links().size(), nLinks);
+  BOOST_CHECK_EQUAL(model->curves().size(), nCurves);
+}
+
+BOOST_AUTO_TEST_CASE(model_checkpoint_restart) {
+  
+  LocalFiles files({"local-checkpoint.inp"});
+  const string path = writeNetwork("local-checkpoint.inp");
+  const time_t end = modelStart + 6*3600, restart = modelStart + 3*3600;
+  
+  // the whole range in one run, with hourly checkpoints
+  EpanetModel::_sp full(new EpanetModel(path));
+  PointRecord::_sp fullRecord = memoryRecord();
+  recordStates(*full, fullRecord);
+  scheduleValve(*full);
+  full->setCheckpointClock(Clock::_sp(new Clock(3600)));
+  full->initEngine();
+  full->runExtendedPeriod(modelStart, end);
+  auto checkpoints = full->checkpoints(TimeRange(restart, restart));
+  BOOST_REQUIRE_EQUAL(checkpoints.size(), 1);
+  
+  // a second engine, moved past the restart by a run of its own, then restarted from the checkpoint
+  EpanetModel::_sp restarted(new EpanetModel(path));
+  scheduleValve(*restarted);
+  restarted->initEngine();
+  restarted->runExtendedPeriod(modelStart, modelStart + 5*3600);
+  PointRecord::_sp restartedRecord = memoryRecord(); // only the restarted run's states
+  recordStates(*restarted, restartedRecord);
+  restarted->addCheckpoint(checkpoints.front());
+  BOOST_CHECK_EQUAL(restarted->restoreNearestCheckpoint(restart), restart);
+  restarted->runExtendedPeriod(restart, end);
+  
+  const TimeRange compared(restart, end);
+  vector<TimeSeries::_sp> fullSeries, restartedSeries;
+  for (const string name : {"T1"}) {
+    fullSeries.push_back(dynamic_pointer_cast<Tank>(full->nodeWithName(name))->level());
+    restartedSeries.push_back(dynamic_pointer_cast<Tank>(restarted->nodeWithName(name))->level());
+  }
+  for (const string name : {"J2", "J3"}) {
+    fullSeries.push_back(dynamic_pointer_cast<Junction>(full->nodeWithName(name))->head());
+    restartedSeries.push_back(dynamic_pointer_cast<Junction>(restarted->nodeWithName(name))->head());
+  }
+  for (const string name : {"V1", "P2", "PU1"}) {
+    fullSeries.push_back(dynamic_pointer_cast<Pipe>(full->linkWithName(name))->flow());
+    restartedSeries.push_back(dynamic_pointer_cast<Pipe>(restarted->linkWithName(name))->flow());
+  }
+  for (size_t i = 0; i < fullSeries.size(); ++i) {
+    auto expected = fullRecord->pointsInRange(fullSeries[i]->name(), compared);
+    auto actual = restartedRecord->pointsInRange(restartedSeries[i]->name(), compared);
+    BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+    BOOST_CHECK(!expected.empty());
+    for (size_t j = 0; j < expected.size(); ++j) {
+      BOOST_CHECK_EQUAL(actual[j].time, expected[j].time);
+      BOOST_CHECK_SMALL(actual[j].value - expected[j].value, 1e-3);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(model_clone_checks_file) {
+
+  LocalFiles files({"local-clone.inp"});
+  const string path = writeNetwork("local-clone.inp");
+  EpanetModel::_sp model(new EpanetModel(path));
+  EpanetModel::_sp engine = model->clone();
+  BOOST_CHECK_EQUAL(engine->nodes().size(), model->nodes().size());
+  BOOST_CHECK_EQUAL(engine->links().size(), model->links().size());
+
+  // the same network with J3 renamed: the copied wrappers would not line up with the file
+  string inp = readFile(path);
+  for (size_t pos = inp.find("J3"); pos != string::npos; pos = inp.find("J3", pos)) {
+    inp.replace(pos, 2, "J9");
+  }
+  writeFile(path, inp);
+  BOOST_CHECK_THROW(model->clone(), RtxException);
+}
+
+BOOST_AUTO_TEST_CASE(model_parallel_retrospective_seams) {
+
+  LocalFiles files({"local-parallel.inp"});
+  const string path = writeNetwork("local-parallel.inp");
+  const TimeRange range(modelStart, modelStart + 6*3600);
+  
+  // the whole range on one engine
+  EpanetModel::_sp sequential(new EpanetModel(path));
+  PointRecord::_sp sequentialRecord = memoryRecord();
+  recordStates(*sequential, sequentialRecord);
+  scheduleValve(*sequential);
+  resetTankEveryTwoHours(*sequential);
+  sequential->initEngine();
+  sequential->runExtendedPeriod(range.start, range.end);
+  
+  // the same range cut at the resets, on two workers
+  EpanetModel::_sp model(new EpanetModel(path));
+  PointRecord::_sp parallelRecord = memoryRecord();
+  recordStates(*model, parallelRecord);
+  scheduleValve(*model);
+  resetTankEveryTwoHours(*model);
+  model->setPipelineDepth(2); // the workers run without read-ahead whatever the model is set to
+  model->initEngine();
+  
+  EpanetModel::_sp engine = model->clone();
+  BOOST_CHECK(engine->tankResetClock() != model->tankResetClock()); // workers do not share clocks
+  BOOST_CHECK_EQUAL(engine->tankResetClock()->period(), model->tankResetClock()->period());
+  engine.reset();
+  
+  ParallelRetrospective retrospective(model);
+  retrospective.setWorkerCount(2);
+  retrospective.setMinimumChunkDuration(2*3600);
+  BOOST_CHECK_EQUAL(retrospective.chunks(range.start, range.end).size(), 3);
+  BOOST_CHECK(retrospective.run(range.start, range.end).empty());
+  
+  // the seams do not show in the results
+  vector<TimeSeries::_sp> sequentialSeries, parallelSeries;
+  for (const string name : {"T1"}) {
+    sequentialSeries.push_back(dynamic_pointer_cast<Tank>(sequential->nodeWithName(name))->level());
+    parallelSeries.push_back(dynamic_pointer_cast<Tank>(model->nodeWithName(name))->level());
+  }
+  for (const string name : {"J2", "J3"}) {
+    sequentialSeries.push_back(dynamic_pointer_cast<Junction>(sequential->nodeWithName(name))->head());
+    parallelSeries.push_back(dynamic_pointer_cast<Junction>(model->nodeWithName(name))->head());
+  }
+  for (const string name : {"V1", "P2", "PU1"}) {
+    sequentialSeries.push_back(dynamic_pointer_cast<Pipe>(sequential->linkWithName(name))->flow());
+    parallelSeries.push_back(dynamic_pointer_cast<Pipe>(model->linkWithName(name))->flow());
+  }
+  for (size_t i = 0; i < sequentialSeries.size(); ++i) {
+    auto expected = sequentialRecord->pointsInRange(sequentialSeries[i]->name(), range);
+    auto actual = parallelRecord->pointsInRange(parallelSeries[i]->name(), range);
+    BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+    BOOST_CHECK(expected.size() > 3);
+    for (size_t j = 0; j < expected.size(); ++j) {
+      BOOST_CHECK_EQUAL(actual[j].time, expected[j].time);
+      BOOST_CHECK_SMALL(actual[j].value - expected[j].value, 1e-3);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+// model
+/////////////////////////
@@ -0,0 +1,40 @@
+#ifdef RTX_WITH_OPC
+
+#include "test_main.h"
+#include "OpcAdapter.h"
+
+using namespace RTX;
+using namespace std;
+
+////////////////////////
+// opc
+BOOST_AUTO_TEST_SUITE(opc)
+
+BOOST_AUTO_TEST_CASE(opc_connection_string) {
+  OpcAdapter adapter([](const std::string){});
+  adapter.setConnectionString("host=plc.local&port=4841&u=operator&p=secret");
+  BOOST_CHECK_EQUAL(adapter.connectionString(), "proto=opc.tcp&host=plc.local&port=4841&u=operator&p=secret");
+}
+
+BOOST_AUTO_TEST_CASE(opc_unreachable) {
+  vector<string> errors;
+  OpcAdapter adapter([&](const std::string msg){ errors.push_back(msg); });
+  adapter.setConnectionString("host=127.0.0.1&port=1"); // nothing listens here
+  adapter.doConnect();
+  BOOST_CHECK(!adapter.adapterConnected());
+  BOOST_CHECK(errors.size() > 0);
+  
+  // reads and subscriptions fail quietly, and tearing down a subscription that never started is safe
+  BOOST_CHECK(!adapter.subscribe({"level"}, [](const string& id, vector<Point>& points){}));
+  adapter.unsubscribe();
+  auto fetch = adapter.selectRanges({"level"}, TimeRange(60, 3600));
+  BOOST_CHECK_EQUAL(fetch.size(), 1);
+  BOOST_CHECK_EQUAL(fetch.at("level").size(), 0);
+  BOOST_CHECK_EQUAL(adapter.selectRange("level", TimeRange(60, 3600)).size(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+// opc
+/////////////////////////
+
+#endif
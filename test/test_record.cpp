@@ -1,9 +1,38 @@
 #include "test_main.h"
 #include "ConcreteDbRecords.h"
+#include "TestAdapter.h"
+#include "LocalFiles.h"
 
 using namespace RTX;
 using namespace std;
 
+// a connected columnar record with an empty store, holding the given points in each named series
+static ColumnarPointRecord::_sp seedColumnar(const string& connection, const vector<string>& names, Units units, const vector<Point>& points, int segmentCapacity = 0) {
+  ColumnarPointRecord::_sp record(new ColumnarPointRecord);
+  record->setConnectionString(connection);
+  if (segmentCapacity > 0) {
+    record->setSegmentCapacity(segmentCapacity);
+  }
+  record->dbConnect();
+  BOOST_REQUIRE(record->isConnected());
+  record->truncate();
+  for (const string& name : names) {
+    BOOST_CHECK(record->registerAndGetIdentifierForSeriesWithUnits(name, units));
+    if (!points.empty()) {
+      record->addPoints(name, points);
+    }
+  }
+  return record;
+}
+
+static vector<Point> evenPoints(time_t start, time_t end, time_t step, double value) {
+  vector<Point> points;
+  for (time_t t = start; t <= end; t += step) {
+    points.push_back(Point(t, value));
+  }
+  return points;
+}
+
 ////////////////////////
 // record
 BOOST_AUTO_TEST_SUITE(record)
@@ -22,6 +51,303 @@ BOOST_AUTO_TEST_CASE(record_basic) {
   BOOST_CHECK_EQUAL(record->connectionString(), connection);
 }
 
+BOOST_AUTO_TEST_CASE(record_columnar) {
+  
+  const string connection("local-columnar");
+  const string seriesName("flow,asset=pump 1");
+  LocalFiles files({connection});
+  
+  {
+    vector<Point> points;
+    for (time_t t = 60; t <= 60*1000; t += 60) {
+      points.push_back(Point(t, (double)t / 60.));
+    }
+    seedColumnar(connection, {seriesName}, RTX_GALLON_PER_MINUTE, points, 500);
+  }
+  
+  // a fresh record has an empty memory cache, so these are served from the mapped columns
+  ColumnarPointRecord::_sp record(new ColumnarPointRecord);
+  record->setConnectionString(connection);
+  record->dbConnect();
+  
+  auto range = record->pointsInRange(seriesName, TimeRange(60*400, 60*600));
+  BOOST_CHECK_EQUAL(range.size(), 201);
+  BOOST_CHECK_EQUAL(range.front().value, 400.);
+  
+  Point before = record->pointBefore(seriesName, 60*1000 + 30);
+  BOOST_CHECK_EQUAL(before.time, 60*1000);
+  
+  Point after = record->pointAfter(seriesName, 60*499 + 1);
+  BOOST_CHECK_EQUAL(after.time, 60*500);
+}
+
+BOOST_AUTO_TEST_CASE(record_columnar_rows) {
+  
+  const string connection("local-columnar-rows");
+  const vector<string> names({"head,asset=junction 1", "head,asset=junction 2"});
+  LocalFiles files({connection});
+  
+  {
+    ColumnarPointRecord::_sp record = seedColumnar(connection, names, RTX_FOOT, {});
+    
+    // interleaved rows, as a model step writes them; the time-zero row is rejected
+    PointRecord::pointRows_t rows;
+    rows.push_back(make_pair(names.front(), Point(0, 1.)));
+    for (time_t t = 60; t <= 60*10; t += 60) {
+      for (const string& name : names) {
+        rows.push_back(make_pair(name, Point(t, 2.)));
+      }
+    }
+    record->addPointRows(rows);
+  }
+  
+  ColumnarPointRecord::_sp record(new ColumnarPointRecord);
+  record->setConnectionString(connection);
+  record->dbConnect();
+  for (const string& name : names) {
+    auto range = record->pointsInRange(name, TimeRange(0, 60*10));
+    BOOST_CHECK_EQUAL(range.size(), 10);
+    BOOST_CHECK_EQUAL(range.front().time, 60);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(record_columnar_torn) {
+  
+  const string connection("local-columnar-torn");
+  const string seriesName("flow,asset=pump 2");
+  LocalFiles files({connection});
+  seedColumnar(connection, {seriesName}, RTX_GALLON_PER_MINUTE, evenPoints(1, 10, 1, 1.));
+  
+  // a crash tore the last write: one more row reached the time column than the others
+  boost::filesystem::path timeColumn;
+  for (auto& entry : boost::filesystem::recursive_directory_iterator(connection)) {
+    if (entry.path().extension() == ".time") {
+      timeColumn = entry.path();
+    }
+  }
+  BOOST_REQUIRE(!timeColumn.empty());
+  {
+    ofstream out(timeColumn.string(), ios::binary | ios::app);
+    int64_t torn = 11;
+    out.write(reinterpret_cast<const char*>(&torn), sizeof(torn));
+  }
+  
+  {
+    ColumnarPointRecord::_sp record(new ColumnarPointRecord);
+    record->setConnectionString(connection);
+    record->dbConnect();
+    BOOST_CHECK_EQUAL(record->pointsInRange(seriesName, TimeRange(1, 30)).size(), 10);
+    record->addPoints(seriesName, {Point(20, 20.), Point(21, 21.), Point(22, 22.)});
+  }
+  
+  // the torn row is gone, and every column took the new rows at the same place
+  ColumnarPointRecord::_sp record(new ColumnarPointRecord);
+  record->setConnectionString(connection);
+  record->dbConnect();
+  auto points = record->pointsInRange(seriesName, TimeRange(1, 30));
+  BOOST_REQUIRE_EQUAL(points.size(), 13);
+  for (const Point& p : points) {
+    BOOST_CHECK_EQUAL(p.value, p.time <= 10 ? 1. : (double)p.time);
+  }
+  BOOST_CHECK_EQUAL(points.back().time, 22);
+}
+
+BOOST_AUTO_TEST_CASE(record_prefetch_chunked) {
+
+  const vector<string> names({"flow,asset=meter 1", "flow,asset=meter 2"});
+  auto seed = [&](TestPointRecord::_sp record) {
+    record->setConnectionString("memory");
+    record->adapter().chunkSize = 25;
+    for (const string& name : names) {
+      for (time_t t = 60; t <= 60*200; t += 60) {
+        record->adapter().series[name].push_back(Point(t, (double)t));
+      }
+    }
+    record->dbConnect();
+    for (const string& name : names) {
+      BOOST_CHECK(record->registerAndGetIdentifierForSeriesWithUnits(name, RTX_DIMENSIONLESS));
+    }
+  };
+
+  // the chunks of each series join into one run in the buffer
+  TestPointRecord::_sp full(new TestPointRecord);
+  seed(full);
+  full->willQuery(TimeRange(60, 60*200));
+  for (const string& name : names) {
+    BOOST_CHECK_EQUAL(full->pointsInRange(name, TimeRange(60*2, 60*199)).size(), 198);
+  }
+  BOOST_CHECK_EQUAL(full->adapter().nRangeQueries, 0);
+
+  // a limited prefetch keeps the earliest points, and reads past them go to the database
+  TestPointRecord::_sp limited(new TestPointRecord);
+  seed(limited);
+  limited->setPrefetchLimit(60);
+  limited->willQuery(TimeRange(60, 60*200));
+  BOOST_CHECK_EQUAL(limited->pointsInRange(names.front(), TimeRange(60*2, 60*50)).size(), 49);
+  BOOST_CHECK_EQUAL(limited->adapter().nRangeQueries, 0);
+  auto all = limited->pointsInRange(names.back(), TimeRange(60*2, 60*199));
+  BOOST_CHECK_EQUAL(all.size(), 198);
+  BOOST_CHECK_EQUAL(all.back().value, 60.*199);
+  BOOST_CHECK(limited->adapter().nRangeQueries > 0);
+}
+
+BOOST_AUTO_TEST_CASE(record_spool) {
+
+  const string connection("local-spooled");
+  const string seriesName("pressure,asset=junction 7");
+  LocalFiles files({connection, "local-spooled-wal"});
+
+  {
+    ColumnarPointRecord::_sp record = seedColumnar(connection, {seriesName}, RTX_PSI, {});
+
+    record->enableWriteSpool("local-spooled-wal", 1 << 20, false);
+    for (time_t t = 60; t <= 60*100; t += 60) {
+      record->addPoint(seriesName, Point(t, 50.));
+    }
+    BOOST_CHECK(record->waitForWriteSpool(10));
+  }
+
+  ColumnarPointRecord::_sp record(new ColumnarPointRecord);
+  record->setConnectionString(connection);
+  record->dbConnect();
+  auto range = record->pointsInRange(seriesName, TimeRange(60, 60*100));
+  BOOST_CHECK_EQUAL(range.size(), 100);
+}
+
+BOOST_AUTO_TEST_CASE(record_spool_buffer) {
+
+  const string seriesName("pressure,asset=junction 8");
+  LocalFiles files({"local-spooled-buffer-wal"});
+  TestPointRecord::_sp record(new TestPointRecord);
+  record->setConnectionString("memory");
+  for (time_t t = 60; t <= 60*100; t += 60) {
+    record->adapter().series[seriesName].push_back(Point(t, 50.));
+  }
+  record->dbConnect();
+  BOOST_CHECK(record->registerAndGetIdentifierForSeriesWithUnits(seriesName, RTX_DIMENSIONLESS));
+  BOOST_CHECK_EQUAL(record->pointsInRange(seriesName, TimeRange(60, 60*100)).size(), 100);
+  const int nQueries = record->adapter().nRangeQueries;
+
+  // spooled single points do not reset the buffered range
+  record->enableWriteSpool("local-spooled-buffer-wal", 1 << 20, false);
+  for (time_t t = 60*101; t <= 60*110; t += 60) {
+    record->addPoint(seriesName, Point(t, 51.));
+  }
+  BOOST_CHECK_EQUAL(record->pointsInRange(seriesName, TimeRange(60*2, 60*99)).size(), 98);
+  BOOST_CHECK_EQUAL(record->adapter().nRangeQueries, nQueries);
+
+  BOOST_CHECK(record->waitForWriteSpool(10));
+  record->disableWriteSpool();
+  BOOST_CHECK_EQUAL(record->adapter().series[seriesName].size(), 110);
+}
+
+BOOST_AUTO_TEST_CASE(record_spool_failing_sink) {
+
+  const string seriesName("pressure,asset=junction 9");
+  LocalFiles files({"local-spooled-failing-wal"});
+  TestPointRecord::_sp record(new TestPointRecord);
+  record->setConnectionString("memory");
+  record->dbConnect();
+  BOOST_CHECK(record->registerAndGetIdentifierForSeriesWithUnits(seriesName, RTX_DIMENSIONLESS));
+
+  // the sink is connected but loses the writes; the spool must not move past them
+  record->adapter().failWrites = true;
+  record->enableWriteSpool("local-spooled-failing-wal", 1 << 20, false);
+  PointRecord::pointRows_t rows;
+  for (const Point& p : evenPoints(60, 60*20, 60, 52.)) {
+    rows.push_back(make_pair(seriesName, p));
+  }
+  record->addPointRows(rows);
+  BOOST_CHECK(!record->waitForWriteSpool(2));
+  record->disableWriteSpool();
+  BOOST_CHECK(record->adapter().series[seriesName].empty());
+
+  // so they are replayed once it recovers
+  record->adapter().failWrites = false;
+  record->enableWriteSpool("local-spooled-failing-wal", 1 << 20, true);
+  BOOST_CHECK(record->waitForWriteSpool(10));
+  record->disableWriteSpool();
+  BOOST_CHECK_EQUAL(record->adapter().series[seriesName].size(), 20);
+  BOOST_CHECK(record->adapter().nRowInserts > 0); // delivered as rows, not a range per spooled point
+}
+
+BOOST_AUTO_TEST_CASE(record_subscribe) {
+
+  const string seriesName("level,asset=tank 3");
+  TestPointRecord::_sp record(new TestPointRecord);
+  record->setConnectionString("memory");
+
+  // nothing to tear down before the adapter has connected
+  record->unsubscribe();
+  BOOST_CHECK_EQUAL(record->adapter().nUnsubscribes, 0);
+
+  record->adapter().series[seriesName];
+  record->dbConnect();
+  BOOST_CHECK(record->registerAndGetIdentifierForSeriesWithUnits(seriesName, RTX_DIMENSIONLESS));
+  BOOST_REQUIRE(record->subscribe({seriesName}));
+  vector<Point> samples({Point(60, 1.), Point(120, 2.)});
+  record->adapter().subscriber(seriesName, samples);
+  BOOST_CHECK_EQUAL(record->point(seriesName, 120).value, 2.);
+
+  record->unsubscribe();
+  BOOST_CHECK_EQUAL(record->adapter().nUnsubscribes, 1);
+}
+
+BOOST_AUTO_TEST_CASE(record_async) {
+
+  const string connection("local-async");
+  const vector<string> names({"level,asset=tank 1", "level,asset=tank 2"});
+  LocalFiles files({connection});
+
+  seedColumnar(connection, names, RTX_FOOT, evenPoints(60, 60*200, 60, 10.));
+
+  ColumnarPointRecord::_sp record(new ColumnarPointRecord);
+  record->setConnectionString(connection);
+  record->dbConnect();
+
+  // both requests are outstanding before either result is collected
+  vector<future<vector<Point> > > pending;
+  for (const string& name : names) {
+    pending.push_back(record->pointsInRangeAsync(name, TimeRange(60*50, 60*100)));
+  }
+  for (auto& f : pending) {
+    BOOST_CHECK_EQUAL(f.get().size(), 51);
+  }
+
+  auto cancel = DbAdapter::newCancelToken();
+  *cancel = true;
+  BOOST_CHECK_EQUAL(record->pointsInRangeAsync(names.front(), TimeRange(60*150, 60*180), cancel).get().size(), 0);
+  
+  // a repeated request is answered from the buffer, as pointsInRange would be
+  BOOST_CHECK_EQUAL(record->pointsInRangeAsync(names.front(), TimeRange(60*60, 60*90)).get().size(), 31);
+}
+
+BOOST_AUTO_TEST_CASE(record_async_iterative) {
+
+  // backends without singly bound queries (PI, ODBC) are searched in windows, as pointBefore and pointAfter do
+  const string seriesName("flow,asset=meter 9");
+  TestPointRecord::_sp record(new TestPointRecord);
+  record->setConnectionString("memory");
+  record->adapter().opts.searchIteratively = true;
+  record->adapter().opts.supportsSinglyBoundQuery = false;
+  record->adapter().opts.canDoWideQuery = false;
+  record->adapter().series[seriesName] = evenPoints(60*60*10, 60*60*12, 60*60, 5.);
+  record->dbConnect();
+  BOOST_CHECK(record->registerAndGetIdentifierForSeriesWithUnits(seriesName, RTX_DIMENSIONLESS));
+
+  const time_t before = 60*60*10 + 60*60*7; // two windows after the last point
+  BOOST_CHECK_EQUAL(record->pointBeforeAsync(seriesName, before).get().time, 60*60*12);
+  BOOST_CHECK_EQUAL(record->pointAfterAsync(seriesName, 60*30).get().time, 60*60*10);
+  BOOST_CHECK_EQUAL(record->pointBefore(seriesName, before).time, 60*60*12);
+
+  // nothing within the search depth
+  BOOST_CHECK(!record->pointAfterAsync(seriesName, 60*60*13).get().isValid);
+
+  auto cancel = DbAdapter::newCancelToken();
+  *cancel = true;
+  BOOST_CHECK(!record->pointAfterAsync(seriesName, 60*60*24*30, cancel).get().isValid);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 // record
 /////////////////////////
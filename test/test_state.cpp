@@ -0,0 +1,74 @@
+#include "test_main.h"
+#include "NetworkState.h"
+
+#include <sstream>
+
+using namespace RTX;
+using namespace std;
+
+////////////////////////
+// state
+BOOST_AUTO_TEST_SUITE(state)
+
+BOOST_AUTO_TEST_CASE(state_roundtrip) {
+  
+  NetworkState state(3, 1, 2, 4);
+  state.time = 1520749815;
+  double v = 0;
+  for (double& x : state.junctionHead) { x = ++v; }
+  for (double& x : state.tankLevel) { x = ++v; }
+  for (double& x : state.linkFlow) { x = ++v; }
+  state.linkStatus[2] = 1.;
+  
+  stringstream buf;
+  state.serialize(buf);
+  NetworkState read;
+  BOOST_REQUIRE(NetworkState::deserialize(buf, read));
+  BOOST_CHECK_EQUAL(read.time, state.time);
+  BOOST_CHECK(read.sameShapeAs(state));
+  BOOST_CHECK_EQUAL(read.junctionCount(), 3);
+  BOOST_CHECK_EQUAL(read.linkCount(), 4);
+  BOOST_CHECK_EQUAL(read.maxAbsDifference(state), 0.);
+  BOOST_CHECK_EQUAL(read.linkStatus[2], 1.);
+  
+  // back to back, as a state file holds them
+  stringstream two;
+  state.serialize(two);
+  state.time += 60;
+  state.serialize(two);
+  BOOST_REQUIRE(NetworkState::deserialize(two, read));
+  BOOST_REQUIRE(NetworkState::deserialize(two, read));
+  BOOST_CHECK_EQUAL(read.time, state.time);
+  BOOST_CHECK(!NetworkState::deserialize(two, read));
+}
+
+BOOST_AUTO_TEST_CASE(state_rejects_bad_input) {
+  
+  NetworkState state(2, 0, 1, 2);
+  stringstream buf;
+  state.serialize(buf);
+  const string bytes = buf.str();
+  NetworkState read;
+  
+  // truncated
+  stringstream shortBuf(bytes.substr(0, bytes.size() - 4));
+  BOOST_CHECK(!NetworkState::deserialize(shortBuf, read));
+  
+  // an element count far past the end of the data is rejected before anything is allocated for it
+  string corrupt(bytes);
+  const size_t firstLength = 4 + 4 + 8 + 4;
+  const uint64_t huge = (uint64_t)1 << 40;
+  corrupt.replace(firstLength, sizeof(huge), (const char*)&huge, sizeof(huge));
+  stringstream corruptBuf(corrupt);
+  BOOST_CHECK(!NetworkState::deserialize(corruptBuf, read));
+  
+  // wrong magic
+  string notState(bytes);
+  notState[0] = 'X';
+  stringstream notStateBuf(notState);
+  BOOST_CHECK(!NetworkState::deserialize(notStateBuf, read));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+// state
+/////////////////////////
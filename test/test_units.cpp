@@ -1,5 +1,6 @@
 #include "test_main.h"
 #include "Units.h"
+#include "PointRecordTime.h"
 
 using namespace RTX;
 using namespace std;
@@ -30,6 +31,51 @@ BOOST_AUTO_TEST_CASE(units_convert_nan) {
   
 }
 
+BOOST_AUTO_TEST_CASE(units_time_iso8601) {
+  
+  const time_t t = PointRecordTime::timeFromCivil(2018, 3, 11, 6, 30, 15);
+  BOOST_CHECK_EQUAL(t, 1520749815);
+  BOOST_CHECK_EQUAL(PointRecordTime::timeFromIso8601("2018-03-11T06:30:15Z"), t);
+  BOOST_CHECK_EQUAL(PointRecordTime::timeFromIso8601("2018-03-11 06:30:15"), t);
+  BOOST_CHECK_EQUAL(PointRecordTime::timeFromIso8601("2018-03-11T06:30:15.875Z"), t);
+  BOOST_CHECK_EQUAL(PointRecordTime::timeFromIso8601("2018-03-11T01:30:15-05:00"), t);
+  BOOST_CHECK_EQUAL(PointRecordTime::timeFromIso8601("2018-03-11T12:00:15+0530"), t);
+  BOOST_CHECK_EQUAL(PointRecordTime::timeFromIso8601("2018-03-11T07:30:15+01"), t);
+}
+
+BOOST_AUTO_TEST_CASE(units_time_dst) {
+  
+  using boost::local_time::time_zone_ptr;
+  using boost::local_time::posix_time_zone;
+  time_zone_ptr eastern(new posix_time_zone("EST-05EDT,M3.2.0,M11.1.0"));
+  auto zone = PointRecordTime::zoneOffsets(eastern);
+  auto local = [](int mo, int d, int h, int mi) { return PointRecordTime::timeFromCivil(2018, mo, d, h, mi, 0); };
+  const time_t hour = 3600;
+  
+  // daylight time starts at 2018-03-11 02:00 EST, which is 07:00 UTC
+  BOOST_CHECK_EQUAL(zone->utcFromLocal(local(3, 11, 1, 59)), local(3, 11, 6, 59));
+  BOOST_CHECK_EQUAL(zone->utcFromLocal(local(3, 11, 3, 0)), local(3, 11, 7, 0));
+  BOOST_CHECK_EQUAL(zone->localFromUtc(local(3, 11, 6, 59)), local(3, 11, 1, 59));
+  BOOST_CHECK_EQUAL(zone->localFromUtc(local(3, 11, 7, 0)), local(3, 11, 3, 0));
+  // the skipped hour reads as standard time
+  BOOST_CHECK_EQUAL(zone->utcFromLocal(local(3, 11, 2, 30)), local(3, 11, 2, 30) + 5*hour);
+  
+  // and ends at 2018-11-04 02:00 EDT, which is 06:00 UTC; the repeated hour resolves to daylight time
+  BOOST_CHECK_EQUAL(zone->utcFromLocal(local(11, 4, 0, 59)), local(11, 4, 4, 59));
+  BOOST_CHECK_EQUAL(zone->utcFromLocal(local(11, 4, 1, 30)), local(11, 4, 5, 30));
+  BOOST_CHECK_EQUAL(zone->utcFromLocal(local(11, 4, 2, 0)), local(11, 4, 7, 0));
+  BOOST_CHECK_EQUAL(zone->localFromUtc(local(11, 4, 5, 59)), local(11, 4, 1, 59));
+  BOOST_CHECK_EQUAL(zone->localFromUtc(local(11, 4, 6, 0)), local(11, 4, 1, 0));
+  
+  // the tabulated offsets agree with boost across the year
+  for (time_t utc = local(1, 1, 0, 0); utc < local(12, 31, 0, 0); utc += 7*hour + 13*60) {
+    boost::local_time::local_date_time ldt(boost::posix_time::from_time_t(utc), eastern);
+    const time_t expected = (ldt.local_time() - boost::posix_time::ptime(boost::gregorian::date(1970,1,1))).total_seconds();
+    BOOST_CHECK_EQUAL(zone->localFromUtc(utc), expected);
+    BOOST_CHECK_EQUAL(zone->localFromUtc(zone->utcFromLocal(expected)), expected);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 // units
 /////////////////////////